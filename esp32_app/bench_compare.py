@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""Compare two microbenchmark result files (JSON lines from src/bench.cpp).
+
+Save a baseline, change the code, run again and compare:
+
+    curl -o before.jsonl http://<esp32-ip>/api/bench
+    .pio/build/native/program --bench > before.jsonl      # or on the host
+    python3 esp32_app/bench_compare.py before.jsonl after.jsonl
+
+Compares ns_median per case (cycles_median when both runs are from the
+device). Exits with status 1 when any case is slower than --threshold
+percent, so it can gate a script or CI job. Results from different targets
+are not comparable and are refused.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    header, cases = None, {}
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line:
+                continue
+            record = json.loads(line)
+            if "suite" in record:
+                header = record
+            elif "error" in record:
+                print("%s: %s not run: %s" % (path, record.get("bench"), record["error"]))
+            elif "bench" in record:
+                cases[record["bench"]] = record
+    if header is None:
+        sys.exit("%s: no suite header, not a benchmark result file" % path)
+    return header, cases
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("before")
+    parser.add_argument("after")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="percent slowdown reported as a regression (default 10)")
+    args = parser.parse_args()
+
+    before_header, before = load(args.before)
+    after_header, after = load(args.after)
+    if before_header["target"] != after_header["target"]:
+        sys.exit("cannot compare %s results with %s results" %
+                 (before_header["target"], after_header["target"]))
+
+    metric = "cycles_median" if before_header["target"] == "esp32" else "ns_median"
+    print("%-20s %14s %14s %8s" % ("bench", "before", "after", "change"))
+
+    regressions = 0
+    for name in sorted(set(before) | set(after)):
+        if name not in before or name not in after:
+            print("%-20s %s" % (name, "only in " + (args.before if name in before else args.after)))
+            continue
+        old, new = before[name][metric], after[name][metric]
+        change = (new - old) * 100.0 / old if old else 0.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        print("%-20s %14.1f %14.1f %+7.1f%%%s" % (name, old, new, change, flag))
+
+    if regressions:
+        print("%d case(s) slower than %.0f%%" % (regressions, args.threshold))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,22 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <Arduino.h>
+
+// Microbenchmarks for the ingestion and serialization hot paths. Every case
+// runs against a fixed dataset (its own SystemState, filled the same way
+// each time) so results can be compared across commits. Output is one JSON
+// object per line: a header, then one line per case with per-operation
+// times:
+//
+//   {"suite":"surveillance","version":1,"target":"esp32","cpu_mhz":240,"runs":5}
+//   {"bench":"pi_json","iterations":50,"ns_median":..,"ns_min":..,"cycles_median":..,"bytes":0}
+//
+// Cycles come from the CCOUNT register on the ESP32 and are 0 on the host.
+// Run with GET /api/bench on the device or `program --bench` in env:native,
+// and compare two result files with bench_compare.py.
+
+// Runs the cases whose name contains filter (nullptr = all); returns how many ran
+int runBenchmarks(Print& out, const char* filter = nullptr);
+
+#endif // BENCH_H
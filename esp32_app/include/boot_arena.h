@@ -0,0 +1,45 @@
+#ifndef BOOT_ARENA_H
+#define BOOT_ARENA_H
+
+#include <Arduino.h>
+#include <new>
+#include <utility>
+
+#ifndef BOOT_ARENA_SIZE
+#define BOOT_ARENA_SIZE 12288
+#endif
+
+// Static storage for the objects modules create once in begin(): network
+// clients, the web server, notification workers. The arena is part of .bss,
+// so its size is known at link time. Space is never reclaimed; destroy()
+// only runs the destructor. After seal() at the end of setup() create()
+// fails instead of quietly growing memory use at runtime.
+class BootArena {
+public:
+  template <typename T, typename... Args>
+  T* create(const char* what, Args&&... args) {
+    void* slot = allocate(what, sizeof(T), alignof(T));
+    return slot ? new (slot) T(std::forward<Args>(args)...) : nullptr;
+  }
+
+  template <typename T>
+  void destroy(T* object) {
+    if (object) object->~T();
+  }
+
+  void seal();
+  bool isSealed() const { return sealed; }
+  size_t used() const { return offset; }
+  static constexpr size_t size() { return BOOT_ARENA_SIZE; }
+
+private:
+  alignas(8) uint8_t storage[BOOT_ARENA_SIZE];
+  size_t offset = 0;
+  bool sealed = false;
+
+  void* allocate(const char* what, size_t length, size_t align);
+};
+
+extern BootArena bootArena;
+
+#endif // BOOT_ARENA_H
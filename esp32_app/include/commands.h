@@ -0,0 +1,65 @@
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include <Arduino.h>
+
+// Transports a command can arrive on (CommandSpec::channels bit mask)
+#define CMD_UART     0x01
+#define CMD_MQTT     0x02
+#define CMD_TELEGRAM 0x04
+#define CMD_HTTP     0x08
+#define CMD_ALL      (CMD_UART | CMD_MQTT | CMD_TELEGRAM | CMD_HTTP)
+// Channels a person sends from; the Pi link is not one of them
+#define CMD_REMOTE   (CMD_MQTT | CMD_TELEGRAM | CMD_HTTP)
+
+enum class CommandArg : uint8_t { None, Number, Text };
+
+// Parsed argument, pointing into the caller's line (no copies)
+struct CommandArgs {
+  bool present = false;
+  float number = 0;
+  const char* text = "";
+};
+
+// Filled in by the handler; each transport sends text back its own way
+struct CommandReply {
+  String text;
+  bool ok = true;
+  bool restart = false;   // reply first, then call commands.complete()
+};
+
+// One table of commands shared by the Pi UART link, MQTT, Telegram and the
+// HTTP API. Lines look like "name", "name arg", "NAME:arg" or "/name@bot arg";
+// names are case-insensitive. Lookup is a single probe into a perfect hash
+// table built at compile time, followed by one name check.
+class CommandRegistry {
+public:
+  CommandRegistry();
+
+  // Parse and run one NUL-terminated line; false when the command is
+  // unknown, not allowed on this channel, or its argument doesn't parse
+  bool dispatch(uint8_t channel, const char* line, CommandReply& reply);
+
+  // Finish a command after its reply went out (deferred restart)
+  void complete(const CommandReply& reply);
+
+  // Main loop: carry out a deferred restart once it is due
+  void handle();
+
+  // Help text listing the commands available on a channel
+  String help(uint8_t channel) const;
+
+  unsigned long dispatchedCount() const { return dispatched; }
+  unsigned long rejectedCount() const { return rejected; }
+
+private:
+  static const unsigned long RESTART_DELAY_MS = 3000;
+
+  unsigned long restartAt;
+  unsigned long dispatched;
+  unsigned long rejected;
+};
+
+extern CommandRegistry commands;
+
+#endif // COMMANDS_H
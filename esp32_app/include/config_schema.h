@@ -0,0 +1,176 @@
+#ifndef CONFIG_SCHEMA_H
+#define CONFIG_SCHEMA_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <stddef.h>
+#include <type_traits>
+#include "config.h"
+
+// Single description of every AppConfig field. Defaults, persistence,
+// JSON encode/decode and the settings form are all driven from this table.
+
+enum class ConfigType : uint8_t { Bool, Int, ULong, Float, String };
+
+// Field flags
+#define CFG_PERSIST 0x01  // stored in the NVS config blob
+#define CFG_FORM    0x02  // shown on the settings page
+#define CFG_SECRET  0x04  // never echoed back; an empty submission keeps the value
+
+struct ConfigField {
+  const char* key;          // JSON/form name, also the legacy per-key NVS name
+  const char* label;
+  ConfigType type;
+  uint16_t offset;          // within AppConfig
+  uint16_t size;            // bytes, string capacity for ConfigType::String
+  double defaultValue;      // user units (see scale)
+  const char* defaultText;  // ConfigType::String only
+  double minValue;          // user units
+  double maxValue;
+  uint16_t scale;           // stored value = user value * scale
+  uint8_t flags;
+};
+
+template <typename T> struct ConfigTypeOf;
+template <> struct ConfigTypeOf<bool> { static constexpr ConfigType value = ConfigType::Bool; };
+template <> struct ConfigTypeOf<int> { static constexpr ConfigType value = ConfigType::Int; };
+template <> struct ConfigTypeOf<unsigned long> { static constexpr ConfigType value = ConfigType::ULong; };
+template <> struct ConfigTypeOf<float> { static constexpr ConfigType value = ConfigType::Float; };
+template <size_t N> struct ConfigTypeOf<char[N]> { static constexpr ConfigType value = ConfigType::String; };
+
+#define CFG_MEMBER_TYPE(path) typename std::remove_reference<decltype(((AppConfig*)nullptr)->path)>::type
+
+#define CFG_VALUE(path, key, label, def, lo, hi, scale, flags) \
+  { key, label, ConfigTypeOf<CFG_MEMBER_TYPE(path)>::value, offsetof(AppConfig, path), \
+    sizeof(CFG_MEMBER_TYPE(path)), def, nullptr, lo, hi, scale, flags }
+
+#define CFG_TEXT(path, key, label, def, flags) \
+  { key, label, ConfigType::String, offsetof(AppConfig, path), \
+    sizeof(CFG_MEMBER_TYPE(path)), 0, def, 0, 0, 1, flags }
+
+constexpr ConfigField CONFIG_FIELDS[] = {
+  // Hardware pins
+  CFG_VALUE(hardware.uart_rx_pin,    "uart_rx_pin",  "UART RX Pin", 16, 0, 39, 1, CFG_PERSIST),
+  CFG_VALUE(hardware.uart_tx_pin,    "uart_tx_pin",  "UART TX Pin", 17, 0, 39, 1, CFG_PERSIST),
+  CFG_VALUE(hardware.spi_cs_pin,     "spi_cs_pin",   "SPI CS Pin", 5, 0, 39, 1, CFG_PERSIST),
+  CFG_VALUE(hardware.spi_mosi_pin,   "spi_mosi_pin", "SPI MOSI Pin", 23, 0, 39, 1, CFG_PERSIST),
+  CFG_VALUE(hardware.spi_miso_pin,   "spi_miso_pin", "SPI MISO Pin", 19, 0, 39, 1, CFG_PERSIST),
+  CFG_VALUE(hardware.spi_sck_pin,    "spi_sck_pin",  "SPI SCK Pin", 18, 0, 39, 1, CFG_PERSIST),
+  CFG_VALUE(hardware.status_led_pin, "led_pin",      "Status LED Pin", 2, 0, 39, 1, CFG_PERSIST),
+  CFG_VALUE(hardware.trigger_pin,    "trigger_pin",  "Trigger Pin", 4, 0, 39, 1, CFG_PERSIST),
+  CFG_VALUE(hardware.echo_pin,       "echo_pin",     "Echo Pin", 15, 0, 39, 1, CFG_PERSIST),
+  CFG_VALUE(hardware.i2c_sda_pin,    "i2c_sda_pin",  "I2C SDA Pin", 21, 0, 39, 1, CFG_PERSIST),
+  CFG_VALUE(hardware.i2c_scl_pin,    "i2c_scl_pin",  "I2C SCL Pin", 22, 0, 39, 1, CFG_PERSIST),
+
+  // WiFi
+  CFG_VALUE(wifi.enable_station_mode, "enable_station", "WiFi Station Mode", 1, 0, 1, 1, CFG_PERSIST | CFG_FORM),
+  CFG_TEXT(wifi.sta_ssid,             "sta_ssid",       "WiFi SSID", "", CFG_PERSIST | CFG_FORM),
+  CFG_TEXT(wifi.sta_password,         "sta_password",   "WiFi Password", "", CFG_PERSIST | CFG_FORM | CFG_SECRET),
+  CFG_TEXT(wifi.ap_ssid,              "ap_ssid",        "Access Point SSID", "surveillance_system", CFG_PERSIST),
+  CFG_TEXT(wifi.ap_password,          "ap_password",    "Access Point Password", "password", CFG_PERSIST | CFG_SECRET),
+  CFG_VALUE(wifi.connection_timeout,  "wifi_timeout",   "WiFi Timeout (ms)", 10000, 1000, 60000, 1, CFG_PERSIST),
+
+  // System
+  CFG_VALUE(system.enable_web_server,    "web_server",      "Web Server", 1, 0, 1, 1, CFG_PERSIST),
+  CFG_VALUE(system.distance_threshold,   "threshold",       "Distance Threshold (cm)", 40.0, 1, 400, 1, CFG_PERSIST | CFG_FORM),
+  CFG_VALUE(system.alert_cooldown,       "cooldown",        "Alert Cooldown (seconds)", 30, 1, 3600, 1000, CFG_PERSIST | CFG_FORM),
+  CFG_VALUE(system.web_refresh_interval, "refresh",         "Dashboard Refresh (seconds)", 2, 1, 60, 1, CFG_PERSIST | CFG_FORM),
+  CFG_VALUE(system.enable_data_logging,  "data_logging",    "Data Logging", 1, 0, 1, 1, CFG_PERSIST | CFG_FORM),
+  CFG_VALUE(system.history_size,         "history_size",    "History Size", 100, 1, 100, 1, CFG_PERSIST),
+  CFG_VALUE(system.sensor_read_interval, "sensor_interval", "Sensor Interval (ms)", 500, 10, 60000, 1, CFG_PERSIST),
+  CFG_VALUE(system.enable_uart,          "uart",            "UART Link", 1, 0, 1, 1, CFG_PERSIST),
+  CFG_VALUE(system.enable_spi,           "spi",             "SPI Link", 1, 0, 1, 1, CFG_PERSIST),
+  CFG_VALUE(system.spi_clock_speed,      "spi_clock",       "SPI Clock (Hz)", 1000000, 100000, 20000000, 1, CFG_PERSIST),
+
+  // Telegram
+  CFG_VALUE(telegram.enable_telegram, "telegram",    "Telegram Alerts", 0, 0, 1, 1, CFG_PERSIST | CFG_FORM),
+  CFG_TEXT(telegram.bot_token,        "bot_token",   "Telegram Bot Token", "", CFG_PERSIST | CFG_FORM | CFG_SECRET),
+  CFG_TEXT(telegram.chat_id,          "chat_id",     "Telegram Chat ID", "", CFG_PERSIST | CFG_FORM),
+  CFG_VALUE(telegram.check_interval,  "tg_interval", "Telegram Poll Interval (ms)", 5000, 1000, 600000, 1, CFG_PERSIST),
+  CFG_VALUE(telegram.long_poll,       "tg_long_poll", "Telegram Long Poll (seconds)", 25, 0, 50, 1, CFG_PERSIST),
+  CFG_TEXT(telegram.api_server,       "tg_api_server", "Telegram API Server (testing)", "", CFG_PERSIST),
+
+  // MQTT
+  CFG_VALUE(mqtt.enable_mqtt, "mqtt",          "MQTT", 0, 0, 1, 1, CFG_PERSIST | CFG_FORM),
+  CFG_TEXT(mqtt.server,       "mqtt_server",   "MQTT Server", "mqtt.broker.com", CFG_PERSIST | CFG_FORM),
+  CFG_VALUE(mqtt.port,        "mqtt_port",     "MQTT Port", 1883, 1, 65535, 1, CFG_PERSIST | CFG_FORM),
+  CFG_TEXT(mqtt.topic,        "mqtt_topic",    "MQTT Topic", "esp32/surveillance", CFG_PERSIST | CFG_FORM),
+  CFG_TEXT(mqtt.username,     "mqtt_user",     "MQTT Username", "", CFG_PERSIST | CFG_FORM),
+  CFG_TEXT(mqtt.password,     "mqtt_password", "MQTT Password", "", CFG_PERSIST | CFG_FORM | CFG_SECRET),
+  CFG_VALUE(mqtt.enable_telemetry, "mqtt_telemetry", "MQTT Telemetry", 1, 0, 1, 1, CFG_PERSIST | CFG_FORM),
+
+  // Webhook
+  CFG_VALUE(webhook.enable_webhook, "webhook",     "Webhook Alerts", 0, 0, 1, 1, CFG_PERSIST | CFG_FORM),
+  CFG_TEXT(webhook.url,             "webhook_url", "Webhook URL", "", CFG_PERSIST | CFG_FORM),
+  CFG_VALUE(webhook.report_readings, "webhook_data", "Webhook Readings", 0, 0, 1, 1, CFG_PERSIST | CFG_FORM),
+
+  // Telemetry reporting (MQTT and webhook readings)
+  CFG_VALUE(report.deadband,  "report_band", "Report Deadband (cm)", 2.0, 0, 100, 1, CFG_PERSIST | CFG_FORM),
+  CFG_VALUE(report.heartbeat, "report_beat", "Report Heartbeat (seconds)", 300, 10, 86400, 1, CFG_PERSIST | CFG_FORM),
+
+  // Raspberry Pi link
+  CFG_VALUE(raspberry_pi.enable_communication, "pi_comm",      "Pi Communication", 1, 0, 1, 1, CFG_PERSIST),
+  CFG_VALUE(raspberry_pi.uart_baud_rate,       "pi_baud",      "Pi UART Baud", 115200, 1200, 2000000, 1, CFG_PERSIST),
+  CFG_VALUE(raspberry_pi.spi_transfer_size,    "pi_spi_size",  "Pi SPI Transfer Size", 4096, 1, 65536, 1, CFG_PERSIST),
+  CFG_VALUE(raspberry_pi.heartbeat_interval,   "pi_heartbeat", "Pi Heartbeat (ms)", 5000, 100, 600000, 1, CFG_PERSIST),
+  CFG_VALUE(raspberry_pi.connection_timeout,   "pi_timeout",   "Pi Timeout (ms)", 10000, 100, 600000, 1, CFG_PERSIST),
+};
+
+constexpr size_t CONFIG_FIELD_COUNT = sizeof(CONFIG_FIELDS) / sizeof(CONFIG_FIELDS[0]);
+
+// Blob records are tagged with a 16-bit hash of the key
+constexpr uint16_t configKeyHash(const char* key) {
+  uint32_t hash = 2166136261u;
+  for (; *key; key++) hash = (hash ^ (uint8_t)*key) * 16777619u;
+  return (hash >> 16) ^ (hash & 0xFFFF);
+}
+
+constexpr size_t configKeyLength(const char* key) {
+  size_t length = 0;
+  while (key[length]) length++;
+  return length;
+}
+
+constexpr bool configKeysUnique() {
+  for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+    for (size_t j = i + 1; j < CONFIG_FIELD_COUNT; j++) {
+      if (configKeyHash(CONFIG_FIELDS[i].key) == configKeyHash(CONFIG_FIELDS[j].key)) return false;
+    }
+    // NVS keys are limited to 15 characters
+    if (configKeyLength(CONFIG_FIELDS[i].key) > 15) return false;
+  }
+  return true;
+}
+static_assert(configKeysUnique(), "config keys must be unique, hash-distinct and at most 15 chars");
+
+// Upper bound for the encoded blob: header + (4-byte record header + value) per field
+constexpr size_t configBlobCapacity() {
+  size_t total = 12;
+  for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) total += 4 + CONFIG_FIELDS[i].size;
+  return total;
+}
+
+class ConfigSchema {
+public:
+  static void applyDefaults(AppConfig& cfg);
+
+  // Versioned, self-describing blob: fields are matched by key on decode,
+  // so adding, removing or reordering fields keeps the remaining values
+  static size_t encodeBlob(const AppConfig& cfg, uint8_t* buffer, size_t capacity);
+  static bool decodeBlob(AppConfig& cfg, const uint8_t* buffer, size_t length);
+
+  // Secrets are reported only as set/unset
+  static void toJson(const AppConfig& cfg, JsonObject obj);
+  // Applies the keys present in obj; false (with a message) on the first invalid value
+  static bool fromJson(AppConfig& cfg, JsonObjectConst obj, String& error);
+
+  static bool fieldEquals(const ConfigField& field, const AppConfig& a, const AppConfig& b);
+  // Current value of a ConfigType::String field ("" for other types), and of
+  // a numeric or bool field in user units
+  static const char* textValue(const ConfigField& field, const AppConfig& cfg);
+  static double numberValue(const ConfigField& field, const AppConfig& cfg);
+
+  static const ConfigField* find(const char* key);
+};
+
+#endif // CONFIG_SCHEMA_H
@@ -0,0 +1,56 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Owns changes to the global config. Edits from any task are staged here,
+// published on the main loop as a new live version (see config()), and
+// written to NVS only after edits have been quiet for a debounce period,
+// and only when a persisted field actually differs from what is stored.
+class ConfigStore {
+public:
+  ConfigStore();
+
+  // Call once after the config has been loaded from NVS
+  void begin();
+
+  // Latest accepted config (including staged edits), copied under the lock
+  void current(AppConfig& out);
+
+  // Queue an already-validated config; safe from web/async tasks
+  void stage(const AppConfig& updated);
+
+  // Main loop: apply staged edits, persist once the debounce expires
+  void handle();
+
+  // Persist immediately (e.g. before a restart)
+  void flush();
+
+  unsigned long writeCount() const { return writes; }
+  unsigned long coalescedCount() const { return coalesced; }
+
+  // Least time between two publishes, so a reader that took config() just
+  // before one is done before its buffer is reused
+  static const unsigned long PUBLISH_GAP_MS = 1000;
+
+private:
+  static const unsigned long DEBOUNCE_MS = 3000;
+
+  portMUX_TYPE lock;
+  AppConfig pending;
+  AppConfig persisted;      // what NVS currently holds
+  bool hasPending;
+  bool dirty;               // live config differs from NVS
+  unsigned long lastEdit;
+  unsigned long lastPublish;
+  unsigned long writes;
+  unsigned long coalesced;  // edits absorbed into a later write
+
+  void apply(bool force);
+  void persist();
+};
+
+extern ConfigStore configStore;
+
+#endif // CONFIG_STORE_H
@@ -0,0 +1,66 @@
+#ifndef FIXED_STRING_H
+#define FIXED_STRING_H
+
+#include <Arduino.h>
+
+// NUL-terminated text in a fixed array, for long-lived members that String
+// would keep reallocating (status lines, the Pi line buffer). Never touches
+// the heap; text that doesn't fit is cut at a UTF-8 character boundary.
+template <size_t N>
+class FixedString {
+  static_assert(N > 1 && N <= 65535, "FixedString size must fit a uint16_t");
+
+public:
+  FixedString() : len(0) { text[0] = '\0'; }
+  FixedString(const char* value) { assign(value); }
+
+  FixedString& operator=(const char* value) {
+    assign(value);
+    return *this;
+  }
+
+  void assign(const char* value) {
+    size_t length = strnlen(value, N);
+    if (length > N - 1) {
+      length = N - 1;
+      while (length > 0 && (value[length] & 0xC0) == 0x80) length--;
+    }
+    memcpy(text, value, length);
+    text[length] = '\0';
+    len = length;
+  }
+
+  // False (and nothing appended) when full
+  bool append(char c) {
+    if (len == N - 1) return false;
+    text[len++] = c;
+    text[len] = '\0';
+    return true;
+  }
+
+  void truncate(size_t length) {
+    if (length >= len) return;
+    len = length;
+    text[len] = '\0';
+  }
+
+  void clear() {
+    len = 0;
+    text[0] = '\0';
+  }
+
+  const char* c_str() const { return text; }
+  size_t length() const { return len; }
+  bool isEmpty() const { return len == 0; }
+  bool full() const { return len == N - 1; }
+  static constexpr size_t capacity() { return N - 1; }
+
+  bool operator==(const char* other) const { return strcmp(text, other) == 0; }
+  bool operator!=(const char* other) const { return strcmp(text, other) != 0; }
+
+private:
+  char text[N];
+  uint16_t len;
+};
+
+#endif // FIXED_STRING_H
@@ -0,0 +1,117 @@
+#ifndef HEAP_PROFILER_H
+#define HEAP_PROFILER_H
+
+#include <Arduino.h>
+
+// Heap gauges, plus per-tag allocation tracking when built with
+// -DHEAP_PROFILE (env:esp32-heapprof on the device, always in env:native).
+//
+// Code names the source of its allocations with HEAP_TAG("name") at the top
+// of a scope. Everything the current task allocates until the scope ends is
+// counted under that name; untagged allocations count as "other". Each tag
+// has allocations, frees, live blocks and bytes, peak and total bytes, the
+// average lifetime of freed blocks, and how many live blocks are older than
+// LONG_LIVED_MS. Long-lived blocks allocated in between short-lived ones are
+// what splits the heap, so watch those next to the largest-free-block gauge.
+//
+// On the ESP32 malloc/free/realloc/calloc are wrapped at link time, which
+// also covers String and operator new. On the host, operator new/delete are
+// replaced. Live blocks are kept in a fixed table; blocks that don't fit
+// are counted as untracked.
+//
+// Allocations are also counted per task, which is what -DZERO_HEAP builds
+// check: a Scheduler with requireZeroHeap() aborts when one of its jobs
+// allocates after boot. HEAP_EXEMPT() marks a scope whose allocations are
+// expected (starting a diagnostic tool) and left out of that count.
+
+#if defined(ZERO_HEAP) && !defined(HEAP_PROFILE)
+#error "ZERO_HEAP needs the HEAP_PROFILE allocation hooks"
+#endif
+
+struct HeapGauges {
+  uint32_t freeBytes;
+  uint32_t minFreeBytes;   // low-water mark since boot
+  uint32_t largestBlock;
+  uint8_t fragmentation;   // % of the free heap not usable as one block
+};
+
+struct HeapTagStats {
+  const char* name;
+  uint32_t allocs;
+  uint32_t frees;
+  uint32_t liveBlocks;
+  uint32_t liveBytes;
+  uint32_t peakBytes;
+  uint64_t totalBytes;
+  uint64_t lifetimeMs;     // summed over freed blocks
+  uint32_t longLived;      // live blocks older than LONG_LIVED_MS
+};
+
+class HeapProfiler {
+public:
+  static const int MAX_TAGS = 16;
+  static const unsigned long LONG_LIVED_MS = 60000;
+
+  static HeapGauges gauges();
+
+  // Built with HEAP_PROFILE
+  static bool enabled();
+
+  // Copy of the per-tag counters; returns how many tags there are
+  int snapshot(HeapTagStats* out, int maxTags) const;
+  unsigned long untrackedCount() const;
+
+  // Gauges and tags as one JSON object (GET /api/heap)
+  void writeJson(Print& out) const;
+
+  // Gauges and the biggest tags for the health log
+  String summary() const;
+
+  // Allocation hooks
+  void recordAlloc(void* ptr, size_t size);
+  void recordFree(void* ptr);
+
+  // Allocations by the calling task outside HEAP_EXEMPT scopes, and the tag
+  // of the latest one
+  static uint32_t taskAllocations();
+  static const char* taskLastTag();
+
+  // Used by HeapTag and HeapExempt
+  static uint8_t tagIndex(const char* name);
+  static const char* tagName(uint8_t index);
+  static uint8_t currentTag();
+  static void setCurrentTag(uint8_t tag);
+  static void setTaskExempt(bool exempt);
+};
+
+extern HeapProfiler heapProfiler;
+
+#ifdef HEAP_PROFILE
+class HeapTag {
+public:
+  explicit HeapTag(const char* name) : previous(HeapProfiler::currentTag()) {
+    HeapProfiler::setCurrentTag(HeapProfiler::tagIndex(name));
+  }
+  ~HeapTag() { HeapProfiler::setCurrentTag(previous); }
+
+private:
+  uint8_t previous;
+};
+
+#define HEAP_TAG_JOIN2(a, b) a##b
+#define HEAP_TAG_JOIN(a, b) HEAP_TAG_JOIN2(a, b)
+#define HEAP_TAG(name) HeapTag HEAP_TAG_JOIN(heapTag, __LINE__)(name)
+
+class HeapExempt {
+public:
+  HeapExempt() { HeapProfiler::setTaskExempt(true); }
+  ~HeapExempt() { HeapProfiler::setTaskExempt(false); }
+};
+
+#define HEAP_EXEMPT() HeapExempt HEAP_TAG_JOIN(heapExempt, __LINE__)
+#else
+#define HEAP_TAG(name) do {} while (0)
+#define HEAP_EXEMPT() do {} while (0)
+#endif
+
+#endif // HEAP_PROFILER_H
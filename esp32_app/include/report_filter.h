@@ -0,0 +1,50 @@
+#ifndef REPORT_FILTER_H
+#define REPORT_FILTER_H
+
+#include <Arduino.h>
+#include "state.h"
+
+enum class ReportReason : uint8_t { None = 0, First, Change, State, Heartbeat };
+
+// Report-by-exception for one outbound channel. A reading is reported when
+// its distance moved more than the deadband away from the last reported
+// value, when the detection/alert/mode state changed, or when nothing was
+// reported for a heartbeat period. Everything else is suppressed and
+// counted, so the health log shows how much traffic the filter saves.
+//
+// Not thread-safe: each channel's filter is used by one task.
+class ReportFilter {
+public:
+  explicit ReportFilter(const char* name);
+
+  // Decide whether a reading goes out; the reference moves only on a report
+  ReportReason evaluate(const SensorData& data, float deadband, unsigned long heartbeatMs,
+                        unsigned long now);
+
+  // Report the next reading unconditionally (e.g. after the channel was re-enabled)
+  void reset() { hasReference = false; }
+
+  unsigned long sentCount() const;
+  unsigned long suppressedCount() const { return suppressed; }
+
+  // Sent by reason and suppressed share for the health log
+  String stats() const;
+
+  static const char* reasonName(ReportReason reason);
+
+private:
+  static const int REASON_COUNT = 5;
+
+  const char* name;
+  bool hasReference;
+  float referenceDistance;
+  uint8_t referenceState;
+  unsigned long lastReport;
+
+  unsigned long sent[REASON_COUNT];
+  unsigned long suppressed;
+
+  static uint8_t stateOf(const SensorData& data);
+};
+
+#endif // REPORT_FILTER_H
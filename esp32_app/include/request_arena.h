@@ -0,0 +1,137 @@
+#ifndef REQUEST_ARENA_H
+#define REQUEST_ARENA_H
+
+#include <Arduino.h>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifndef REQUEST_ARENA_SLABS
+#define REQUEST_ARENA_SLABS 4
+#endif
+
+#ifndef REQUEST_ARENA_SLAB_SIZE
+#define REQUEST_ARENA_SLAB_SIZE 8192
+#endif
+
+// Slabs only acquire(true) may take: the metrics endpoints keep answering
+// while everything else has the pool busy
+#ifndef REQUEST_ARENA_RESERVED
+#define REQUEST_ARENA_RESERVED 1
+#endif
+
+// Response memory for the web server. A handler leases one slab and either
+// prints a body into it front to back, with the response sent straight
+// from the slab, or keeps a streaming response's state in it (create()):
+// template and export cursors, the chart downsampler, a trace snapshot. The
+// lease goes back to the pool in one piece when the connection closes, after
+// the destructors of what was created in it have run (closing its files).
+// The pool is part of .bss, so what the handlers produce and keep never comes
+// from the heap, and REQUEST_ARENA_SLABS x REQUEST_ARENA_SLAB_SIZE is the
+// most it can ever use. What does still allocate is below the handlers:
+// ESPAsyncWebServer's request and response objects, SPIFFS file handles,
+// and the String replies of /api/command. When no slab is free, acquire()
+// fails and the handler answers 503 instead of queueing.
+//
+// Leases are taken and returned on the async_tcp task only.
+class RequestArena {
+public:
+  class Lease : public Print {
+  public:
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* data, size_t length) override;
+
+    const uint8_t* data() const { return slab; }
+    size_t length() const { return used; }
+    // Output didn't fit and was cut; don't send it
+    bool overflowed() const { return overflow; }
+
+    // Bytes left for create() and print()
+    size_t room() const { return overflow ? 0 : REQUEST_ARENA_SLAB_SIZE - used; }
+
+    // Constructs a T in the slab, nullptr if it doesn't fit. A T with a
+    // destructor also takes a cleanup record; release() runs those
+    // destructors, newest first. Use a lease for a body or for objects, not
+    // both.
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+      Cleanup* cleanup = nullptr;
+      if (!std::is_trivially_destructible<T>::value) {
+        cleanup = static_cast<Cleanup*>(allocate(sizeof(Cleanup), alignof(Cleanup)));
+        if (!cleanup) return nullptr;
+      }
+      void* slot = allocate(sizeof(T), alignof(T));
+      if (!slot) return nullptr;
+      T* object = new (slot) T(std::forward<Args>(args)...);
+      if (cleanup) {
+        cleanup->destroy = destroy<T>;
+        cleanup->object = object;
+        cleanup->next = cleanups;
+        cleanups = cleanup;
+      }
+      return object;
+    }
+
+    // count value-initialized Ts in a row, nullptr if they don't fit
+    template <typename T>
+    T* createArray(size_t count) {
+      static_assert(std::is_trivially_destructible<T>::value, "arrays get no cleanup records");
+      if (count > room() / sizeof(T)) return nullptr;
+      void* slot = allocate(count * sizeof(T), alignof(T));
+      return slot ? new (slot) T[count]() : nullptr;
+    }
+
+    // Runs the destructors, then back to the pool; data() is gone afterwards
+    void release();
+
+  private:
+    friend class RequestArena;
+
+    struct Cleanup {
+      void (*destroy)(void* object);
+      void* object;
+      Cleanup* next;
+    };
+
+    template <typename T>
+    static void destroy(void* object) { static_cast<T*>(object)->~T(); }
+
+    uint8_t* slab = nullptr;
+    size_t used = 0;
+    bool overflow = false;
+    bool leased = false;
+    Cleanup* cleanups = nullptr;
+
+    void* allocate(size_t length, size_t align);
+  };
+
+  // nullptr when no slab is free; only reserved requests get the last
+  // REQUEST_ARENA_RESERVED slabs
+  Lease* acquire(bool reserved = false);
+
+  uint8_t inUse() const { return leasedCount; }
+  uint8_t peakInUse() const { return peakLeased; }
+  size_t peakBytes() const { return peakUsed; }
+  uint32_t rejected() const { return rejectCount; }
+  uint32_t overflows() const { return overflowCount; }
+  static constexpr uint8_t slabs() { return REQUEST_ARENA_SLABS; }
+  static constexpr size_t slabSize() { return REQUEST_ARENA_SLAB_SIZE; }
+
+  // Pool usage for the health log
+  String summary() const;
+
+private:
+  alignas(8) uint8_t storage[REQUEST_ARENA_SLABS][REQUEST_ARENA_SLAB_SIZE];
+  Lease leases[REQUEST_ARENA_SLABS];
+  uint8_t leasedCount = 0;
+  uint8_t peakLeased = 0;
+  size_t peakUsed = 0;
+  uint32_t rejectCount = 0;
+  uint32_t overflowCount = 0;
+
+  void returned(Lease& lease);
+};
+
+extern RequestArena requestArena;
+
+#endif // REQUEST_ARENA_H
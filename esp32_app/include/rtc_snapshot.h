@@ -0,0 +1,32 @@
+#ifndef RTC_SNAPSHOT_H
+#define RTC_SNAPSHOT_H
+
+#include <Arduino.h>
+#include "state.h"
+
+// Keeps recent samples and key counters in RTC slow memory, which survives
+// watchdog, panic and software (OTA) resets but not power loss. On a warm
+// boot the snapshot is validated and copied back into SystemState, so history
+// and the alert cooldown carry over without touching flash.
+class RtcSnapshot {
+public:
+  // Returns true if state was restored from a valid snapshot
+  bool restore(SystemState& state);
+
+  // Ingestion path: one slot write plus a header copy and checksum
+  void recordSample(const SensorData& data);
+
+  // Copies counters and lastAlertTime; cheap enough to call every loop
+  void sync(const SystemState& state);
+
+  bool wasRestored() const { return restored; }
+  unsigned long restoredSamples() const { return restoredCount; }
+
+private:
+  bool restored = false;
+  unsigned long restoredCount = 0;
+};
+
+extern RtcSnapshot rtcSnapshot;
+
+#endif // RTC_SNAPSHOT_H
@@ -0,0 +1,58 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+#include <functional>
+
+// Deadline scheduler for a task's periodic jobs. run() executes every job
+// whose deadline has passed and returns how long the caller can sleep until
+// the next one is due, so tasks block instead of polling on a fixed delay.
+// Each job records how late it ran relative to its deadline (jitter).
+//
+// Not thread-safe: each task owns its own instance.
+class Scheduler {
+public:
+  typedef std::function<void()> JobFn;
+
+  static const int MAX_JOBS = 8;
+
+  explicit Scheduler(const char* name);
+
+  // Returns the job id, or -1 when the table is full
+  int add(const char* name, unsigned long periodMs, JobFn fn, unsigned long firstDelayMs = 0);
+
+  // Change a job's period; takes effect from its next run
+  void setPeriod(int id, unsigned long periodMs);
+
+  // Run all due jobs; returns milliseconds until the next deadline
+  unsigned long run();
+
+  // ZERO_HEAP builds: once settleMs have passed, a job that allocates from
+  // the heap aborts the firmware, naming the job and the allocation's tag.
+  // Other schedulers only count such runs (stats()). No-op otherwise.
+  void requireZeroHeap(unsigned long settleMs);
+
+  // Per-job runs, average and worst lateness for the health log
+  String stats() const;
+
+private:
+  struct Job {
+    const char* name;
+    unsigned long period;
+    unsigned long deadline;
+    JobFn fn;
+    unsigned long runs;
+    unsigned long totalLate;
+    unsigned long maxLate;
+    unsigned long heapRuns;  // runs that allocated (ZERO_HEAP builds)
+  };
+
+  const char* name;
+  Job jobs[MAX_JOBS];
+  int count;
+  unsigned long zeroHeapFrom;  // millis() when enforcement starts, 0 = off
+
+  void heapUsed(Job& job);
+};
+
+#endif // SCHEDULER_H
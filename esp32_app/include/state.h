@@ -2,6 +2,7 @@
 #define STATE_H
 
 #include <Arduino.h>
+#include "fixed_string.h"
 
 // Holds one reading from the ultrasonic sensor
 struct SensorData {
@@ -11,7 +12,7 @@ struct SensorData {
   bool alert_active = false; // From JSON 'a'
   int mode = 0;              // From JSON 'm'
   float pi_history[5] = {0}; // From JSON 'h'
-  String status = "Initializing";
+  FixedString<32> status = "Initializing";
   
   bool isValid() const {
     return distance > 0 && distance < 400; // Valid ultrasonic range
@@ -19,6 +20,8 @@ struct SensorData {
 };
 
 class SystemState {
+  friend class RtcSnapshot;
+
 private:
   static const int HISTORY_SIZE = 100;
   SensorData history[HISTORY_SIZE];
@@ -33,13 +36,18 @@ public:
   unsigned long lastAlertTime = 0;
   unsigned long systemUptime = 0;
   bool wifiConnected = false;
-  String wifiMode = "AP";
+  FixedString<16> wifiMode = "AP";
   int wifiSignalStrength = 0;
 
   // Pi connection tracking
   unsigned long lastPiHeartbeat = 0;
   bool piConnected = false;
 
+  // Counters carried across warm reboots by RtcSnapshot
+  unsigned long bootCount = 0;
+  unsigned long sampleCount = 0;
+  unsigned long alertCount = 0;
+
   SystemState();
 
   // Update methods
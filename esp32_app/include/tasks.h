@@ -0,0 +1,88 @@
+#ifndef TASKS_H
+#define TASKS_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include "state.h"
+#include "scheduler.h"
+#include "report_filter.h"
+
+// Splits the firmware into two pinned tasks:
+//  - sensor task (APP core): Pi ingestion, detection, cooldown, status LED
+//  - network task (PRO core, with the WiFi stack): WiFi, MQTT, telemetry
+// New samples reach the network task as copies through a bounded queue;
+// it never reads the sensor task's live state.
+// Telegram commands are long-polled by TelegramModule's own task. Alerts
+// leave the sensor task through the non-blocking notification dispatcher.
+// loop() keeps the low-priority housekeeping (config, flash, health).
+// Only the sensor task and loop() are watched by the task watchdog, so a
+// slow TLS request can stall notifications but never detection.
+class TaskRunner {
+public:
+  TaskRunner();
+
+  // Start both tasks; call at the end of setup()
+  bool begin();
+
+  // One-line stack headroom report for the health log
+  String healthSummary() const;
+
+  // Job jitter for both tasks
+  String schedulerSummary() const;
+
+  // Sent and suppressed telemetry per channel
+  String reportSummary() const;
+
+private:
+  static const uint32_t SENSOR_STACK = 4096;
+  static const uint32_t NETWORK_STACK = 8192;  // TLS handshakes need the room
+  static const UBaseType_t SENSOR_PRIORITY = 5;
+  static const UBaseType_t NETWORK_PRIORITY = 2;
+  static const unsigned long PI_POLL_MS = 10;
+  static const unsigned long PI_TIMEOUT_CHECK_MS = 1000;
+  static const unsigned long WIFI_HANDLE_MS = 100;
+  static const unsigned long MQTT_LOOP_MS = 100;
+  static const unsigned long MQTT_RECONNECT_MS = 5000;
+  static const unsigned long TELEMETRY_CHECK_MS = 100;
+  // Samples waiting for telemetry; the oldest is dropped when it's full
+  static const UBaseType_t READING_QUEUE_DEPTH = 16;
+  // ZERO_HEAP builds: sensor jobs may allocate only this long after start
+  static const unsigned long ZERO_HEAP_SETTLE_MS = 10000;
+
+  TaskHandle_t sensorHandle;
+  TaskHandle_t networkHandle;
+
+  // Sensor task -> network task, statically allocated
+  QueueHandle_t readings;
+  StaticQueue_t readingQueue;
+  uint8_t readingStorage[READING_QUEUE_DEPTH * sizeof(SensorData)];
+  uint32_t readingsDropped;
+
+  // Each task's periodic work; only touched by the owning task after begin()
+  Scheduler sensorJobs;
+  Scheduler networkJobs;
+
+  // Report-by-exception state per telemetry channel (network task)
+  ReportFilter mqttReport;
+  ReportFilter webhookReport;
+
+  static void sensorTask(void* arg);
+  static void networkTask(void* arg);
+
+  void runSensor();
+  void runNetwork();
+  void setupSensorJobs();
+  void setupNetworkJobs();
+  // deliver = false stops before the sinks and the event log (UART replay)
+  void evaluateAlert(SystemState& state, bool deliver);
+  void checkPiTimeout();
+  void queueReading();
+  void reportReadings();
+  void reportReading(const SensorData& data);
+};
+
+extern TaskRunner tasks;
+
+#endif // TASKS_H
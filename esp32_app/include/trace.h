@@ -0,0 +1,119 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Levels; records below TRACE_MIN_LEVEL are compiled out, records below
+// TRACE_SERIAL_LEVEL stay in the ring (see /api/logs) but aren't printed
+#define TRACE_DEBUG 0
+#define TRACE_INFO  1
+#define TRACE_WARN  2
+#define TRACE_ERROR 3
+
+#ifndef TRACE_MIN_LEVEL
+#define TRACE_MIN_LEVEL TRACE_DEBUG
+#endif
+
+#ifndef TRACE_SERIAL_LEVEL
+#define TRACE_SERIAL_LEVEL TRACE_INFO
+#endif
+
+#define TRACE_TEXT_LENGTH 16
+#define TRACE_LINE_LENGTH 128
+
+enum class TraceId : uint16_t {
+#define TRACE_EVENT(name, level, format) name,
+#include "trace_events.h"
+#undef TRACE_EVENT
+  Count
+};
+
+constexpr uint8_t TRACE_LEVELS[] = {
+#define TRACE_EVENT(name, level, format) level,
+#include "trace_events.h"
+#undef TRACE_EVENT
+};
+
+// Fixed 32-byte record, also the wire format of /api/logs?format=bin
+struct __attribute__((packed)) TraceRecord {
+  uint32_t time;        // millis()
+  uint16_t id;
+  uint8_t level;
+  uint8_t core;
+  uint32_t args[2];     // int, unsigned or float bits, in format order
+  char text[TRACE_TEXT_LENGTH];
+};
+
+static_assert(sizeof(TraceRecord) == 32, "TraceRecord layout is shared with trace_decode.py");
+
+// Binary trace log. Producers on any task reserve a slot with one atomic
+// increment and copy a few words in; nothing is formatted or written to a
+// port on the producer's side. When the ring is full the oldest records are
+// overwritten and counted as lost. Formatting happens only when draining to
+// serial (main loop), rendering /api/logs, or on the host (trace_decode.py).
+class TraceLog {
+public:
+  static const uint32_t CAPACITY = 256;  // power of two
+
+  TraceLog();
+
+  template <typename... Args>
+  void record(TraceId id, Args... args) {
+    TraceRecord entry;
+    entry.id = (uint16_t)id;
+    entry.level = TRACE_LEVELS[(int)id];
+    entry.args[0] = entry.args[1] = 0;
+    entry.text[0] = '\0';
+    uint8_t used = 0;
+    int expand[] = { 0, (pack(entry, used, args), 0)... };
+    (void)expand;
+    (void)used;
+    commit(entry);
+  }
+
+  // Main loop: print up to maxRecords pending records at or above TRACE_SERIAL_LEVEL
+  void drainToSerial(int maxRecords);
+
+  // Copy the newest records without consuming them; returns the count
+  size_t snapshot(TraceRecord* out, size_t maxRecords) const;
+
+  // Render one record as a text line; returns its length
+  static size_t format(const TraceRecord& entry, char* line, size_t size);
+  static const char* formatOf(uint16_t id);
+
+  unsigned long lostCount() const { return lost; }
+
+private:
+  struct Slot {
+    std::atomic<uint32_t> seq;   // ticket + 1 once written, 0 while empty or being written
+    TraceRecord entry;
+  };
+
+  Slot slots[CAPACITY];
+  std::atomic<uint32_t> head;    // next ticket
+  uint32_t tail;                 // next ticket to drain (main loop only)
+  unsigned long lost;
+
+  void commit(TraceRecord& entry);
+  bool read(uint32_t ticket, TraceRecord& out) const;
+
+  static void pack(TraceRecord& entry, uint8_t& used, int value);
+  static void pack(TraceRecord& entry, uint8_t& used, unsigned value);
+  static void pack(TraceRecord& entry, uint8_t& used, long value) { pack(entry, used, (int)value); }
+  static void pack(TraceRecord& entry, uint8_t& used, unsigned long value) { pack(entry, used, (unsigned)value); }
+  static void pack(TraceRecord& entry, uint8_t& used, float value);
+  static void pack(TraceRecord& entry, uint8_t& used, double value) { pack(entry, used, (float)value); }
+  static void pack(TraceRecord& entry, uint8_t& used, const char* text);
+};
+
+extern TraceLog traceLog;
+
+// TRACE(PI_RX, length, text) - the level test folds away at compile time
+#define TRACE(name, ...)                                                         \
+  do {                                                                           \
+    if (TRACE_LEVELS[(int)TraceId::name] >= TRACE_MIN_LEVEL)                     \
+      traceLog.record(TraceId::name, ##__VA_ARGS__);                             \
+  } while (0)
+
+#endif // TRACE_H
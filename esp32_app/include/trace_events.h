@@ -0,0 +1,34 @@
+// Trace event table: TRACE_EVENT(name, level, format)
+//
+// Records store only the event id and raw arguments; the format is applied
+// when draining. Formats take at most two numeric arguments (%d %u %x %f %c)
+// and one %s, which is truncated to TRACE_TEXT_LENGTH - 1 characters.
+// trace_decode.py reads this file, so keep one event per line and append
+// new events at the end to keep ids stable.
+
+TRACE_EVENT(TRACE_LOST,          TRACE_WARN,  "%u trace records lost")
+TRACE_EVENT(PI_RX,               TRACE_DEBUG, "pi rx %u bytes: %s")
+TRACE_EVENT(PI_JSON_ERROR,       TRACE_WARN,  "pi json error: %s")
+TRACE_EVENT(PI_COMMAND,          TRACE_DEBUG, "pi command: %s")
+TRACE_EVENT(PI_COMMAND_REJECTED, TRACE_WARN,  "pi command rejected: %s")
+TRACE_EVENT(PI_ALERT,            TRACE_INFO,  "pi alert: %s")
+TRACE_EVENT(PI_ERROR,            TRACE_WARN,  "pi error: %s")
+TRACE_EVENT(PI_SYSTEM,           TRACE_INFO,  "pi system: %s")
+TRACE_EVENT(UART_RX,             TRACE_DEBUG, "uart rx %u bytes: %s")
+TRACE_EVENT(UART_TX,             TRACE_DEBUG, "uart tx %u bytes: %s")
+TRACE_EVENT(UART_TX_RAW,         TRACE_DEBUG, "uart tx %u bytes")
+TRACE_EVENT(SPI_DISTANCE,        TRACE_DEBUG, "spi distance %f cm")
+TRACE_EVENT(SPI_BAD_DISTANCE,    TRACE_WARN,  "spi invalid distance %f")
+TRACE_EVENT(SPI_TIMEOUT,         TRACE_WARN,  "spi send timeout")
+TRACE_EVENT(SPI_RESPONSE,        TRACE_DEBUG, "spi response 0x%x")
+TRACE_EVENT(MQTT_RX,             TRACE_DEBUG, "mqtt rx %u bytes on %s")
+TRACE_EVENT(MQTT_COMMAND,        TRACE_INFO,  "mqtt command: %s")
+TRACE_EVENT(MQTT_TOO_LARGE,      TRACE_ERROR, "mqtt payload too large (%u bytes) for %s")
+TRACE_EVENT(MQTT_DATA,           TRACE_DEBUG, "mqtt data published: %f cm")
+TRACE_EVENT(MQTT_DATA_FAILED,    TRACE_WARN,  "mqtt data publish failed")
+TRACE_EVENT(MQTT_ALERT,          TRACE_INFO,  "mqtt alert published: %s")
+TRACE_EVENT(MQTT_ALERT_FAILED,   TRACE_WARN,  "mqtt alert publish failed")
+TRACE_EVENT(PI_LINE_TOO_LONG,    TRACE_WARN,  "pi line over %u bytes dropped")
+TRACE_EVENT(WEB_GZIP,            TRACE_DEBUG, "gzip response %u -> %u bytes")
+TRACE_EVENT(WEB_SHED,            TRACE_DEBUG, "web %s shed, %u in flight")
+TRACE_EVENT(MQTT_SEQ_UNSAVED,    TRACE_WARN,  "mqtt telemetry seq %u not saved to nvs")
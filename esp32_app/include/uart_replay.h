@@ -0,0 +1,92 @@
+#ifndef UART_REPLAY_H
+#define UART_REPLAY_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "state.h"
+
+class PiCommunication;
+
+// Capture file for Pi -> ESP32 UART traffic, one received line per line:
+//
+//   # pi-uart-capture v1
+//   <ms since capture start> <line as received, without the newline>
+//
+// Lines starting with '#' are comments. Times never decrease. Written by
+// uart_replay.py (record/synth); uploaded with POST /api/replay.
+#define REPLAY_FILE   "/replay.txt"
+#define REPLAY_HEADER "# pi-uart-capture v1"
+
+// Built-in replay source. While a replay runs, the sensor task takes lines
+// from REPLAY_FILE beside Serial2 and feeds them to the same parser and
+// alert evaluation, at the recorded pace times a speed factor (0 = as fast
+// as possible). The readings go into a scratch SystemState through a
+// non-persisting PiCommunication, so nothing is stored or sent. It measures how late each line is
+// handled against its schedule and how long each stage takes, and notes
+// where the lag first exceeds BEHIND_MS: the rate the firmware can no
+// longer keep up with.
+//
+// start()/stop() may be called from any task; the sensor task picks the
+// request up on its next handle().
+class UartReplay {
+public:
+  UartReplay();
+
+  // Queue a replay of REPLAY_FILE; false if one is already running
+  bool start(float speed);
+  void stop() { stopRequested = true; }
+
+  // Sensor task, next to piComm.handle(); true while a replay runs
+  bool handle();
+
+  // Scratch state the replayed readings go to, nullptr when not running
+  SystemState* state() const { return active ? replayState : nullptr; }
+
+  // Time spent in the sensor task's alert evaluation during a replay
+  void noteAlert(unsigned long us);
+
+  bool isActive() const { return active; }
+
+  // Progress while running, results after the last run
+  String summary() const;
+
+private:
+  static const unsigned long BUDGET_US = 8000;  // per handle(), of the 10 ms Pi poll period
+  static const unsigned long BEHIND_MS = 100;
+  static const size_t MAX_LINE = 256;
+
+  volatile bool startRequested;
+  volatile bool stopRequested;
+  volatile float requestedSpeed;
+
+  bool active;
+  float speed;
+  File file;
+  char line[MAX_LINE];
+  bool hasLine;
+  uint32_t lineAt;        // capture time of the pending line, ms
+  unsigned long startedAt;
+  unsigned long finishedAt;
+
+  unsigned long lines;
+  unsigned long skipped;  // malformed or too long
+  uint32_t lastAt;        // capture time of the last line handled
+  unsigned long maxLag;
+  unsigned long behindLine;  // first line later than BEHIND_MS, 0 = never
+  float behindRate;          // offered lines/s up to that point
+  unsigned long parseTotal;
+  unsigned long parseMax;
+  unsigned long alertTotal;
+  unsigned long alertMax;
+  unsigned long alertRuns;
+  SystemState* replayState;
+  PiCommunication* replayPi;
+
+  void begin();
+  void finish(const char* reason);
+  bool readLine();
+};
+
+extern UartReplay uartReplay;
+
+#endif // UART_REPLAY_H
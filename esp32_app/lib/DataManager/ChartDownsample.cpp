@@ -0,0 +1,132 @@
+#include "ChartDownsample.h"
+
+ChartDownsample::ChartDownsample(uint32_t from, uint32_t to, uint16_t points)
+    : from(from), to(to), points(constrain(points, MIN_POINTS, MAX_POINTS)),
+      bucketReader(SAMPLES_FILE_OLD, SAMPLES_FILE, sizeof(StoredSample)),
+      nextReader(SAMPLES_FILE_OLD, SAMPLES_FILE, sizeof(StoredSample)) {}
+
+size_t ChartDownsample::read(uint8_t* buffer, size_t maxLen) {
+    size_t written = 0;
+
+    while (written < maxLen) {
+        if (linePos >= lineLength && !nextLine()) break;
+
+        size_t n = min(maxLen - written, lineLength - linePos);
+        memcpy(buffer + written, line + linePos, n);
+        linePos += n;
+        written += n;
+    }
+
+    return written;
+}
+
+bool ChartDownsample::nextLine() {
+    lineLength = 0;
+    linePos = 0;
+
+    if (!counted) {
+        count();
+        lineLength = snprintf(line, sizeof(line), "{\"samples\":%lu,\"points\":[", (unsigned long)total);
+        return true;
+    }
+    if (finished) return false;
+
+    Point point;
+    if (emitted < min(total, (uint32_t)points) && nextPoint(point)) {
+        formatPoint(point);
+        emitted++;
+        return true;
+    }
+
+    // Also ends the array early if the files were rotated under us
+    finished = true;
+    lineLength = snprintf(line, sizeof(line), "]}\n");
+    return true;
+}
+
+void ChartDownsample::count() {
+    counted = true;
+    uint32_t skip;
+    total = dataManager.countSamples(from, to, skip);
+    bucketReader.skip(skip);
+    nextReader.skip(skip);
+}
+
+bool ChartDownsample::nextPoint(Point& point) {
+    // Short ranges, and the first and last sample of long ones, go out as they are
+    if (total <= points || emitted == 0 || emitted == points - 1) {
+        if (!nextSample(bucketReader, bucketPosition, point)) return false;
+        kept = point;
+        return true;
+    }
+
+    uint32_t bucket = emitted - 1;
+    uint32_t end = bucketStart(bucket + 1);
+    uint32_t nextEnd = bucketStart(bucket + 2);
+
+    // Average of the next bucket; the lead reader starts a bucket late
+    Point sample;
+    while (nextPosition < end) {
+        if (!nextSample(nextReader, nextPosition, sample)) return false;
+    }
+    float sumX = 0;
+    float sumDistance = 0;
+    uint32_t count = 0;
+    while (nextPosition < nextEnd && nextSample(nextReader, nextPosition, sample)) {
+        sumX += sample.x;
+        sumDistance += sample.distance;
+        count++;
+    }
+    if (count == 0) return false;
+    float averageX = sumX / count;
+    float averageDistance = sumDistance / count;
+
+    // Keep the sample spanning the largest triangle with the last kept point
+    // and that average (twice the area; only the order matters)
+    float largest = -1;
+    while (bucketPosition < end && nextSample(bucketReader, bucketPosition, sample)) {
+        float area = fabsf((kept.x - averageX) * (sample.distance - kept.distance) -
+                           (kept.x - sample.x) * (averageDistance - kept.distance));
+        if (area > largest) {
+            largest = area;
+            point = sample;
+        }
+    }
+    if (largest < 0) return false;
+
+    kept = point;
+    return true;
+}
+
+bool ChartDownsample::nextSample(RecordReader& reader, uint32_t& position, Point& point) {
+    while (const uint8_t* record = reader.peek()) {
+        StoredSample sample;
+        memcpy(&sample, record, sizeof(sample));
+        reader.pop();
+        if (sample.time < from || sample.time > to) continue;
+
+        // Both readers meet the same first sample in range first
+        if (!originSet) {
+            origin = sample.time;
+            originSet = true;
+        }
+        point.time = sample.time;
+        point.millis = sample.millis;
+        point.x = (float)((int64_t)sample.time - origin) + sample.millis / 1000.0f;
+        point.distance = sample.distance;
+        position++;
+        return true;
+    }
+    return false;
+}
+
+uint32_t ChartDownsample::bucketStart(uint32_t bucket) const {
+    // Buckets split samples 1 .. total - 2 evenly; the last one ends at total - 1
+    return min(total, (uint32_t)(1 + (uint64_t)bucket * (total - 2) / (points - 2)));
+}
+
+void ChartDownsample::formatPoint(const Point& point) {
+    lineLength = snprintf(line, sizeof(line), "%s[%lu.%03u,%.2f]", emitted ? "," : "",
+                          (unsigned long)point.time, point.millis, point.distance);
+    lineLength = min(lineLength, sizeof(line) - 1);
+}
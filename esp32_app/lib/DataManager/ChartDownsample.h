@@ -0,0 +1,68 @@
+#ifndef CHART_DOWNSAMPLE_H
+#define CHART_DOWNSAMPLE_H
+
+#include <Arduino.h>
+#include "DataManager.h"
+#include "RecordReader.h"
+
+// Largest-Triangle-Three-Buckets downsample of the stored samples in a time
+// range, as JSON for the history chart:
+//   {"samples":<in range>,"points":[[<time>,<distance>],...]}
+// The first and last sample are kept; the rest are split into points - 2
+// buckets of equal sample count, and from each bucket the sample forming
+// the largest triangle with the point kept before it and the average of
+// the next bucket is kept. Peaks and dips survive, flat stretches thin out.
+//
+// The range is counted from DataManager's sample index, and both readers
+// start at the first indexed block that can hold it. Then it is one pass:
+// one reader walks the bucket being decided while a second one runs a
+// bucket ahead to average it, so memory is this object whatever the range
+// holds. Ranges with no more than `points` samples come back as they are.
+class ChartDownsample {
+public:
+  static constexpr uint16_t MIN_POINTS = 3;
+  static constexpr uint16_t MAX_POINTS = 1000;
+
+  ChartDownsample(uint32_t from, uint32_t to, uint16_t points);
+
+  // Fills up to maxLen bytes, returns 0 when the response is complete
+  size_t read(uint8_t* buffer, size_t maxLen);
+
+  uint32_t sampleCount() const { return total; }
+
+private:
+  struct Point {
+    uint32_t time;
+    uint16_t millis;
+    float x;          // seconds since the first sample in range
+    float distance;
+  };
+
+  uint32_t from;
+  uint32_t to;
+  uint16_t points;
+  RecordReader bucketReader;   // bucket being decided
+  RecordReader nextReader;     // one bucket ahead
+  uint32_t bucketPosition = 0; // range index of bucketReader's next sample
+  uint32_t nextPosition = 0;
+  uint32_t total = 0;
+  uint32_t origin = 0;
+  bool originSet = false;
+  bool counted = false;
+  bool finished = false;
+  uint16_t emitted = 0;
+  Point kept;                  // last point written
+
+  char line[40];
+  size_t lineLength = 0;
+  size_t linePos = 0;
+
+  bool nextLine();
+  void count();
+  bool nextPoint(Point& point);
+  bool nextSample(RecordReader& reader, uint32_t& position, Point& point);
+  uint32_t bucketStart(uint32_t bucket) const;
+  void formatPoint(const Point& point);
+};
+
+#endif
@@ -0,0 +1,136 @@
+#include "DataExport.h"
+
+DataExport::DataExport(ExportFormat format, ExportClock clock, uint32_t from, uint32_t to,
+                       bool includeSamples, bool includeEvents)
+    : format(format), clock(clock), from(from), to(to),
+      samples(SAMPLES_FILE_OLD, SAMPLES_FILE, sizeof(StoredSample), includeSamples),
+      events(EVENTS_FILE_OLD, EVENTS_FILE, sizeof(StoredEvent), includeEvents) {}
+
+size_t DataExport::read(uint8_t* buffer, size_t maxLen) {
+    size_t written = 0;
+
+    while (written < maxLen) {
+        if (linePos >= lineLength && !nextLine()) break;
+
+        size_t n = min(maxLen - written, lineLength - linePos);
+        memcpy(buffer + written, line + linePos, n);
+        linePos += n;
+        written += n;
+    }
+
+    return written;
+}
+
+bool DataExport::nextLine() {
+    lineLength = 0;
+    linePos = 0;
+
+    if (!headerSent) {
+        headerSent = true;
+        if (format == ExportFormat::CSV) {
+            lineLength = snprintf(line, sizeof(line),
+                                  "type,time,clock,distance,object_detected,alert_active,mode,message\n");
+            return true;
+        }
+    }
+
+    while (true) {
+        const uint8_t* sampleRecord = samples.peek();
+        const uint8_t* eventRecord = events.peek();
+        if (!sampleRecord && !eventRecord) return false;
+
+        StoredSample sample;
+        StoredEvent event;
+        if (sampleRecord) memcpy(&sample, sampleRecord, sizeof(sample));
+        if (eventRecord) memcpy(&event, eventRecord, sizeof(event));
+
+        // Drop the other clock's records before anything compares their times
+        if (sampleRecord && !onClock(sample.flags)) {
+            samples.pop();
+            continue;
+        }
+        if (eventRecord && !onClock(event.flags)) {
+            events.pop();
+            continue;
+        }
+
+        // Both files are append-only, so a two-way merge keeps epoch time order
+        bool takeSample = sampleRecord &&
+            (!eventRecord || clock == ExportClock::Uptime || sample.time < event.time ||
+             (sample.time == event.time && sample.millis <= event.millis));
+
+        if (takeSample) {
+            samples.pop();
+            if (sample.time < from || sample.time > to) continue;
+            formatSample(sample);
+        } else {
+            events.pop();
+            if (event.time < from || event.time > to) continue;
+            formatEvent(event);
+        }
+
+        records++;
+        return true;
+    }
+}
+
+bool DataExport::onClock(uint8_t flags) const {
+    return ((flags & RECORD_UPTIME_CLOCK) != 0) == (clock == ExportClock::Uptime);
+}
+
+void DataExport::formatSample(const StoredSample& sample) {
+    const char* clock = (sample.flags & RECORD_UPTIME_CLOCK) ? "uptime" : "epoch";
+    bool detected = sample.flags & RECORD_OBJECT_DETECTED;
+    bool alert = sample.flags & RECORD_ALERT_ACTIVE;
+
+    if (format == ExportFormat::CSV) {
+        lineLength = snprintf(line, sizeof(line), "sample,%lu.%03u,%s,%.2f,%d,%d,%u,\n",
+                              (unsigned long)sample.time, sample.millis, clock,
+                              sample.distance, detected, alert, sample.mode);
+    } else {
+        lineLength = snprintf(line, sizeof(line),
+                              "{\"type\":\"sample\",\"time\":%lu.%03u,\"clock\":\"%s\",\"distance\":%.2f,"
+                              "\"object_detected\":%s,\"alert_active\":%s,\"mode\":%u}\n",
+                              (unsigned long)sample.time, sample.millis, clock, sample.distance,
+                              detected ? "true" : "false", alert ? "true" : "false", sample.mode);
+    }
+    lineLength = min(lineLength, sizeof(line) - 1);
+}
+
+void DataExport::formatEvent(const StoredEvent& event) {
+    const char* clock = (event.flags & RECORD_UPTIME_CLOCK) ? "uptime" : "epoch";
+
+    if (format == ExportFormat::CSV) {
+        lineLength = snprintf(line, sizeof(line), "event,%lu.%03u,%s,,,,,\"",
+                              (unsigned long)event.time, event.millis, clock);
+    } else {
+        lineLength = snprintf(line, sizeof(line),
+                              "{\"type\":\"event\",\"time\":%lu.%03u,\"clock\":\"%s\",\"message\":\"",
+                              (unsigned long)event.time, event.millis, clock);
+    }
+
+    // Escape the message for the target format (at most 6 bytes per input byte)
+    size_t length = min((size_t)event.length, sizeof(event.text));
+    for (size_t i = 0; i < length && lineLength < sizeof(line) - 8; i++) {
+        char c = event.text[i];
+        if (c == '"') {
+            line[lineLength++] = format == ExportFormat::CSV ? '"' : '\\';
+            line[lineLength++] = '"';
+        } else if (format == ExportFormat::NDJSON && c == '\\') {
+            line[lineLength++] = '\\';
+            line[lineLength++] = '\\';
+        } else if ((uint8_t)c < 0x20) {
+            if (format == ExportFormat::NDJSON) {
+                lineLength += snprintf(line + lineLength, 7, "\\u%04x", c);
+            } else {
+                line[lineLength++] = ' ';
+            }
+        } else {
+            line[lineLength++] = c;
+        }
+    }
+
+    line[lineLength++] = '"';
+    if (format == ExportFormat::NDJSON) line[lineLength++] = '}';
+    line[lineLength++] = '\n';
+}
@@ -0,0 +1,52 @@
+#ifndef DATA_EXPORT_H
+#define DATA_EXPORT_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "DataManager.h"
+#include "RecordReader.h"
+
+enum class ExportFormat { NDJSON, CSV };
+
+// Records written before NTP synced carry uptime seconds (RECORD_UPTIME_CLOCK),
+// which restart at every boot and have no place among epoch times
+enum class ExportClock { Epoch, Uptime };
+
+// Streams persisted samples and events on one clock for a time range in that
+// clock's seconds. Records on the other clock are left out, so no two times
+// from different clocks are ever compared. Epoch records are merged in time
+// order; uptime records can't be ordered across boots, so they come samples
+// first, then events, each in the order written.
+// Records are read from flash a few at a time and formatted one line at a
+// time, so memory use is fixed regardless of the range being exported.
+class DataExport {
+public:
+  DataExport(ExportFormat format, ExportClock clock, uint32_t from, uint32_t to,
+             bool includeSamples, bool includeEvents);
+
+  // Fills up to maxLen bytes, returns 0 when the export is complete
+  size_t read(uint8_t* buffer, size_t maxLen);
+
+  size_t recordCount() const { return records; }
+
+private:
+  ExportFormat format;
+  ExportClock clock;
+  uint32_t from;
+  uint32_t to;
+  RecordReader samples;
+  RecordReader events;
+  bool headerSent = false;
+  size_t records = 0;
+
+  char line[160];
+  size_t lineLength = 0;
+  size_t linePos = 0;
+
+  bool nextLine();
+  bool onClock(uint8_t flags) const;
+  void formatSample(const StoredSample& sample);
+  void formatEvent(const StoredEvent& event);
+};
+
+#endif
@@ -1,9 +1,15 @@
 #include "DataManager.h"
+#include "../../include/config_schema.h"
+#include "../../include/heap_profiler.h"
 #include <SPIFFS.h>
+#include <sys/time.h>
 
 DataManager dataManager;
 
-DataManager::DataManager() : initialized(false) {}
+DataManager::DataManager()
+    : initialized(false), spiffsReady(false), sampleBufferCount(0), eventBufferCount(0),
+      bufferLock(nullptr), flushWanted(false), lastFlush(0), sampleIndex{},
+      indexLock(portMUX_INITIALIZER_UNLOCKED) {}
 
 DataManager::~DataManager() {
     end();
@@ -12,6 +18,10 @@ DataManager::~DataManager() {
 bool DataManager::begin() {
     if (initialized) return true;
 
+    if (!bufferLock) {
+        bufferLock = xSemaphoreCreateRecursiveMutex();
+    }
+
     if (!preferences.begin("surveillance", false)) {
         Serial.println(" Failed to initialize preferences");
         return false;
@@ -24,7 +34,9 @@ bool DataManager::begin() {
         Serial.println(" Failed to initialize SPIFFS");
         // Continue without SPIFFS - use preferences only
     } else {
+        spiffsReady = true;
         Serial.println(" SPIFFS initialized");
+        buildSampleIndex();
     }
 
     Serial.println(" DataManager initialized");
@@ -33,8 +45,10 @@ bool DataManager::begin() {
 
 void DataManager::end() {
     if (initialized) {
+        flush();
         preferences.end();
         SPIFFS.end();
+        spiffsReady = false;
         initialized = false;
     }
     Serial.println(" DataManager stopped");
@@ -43,47 +57,38 @@ void DataManager::end() {
 void DataManager::saveConfig(const AppConfig& cfg) {
     if (!initialized) return;
 
-    preferences.putFloat("threshold", cfg.system.distance_threshold);
-    preferences.putULong("cooldown", cfg.system.alert_cooldown);
-    preferences.putInt("refresh", cfg.system.web_refresh_interval);
-    preferences.putBool("telegram", cfg.telegram.enable_telegram);
-    preferences.putBool("web_server", cfg.system.enable_web_server);
-    preferences.putBool("data_logging", cfg.system.enable_data_logging);
-    
-    // WiFi settings
-    preferences.putString("sta_ssid", cfg.wifi.sta_ssid);
-    preferences.putString("sta_password", cfg.wifi.sta_password);
-    preferences.putBool("enable_station", cfg.wifi.enable_station_mode);
-    
-    // Telegram settings
-    preferences.putString("bot_token", cfg.telegram.bot_token);
-    preferences.putString("chat_id", cfg.telegram.chat_id);
+    static uint8_t blob[configBlobCapacity()];
+    size_t length = ConfigSchema::encodeBlob(cfg, blob, sizeof(blob));
+    if (length == 0 || preferences.putBytes(CONFIG_BLOB_KEY, blob, length) != length) {
+        Serial.println(" Failed to save configuration");
+        return;
+    }
 
-    Serial.println(" Configuration saved to preferences");
+    Serial.println(" Configuration saved to preferences (" + String(length) + " bytes)");
 }
 
 bool DataManager::loadConfig(AppConfig& cfg) {
     if (!initialized) return false;
 
-    // System settings
-    cfg.system.distance_threshold = preferences.getFloat("threshold", 50.0);
-    cfg.system.alert_cooldown = preferences.getULong("cooldown", 5000);
-    cfg.system.web_refresh_interval = preferences.getInt("refresh", 2);
-    cfg.system.enable_web_server = preferences.getBool("web_server", true);
-    cfg.system.enable_data_logging = preferences.getBool("data_logging", true);
-    
-    // WiFi settings
-    strncpy((char*)cfg.wifi.sta_ssid, preferences.getString("sta_ssid", "").c_str(), 32);
-    strncpy((char*)cfg.wifi.sta_password, preferences.getString("sta_password", "").c_str(), 64);
-    cfg.wifi.enable_station_mode = preferences.getBool("enable_station", false);
-    
-    // Telegram settings
-    strncpy((char*)cfg.telegram.bot_token, preferences.getString("bot_token", "").c_str(), 64);
-    strncpy((char*)cfg.telegram.chat_id, preferences.getString("chat_id", "").c_str(), 32);
-    cfg.telegram.enable_telegram = preferences.getBool("telegram", true);
+    // One blob read instead of a lookup per field
+    static uint8_t blob[configBlobCapacity()];
+    size_t length = preferences.isKey(CONFIG_BLOB_KEY)
+        ? preferences.getBytes(CONFIG_BLOB_KEY, blob, sizeof(blob))
+        : 0;
+
+    if (length > 0) {
+        if (!ConfigSchema::decodeBlob(cfg, blob, length)) {
+            Serial.println(" Stored configuration is corrupt, using defaults");
+            return false;
+        }
+        Serial.println(" Configuration loaded from preferences");
+    } else if (migrateLegacyConfig(cfg)) {
+        Serial.println(" Migrated per-key configuration to config blob");
+    } else {
+        Serial.println(" No stored configuration, using defaults");
+        return false;
+    }
 
-    Serial.println(" Configuration loaded from preferences");
-    
     // Log loaded configuration
     Serial.println(" Loaded Config - Threshold: " + String(cfg.system.distance_threshold) + 
                   "cm, Cooldown: " + String(cfg.system.alert_cooldown/1000) + "s");
@@ -91,45 +96,299 @@ bool DataManager::loadConfig(AppConfig& cfg) {
     return true;
 }
 
-void DataManager::logEvent(const String& event) {
-    if (!initialized || !config.system.enable_data_logging) return;
+bool DataManager::migrateLegacyConfig(AppConfig& cfg) {
+    // Older firmware stored a dozen fields under their own keys
+    int migrated = 0;
+    for (const ConfigField& field : CONFIG_FIELDS) {
+        if (!(field.flags & CFG_PERSIST) || !preferences.isKey(field.key)) continue;
 
-    // Log to serial
-    Serial.println(" Event: " + event);
-    
-    // Log to file if SPIFFS is available
-    if (SPIFFS.exists("/events.log")) {
-        File file = SPIFFS.open("/events.log", FILE_APPEND);
-        if (file) {
-            file.println("[" + String(millis()) + "] " + event);
-            file.close();
+        uint8_t* target = reinterpret_cast<uint8_t*>(&cfg) + field.offset;
+        switch (field.type) {
+            case ConfigType::Bool:
+                *reinterpret_cast<bool*>(target) = preferences.getBool(field.key);
+                break;
+            case ConfigType::Int:
+                *reinterpret_cast<int*>(target) = preferences.getInt(field.key);
+                break;
+            case ConfigType::ULong:
+                *reinterpret_cast<unsigned long*>(target) = preferences.getULong(field.key);
+                break;
+            case ConfigType::Float:
+                *reinterpret_cast<float*>(target) = preferences.getFloat(field.key);
+                break;
+            case ConfigType::String:
+                preferences.getString(field.key, reinterpret_cast<char*>(target), field.size);
+                break;
         }
+        preferences.remove(field.key);
+        migrated++;
     }
+
+    if (migrated == 0) return false;
+    saveConfig(cfg);
+    return true;
+}
+
+bool DataManager::loadWifiCache(WifiCache& cache) {
+    if (!initialized || !preferences.isKey(WIFI_CACHE_KEY)) return false;
+    return preferences.getBytes(WIFI_CACHE_KEY, &cache, sizeof(cache)) == sizeof(cache);
+}
+
+void DataManager::saveWifiCache(const WifiCache& cache) {
+    if (!initialized) return;
+
+    // Only write when the AP actually changed to spare NVS erase cycles
+    WifiCache stored;
+    if (loadWifiCache(stored) && memcmp(&stored, &cache, sizeof(cache)) == 0) return;
+    preferences.putBytes(WIFI_CACHE_KEY, &cache, sizeof(cache));
+}
+
+void DataManager::clearWifiCache() {
+    if (!initialized) return;
+    preferences.remove(WIFI_CACHE_KEY);
+}
+
+uint32_t DataManager::loadTelemetrySeq() {
+    if (!initialized) return 0;
+    return preferences.getULong(TELEMETRY_SEQ_KEY, 0);
+}
+
+bool DataManager::saveTelemetrySeq(uint32_t next) {
+    if (!initialized) return false;
+    return preferences.putULong(TELEMETRY_SEQ_KEY, next) == sizeof(uint32_t);
+}
+
+uint8_t DataManager::currentTime(uint32_t& time, uint16_t& ms) {
+    // Prefer wall-clock time once NTP has synced, otherwise fall back to uptime
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+    if (now.tv_sec > 1600000000) {
+        time = now.tv_sec;
+        ms = now.tv_usec / 1000;
+        return 0;
+    }
+
+    unsigned long uptime = millis();
+    time = uptime / 1000;
+    ms = uptime % 1000;
+    return RECORD_UPTIME_CLOCK;
+}
+
+void DataManager::logEvent(const char* event) {
+    HEAP_TAG("storage");
+    if (!initialized || !config().system.enable_data_logging) return;
+
+    // Log to serial
+    Serial.print(" Event: ");
+    Serial.println(event);
+
+    uint32_t time;
+    uint16_t ms;
+    xSemaphoreTakeRecursive(bufferLock, portMAX_DELAY);
+    StoredEvent& record = eventBuffer[eventBufferCount++];
+    record.flags = currentTime(time, ms);
+    record.time = time;
+    record.millis = ms;
+    size_t length = strlen(event);
+    record.length = min(length, sizeof(record.text));
+    // Don't split a multi-byte UTF-8 character at the cut
+    while (record.length > 0 && record.length < length &&
+           (event[record.length] & 0xC0) == 0x80) {
+        record.length--;
+    }
+    memcpy(record.text, event, record.length);
+
+    // Events are rare, so persist them promptly
+    if (eventBufferCount == EVENT_BUFFER_SIZE) {
+        flush();
+    } else if (strncmp(event, "Alert", 5) == 0) {
+        flushWanted = true;
+    }
+    xSemaphoreGiveRecursive(bufferLock);
+}
+
+StoredSample DataManager::makeSample(const SensorData& data) {
+    uint32_t time;
+    uint16_t ms;
+    StoredSample record;
+    record.flags = currentTime(time, ms) |
+                   (data.object_detected ? RECORD_OBJECT_DETECTED : 0) |
+                   (data.alert_active ? RECORD_ALERT_ACTIVE : 0);
+    record.time = time;
+    record.millis = ms;
+    record.distance = data.distance;
+    record.mode = data.mode;
+    return record;
 }
 
 void DataManager::saveSensorData(const SensorData& data) {
-    if (!initialized || !config.system.enable_data_logging) return;
-
-    // Save to preferences (limited storage)
-    String key = "data_" + String(millis());
-    String value = String(data.distance) + "," + 
-                   String(data.timestamp) + "," + 
-                   String(data.object_detected) + "," + 
-                   data.status;
-    
-    preferences.putString(key.c_str(), value);
-    
-    // Save to file if SPIFFS is available
-    if (SPIFFS.exists("/sensor_data.csv")) {
-        File file = SPIFFS.open("/sensor_data.csv", FILE_APPEND);
-        if (file) {
-            file.println(String(data.timestamp) + "," + 
-                        String(data.distance, 2) + "," + 
-                        String(data.object_detected) + "," + 
-                        data.status);
-            file.close();
+    HEAP_TAG("storage");
+    if (!initialized || !config().system.enable_data_logging || !spiffsReady) return;
+
+    xSemaphoreTakeRecursive(bufferLock, portMAX_DELAY);
+    sampleBuffer[sampleBufferCount++] = makeSample(data);
+
+    if (sampleBufferCount == SAMPLE_BUFFER_SIZE) {
+        flush();
+    } else if (sampleBufferCount >= SAMPLE_BUFFER_SIZE * 3 / 4) {
+        flushWanted = true;
+    }
+    xSemaphoreGiveRecursive(bufferLock);
+}
+
+void DataManager::flush() {
+    HEAP_TAG("storage");
+    if (!bufferLock) return;
+    xSemaphoreTakeRecursive(bufferLock, portMAX_DELAY);
+
+    if (!spiffsReady) {
+        sampleBufferCount = 0;
+        eventBufferCount = 0;
+        xSemaphoreGiveRecursive(bufferLock);
+        return;
+    }
+
+    if (sampleBufferCount > 0) {
+        Append result = appendRecords(SAMPLES_FILE, SAMPLES_FILE_OLD, MAX_SAMPLES_FILE_SIZE,
+                                      (const uint8_t*)sampleBuffer,
+                                      sampleBufferCount * sizeof(StoredSample));
+        if (result == Append::Rotated) {
+            portENTER_CRITICAL(&indexLock);
+            sampleIndex[0] = sampleIndex[1];
+            sampleIndex[1].records = 0;
+            portEXIT_CRITICAL(&indexLock);
         }
+        if (result != Append::Failed) indexSamples(sampleIndex[1], sampleBuffer, sampleBufferCount);
+        sampleBufferCount = 0;
+    }
+
+    if (eventBufferCount > 0) {
+        appendRecords(EVENTS_FILE, EVENTS_FILE_OLD, MAX_EVENTS_FILE_SIZE,
+                      (const uint8_t*)eventBuffer, eventBufferCount * sizeof(StoredEvent));
+        eventBufferCount = 0;
     }
+
+    xSemaphoreGiveRecursive(bufferLock);
+}
+
+void DataManager::handle() {
+    unsigned long now = millis();
+    if (!flushWanted && now - lastFlush < FLUSH_INTERVAL_MS) return;
+    flushWanted = false;
+    lastFlush = now;
+    flush();
+}
+
+DataManager::Append DataManager::appendRecords(const char* path, const char* oldPath, size_t maxSize,
+                                               const uint8_t* data, size_t length) {
+    File file = SPIFFS.open(path, FILE_APPEND);
+    if (!file) {
+        Serial.println(" Failed to open " + String(path));
+        return Append::Failed;
+    }
+
+    // Rotate: keep one previous generation so storage stays bounded
+    Append result = Append::Appended;
+    if (file.size() + length > maxSize) {
+        file.close();
+        SPIFFS.remove(oldPath);
+        SPIFFS.rename(path, oldPath);
+        result = Append::Rotated;
+        file = SPIFFS.open(path, FILE_APPEND);
+        if (!file) return Append::Failed;
+    }
+
+    file.write(data, length);
+    file.close();
+    return result;
+}
+
+void DataManager::indexSamples(SampleIndex& index, const StoredSample* samples, size_t count) {
+    portENTER_CRITICAL(&indexLock);
+    for (size_t i = 0; i < count; i++) {
+        uint32_t block = index.records / SAMPLE_INDEX_BLOCK;
+        if (block >= SAMPLE_INDEX_BLOCKS) break;
+        uint32_t time = samples[i].time;
+        if (index.records % SAMPLE_INDEX_BLOCK == 0) {
+            index.minTime[block] = index.maxTime[block] = time;
+        } else {
+            index.minTime[block] = min(index.minTime[block], time);
+            index.maxTime[block] = max(index.maxTime[block], time);
+        }
+        index.records++;
+    }
+    portEXIT_CRITICAL(&indexLock);
+}
+
+void DataManager::buildSampleIndex() {
+    // Once at boot; from then on flush() keeps it current
+    const char* const paths[2] = {SAMPLES_FILE_OLD, SAMPLES_FILE};
+    for (int i = 0; i < 2; i++) {
+        sampleIndex[i].records = 0;
+        File file = SPIFFS.open(paths[i], FILE_READ);
+        if (!file) continue;
+        StoredSample samples[32];
+        while (size_t bytes = file.read((uint8_t*)samples, sizeof(samples))) {
+            indexSamples(sampleIndex[i], samples, bytes / sizeof(StoredSample));
+        }
+        file.close();
+    }
+}
+
+uint32_t DataManager::countInFile(const char* path, uint32_t first, uint32_t length,
+                                  uint32_t from, uint32_t to) {
+    File file = SPIFFS.open(path, FILE_READ);
+    if (!file || !file.seek(first * sizeof(StoredSample))) return 0;
+
+    uint32_t count = 0;
+    StoredSample samples[32];
+    while (length > 0) {
+        size_t want = min((size_t)length, sizeof(samples) / sizeof(StoredSample));
+        size_t got = file.read((uint8_t*)samples, want * sizeof(StoredSample)) / sizeof(StoredSample);
+        if (got == 0) break;
+        for (size_t i = 0; i < got; i++) {
+            if (samples[i].time >= from && samples[i].time <= to) count++;
+        }
+        length -= got;
+    }
+    file.close();
+    return count;
+}
+
+uint32_t DataManager::countSamples(uint32_t from, uint32_t to, uint32_t& skip) {
+    // A block wholly inside the range counts without a read and one wholly
+    // outside is passed over; with time rising, at most one block per file
+    // and bound is read. A rotation meanwhile only makes the count stale,
+    // which the readers already have to cope with.
+    const char* const paths[2] = {SAMPLES_FILE_OLD, SAMPLES_FILE};
+    uint32_t total = 0;
+    bool found = false;
+    skip = 0;
+
+    for (int i = 0; i < 2; i++) {
+        for (uint32_t block = 0; block < SAMPLE_INDEX_BLOCKS; block++) {
+            portENTER_CRITICAL(&indexLock);
+            uint32_t records = sampleIndex[i].records;
+            uint32_t first = block * SAMPLE_INDEX_BLOCK;
+            uint32_t length = first < records ? min(records - first, SAMPLE_INDEX_BLOCK) : 0;
+            uint32_t minTime = sampleIndex[i].minTime[block];
+            uint32_t maxTime = sampleIndex[i].maxTime[block];
+            portEXIT_CRITICAL(&indexLock);
+            if (length == 0) break;
+
+            if (maxTime < from || minTime > to) {
+                if (!found) skip += length;
+                continue;
+            }
+            found = true;
+            if (minTime >= from && maxTime <= to) {
+                total += length;
+            } else {
+                total += countInFile(paths[i], first, length, from, to);
+            }
+        }
+    }
+    return total;
 }
 
 void DataManager::cleanupOldData(int maxAgeDays) {
@@ -147,17 +406,26 @@ void DataManager::cleanupOldData(int maxAgeDays) {
     logEvent("Data cleanup performed");
 }
 
-// Additional utility methods
-void DataManager::exportDataToJson() {
-    if (!initialized) return;
-    
-    // This would export data to JSON format for backup/analysis
-    Serial.println(" Exporting data to JSON (placeholder)");
-}
-
 void DataManager::resetAllData() {
     if (!initialized) return;
     
+    // Telemetry consumers dedupe on the sequence number, so it survives a reset
+    uint32_t telemetrySeq = loadTelemetrySeq();
     preferences.clear();
+    if (telemetrySeq) saveTelemetrySeq(telemetrySeq);
+    xSemaphoreTakeRecursive(bufferLock, portMAX_DELAY);
+    sampleBufferCount = 0;
+    eventBufferCount = 0;
+    xSemaphoreGiveRecursive(bufferLock);
+    portENTER_CRITICAL(&indexLock);
+    sampleIndex[0].records = 0;
+    sampleIndex[1].records = 0;
+    portEXIT_CRITICAL(&indexLock);
+    if (spiffsReady) {
+        SPIFFS.remove(SAMPLES_FILE);
+        SPIFFS.remove(SAMPLES_FILE_OLD);
+        SPIFFS.remove(EVENTS_FILE);
+        SPIFFS.remove(EVENTS_FILE_OLD);
+    }
     Serial.println(" All data reset");
 }
\ No newline at end of file
@@ -3,30 +3,132 @@
 
 #include <Arduino.h>
 #include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include "../../include/state.h"
 #include "../../include/config.h"
 
+// On-flash record layouts (fixed size so files can be scanned without parsing)
+struct __attribute__((packed)) StoredSample {
+  uint32_t time;       // epoch seconds, or uptime seconds when RECORD_UPTIME_CLOCK is set
+  uint16_t millis;     // sub-second part
+  float distance;
+  uint8_t flags;
+  uint8_t mode;
+};
+
+struct __attribute__((packed)) StoredEvent {
+  uint32_t time;
+  uint16_t millis;
+  uint8_t flags;
+  uint8_t length;
+  char text[24];
+};
+
+// StoredSample/StoredEvent flags
+#define RECORD_OBJECT_DETECTED 0x01
+#define RECORD_ALERT_ACTIVE    0x02
+#define RECORD_UPTIME_CLOCK    0x80
+
+// Storage files; the ".1" file holds the previous generation after rotation
+#define SAMPLES_FILE     "/samples.bin"
+#define SAMPLES_FILE_OLD "/samples.1.bin"
+#define EVENTS_FILE      "/events.bin"
+#define EVENTS_FILE_OLD  "/events.1.bin"
+
+// NVS key of the versioned config blob (see ConfigSchema)
+#define CONFIG_BLOB_KEY "config"
+#define WIFI_CACHE_KEY  "wifi_ap"
+#define TELEMETRY_SEQ_KEY "mqtt_seq"
+
+// Last access point we associated with, for scan-less reconnects
+struct WifiCache {
+  uint32_t ssidHash;
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint8_t reserved;
+};
+
 class DataManager {
 private:
+  static const int SAMPLE_BUFFER_SIZE = 32;
+  static const int EVENT_BUFFER_SIZE = 8;
+  static const size_t MAX_SAMPLES_FILE_SIZE = 256 * 1024;
+  static const size_t MAX_EVENTS_FILE_SIZE = 32 * 1024;
+  static const unsigned long FLUSH_INTERVAL_MS = 5000;
+  static constexpr uint32_t SAMPLE_INDEX_BLOCK = 512;  // records per index entry
+  static constexpr size_t SAMPLE_INDEX_BLOCKS =
+      MAX_SAMPLES_FILE_SIZE / sizeof(StoredSample) / SAMPLE_INDEX_BLOCK + 1;
+
+  enum class Append { Failed, Appended, Rotated };
+
+  // Time span of each run of SAMPLE_INDEX_BLOCK records in a sample file,
+  // kept up to date as batches are written
+  struct SampleIndex {
+    uint32_t records;
+    uint32_t minTime[SAMPLE_INDEX_BLOCKS];
+    uint32_t maxTime[SAMPLE_INDEX_BLOCKS];
+  };
+
   Preferences preferences;
   bool initialized;
-  
+  bool spiffsReady;
+
+  // Records are batched in RAM and appended to flash in one write
+  StoredSample sampleBuffer[SAMPLE_BUFFER_SIZE];
+  int sampleBufferCount;
+  StoredEvent eventBuffer[EVENT_BUFFER_SIZE];
+  int eventBufferCount;
+  // Buffers are filled by the sensor task and flushed from loop()
+  SemaphoreHandle_t bufferLock;
+  // Set by the sensor task when a buffer is filling up or an alert was
+  // logged; flash writes stay off the sensor task unless loop() falls behind
+  volatile bool flushWanted;
+  unsigned long lastFlush;
+  // SAMPLES_FILE_OLD, SAMPLES_FILE; written in flush(), read by web handlers
+  SampleIndex sampleIndex[2];
+  portMUX_TYPE indexLock;
+
+  bool migrateLegacyConfig(AppConfig& cfg);
+  Append appendRecords(const char* path, const char* oldPath, size_t maxSize,
+                       const uint8_t* data, size_t length);
+  void indexSamples(SampleIndex& index, const StoredSample* samples, size_t count);
+  void buildSampleIndex();
+  static uint32_t countInFile(const char* path, uint32_t first, uint32_t length,
+                              uint32_t from, uint32_t to);
+
 public:
   DataManager();
   ~DataManager();
-  
+
   bool begin();
   void end();
   void saveConfig(const AppConfig& cfg);
   bool loadConfig(AppConfig& cfg);
-  void logEvent(const String& event);
+  void logEvent(const char* event);
   void saveSensorData(const SensorData& data);
+  // Timestamp a reading in the on-flash layout (also used for MQTT telemetry)
+  static StoredSample makeSample(const SensorData& data);
+  static uint8_t currentTime(uint32_t& time, uint16_t& ms);
+  void flush();
+  // Stored samples with from <= time <= to, counted from the index: only
+  // blocks that straddle a bound are read. skip is set to the number of
+  // records, old file first, before the first block that can hold one.
+  uint32_t countSamples(uint32_t from, uint32_t to, uint32_t& skip);
+  // loop(): flush when asked to, or every FLUSH_INTERVAL_MS
+  void handle();
+  bool loadWifiCache(WifiCache& cache);
+  void saveWifiCache(const WifiCache& cache);
+  void clearWifiCache();
+  // First MQTT telemetry sequence number no earlier boot can have used
+  uint32_t loadTelemetrySeq();
+  bool saveTelemetrySeq(uint32_t next);
   void cleanupOldData(int maxAgeDays = 30);
-  void exportDataToJson();
   void resetAllData();
   bool isInitialized() const { return initialized; }
+  bool isStorageReady() const { return spiffsReady; }
 };
 
 extern DataManager dataManager;
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,35 @@
+#include "RecordReader.h"
+#include <SPIFFS.h>
+
+RecordReader::RecordReader(const char* oldPath, const char* path, size_t recordSize, bool enabled)
+    : paths{oldPath, path}, pathIndex(enabled ? 0 : 2), recordSize(recordSize) {}
+
+const uint8_t* RecordReader::peek() {
+    while (index >= count) {
+        if (!file) {
+            if (pathIndex >= 2) return nullptr;
+            const char* path = paths[pathIndex++];
+            if (!SPIFFS.exists(path)) continue;
+            file = SPIFFS.open(path, FILE_READ);
+            size_t records = file ? file.size() / recordSize : 0;
+            if (skipCount >= records) {
+                skipCount -= records;
+                file.close();
+                file = File();
+                continue;
+            }
+            file.seek(skipCount * recordSize);
+            skipCount = 0;
+            continue;
+        }
+
+        size_t bytes = file.read(buffer, BUFFER_SIZE - BUFFER_SIZE % recordSize);
+        count = bytes / recordSize;
+        index = 0;
+        if (count == 0) {
+            file.close();
+            file = File();
+        }
+    }
+    return buffer + index * recordSize;
+}
@@ -0,0 +1,33 @@
+#ifndef RECORD_READER_H
+#define RECORD_READER_H
+
+#include <Arduino.h>
+#include <FS.h>
+
+// Sequential reader over the previous and current generation of one
+// storage file (e.g. SAMPLES_FILE_OLD, then SAMPLES_FILE). Records are read
+// a buffer at a time, so scanning any amount of history costs this object.
+class RecordReader {
+public:
+  RecordReader(const char* oldPath, const char* path, size_t recordSize, bool enabled = true);
+
+  // Current record, nullptr at the end of both files
+  const uint8_t* peek();
+  void pop() { index++; }
+
+  // Before the first peek(): start that many records in, across both files
+  void skip(size_t records) { skipCount += records; }
+
+private:
+  static const size_t BUFFER_SIZE = 384;  // multiple of both record sizes
+  const char* paths[2];
+  int pathIndex;
+  File file;
+  size_t recordSize;
+  uint8_t buffer[BUFFER_SIZE];
+  size_t count = 0;
+  size_t index = 0;
+  size_t skipCount = 0;
+};
+
+#endif
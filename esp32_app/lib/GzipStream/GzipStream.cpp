@@ -0,0 +1,238 @@
+#include "GzipStream.h"
+#include "../../include/trace.h"
+#include <algorithm>
+
+// RFC 1951 length/distance code tables
+static const uint16_t LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t LENGTH_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t DIST_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t DIST_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// Nibble-wise CRC-32 (IEEE), 64 bytes of table instead of 1 KB
+static const uint32_t CRC_TABLE[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+
+static GzipStream::Totals streamTotals;
+
+GzipStream::GzipStream(Source source, void* context) : source(source), context(context) {
+    memset(head, 0, sizeof(head));
+}
+
+uint32_t GzipStream::updateCrc(uint32_t crc, const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ CRC_TABLE[crc & 0x0F];
+        crc = (crc >> 4) ^ CRC_TABLE[crc & 0x0F];
+    }
+    return crc;
+}
+
+size_t GzipStream::read(uint8_t* dst, size_t maxLen) {
+    uint32_t started = micros();
+    size_t written = 0;
+
+    while (written < maxLen) {
+        // Drain what is already encoded
+        if (outHead < outTail) {
+            size_t n = std::min(maxLen - written, outTail - outHead);
+            memcpy(dst + written, out + outHead, n);
+            outHead += n;
+            written += n;
+            totalOut += n;
+            continue;
+        }
+        if (state == State::Done) break;
+        compactOut();
+
+        // Encode until the output buffer is nearly full (one step emits < 8 bytes)
+        while (outFree() >= 16 && state != State::Done) {
+            switch (state) {
+                case State::Header: {
+                    static const uint8_t header[10] = {0x1F, 0x8B, 0x08, 0, 0, 0, 0, 0, 0, 0xFF};
+                    for (uint8_t b : header) putByte(b);
+                    putBits(0, 1);  // BFINAL = 0
+                    putBits(1, 2);  // BTYPE = fixed Huffman
+                    state = State::Body;
+                    break;
+                }
+                case State::Body:
+                    fillWindow();
+                    if (pos < end) {
+                        encodeStep();
+                    } else {
+                        putLiteral(256);  // end of the data block
+                        putBits(1, 1);    // empty final block
+                        putBits(1, 2);
+                        putLiteral(256);
+                        alignToByte();
+                        state = State::Trailer;
+                    }
+                    break;
+                case State::Trailer: {
+                    uint32_t value = crc ^ 0xFFFFFFFF;
+                    for (int i = 0; i < 4; i++) putByte((value >> (8 * i)) & 0xFF);
+                    for (int i = 0; i < 4; i++) putByte((totalIn >> (8 * i)) & 0xFF);
+                    state = State::Done;
+                    break;
+                }
+                case State::Done:
+                    break;
+            }
+        }
+    }
+
+    busyUs += micros() - started;
+    if (state == State::Done && outHead == outTail && written > 0) finish();
+    return written;
+}
+
+void GzipStream::finish() {
+    // Once per stream: the read that hands out the last byte
+    streamTotals.streams++;
+    streamTotals.bytesIn += totalIn;
+    streamTotals.bytesOut += totalOut;
+    streamTotals.busyUs += busyUs;
+    TRACE(WEB_GZIP, (unsigned)totalIn, (unsigned)totalOut);
+}
+
+GzipStream::Totals GzipStream::totals() {
+    return streamTotals;
+}
+
+String GzipStream::summary() {
+    const Totals& t = streamTotals;
+    if (t.streams == 0) return "gzip idle";
+    float ratio = t.bytesOut ? (float)t.bytesIn / t.bytesOut : 0;
+    float usPerKb = t.bytesIn ? t.busyUs * 1024.0f / t.bytesIn : 0;
+    return "gzip " + String(t.streams) + " responses, " + String((unsigned long)(t.bytesIn / 1024)) + " -> " +
+           String((unsigned long)(t.bytesOut / 1024)) + " KB (" + String(ratio, 1) + "x), " +
+           String(usPerKb, 0) + " us/KB";
+}
+
+void GzipStream::fillWindow() {
+    while (!sourceDone && end - pos < MAX_MATCH) {
+        if (end == sizeof(window)) {
+            // Slide the second half down; hash entries pointing below it expire
+            memmove(window, window + WINDOW_SIZE, end - WINDOW_SIZE);
+            pos -= WINDOW_SIZE;
+            end -= WINDOW_SIZE;
+            for (size_t i = 0; i < HASH_SIZE; i++) {
+                head[i] = head[i] > WINDOW_SIZE ? head[i] - WINDOW_SIZE : 0;
+            }
+        }
+
+        size_t n = source(context, window + end, sizeof(window) - end);
+        if (n == 0) {
+            sourceDone = true;
+            break;
+        }
+        crc = updateCrc(crc, window + end, n);
+        totalIn += n;
+        end += n;
+    }
+}
+
+void GzipStream::insertHash(size_t at) {
+    uint32_t key = ((uint32_t)window[at] << 16) | ((uint32_t)window[at + 1] << 8) | window[at + 2];
+    head[(key * 2654435761u) >> (32 - HASH_BITS)] = at + 1;
+}
+
+bool GzipStream::encodeStep() {
+    size_t avail = end - pos;
+
+    if (avail >= MIN_MATCH) {
+        uint32_t key = ((uint32_t)window[pos] << 16) | ((uint32_t)window[pos + 1] << 8) | window[pos + 2];
+        uint32_t slot = (key * 2654435761u) >> (32 - HASH_BITS);
+        size_t candidate = head[slot];
+        head[slot] = pos + 1;
+
+        if (candidate) {
+            size_t from = candidate - 1;
+            size_t limit = std::min(avail, (size_t)MAX_MATCH);
+            size_t len = 0;
+            while (len < limit && window[from + len] == window[pos + len]) len++;
+
+            if (len >= MIN_MATCH) {
+                putMatch(len, pos - from);
+                for (size_t i = 1; i < len && pos + i + MIN_MATCH <= end; i++) {
+                    insertHash(pos + i);
+                }
+                pos += len;
+                return true;
+            }
+        }
+    }
+
+    putLiteral(window[pos++]);
+    return false;
+}
+
+void GzipStream::putByte(uint8_t b) {
+    out[outTail++] = b;
+}
+
+void GzipStream::putBits(uint32_t value, uint8_t count) {
+    bitBuffer |= value << bitCount;
+    bitCount += count;
+    while (bitCount >= 8) {
+        putByte(bitBuffer & 0xFF);
+        bitBuffer >>= 8;
+        bitCount -= 8;
+    }
+}
+
+void GzipStream::putHuffman(uint32_t code, uint8_t length) {
+    // Huffman codes are packed most significant bit first
+    uint32_t reversed = 0;
+    for (uint8_t i = 0; i < length; i++) {
+        reversed = (reversed << 1) | (code & 1);
+        code >>= 1;
+    }
+    putBits(reversed, length);
+}
+
+void GzipStream::putLiteral(uint16_t symbol) {
+    if (symbol <= 143) {
+        putHuffman(0x30 + symbol, 8);
+    } else if (symbol <= 255) {
+        putHuffman(0x190 + symbol - 144, 9);
+    } else if (symbol <= 279) {
+        putHuffman(symbol - 256, 7);
+    } else {
+        putHuffman(0xC0 + symbol - 280, 8);
+    }
+}
+
+void GzipStream::putMatch(size_t length, size_t distance) {
+    int code = 28;
+    while (LENGTH_BASE[code] > length) code--;
+    putLiteral(257 + code);
+    putBits(length - LENGTH_BASE[code], LENGTH_EXTRA[code]);
+
+    int dcode = 29;
+    while (DIST_BASE[dcode] > distance) dcode--;
+    putHuffman(dcode, 5);
+    putBits(distance - DIST_BASE[dcode], DIST_EXTRA[dcode]);
+}
+
+void GzipStream::alignToByte() {
+    if (bitCount > 0) {
+        putByte(bitBuffer & 0xFF);
+        bitBuffer = 0;
+        bitCount = 0;
+    }
+}
+
+void GzipStream::compactOut() {
+    outHead = 0;
+    outTail = 0;
+}
@@ -0,0 +1,86 @@
+#ifndef GZIP_STREAM_H
+#define GZIP_STREAM_H
+
+#include <Arduino.h>
+
+// Pull-based gzip encoder for chunked HTTP responses.
+// Raw bytes are pulled from a source callback and compressed with a single
+// fixed-Huffman deflate block over a small sliding window, so memory use is
+// constant (about 6.5 KB per stream) no matter how much data flows through.
+// Holds no resources, so it can live in a request arena lease.
+//
+// Completed streams add to process-wide totals (bytes in and out, time spent
+// compressing) for the health log, and trace one WEB_GZIP record each.
+class GzipStream {
+public:
+  // Fills up to maxLen bytes, returns 0 once the source is exhausted
+  using Source = size_t (*)(void* context, uint8_t* buffer, size_t maxLen);
+
+  struct Totals {
+    uint32_t streams;
+    uint64_t bytesIn;
+    uint64_t bytesOut;
+    uint64_t busyUs;
+  };
+
+  GzipStream(Source source, void* context);
+
+  // Same contract as an AsyncWebServer chunked callback: returns 0 when done
+  size_t read(uint8_t* out, size_t maxLen);
+
+  bool finished() const { return state == State::Done && outHead == outTail; }
+  size_t bytesIn() const { return totalIn; }
+  size_t bytesOut() const { return totalOut; }
+  uint32_t busyMicros() const { return busyUs; }
+
+  static Totals totals();
+  // Totals for the health log: ratio and cost per KB of input
+  static String summary();
+
+private:
+  static const size_t WINDOW_SIZE = 2048;
+  static const size_t HASH_BITS = 10;
+  static const size_t HASH_SIZE = 1 << HASH_BITS;
+  static const size_t OUT_SIZE = 512;
+  static const size_t MIN_MATCH = 3;
+  static const size_t MAX_MATCH = 258;
+
+  enum class State { Header, Body, Trailer, Done };
+
+  Source source;
+  void* context;
+  State state = State::Header;
+  bool sourceDone = false;
+
+  uint8_t window[WINDOW_SIZE * 2];
+  uint16_t head[HASH_SIZE];   // position + 1 of the latest string per hash, 0 = empty
+  size_t pos = 0;             // next byte to encode
+  size_t end = 0;             // end of valid input in window
+
+  uint8_t out[OUT_SIZE];
+  size_t outHead = 0;
+  size_t outTail = 0;
+  uint32_t bitBuffer = 0;
+  uint8_t bitCount = 0;
+
+  uint32_t crc = 0xFFFFFFFF;
+  size_t totalIn = 0;
+  size_t totalOut = 0;
+  uint32_t busyUs = 0;
+
+  void fillWindow();
+  bool encodeStep();
+  void insertHash(size_t at);
+  void putByte(uint8_t b);
+  void putBits(uint32_t value, uint8_t count);
+  void putHuffman(uint32_t code, uint8_t length);
+  void putLiteral(uint16_t symbol);
+  void putMatch(size_t length, size_t distance);
+  void alignToByte();
+  size_t outFree() const { return OUT_SIZE - outTail; }
+  void compactOut();
+  void finish();
+  static uint32_t updateCrc(uint32_t crc, const uint8_t* data, size_t len);
+};
+
+#endif
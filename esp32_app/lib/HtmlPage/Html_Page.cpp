@@ -1,30 +1,210 @@
 #include "html_page.h"
+#include "../../include/config_schema.h"
+#include "../../include/heap_profiler.h"
 #include <ArduinoJson.h>
 
 SystemState* HtmlPage::systemState = nullptr;
-AppConfig* HtmlPage::config = nullptr;
+
+// Included by name from every page template
+const TemplateStream::Include HtmlPage::PARTS[] = {
+    { "CSS", HtmlPage::CSS },
+    { "HEADER", HtmlPage::HEADER },
+    { "FOOTER", HtmlPage::FOOTER },
+};
 
 void HtmlPage::setSystemState(SystemState* state) {
     systemState = state;
 }
 
-void HtmlPage::setConfig(AppConfig* cfg) {
-    config = cfg;
+TemplateStream HtmlPage::page(const char* text, const void* context) {
+    return TemplateStream(text, PARTS, sizeof(PARTS) / sizeof(PARTS[0]), fillPlaceholder, context);
+}
+
+void HtmlPage::capture(PageValues& values, const char* message) {
+    values.config = config();
+    strlcpy(values.wifiMode, systemState ? systemState->wifiMode.c_str() : "", sizeof(values.wifiMode));
+    values.message = message ? message : "";
+}
+
+TemplateStream HtmlPage::dashboard(const PageValues& values) {
+    if (!systemState) return page("<html><body><h1>System Initializing...</h1><p>Please wait.</p></body></html>");
+    return page(DASHBOARD_PAGE, &values);
+}
+
+TemplateStream HtmlPage::configPage(const PageValues& values) {
+    return page(CONFIG_PAGE, &values);
+}
+
+TemplateStream HtmlPage::historyPage(const PageValues& values) {
+    if (!systemState) return page("History unavailable");
+    return page(HISTORY_PAGE, &values);
+}
+
+TemplateStream HtmlPage::errorPage(const PageValues& values) {
+    return page(ERROR_PAGE, &values);
+}
+
+bool HtmlPage::fillPlaceholder(const char* name, uint16_t index, Print& out, const void* context) {
+    // The only values that change between requests; everything else is template text
+    const PageValues& values = *static_cast<const PageValues*>(context);
+    if (strcmp(name, "FORM_FIELDS") == 0) return writeConfigField(index, out, values.config);
+
+    if (strcmp(name, "THRESHOLD") == 0) {
+        out.print(values.config.system.distance_threshold, 1);
+    } else if (strcmp(name, "REFRESH_MS") == 0) {
+        out.print(values.config.system.web_refresh_interval * 1000);
+    } else if (strcmp(name, "WIFI_MODE") == 0) {
+        writeEscaped(out, values.wifiMode);
+    } else if (strcmp(name, "MESSAGE") == 0) {
+        writeEscaped(out, values.message);
+    }
+    return false;
+}
+
+void HtmlPage::writeAPIResponse(Print& out) {
+    HEAP_TAG("web");
+    if (!systemState) {
+        out.print("{}");
+        return;
+    }
+
+    StaticJsonDocument<1024> doc; // Increased size for history array
+    doc["distance"] = systemState->currentData.distance;
+    doc["object_detected"] = systemState->currentData.object_detected;
+    doc["status"] = systemState->currentData.status.c_str();
+    doc["timestamp"] = systemState->currentData.timestamp;
+    
+    // New fields from Pi
+    doc["mode"] = systemState->currentData.mode;
+    doc["alert_active"] = systemState->currentData.alert_active;
+    
+    JsonArray history = doc.createNestedArray("pi_history");
+    for(int i=0; i<5; i++) {
+        history.add(systemState->currentData.pi_history[i]);
+    }
+    
+    doc["uptime"] = systemState->systemUptime;
+    doc["free_memory"] = ESP.getFreeHeap();
+    doc["wifi_connected"] = systemState->wifiConnected;
+    doc["wifi_mode"] = systemState->wifiMode.c_str();
+    doc["threshold"] = config().system.distance_threshold;
+    doc["boot_count"] = systemState->bootCount;
+    doc["sample_count"] = systemState->sampleCount;
+    doc["alert_count"] = systemState->alertCount;
+    
+    serializeJson(doc, out);
+}
+
+void HtmlPage::writeHistoryJson(Print& out) {
+    HEAP_TAG("web");
+    if (!systemState) {
+        out.print("{\"history\":[]}");
+        return;
+    }
+
+    // Printed item by item: a JsonDocument for the whole history took 4 KB
+    // of the async_tcp stack and silently dropped entries past its capacity
+    out.print("{\"history\":[");
+    int count = systemState->getHistoryCount();
+    for (int i = 0; i < count; i++) {
+        SensorData data = systemState->getHistory(i);
+        if (i > 0) out.print(',');
+        out.print("{\"distance\":");
+        out.print(data.distance, 2);
+        out.print(",\"timestamp\":");
+        out.print(data.timestamp);
+        out.print(",\"object_detected\":");
+        out.print(data.object_detected ? "true" : "false");
+        out.print('}');
+    }
+    out.print("]}");
 }
 
-String HtmlPage::generateDashboard() {
-    if (!systemState || !config) return "<html><body><h1>System Initializing...</h1><p>Please wait.</p></body></html>";
+bool HtmlPage::writeConfigField(uint16_t index, Print& out, const AppConfig& cfg) {
+    // One form control per CFG_FORM field in the schema, one field per call
+    const ConfigField& field = CONFIG_FIELDS[index];
+    bool more = index + 1u < CONFIG_FIELD_COUNT;
+    if (!(field.flags & CFG_FORM)) return more;
+
+    out.print("                <div class=\"form-group\">\n");
+    out.print("                    <label>");
+    out.print(field.label);
+    out.print("</label>\n");
+
+    if (field.type == ConfigType::Bool) {
+        bool enabled = ConfigSchema::numberValue(field, cfg) != 0;
+        out.print("                    <select name=\"");
+        out.print(field.key);
+        out.print("\">\n");
+        out.print("                        <option value=\"true\" ");
+        out.print(enabled ? "selected" : "");
+        out.print(">Enabled</option>\n");
+        out.print("                        <option value=\"false\" ");
+        out.print(!enabled ? "selected" : "");
+        out.print(">Disabled</option>\n");
+        out.print("                    </select>\n");
+    } else if (field.type == ConfigType::String) {
+        bool secret = field.flags & CFG_SECRET;
+        const char* value = ConfigSchema::textValue(field, cfg);
+        out.print("                    <input type=\"");
+        out.print(secret ? "password" : "text");
+        out.print("\" name=\"");
+        out.print(field.key);
+        out.print("\" maxlength=\"");
+        out.print(field.size - 1);
+        out.print("\"");
+        if (secret) {
+            out.print(" value=\"\" placeholder=\"");
+            out.print(value[0] ? "unchanged" : "not set");
+        } else {
+            out.print(" value=\"");
+            writeEscaped(out, value);
+        }
+        out.print("\">\n");
+    } else {
+        double value = ConfigSchema::numberValue(field, cfg);
+        out.print("                    <input type=\"number\" name=\"");
+        out.print(field.key);
+        out.print("\" value=\"");
+        if (field.type == ConfigType::Float) {
+            out.print(value, 1);
+        } else {
+            out.print(lround(value));
+        }
+        out.print("\" step=\"");
+        out.print(field.type == ConfigType::Float ? "0.1" : "1");
+        out.print("\" min=\"");
+        out.print(field.minValue, 0);
+        out.print("\" max=\"");
+        out.print(field.maxValue, 0);
+        out.print("\">\n");
+    }
+    out.print("                </div>\n");
+    return more;
+}
 
-    String html = R"rawliteral(<!DOCTYPE html>
+void HtmlPage::writeEscaped(Print& out, const char* text) {
+    for (; *text; text++) {
+        switch (*text) {
+            case '&': out.print("&amp;"); break;
+            case '<': out.print("&lt;"); break;
+            case '>': out.print("&gt;"); break;
+            case '"': out.print("&quot;"); break;
+            default: out.print(*text);
+        }
+    }
+}
+
+const char HtmlPage::DASHBOARD_PAGE[] = R"rawliteral(<!DOCTYPE html>
 <html lang="en">
 <head>
     <meta charset="UTF-8">
     <meta name="viewport" content="width=device-width, initial-scale=1.0">
     <title>ESP32 Surveillance Dashboard</title>
-    <style>)rawliteral" + getCSS() + R"rawliteral(</style>
+    <style>{{CSS}}</style>
 </head>
 <body>
-    )rawliteral" + getHeader() + R"rawliteral(
+    {{HEADER}}
     
     <div class="container fade-in">
         <div class="dashboard-grid">
@@ -50,7 +230,7 @@ String HtmlPage::generateDashboard() {
                 <div class="progress-bar-bg">
                     <div id="distance-bar" class="progress-bar" style="width: 0%"></div>
                 </div>
-                <p class="metric-sub">Threshold: )rawliteral" + String(config->system.distance_threshold, 1) + R"rawliteral( cm</p>
+                <p class="metric-sub">Threshold: {{THRESHOLD}} cm</p>
             </div>
 
             <!-- Pi Data -->
@@ -67,7 +247,7 @@ String HtmlPage::generateDashboard() {
             <div class="card info-card">
                 <h3>System Info</h3>
                 <ul class="info-list">
-                    <li><span>WiFi Mode:</span> <span>)rawliteral" + systemState->wifiMode + R"rawliteral(</span></li>
+                    <li><span>WiFi Mode:</span> <span>{{WIFI_MODE}}</span></li>
                     <li><span>Uptime:</span> <span id="uptime">--</span></li>
                     <li><span>Memory:</span> <span id="memory">--</span></li>
                     <li><span>Timestamp:</span> <span id="timestamp">--</span></li>
@@ -86,11 +266,11 @@ String HtmlPage::generateDashboard() {
         </div>
     </div>
 
-    )rawliteral" + getFooter() + R"rawliteral(
+    {{FOOTER}}
 
     <script>
-        const REFRESH_INTERVAL = )rawliteral" + String(config->system.web_refresh_interval * 1000) + R"rawliteral(;
-        const threshold = )rawliteral" + String(config->system.distance_threshold) + R"rawliteral(;
+        const REFRESH_INTERVAL = {{REFRESH_MS}};
+        const threshold = {{THRESHOLD}};
         
         function updateDashboard() {
             fetch('/api/status')
@@ -170,70 +350,22 @@ String HtmlPage::generateDashboard() {
 </body>
 </html>
 )rawliteral";
-    return html;
-}
-
-String HtmlPage::generateAPIResponse() {
-    if (!systemState || !config) return "{}";
 
-    StaticJsonDocument<1024> doc; // Increased size for history array
-    doc["distance"] = systemState->currentData.distance;
-    doc["object_detected"] = systemState->currentData.object_detected;
-    doc["status"] = systemState->currentData.status;
-    doc["timestamp"] = systemState->currentData.timestamp;
-    
-    // New fields from Pi
-    doc["mode"] = systemState->currentData.mode;
-    doc["alert_active"] = systemState->currentData.alert_active;
-    
-    JsonArray history = doc.createNestedArray("pi_history");
-    for(int i=0; i<5; i++) {
-        history.add(systemState->currentData.pi_history[i]);
-    }
-    
-    doc["uptime"] = systemState->systemUptime;
-    doc["free_memory"] = ESP.getFreeHeap();
-    doc["wifi_connected"] = systemState->wifiConnected;
-    doc["wifi_mode"] = systemState->wifiMode;
-    doc["threshold"] = config->system.distance_threshold;
-    
-    String response;
-    serializeJson(doc, response);
-    return response;
-}
-
-String HtmlPage::generateConfigPage() {
-    if (!config) return "Config not loaded";
-    
-    String html = R"rawliteral(<!DOCTYPE html>
+const char HtmlPage::CONFIG_PAGE[] = R"rawliteral(<!DOCTYPE html>
 <html lang="en">
 <head>
     <meta charset="UTF-8">
     <meta name="viewport" content="width=device-width, initial-scale=1.0">
     <title>Configuration</title>
-    <style>)rawliteral" + getCSS() + R"rawliteral(</style>
+    <style>{{CSS}}</style>
 </head>
 <body>
-    )rawliteral" + getHeader() + R"rawliteral(
+    {{HEADER}}
     <div class="container fade-in">
         <div class="card">
             <h2>⚙️ System Configuration</h2>
             <form id="configForm">
-                <div class="form-group">
-                    <label>Distance Threshold (cm)</label>
-                    <input type="number" name="threshold" value=")rawliteral" + String(config->system.distance_threshold) + R"rawliteral(" step="0.1" min="1" max="400">
-                </div>
-                <div class="form-group">
-                    <label>Alert Cooldown (seconds)</label>
-                    <input type="number" name="cooldown" value=")rawliteral" + String(config->system.alert_cooldown / 1000) + R"rawliteral(" min="1">
-                </div>
-                <div class="form-group">
-                    <label>Telegram Alerts</label>
-                    <select name="telegram">
-                        <option value="true" )rawliteral" + (config->telegram.enable_telegram ? "selected" : "") + R"rawliteral(>Enabled</option>
-                        <option value="false" )rawliteral" + (!config->telegram.enable_telegram ? "selected" : "") + R"rawliteral(>Disabled</option>
-                    </select>
-                </div>
+{{FORM_FIELDS}}
                 <div class="form-actions">
                     <button type="submit" class="btn btn-primary">Save Changes</button>
                     <button type="button" onclick="location.href='/'" class="btn btn-secondary">Cancel</button>
@@ -251,32 +383,31 @@ String HtmlPage::generateConfigPage() {
                 headers: {'Content-Type': 'application/json'},
                 body: JSON.stringify(data)
             }).then(res => res.json()).then(res => {
+                if (res.status !== 'ok') {
+                    alert('Error: ' + res.message);
+                    return;
+                }
                 alert('Saved!');
                 location.href = '/';
             }).catch(err => alert('Error: ' + err));
         });
     </script>
-    )rawliteral" + getFooter() + R"rawliteral(
+    {{FOOTER}}
 </body>
 </html>
 )rawliteral";
-    return html;
-}
-
-String HtmlPage::generateHistoryPage() {
-     if (!systemState) return "History unavailable";
 
-    String html = R"rawliteral(<!DOCTYPE html>
+const char HtmlPage::HISTORY_PAGE[] = R"rawliteral(<!DOCTYPE html>
 <html lang="en">
 <head>
     <meta charset="UTF-8">
     <meta name="viewport" content="width=device-width, initial-scale=1.0">
     <title>History Data</title>
     <script src="https://cdn.jsdelivr.net/npm/chart.js"></script>
-    <style>)rawliteral" + getCSS() + R"rawliteral(</style>
+    <style>{{CSS}}</style>
 </head>
 <body>
-    )rawliteral" + getHeader() + R"rawliteral(
+    {{HEADER}}
     <div class="container fade-in">
         <div class="card">
             <h2>📈 Distance History</h2>
@@ -293,30 +424,44 @@ String HtmlPage::generateHistoryPage() {
         </div>
     </div>
     <script>
+        function drawChart(labels, values) {
+            new Chart(document.getElementById('historyChart'), {
+                type: 'line',
+                data: {
+                    labels: labels,
+                    datasets: [{
+                        label: 'Distance (cm)',
+                        data: values,
+                        borderColor: '#33b5e5',
+                        pointRadius: 0,
+                        tension: 0.4
+                    }]
+                },
+                options: { responsive: true, maintainAspectRatio: false }
+            });
+        }
+
+        function timeLabel(t) {
+            // Epoch seconds once NTP has synced, uptime seconds before
+            return t > 1000000000 ? new Date(t * 1000).toLocaleString() : Math.round(t) + ' s';
+        }
+
         function loadHistory() {
-            fetch('/api/history').then(r => r.json()).then(data => {
-                const history = data.history;
-                const labels = history.map((_, i) => i); // Simple index or timestamp
-                const values = history.map(h => h.distance);
-                
-                // Update Chart
-                new Chart(document.getElementById('historyChart'), {
-                    type: 'line',
-                    data: {
-                        labels: labels,
-                        datasets: [{
-                            label: 'Distance (cm)',
-                            data: values,
-                            borderColor: '#33b5e5',
-                            tension: 0.4
-                        }]
-                    },
-                    options: { responsive: true, maintainAspectRatio: false }
+            // Chart: stored samples, downsampled on the ESP32 to a few hundred points
+            fetch('/api/chart?points=300').then(r => r.ok ? r.json() : Promise.reject()).then(data => {
+                drawChart(data.points.map(p => timeLabel(p[0])), data.points.map(p => p[1]));
+            }).catch(() => {
+                // No storage: chart the in-memory history instead
+                fetch('/api/history').then(r => r.json()).then(data => {
+                    const history = data.history.slice().reverse();
+                    drawChart(history.map(h => h.timestamp), history.map(h => h.distance));
                 });
+            });
 
-                // Update Table
+            // Table: latest readings
+            fetch('/api/history').then(r => r.json()).then(data => {
                 const tbody = document.getElementById('historyTableBody');
-                tbody.innerHTML = history.slice(0, 10).map(h => `
+                tbody.innerHTML = data.history.slice(0, 10).map(h => `
                     <tr>
                         <td>${h.timestamp}</td>
                         <td>${h.distance.toFixed(1)} cm</td>
@@ -327,35 +472,30 @@ String HtmlPage::generateHistoryPage() {
         }
         loadHistory();
     </script>
-    )rawliteral" + getFooter() + R"rawliteral(
+    {{FOOTER}}
 </body>
 </html>
 )rawliteral";
-    return html;
-}
 
-String HtmlPage::generateErrorPage(const String& message) {
-    return R"rawliteral(
+const char HtmlPage::ERROR_PAGE[] = R"rawliteral(
 <!DOCTYPE html>
 <html>
-<head><title>Error</title><style>)rawliteral" + getCSS() + R"rawliteral(</style></head>
+<head><title>Error</title><style>{{CSS}}</style></head>
 <body>
-    )rawliteral" + getHeader() + R"rawliteral(
+    {{HEADER}}
     <div class="container">
         <div class="card" style="text-align:center; color: #ff4444;">
             <h1>⚠️ Error</h1>
-            <p>)rawliteral" + message + R"rawliteral(</p>
+            <p>{{MESSAGE}}</p>
             <button onclick="location.href='/'" class="btn btn-primary">Go Home</button>
         </div>
     </div>
-    )rawliteral" + getFooter() + R"rawliteral(
+    {{FOOTER}}
 </body>
 </html>
 )rawliteral";
-}
 
-String HtmlPage::getHeader() {
-    return R"rawliteral(
+const char HtmlPage::HEADER[] = R"rawliteral(
     <header class="main-header">
         <div class="logo">🛡️ ESP32 Surveillance</div>
         <nav>
@@ -365,23 +505,14 @@ String HtmlPage::getHeader() {
         </nav>
     </header>
     )rawliteral";
-}
 
-String HtmlPage::getFooter() {
-    return R"rawliteral(
+const char HtmlPage::FOOTER[] = R"rawliteral(
     <footer class="main-footer">
         <p>ESP32 Surveillance System v3.0 | Powered by PlatformIO</p>
     </footer>
     )rawliteral";
-}
 
-String HtmlPage::formatTimestamp(unsigned long timestamp) {
-    // Simple helper
-    return String(timestamp);
-}
-
-String HtmlPage::getCSS() {
-    return R"rawliteral(
+const char HtmlPage::CSS[] = R"rawliteral(
         :root {
             --bg-color: #1a1a2e;
             --card-bg: #16213e;
@@ -534,4 +665,3 @@ String HtmlPage::getCSS() {
             background: rgba(255, 68, 68, 0.1);
         }
     )rawliteral";
-}
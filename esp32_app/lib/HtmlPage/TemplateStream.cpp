@@ -0,0 +1,110 @@
+#include "TemplateStream.h"
+
+// Print over the free part of the output buffer. Drops the first `skip`
+// bytes (sent by an earlier read) and whatever doesn't fit, but counts
+// everything so the caller can tell whether the item was complete.
+class WindowPrint : public Print {
+public:
+    WindowPrint(uint8_t* out, size_t room, size_t skip) : out(out), room(room), skip(skip) {}
+
+    size_t write(uint8_t c) override {
+        if (total++ >= skip && written < room) out[written++] = c;
+        return 1;
+    }
+    using Print::write;
+
+    uint8_t* out;
+    size_t room;
+    size_t skip;
+    size_t written = 0;
+    size_t total = 0;
+};
+
+TemplateStream::TemplateStream(const char* text, const Include* includes, size_t includeCount,
+                               Fill fill, const void* context)
+    : includes(includes), includeCount(includeCount), fill(fill), context(context) {
+    frames[0] = text;
+    depth = 1;
+    name[0] = '\0';
+}
+
+size_t TemplateStream::read(uint8_t* out, size_t maxLen) {
+    size_t written = 0;
+
+    while (written < maxLen) {
+        if (filling) {
+            // Stop here if the item was cut; the rest goes out next time
+            if (!fillItem(out + written, maxLen - written, written)) break;
+            continue;
+        }
+        if (depth == 0) break;
+
+        const char*& p = frames[depth - 1];
+        if (*p == '\0') {
+            depth--;
+            continue;
+        }
+        if (p[0] == '{' && p[1] == '{') {
+            if (openPlaceholder()) continue;
+            // Braces that don't open a placeholder are text
+            out[written++] = *p++;
+        }
+
+        // Literal text up to the next placeholder
+        while (written < maxLen && *p && !(p[0] == '{' && p[1] == '{')) {
+            out[written++] = *p++;
+        }
+    }
+    return written;
+}
+
+bool TemplateStream::fillItem(uint8_t* out, size_t room, size_t& written) {
+    WindowPrint window(out, room, itemSent);
+    bool more = fill(name, item, window, context);
+    written += window.written;
+
+    if (window.total > itemSent + window.written) {
+        itemSent += window.written;
+        return false;
+    }
+    itemSent = 0;
+    if (more) {
+        item++;
+    } else {
+        filling = false;
+    }
+    return true;
+}
+
+bool TemplateStream::openPlaceholder() {
+    const char*& p = frames[depth - 1];
+    const char* start = p + 2;
+    size_t length = 0;
+    while (length < MAX_NAME && start[length] && !(start[length] == '}' && start[length + 1] == '}')) {
+        length++;
+    }
+    // No "}}" within MAX_NAME: not a placeholder, leave it for the caller
+    if (length >= MAX_NAME || !start[length]) return false;
+
+    memcpy(name, start, length);
+    name[length] = '\0';
+    p = start + length + 2;
+
+    const char* include = findInclude(name);
+    if (include) {
+        if (depth < MAX_DEPTH) frames[depth++] = include;
+        return true;
+    }
+    if (!fill) return true;
+    filling = true;
+    item = 0;
+    itemSent = 0;
+    return true;
+}
+
+const char* TemplateStream::findInclude(const char* key) const {
+    for (size_t i = 0; i < includeCount; i++) {
+        if (strcmp(includes[i].name, key) == 0) return includes[i].text;
+    }
+    return nullptr;
+}
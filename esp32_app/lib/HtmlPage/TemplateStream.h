@@ -0,0 +1,59 @@
+#ifndef TEMPLATE_STREAM_H
+#define TEMPLATE_STREAM_H
+
+#include <Arduino.h>
+
+// Pull-based renderer for page templates kept in flash.
+// A template is plain text with {{NAME}} placeholders. Names found in the
+// include table are replaced by another flash template (the shared CSS,
+// header and footer), everything else by the fill callback. A "{{" with no
+// "}}" within MAX_NAME characters is not a placeholder and goes out as
+// text. The output goes straight into the caller's buffer, so memory use
+// is this object (well under 100 bytes) no matter how large the page is.
+//
+// One placeholder can expand to a list: fill() is called with index 0, 1, ...
+// for as long as it returns true. When an item doesn't fit in the rest of
+// the buffer it is rendered again on the next read() and the part already
+// sent is skipped, so fill() must print the same text for the same index:
+// take values that can change from a snapshot passed as context.
+class TemplateStream {
+public:
+  // Prints item `index` of placeholder `name`; true if there is an item index + 1
+  using Fill = bool (*)(const char* name, uint16_t index, Print& out, const void* context);
+
+  struct Include {
+    const char* name;
+    const char* text;
+  };
+
+  TemplateStream(const char* text, const Include* includes, size_t includeCount, Fill fill,
+                 const void* context = nullptr);
+
+  // Same contract as an AsyncWebServer chunked callback: returns 0 when done
+  size_t read(uint8_t* out, size_t maxLen);
+
+  bool finished() const { return depth == 0 && !filling; }
+
+private:
+  static const int MAX_DEPTH = 3;        // page -> include -> include
+  static const size_t MAX_NAME = 24;
+
+  const Include* includes;
+  size_t includeCount;
+  Fill fill;
+  const void* context;
+
+  const char* frames[MAX_DEPTH];         // read position per nesting level
+  int depth = 0;
+
+  char name[MAX_NAME];                   // placeholder being filled
+  bool filling = false;
+  uint16_t item = 0;
+  size_t itemSent = 0;                   // bytes of the current item already sent
+
+  bool fillItem(uint8_t* out, size_t room, size_t& written);
+  bool openPlaceholder();  // false if p isn't at a placeholder
+  const char* findInclude(const char* key) const;
+};
+
+#endif
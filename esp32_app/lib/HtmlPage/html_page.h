@@ -8,30 +8,56 @@
 // Using relative paths to ensure they are found regardless of include path settings
 #include "../../include/state.h"
 #include "../../include/config.h"
+#include "TemplateStream.h"
 
 class HtmlPage {
 public:
+    // Everything a page shows that can change while it streams, copied once
+    // when the page starts. A page goes out over many chunks, and an item cut
+    // at a chunk boundary is rendered again, so every chunk has to see the
+    // same values. Lives next to the page's TemplateStream in its lease.
+    struct PageValues {
+        AppConfig config;
+        char wifiMode[16];
+        const char* message;   // errorPage(), a string literal
+    };
+
+    typedef TemplateStream (*Page)(const PageValues& values);
+
     // Set external dependencies
     static void setSystemState(SystemState* state);
-    static void setConfig(AppConfig* cfg);
-    
-    // Page Generators
-    static String generateDashboard();
-    static String generateAPIResponse();
-    static String generateConfigPage();
-    static String generateHistoryPage();
-    static String generateErrorPage(const String& message);
+
+    static void capture(PageValues& values, const char* message = nullptr);
+
+    // HTML pages, streamed from templates in flash (see TemplateStream.h);
+    // values must outlive the stream
+    static TemplateStream dashboard(const PageValues& values);
+    static TemplateStream configPage(const PageValues& values);
+    static TemplateStream historyPage(const PageValues& values);
+    static TemplateStream errorPage(const PageValues& values);
+
+    // JSON bodies, printed into out (normally a request arena lease)
+    static void writeAPIResponse(Print& out);
+    static void writeHistoryJson(Print& out);
     
 private:
-    // Helper methods for UI components
-    static String getCSS();
-    static String getHeader();
-    static String getFooter();
-    static String formatTimestamp(unsigned long timestamp);
+    static TemplateStream page(const char* text, const void* context = nullptr);
+    static bool fillPlaceholder(const char* name, uint16_t index, Print& out, const void* context);
+    static bool writeConfigField(uint16_t index, Print& out, const AppConfig& cfg);
+    static void writeEscaped(Print& out, const char* text);
+
+    // Page templates and the parts they include
+    static const char DASHBOARD_PAGE[];
+    static const char CONFIG_PAGE[];
+    static const char HISTORY_PAGE[];
+    static const char ERROR_PAGE[];
+    static const char HEADER[];
+    static const char FOOTER[];
+    static const char CSS[];
+    static const TemplateStream::Include PARTS[];
     
     // Dependencies
     static SystemState* systemState;
-    static AppConfig* config;
 };
 
 #endif
@@ -1,9 +1,14 @@
 #include "MqttModule.h"
-#include <ArduinoJson.h>
+#include "../../include/commands.h"
+#include "../../include/trace.h"
+#include "../../include/heap_profiler.h"
+#include "../../include/boot_arena.h"
 
 
 MqttModule::MqttModule() 
-    : wifiClient(nullptr), mqttClient(nullptr), initialized(false), lastReconnectAttempt(0) {}
+    : wifiClient(nullptr), mqttClient(nullptr), initialized(false), lock(nullptr),
+      server{}, port(0), baseTopic{}, telemetrySeq(0), telemetrySeqLimit(0), telemetrySeqLoaded(false),
+      telemetrySent(0), telemetryBatches(0) {}
 
 MqttModule::~MqttModule() {
     stop();
@@ -12,20 +17,24 @@ MqttModule::~MqttModule() {
 bool MqttModule::begin() {
     if (initialized) return true;
 
-    if (config.mqtt.enable_mqtt) {
-        wifiClient = new WiFiClient();
-        mqttClient = new PubSubClient(*wifiClient);
-        mqttClient->setServer(config.mqtt.server, config.mqtt.port);
+    if (config().mqtt.enable_mqtt) {
+        if (!lock) lock = xSemaphoreCreateRecursiveMutex();
+        wifiClient = bootArena.create<WiFiClient>("MQTT transport");
+        mqttClient = wifiClient ? bootArena.create<PubSubClient>("MQTT client", *wifiClient) : nullptr;
+        if (!mqttClient) return false;
+        refreshServer();
+        // Telemetry batches are larger than PubSubClient's 256-byte default
+        mqttClient->setBufferSize(PACKET_BUFFER_SIZE);
+        refreshTopics();
         mqttClient->setCallback([this](char* topic, byte* payload, unsigned int length) {
             this->callback(topic, payload, length);
         });
         
-        lastReconnectAttempt = 0;
         initialized = true;
         
         Serial.println(" MQTT client initialized");
-        Serial.println(" Server: " + String(config.mqtt.server) + ":" + String(config.mqtt.port));
-        Serial.println(" Topic: " + String(config.mqtt.topic));
+        Serial.println(" Server: " + String(server) + ":" + String(port));
+        Serial.println(" Topic: " + String(config().mqtt.topic));
         
         // Attempt initial connection
         reconnect();
@@ -42,59 +51,91 @@ void MqttModule::stop() {
         mqttClient->disconnect();
     }
     
-    if (mqttClient) {
-        delete mqttClient;
-        mqttClient = nullptr;
-    }
-    
-    if (wifiClient) {
-        delete wifiClient;
-        wifiClient = nullptr;
-    }
+    bootArena.destroy(mqttClient);
+    mqttClient = nullptr;
+    bootArena.destroy(wifiClient);
+    wifiClient = nullptr;
     
     initialized = false;
     Serial.println(" MQTT client stopped");
 }
 
-void MqttModule::callback(char* topic, byte* payload, unsigned int length) {
-    Serial.println(" MQTT message received on topic: " + String(topic));
-    
-    // Convert payload to string
-    String message;
-    for (unsigned int i = 0; i < length; i++) {
-        message += (char)payload[i];
-    }
-    
-    Serial.println(" Message: " + message);
-    
-    // Handle different topics
-    if (String(topic) == String(config.mqtt.topic) + "/command") {
-        handleCommand(message);
-    }
+bool MqttModule::refreshServer() {
+    const MqttConfig& mqtt = config().mqtt;
+    if (strcmp(server, mqtt.server) == 0 && port == mqtt.port) return false;
+
+    strlcpy(server, mqtt.server, sizeof(server));
+    port = mqtt.port;
+    mqttClient->setServer(server, port);
+    return true;
 }
 
-void MqttModule::handleCommand(const String& command) {
-    String lowerCaseCommand = command;
-    lowerCaseCommand.toLowerCase();
-    
-    if (lowerCaseCommand == "status") {
-        publishData(systemState.currentData);
-    } else if (command == "test_alert") {
-        publishAlert("Test alert via MQTT");
-    } else if (command == "restart") {
-        Serial.println(" Restart command received via MQTT");
-        ESP.restart();
+void MqttModule::refreshTopics() {
+    if (strcmp(baseTopic, config().mqtt.topic) == 0) return;
+
+    strlcpy(baseTopic, config().mqtt.topic, sizeof(baseTopic));
+    snprintf(alertTopic, sizeof(alertTopic), "%s/alert", baseTopic);
+    snprintf(commandTopic, sizeof(commandTopic), "%s/command", baseTopic);
+    snprintf(telemetryTopic, sizeof(telemetryTopic), "%s/telemetry", baseTopic);
+    snprintf(replyTopic, sizeof(replyTopic), "%s/reply", baseTopic);
+}
+
+size_t MqttModule::payloadCapacity(const char* topic) const {
+    // PubSubClient's packet holds the fixed header, topic length and topic too
+    return PACKET_BUFFER_SIZE - MQTT_MAX_HEADER_SIZE - 2 - strlen(topic);
+}
+
+bool MqttModule::publishDoc(const char* topic) {
+    size_t length = measureJson(doc);
+    if (length > payloadCapacity(topic)) {
+        TRACE(MQTT_TOO_LARGE, length, topic);
+        return false;
     }
+    serializeJson(doc, payload, sizeof(payload));
+    return mqttClient->publish(topic, (const uint8_t*)payload, length);
+}
+
+void MqttModule::callback(char* topic, byte* message, unsigned int length) {
+    TRACE(MQTT_RX, length, topic);
+
+    if (strcmp(topic, commandTopic) != 0) return;
+
+    // The payload lives in PubSubClient's buffer, which the next publish
+    // overwrites, so take the (short) command out first
+    char command[MAX_COMMAND_LENGTH];
+    size_t n = min((size_t)length, sizeof(command) - 1);
+    memcpy(command, message, n);
+    command[n] = '\0';
+    TRACE(MQTT_COMMAND, command);
+
+    CommandReply reply;
+    commands.dispatch(CMD_MQTT, command, reply);
+
+    doc.clear();
+    doc["command"] = command;
+    doc["ok"] = reply.ok;
+    doc["reply"] = reply.text.c_str();
+    publishDoc(replyTopic);
+    commands.complete(reply);
 }
 
 bool MqttModule::reconnect() {
     if (!initialized) return false;
 
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    bool connected = connectLocked();
+    xSemaphoreGiveRecursive(lock);
+    return connected;
+}
+
+bool MqttModule::connectLocked() {
     if (mqttClient->connected()) {
         return true;
     }
 
     Serial.println(" Attempting MQTT connection...");
+    refreshServer();
+    refreshTopics();
     
     String clientId = "ESP32Surveillance-" + String(random(0xffff), HEX);
     
@@ -102,11 +143,10 @@ bool MqttModule::reconnect() {
         Serial.println(" MQTT connected");
         
         // Subscribe to command topic
-        String commandTopic = String(config.mqtt.topic) + "/command";
-        if (mqttClient->subscribe(commandTopic.c_str())) {
-            Serial.println(" Subscribed to: " + commandTopic);
+        if (mqttClient->subscribe(commandTopic)) {
+            Serial.println(" Subscribed to: " + String(commandTopic));
         } else {
-            Serial.println(" Failed to subscribe to: " + commandTopic);
+            Serial.println(" Failed to subscribe to: " + String(commandTopic));
         }
         
         // Publish connection message
@@ -120,69 +160,141 @@ bool MqttModule::reconnect() {
 }
 
 void MqttModule::handleClient() {
+    HEAP_TAG("mqtt");
     if (!initialized) return;
 
-    if (!mqttClient->connected()) {
-        unsigned long currentTime = millis();
-        if (currentTime - lastReconnectAttempt > 5000) { // Try every 5 seconds
-            lastReconnectAttempt = currentTime;
-            if (reconnect()) {
-                lastReconnectAttempt = 0;
+    // Reconnects are paced separately by the network task's scheduler
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    if (refreshServer() && mqttClient->connected()) {
+        // Broker changed on the settings page: the next reconnect uses it
+        mqttClient->disconnect();
+    }
+    if (mqttClient->connected()) {
+        mqttClient->loop();
+        forwardTelemetry();
+    }
+    xSemaphoreGiveRecursive(lock);
+}
+
+void MqttModule::queueTelemetry(const SensorData& data) {
+    if (!telemetrySeqLoaded || telemetrySeq == telemetrySeqLimit) reserveTelemetrySeq();
+
+    TelemetryRecord record;
+    record.seq = ++telemetrySeq;
+    record.sample = DataManager::makeSample(data);
+    telemetry.push(record);
+}
+
+void MqttModule::reserveTelemetrySeq() {
+    // Skip whatever the previous boot reserved, used or not
+    if (!telemetrySeqLoaded) {
+        telemetrySeqLoaded = true;
+        telemetrySeq = telemetrySeqLimit = dataManager.loadTelemetrySeq();
+    }
+
+    telemetrySeqLimit = telemetrySeq + TELEMETRY_SEQ_BLOCK;
+    if (!dataManager.saveTelemetrySeq(telemetrySeqLimit)) {
+        TRACE(MQTT_SEQ_UNSAVED, (unsigned)telemetrySeqLimit);
+    }
+}
+
+void MqttModule::forwardTelemetry() {
+    HEAP_TAG("mqtt");
+    static TelemetryRecord batch[TELEMETRY_BATCH];
+    refreshTopics();
+    size_t capacity = payloadCapacity(telemetryTopic);
+
+    // A few batches per call keeps the network task responsive while a
+    // long backlog drains
+    for (int i = 0; i < TELEMETRY_BATCHES_PER_CALL; i++) {
+        size_t n = telemetry.peek(batch, TELEMETRY_BATCH);
+        if (n == 0) return;
+
+        doc.clear();
+        JsonArray records = doc.createNestedArray("records");
+        size_t added = 0;
+        for (; added < n; added++) {
+            // Packed fields can't bind to references, so copy them out
+            const StoredSample& sample = batch[added].sample;
+            JsonObject item = records.createNestedObject();
+            item["seq"] = (uint32_t)batch[added].seq;
+            item["t"] = (uint32_t)sample.time;
+            item["ms"] = (uint16_t)sample.millis;
+            item["d"] = (float)sample.distance;
+            item["o"] = (sample.flags & RECORD_OBJECT_DETECTED) ? 1 : 0;
+            item["a"] = (sample.flags & RECORD_ALERT_ACTIVE) ? 1 : 0;
+            item["m"] = (uint8_t)sample.mode;
+            if (sample.flags & RECORD_UPTIME_CLOCK) item["clock"] = "uptime";
+
+            // Keep the batch within one packet; the rest goes in the next one
+            if (added > 0 && measureJson(doc) > capacity) {
+                records.remove(added);
+                break;
             }
         }
-    } else {
+
+        // PubSubClient only publishes at QoS 0, so a batch counts as sent once
+        // it was written and the connection survived a round of loop()
+        if (!publishDoc(telemetryTopic)) return;
         mqttClient->loop();
+        if (!mqttClient->connected()) return;
+
+        telemetry.consume(added);
+        telemetrySent += added;
+        telemetryBatches++;
     }
 }
 
+String MqttModule::telemetryStats() const {
+    return "MQTT telemetry sent " + String(telemetrySent) + " in " + String(telemetryBatches) +
+           " batches, pending " + String(telemetry.pending()) + ", spilled " +
+           String(telemetry.spilledCount()) + ", dropped " + String(telemetry.droppedCount());
+}
+
 bool MqttModule::publishData(const SensorData& data) {
-    if (!initialized || !mqttClient->connected()) {
+    if (!isConnected()) {
         Serial.println(" MQTT not connected, cannot publish data");
         return false;
     }
 
-    StaticJsonDocument<512> doc;
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    refreshTopics();
+    doc.clear();
     doc["distance"] = data.distance;
     doc["object_detected"] = data.object_detected;
-    doc["status"] = data.status;
+    doc["status"] = data.status.c_str();
     doc["timestamp"] = data.timestamp;
     doc["uptime"] = systemState.systemUptime;
     doc["free_memory"] = ESP.getFreeHeap();
+    bool success = publishDoc(baseTopic);
+    xSemaphoreGiveRecursive(lock);
 
-    String jsonStr;
-    serializeJson(doc, jsonStr);
-
-    bool success = mqttClient->publish(config.mqtt.topic, jsonStr.c_str());
-    
     if (success) {
-        Serial.println(" MQTT data published: " + String(data.distance, 1) + "cm");
+        TRACE(MQTT_DATA, data.distance);
     } else {
-        Serial.println(" MQTT publish failed");
+        TRACE(MQTT_DATA_FAILED);
     }
     
     return success;
 }
 
-bool MqttModule::publishAlert(const String& message) {
-    if (!initialized || !mqttClient->connected()) return false;
+bool MqttModule::publishAlert(const char* message, float distance) {
+    if (!isConnected()) return false;
 
-    String alertTopic = String(config.mqtt.topic) + "/alert";
-    
-    StaticJsonDocument<256> doc;
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    refreshTopics();
+    doc.clear();
     doc["message"] = message;
-    doc["distance"] = systemState.currentData.distance;
+    doc["distance"] = isnan(distance) ? systemState.currentData.distance : distance;
     doc["timestamp"] = millis();
     doc["uptime"] = systemState.systemUptime;
+    bool success = publishDoc(alertTopic);
+    xSemaphoreGiveRecursive(lock);
 
-    String jsonStr;
-    serializeJson(doc, jsonStr);
-
-    bool success = mqttClient->publish(alertTopic.c_str(), jsonStr.c_str());
-    
     if (success) {
-        Serial.println(" MQTT alert published: " + message);
+        TRACE(MQTT_ALERT, message);
     } else {
-        Serial.println(" MQTT alert publish failed");
+        TRACE(MQTT_ALERT_FAILED);
     }
     
     return success;
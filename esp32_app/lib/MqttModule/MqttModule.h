@@ -4,19 +4,68 @@
 #include <Arduino.h>
 #include <PubSubClient.h>
 #include <WiFi.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <ArduinoJson.h>
 #include "../../include/state.h"
 #include "../../include/config.h"
+#include "TelemetryBuffer.h"
 
+// Publishing doesn't touch the heap: topics are built once, and every
+// message is serialized from one reusable JSON document into one payload
+// buffer sized to PubSubClient's packet buffer. Inbound messages are read
+// straight out of PubSubClient's buffer.
 class MqttModule {
 private:
+  // Store-and-forward telemetry (network task only)
+  static const size_t TELEMETRY_BATCH = 16;
+  static const int TELEMETRY_BATCHES_PER_CALL = 4;
+  static const uint16_t PACKET_BUFFER_SIZE = 2048;
+  static const size_t MAX_TOPIC_LENGTH = sizeof(MqttConfig::topic) + 16;
+  static const size_t MAX_COMMAND_LENGTH = 64;
+  // Telemetry sequence numbers are reserved in NVS this many at a time, so
+  // they keep rising across reboots and power loss for one write per block
+  static const uint32_t TELEMETRY_SEQ_BLOCK = 1024;
+  static const size_t DOC_SIZE = JSON_OBJECT_SIZE(1) + JSON_ARRAY_SIZE(TELEMETRY_BATCH) +
+                                 TELEMETRY_BATCH * JSON_OBJECT_SIZE(8);
+
   WiFiClient* wifiClient;
   PubSubClient* mqttClient;
   bool initialized;
-  unsigned long lastReconnectAttempt;
-  
-  void callback(char* topic, byte* payload, unsigned int length);
-  bool reconnect();
-  void handleCommand(const String& command);
+  // PubSubClient isn't thread-safe; recursive because callbacks publish from
+  // inside loop(). Also guards the topic, document and payload buffers.
+  SemaphoreHandle_t lock;
+
+  // Copy of the broker address for PubSubClient, which keeps the pointer it
+  // is given; config() buffers are reused after the next edit
+  char server[sizeof(MqttConfig::server)];
+  int port;
+
+  // <topic>, <topic>/alert, ... rebuilt only when config().mqtt.topic changes
+  char baseTopic[sizeof(MqttConfig::topic)];
+  char alertTopic[MAX_TOPIC_LENGTH];
+  char commandTopic[MAX_TOPIC_LENGTH];
+  char telemetryTopic[MAX_TOPIC_LENGTH];
+  char replyTopic[MAX_TOPIC_LENGTH];
+
+  StaticJsonDocument<DOC_SIZE> doc;
+  char payload[PACKET_BUFFER_SIZE];
+
+  TelemetryBuffer telemetry;
+  uint32_t telemetrySeq;       // last sequence number handed out
+  uint32_t telemetrySeqLimit;  // last one covered by NVS
+  bool telemetrySeqLoaded;
+  unsigned long telemetrySent;
+  unsigned long telemetryBatches;
+
+  bool refreshServer();
+  void refreshTopics();
+  size_t payloadCapacity(const char* topic) const;
+  bool publishDoc(const char* topic);
+  void forwardTelemetry();
+  void reserveTelemetrySeq();
+  void callback(char* topic, byte* message, unsigned int length);
+  bool connectLocked();
 
 public:
   MqttModule();
@@ -25,9 +74,14 @@ public:
   bool begin();
   void stop();
   void handleClient();
+  bool reconnect();
   bool publishData(const SensorData& data);
-  bool publishAlert(const String& message);
+  bool publishAlert(const char* message, float distance = NAN);
   bool isConnected() const;
+
+  // Queue a reading for <topic>/telemetry; kept across broker outages
+  void queueTelemetry(const SensorData& data);
+  String telemetryStats() const;
 };
 
 extern MqttModule mqttClient;
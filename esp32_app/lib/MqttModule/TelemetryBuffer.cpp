@@ -0,0 +1,126 @@
+#include "TelemetryBuffer.h"
+#include <SPIFFS.h>
+
+TelemetryBuffer::TelemetryBuffer()
+    : head(0), count(0), backlogRead(0), oldSize(0), backlogSize(0), backlogChecked(false),
+      spilled(0), dropped(0) {}
+
+size_t TelemetryBuffer::recordBytes(const char* path) {
+  File file = SPIFFS.open(path, FILE_READ);
+  if (!file) return 0;
+  size_t size = file.size() - file.size() % sizeof(TelemetryRecord);
+  file.close();
+  return size;
+}
+
+size_t TelemetryBuffer::backlogRecords() {
+  if (!backlogChecked && dataManager.isStorageReady()) {
+    // Pick up a backlog left by the previous boot
+    backlogChecked = true;
+    if (SPIFFS.exists(TELEMETRY_BACKLOG_FILE_OLD)) oldSize = recordBytes(TELEMETRY_BACKLOG_FILE_OLD);
+    if (SPIFFS.exists(TELEMETRY_BACKLOG_FILE)) backlogSize = recordBytes(TELEMETRY_BACKLOG_FILE);
+  }
+  return (oldSize + backlogSize - backlogRead) / sizeof(TelemetryRecord);
+}
+
+void TelemetryBuffer::rotate() {
+  // Whatever the old file still holds is the oldest backlog: let it go
+  if (backlogRead < oldSize) {
+    dropped += (oldSize - backlogRead) / sizeof(TelemetryRecord);
+    backlogRead = oldSize;
+  }
+  backlogRead -= oldSize;
+
+  SPIFFS.remove(TELEMETRY_BACKLOG_FILE_OLD);
+  SPIFFS.rename(TELEMETRY_BACKLOG_FILE, TELEMETRY_BACKLOG_FILE_OLD);
+  oldSize = backlogSize;
+  backlogSize = 0;
+}
+
+void TelemetryBuffer::push(const TelemetryRecord& record) {
+  if (count == RAM_CAPACITY) {
+    spill(RAM_CAPACITY / 2);
+  }
+
+  ram[(head + count) % RAM_CAPACITY] = record;
+  count++;
+}
+
+void TelemetryBuffer::spill(int records) {
+  backlogRecords();
+
+  size_t bytes = records * sizeof(TelemetryRecord);
+  if (dataManager.isStorageReady() && backlogSize + bytes > MAX_BACKLOG_BYTES / 2) {
+    rotate();
+  }
+
+  if (!dataManager.isStorageReady()) {
+    // Nowhere to put them; with no backlog these are the oldest records
+    dropped += records;
+  } else {
+    File file = SPIFFS.open(TELEMETRY_BACKLOG_FILE, FILE_APPEND);
+    if (!file) {
+      dropped += records;
+    } else {
+      // The ring may wrap, so write it in up to two runs
+      int first = min(records, (int)RAM_CAPACITY - head);
+      file.write((const uint8_t*)&ram[head], first * sizeof(TelemetryRecord));
+      if (records > first) {
+        file.write((const uint8_t*)&ram[0], (records - first) * sizeof(TelemetryRecord));
+      }
+      file.close();
+      backlogSize += bytes;
+      spilled += records;
+    }
+  }
+
+  head = (head + records) % RAM_CAPACITY;
+  count -= records;
+}
+
+size_t TelemetryBuffer::peek(TelemetryRecord* out, size_t limit) {
+  size_t inBacklog = backlogRecords();
+
+  if (inBacklog > 0) {
+    // One file per batch: the rest of the old file, then the current one
+    bool inOld = backlogRead < oldSize;
+    File file = SPIFFS.open(inOld ? TELEMETRY_BACKLOG_FILE_OLD : TELEMETRY_BACKLOG_FILE, FILE_READ);
+    if (!file) return 0;
+    file.seek(inOld ? backlogRead : backlogRead - oldSize);
+    size_t n = min(limit, inOld ? (oldSize - backlogRead) / sizeof(TelemetryRecord) : inBacklog);
+    size_t read = file.read((uint8_t*)out, n * sizeof(TelemetryRecord));
+    file.close();
+    return read / sizeof(TelemetryRecord);
+  }
+
+  size_t n = min(limit, (size_t)count);
+  for (size_t i = 0; i < n; i++) {
+    out[i] = ram[(head + i) % RAM_CAPACITY];
+  }
+  return n;
+}
+
+void TelemetryBuffer::consume(size_t consumed) {
+  size_t inBacklog = backlogRecords();
+
+  if (inBacklog > 0) {
+    backlogRead += min(consumed, inBacklog) * sizeof(TelemetryRecord);
+    if (oldSize > 0 && backlogRead >= oldSize) {
+      // Old file replayed
+      SPIFFS.remove(TELEMETRY_BACKLOG_FILE_OLD);
+      backlogRead -= oldSize;
+      oldSize = 0;
+    }
+    if (oldSize == 0 && backlogRead >= backlogSize) {
+      // Fully replayed
+      SPIFFS.remove(TELEMETRY_BACKLOG_FILE);
+      backlogRead = 0;
+      backlogSize = 0;
+    }
+    return;
+  }
+
+  consumed = min(consumed, (size_t)count);
+  head = (head + consumed) % RAM_CAPACITY;
+  count -= consumed;
+}
@@ -0,0 +1,65 @@
+#ifndef TELEMETRY_BUFFER_H
+#define TELEMETRY_BUFFER_H
+
+#include <Arduino.h>
+#include "../DataManager/DataManager.h"
+
+struct __attribute__((packed)) TelemetryRecord {
+  uint32_t seq;          // never reused, even across reboots; lets the consumer drop duplicates
+  StoredSample sample;
+};
+
+#define TELEMETRY_BACKLOG_FILE     "/mqtt_backlog.bin"
+#define TELEMETRY_BACKLOG_FILE_OLD "/mqtt_backlog.1.bin"
+
+// Store-and-forward queue for MQTT telemetry. Records live in a small RAM
+// ring; when it fills (broker unreachable) the oldest half is appended to a
+// flash backlog in one write. Readers always see the oldest records first:
+// the flash backlog, then RAM. A batch is only consumed after it was sent,
+// so delivery is at-least-once. The read position in the backlog is kept in
+// RAM, so after a reboot an unfinished backlog is replayed from its start.
+//
+// The backlog rotates like the sample files: once the current file holds
+// half of MAX_BACKLOG_BYTES it becomes the old file, replacing the previous
+// one. A long outage therefore loses its oldest records and keeps the
+// newest, with no gap in the middle of the series.
+//
+// Only used from the network task.
+class TelemetryBuffer {
+public:
+  static const int RAM_CAPACITY = 32;
+  static const size_t MAX_BACKLOG_BYTES = 128 * 1024;
+
+  TelemetryBuffer();
+
+  void push(const TelemetryRecord& record);
+
+  // Copy up to limit of the oldest records; never mixes flash and RAM records
+  size_t peek(TelemetryRecord* out, size_t limit);
+  void consume(size_t count);
+
+  // Safe to read from other tasks for stats
+  size_t pending() const { return (oldSize + backlogSize - backlogRead) / sizeof(TelemetryRecord) + count; }
+  unsigned long spilledCount() const { return spilled; }
+  unsigned long droppedCount() const { return dropped; }
+
+private:
+  TelemetryRecord ram[RAM_CAPACITY];
+  int head;    // oldest
+  int count;
+
+  size_t backlogRead;       // byte offset of the next unsent record, old file first
+  size_t oldSize;           // valid bytes in the old backlog file
+  size_t backlogSize;       // valid bytes in the current backlog file
+  bool backlogChecked;      // backlog from a previous boot has been picked up
+
+  unsigned long spilled;
+  unsigned long dropped;    // rotated out unsent, or no storage
+
+  void spill(int records);
+  void rotate();
+  size_t backlogRecords();
+  static size_t recordBytes(const char* path);
+};
+
+#endif
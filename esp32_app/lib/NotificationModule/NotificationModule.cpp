@@ -0,0 +1,327 @@
+#include "NotificationModule.h"
+#include <ArduinoJson.h>
+#include <WiFi.h>
+#include "../../include/config.h"
+#include "../TelegramModule/TelegramModule.h"
+#include "../MqttModule/MqttModule.h"
+#include "../WebhookModule/WebhookModule.h"
+#include "../../include/boot_arena.h"
+#include "../../include/heap_profiler.h"
+
+NotificationDispatcher notifications;
+
+static uint32_t keyHash(const char* key) {
+  uint32_t hash = 2166136261u;
+  for (; *key; key++) hash = (hash ^ (uint8_t)*key) * 16777619u;
+  return hash ? hash : 1;
+}
+
+// ---- Built-in sinks ----
+
+class TelegramSink : public NotificationSink {
+public:
+  const char* name() const override { return "telegram"; }
+  bool enabled() const override { return config().telegram.enable_telegram && telegramBot.isInitialized(); }
+  bool ready() const override { return WiFi.isConnected(); }
+  bool deliver(const Notification& notification) override {
+    return telegramBot.sendAlert(notification.text, notification.distance);
+  }
+};
+
+class MqttSink : public NotificationSink {
+public:
+  const char* name() const override { return "mqtt"; }
+  bool enabled() const override { return config().mqtt.enable_mqtt; }
+  bool ready() const override { return mqttClient.isConnected(); }
+  bool deliver(const Notification& notification) override {
+    return mqttClient.publishAlert(notification.text, notification.distance);
+  }
+};
+
+class WebhookSink : public NotificationSink {
+public:
+  const char* name() const override { return "webhook"; }
+  bool enabled() const override { return webhook.isConfigured(); }
+  bool ready() const override { return WiFi.isConnected(); }
+  bool deliver(const Notification& notification) override {
+    StaticJsonDocument<256> doc;
+    doc["id"] = notification.id;
+    doc["priority"] = (int)notification.priority;
+    doc["message"] = notification.text;
+    if (!isnan(notification.distance)) doc["distance"] = notification.distance;
+    doc["age_ms"] = millis() - notification.createdAt;
+    doc["uptime"] = millis() / 1000;
+
+    String body;
+    serializeJson(doc, body);
+    int code = webhook.post(body);
+    return code >= 200 && code < 300;
+  }
+};
+
+static TelegramSink telegramSink;
+static MqttSink mqttSink;
+static WebhookSink webhookSink;
+
+// ---- SinkWorker ----
+
+SinkWorker::SinkWorker(NotificationSink& sink)
+    : sink(sink), inbox(nullptr), handle(nullptr), pending{}, pendingUsed(0),
+      delivered(0), failed(0), retries(0), dropped(0), coalesced(0),
+      latencyTotal(0), latencyMax(0) {}
+
+bool SinkWorker::begin(uint32_t stackSize, UBaseType_t priority) {
+  inbox = xQueueCreate(INBOX_LENGTH, sizeof(Notification));
+  if (!inbox) return false;
+
+  String taskName = String("notify-") + sink.name();
+  return xTaskCreatePinnedToCore(taskEntry, taskName.c_str(), stackSize, this,
+                                 priority, &handle, PRO_CPU_NUM) == pdPASS;
+}
+
+bool SinkWorker::offer(const Notification& notification) {
+  if (!inbox || xQueueSend(inbox, &notification, 0) != pdTRUE) {
+    dropped++;
+    return false;
+  }
+  return true;
+}
+
+void SinkWorker::taskEntry(void* arg) {
+  static_cast<SinkWorker*>(arg)->run();
+}
+
+void SinkWorker::run() {
+  Notification incoming;
+
+  for (;;) {
+    unsigned long wait;
+    int due = nextDue(millis(), wait);
+    if (due >= 0) {
+      attempt(pending[due]);
+      wait = 0;
+    }
+
+    // Sleep until the next retry is due or something new arrives
+    TickType_t ticks = wait == WAIT_FOREVER ? portMAX_DELAY : pdMS_TO_TICKS(wait);
+    if (xQueueReceive(inbox, &incoming, ticks) == pdTRUE) {
+      do {
+        accept(incoming);
+      } while (xQueueReceive(inbox, &incoming, 0) == pdTRUE);
+    }
+  }
+}
+
+void SinkWorker::accept(const Notification& notification) {
+  if (!sink.enabled()) {
+    dropped++;
+    return;
+  }
+
+  Pending* slot = nullptr;
+
+  if (notification.key) {
+    for (Pending& entry : pending) {
+      if (entry.used && entry.notification.key == notification.key) {
+        // Keep the original creation time so latency covers the whole wait
+        unsigned long createdAt = entry.notification.createdAt;
+        NotifyPriority priority = max(entry.notification.priority, notification.priority);
+        entry.notification = notification;
+        entry.notification.createdAt = createdAt;
+        entry.notification.priority = priority;
+        coalesced++;
+        return;
+      }
+    }
+  }
+
+  for (Pending& entry : pending) {
+    if (!entry.used) {
+      slot = &entry;
+      break;
+    }
+  }
+
+  if (!slot) {
+    // Full: evict the oldest entry of the lowest priority, if it ranks no higher
+    for (Pending& entry : pending) {
+      if (!slot || entry.notification.priority < slot->notification.priority ||
+          (entry.notification.priority == slot->notification.priority &&
+           (long)(entry.notification.createdAt - slot->notification.createdAt) < 0)) {
+        slot = &entry;
+      }
+    }
+    dropped++;
+    if (slot->notification.priority > notification.priority) return;
+    release(*slot);
+  }
+
+  slot->notification = notification;
+  slot->attempts = 0;
+  slot->nextAttempt = millis();
+  slot->used = true;
+  pendingUsed++;
+}
+
+int SinkWorker::nextDue(unsigned long now, unsigned long& wait) {
+  wait = WAIT_FOREVER;
+  if (pendingUsed == 0) return -1;
+
+  // Switched off from the settings page: nothing left to deliver to
+  if (!sink.enabled()) {
+    for (Pending& entry : pending) {
+      if (entry.used) {
+        dropped++;
+        release(entry);
+      }
+    }
+    return -1;
+  }
+
+  // Hold everything while the transport is down instead of burning attempts
+  if (!sink.ready()) {
+    wait = READY_POLL_MS;
+    return -1;
+  }
+
+  int best = -1;
+  for (int i = 0; i < MAX_PENDING; i++) {
+    const Pending& entry = pending[i];
+    if (!entry.used) continue;
+
+    long remaining = (long)(entry.nextAttempt - now);
+    if (remaining > 0) {
+      if ((unsigned long)remaining < wait) wait = remaining;
+      continue;
+    }
+
+    if (best < 0 || entry.notification.priority > pending[best].notification.priority ||
+        (entry.notification.priority == pending[best].notification.priority &&
+         (long)(entry.notification.createdAt - pending[best].notification.createdAt) < 0)) {
+      best = i;
+    }
+  }
+  return best;
+}
+
+void SinkWorker::attempt(Pending& entry) {
+  HEAP_TAG("notify");
+  unsigned long started = millis();
+  bool ok = sink.deliver(entry.notification);
+  unsigned long now = millis();
+
+  if (ok) {
+    unsigned long latency = now - entry.notification.createdAt;
+    delivered++;
+    latencyTotal += latency;
+    if (latency > latencyMax) latencyMax = latency;
+    Serial.println("🔔 " + String(sink.name()) + " delivered #" + String(entry.notification.id) +
+                   " in " + String(latency) + "ms (attempt " + String(entry.attempts + 1) + ")");
+    release(entry);
+    return;
+  }
+
+  entry.attempts++;
+  if (entry.attempts >= MAX_ATTEMPTS || now - entry.notification.createdAt > MAX_AGE_MS) {
+    failed++;
+    Serial.println("❌ " + String(sink.name()) + " gave up on #" + String(entry.notification.id) +
+                   " after " + String(entry.attempts) + " attempts");
+    release(entry);
+    return;
+  }
+
+  unsigned long backoff = min(MIN_BACKOFF_MS << (entry.attempts - 1), (unsigned long)MAX_BACKOFF_MS);
+  entry.nextAttempt = now + backoff;
+  retries++;
+  Serial.println("⚠️ " + String(sink.name()) + " attempt failed after " + String(now - started) +
+                 "ms, retry in " + String(backoff / 1000) + "s");
+}
+
+void SinkWorker::release(Pending& entry) {
+  entry.used = false;
+  pendingUsed--;
+}
+
+String SinkWorker::summary() const {
+  unsigned long avg = delivered ? latencyTotal / delivered : 0;
+  return String(sink.name()) + " ok " + String(delivered) + ", failed " + String(failed) +
+         ", retries " + String(retries) + ", dropped " + String(dropped) +
+         ", coalesced " + String(coalesced) + ", pending " + String(pendingUsed) +
+         ", latency avg " + String(avg) + "/max " + String(latencyMax) + "ms";
+}
+
+// ---- NotificationDispatcher ----
+
+NotificationDispatcher::NotificationDispatcher()
+    : workers{}, workerCount(0), idLock(portMUX_INITIALIZER_UNLOCKED), nextId(1) {}
+
+bool NotificationDispatcher::begin() {
+  struct SinkSetup {
+    NotificationSink* sink;
+    uint32_t stack;
+  };
+  // TLS and HTTP need the larger stacks; MQTT publishes over plain TCP
+  static const SinkSetup setups[MAX_SINKS] = {
+    { &telegramSink, 8192 },
+    { &mqttSink, 4096 },
+    { &webhookSink, 6144 },
+  };
+
+  bool ok = true;
+  for (const SinkSetup& setup : setups) {
+    SinkWorker* worker = bootArena.create<SinkWorker>("notification worker", *setup.sink);
+    if (!worker || !worker->begin(setup.stack, 1)) {
+      Serial.println("❌ Failed to start notification worker: " + String(setup.sink->name()));
+      bootArena.destroy(worker);
+      ok = false;
+      continue;
+    }
+    workers[workerCount++] = worker;
+  }
+
+  Serial.println("✅ Notification dispatcher started (" + String(workerCount) + " sinks)");
+  return ok;
+}
+
+Notification NotificationDispatcher::make(NotifyPriority priority, const char* key,
+                                         const char* text, float distance) {
+  Notification notification;
+  portENTER_CRITICAL(&idLock);
+  notification.id = nextId++;
+  portEXIT_CRITICAL(&idLock);
+  notification.key = key ? keyHash(key) : 0;
+  notification.priority = priority;
+  notification.distance = distance;
+  notification.createdAt = millis();
+  strncpy(notification.text, text, sizeof(notification.text) - 1);
+  notification.text[sizeof(notification.text) - 1] = '\0';
+  return notification;
+}
+
+bool NotificationDispatcher::notify(NotifyPriority priority, const char* key, const char* text, float distance) {
+  Notification notification = make(priority, key, text, distance);
+
+  bool accepted = false;
+  for (int i = 0; i < workerCount; i++) {
+    if (workers[i]->enabled() && workers[i]->offer(notification)) accepted = true;
+  }
+  return accepted;
+}
+
+bool NotificationDispatcher::notifySink(const char* sink, NotifyPriority priority, const char* key,
+                                        const char* text, float distance) {
+  for (int i = 0; i < workerCount; i++) {
+    if (strcmp(workers[i]->name(), sink) != 0) continue;
+    return workers[i]->enabled() && workers[i]->offer(make(priority, key, text, distance));
+  }
+  return false;
+}
+
+String NotificationDispatcher::summary() const {
+  String out;
+  for (int i = 0; i < workerCount; i++) {
+    if (i) out += " | ";
+    out += workers[i]->summary();
+  }
+  return out.length() ? out : "No notification sinks";
+}
@@ -0,0 +1,127 @@
+#ifndef NOTIFICATION_MODULE_H
+#define NOTIFICATION_MODULE_H
+
+#include <Arduino.h>
+#include <limits.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+enum class NotifyPriority : uint8_t { Low = 0, Normal = 1, High = 2 };
+
+struct Notification {
+  uint32_t id;
+  uint32_t key;               // coalescing key, 0 = never coalesce
+  NotifyPriority priority;
+  float distance;             // NAN when not tied to a reading
+  unsigned long createdAt;    // millis() when raised
+  char text[96];
+};
+
+// A delivery target. deliver() may block (TLS, HTTP); it only ever runs on
+// the sink's own worker task.
+class NotificationSink {
+public:
+  virtual ~NotificationSink() {}
+  virtual const char* name() const = 0;
+  virtual bool enabled() const = 0;   // configured and switched on
+  virtual bool ready() const = 0;     // transport up; no attempts are spent while false
+  virtual bool deliver(const Notification& notification) = 0;
+};
+
+// One task per sink. New notifications arrive through a bounded inbox and
+// wait in a small pending table until delivered: highest priority first,
+// oldest first within a priority, failed attempts retried with exponential
+// backoff. Pending entries with the same key are coalesced into the latest.
+class SinkWorker {
+public:
+  explicit SinkWorker(NotificationSink& sink);
+
+  bool begin(uint32_t stackSize, UBaseType_t priority);
+
+  // Any task, never blocks; false when the inbox is full
+  bool offer(const Notification& notification);
+
+  const char* name() const { return sink.name(); }
+  bool enabled() const { return sink.enabled(); }
+  String summary() const;
+
+  unsigned long deliveredCount() const { return delivered; }
+  unsigned long failedCount() const { return failed; }
+  unsigned long droppedCount() const { return dropped; }
+  int pendingCount() const { return pendingUsed; }
+
+private:
+  static const int INBOX_LENGTH = 8;
+  static const int MAX_PENDING = 16;
+  static const uint8_t MAX_ATTEMPTS = 12;
+  static const unsigned long MIN_BACKOFF_MS = 2000;
+  static const unsigned long MAX_BACKOFF_MS = 60000;
+  static const unsigned long MAX_AGE_MS = 30UL * 60 * 1000;
+  static const unsigned long READY_POLL_MS = 1000;
+  static const unsigned long WAIT_FOREVER = ULONG_MAX;
+
+  struct Pending {
+    Notification notification;
+    uint8_t attempts;
+    unsigned long nextAttempt;
+    bool used;
+  };
+
+  NotificationSink& sink;
+  QueueHandle_t inbox;
+  TaskHandle_t handle;
+  Pending pending[MAX_PENDING];
+  int pendingUsed;
+
+  volatile unsigned long delivered;
+  volatile unsigned long failed;      // gave up after MAX_ATTEMPTS or MAX_AGE_MS
+  volatile unsigned long retries;
+  volatile unsigned long dropped;     // inbox or table full, or sink disabled
+  volatile unsigned long coalesced;
+  volatile unsigned long latencyTotal;
+  volatile unsigned long latencyMax;
+
+  static void taskEntry(void* arg);
+  void run();
+  void accept(const Notification& notification);
+  int nextDue(unsigned long now, unsigned long& wait);
+  void attempt(Pending& entry);
+  void release(Pending& entry);
+};
+
+// Fans notifications out to one SinkWorker per sink (Telegram, MQTT,
+// webhook). Producers never block, so raising an alert costs ingestion a
+// few queue copies regardless of how slow or unreachable a sink is.
+class NotificationDispatcher {
+public:
+  NotificationDispatcher();
+
+  // Start a worker per built-in sink; call once WiFi and the modules are set up
+  bool begin();
+
+  // Queue a message for every enabled sink. Messages sharing a key replace
+  // an undelivered predecessor instead of queuing behind it.
+  bool notify(NotifyPriority priority, const char* key, const char* text, float distance = NAN);
+
+  // Queue a message for one named sink only (e.g. "webhook" readings)
+  bool notifySink(const char* sink, NotifyPriority priority, const char* key, const char* text,
+                  float distance = NAN);
+
+  // Per-sink delivery, retry and latency figures for the health log
+  String summary() const;
+
+private:
+  static const int MAX_SINKS = 3;
+
+  SinkWorker* workers[MAX_SINKS];
+  int workerCount;
+  portMUX_TYPE idLock;
+  uint32_t nextId;
+
+  Notification make(NotifyPriority priority, const char* key, const char* text, float distance);
+};
+
+extern NotificationDispatcher notifications;
+
+#endif
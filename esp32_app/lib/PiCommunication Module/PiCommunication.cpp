@@ -1,42 +1,49 @@
 #include "PiCommunication.h"
 #include "../../include/config.h"
+#include "../DataManager/DataManager.h"
+#include "../../include/commands.h"
+#include "../../include/trace.h"
+#include "../../include/heap_profiler.h"
+#include "../../include/rtc_snapshot.h"
 #include <ArduinoJson.h>
 
 // Global instance (will be defined in main.cpp)
 extern SystemState systemState;
-extern AppConfig config;
 
 PiCommunication piComm(systemState);
 
 void PiCommunication::begin() {
     // Setup UART (Pi → ESP32)
-    if (config.system.enable_uart) {
-        Serial2.begin(config.raspberry_pi.uart_baud_rate, SERIAL_8N1, 
-                     config.hardware.uart_rx_pin, config.hardware.uart_tx_pin);
+    if (config().system.enable_uart) {
+        Serial2.begin(config().raspberry_pi.uart_baud_rate, SERIAL_8N1, 
+                     config().hardware.uart_rx_pin, config().hardware.uart_tx_pin);
         Serial.println("✓ UART communication with Pi initialized");
     }
     
     // Setup SPI (Pi → ESP32 for faster data)
-    if (config.system.enable_spi) {
-        SPI.begin(config.hardware.spi_sck_pin, 
-                  config.hardware.spi_miso_pin, 
-                  config.hardware.spi_mosi_pin, 
-                  config.hardware.spi_cs_pin);
-        pinMode(config.hardware.spi_cs_pin, INPUT_PULLUP);
+    if (config().system.enable_spi) {
+        SPI.begin(config().hardware.spi_sck_pin, 
+                  config().hardware.spi_miso_pin, 
+                  config().hardware.spi_mosi_pin, 
+                  config().hardware.spi_cs_pin);
+        pinMode(config().hardware.spi_cs_pin, INPUT_PULLUP);
         Serial.println("✓ SPI communication with Pi initialized");
     }
 }
 
 void PiCommunication::handle() {
     // Check for UART messages from Pi
-    if (config.system.enable_uart && Serial2.available()) {
+    if (config().system.enable_uart && Serial2.available()) {
         while (Serial2.available()) {
             char c = Serial2.read();
             if (c == '\n') {
-                processPiMessage(receivedData);
-                receivedData = "";
-            } else {
-                receivedData += c;
+                if (!discarding) processPiMessage(receivedData.c_str());
+                receivedData.clear();
+                discarding = false;
+            } else if (!discarding && !receivedData.append(c)) {
+                // No room: drop the line rather than parse half of it
+                TRACE(PI_LINE_TOO_LONG, (unsigned)receivedData.capacity());
+                discarding = true;
             }
         }
     }
@@ -45,12 +52,12 @@ void PiCommunication::handle() {
     checkSPIData();
 }
 
-void PiCommunication::processPiMessage(String message) {
-    Serial.print("Received from Pi: ");
-    Serial.println(message);
+void PiCommunication::processPiMessage(const char* message) {
+    HEAP_TAG("pi");
+    TRACE(PI_RX, strlen(message), message);
     
     // Check if message is JSON
-    if (message.startsWith("{")) {
+    if (message[0] == '{') {
         StaticJsonDocument<512> doc;
         DeserializationError error = deserializeJson(doc, message);
         
@@ -65,7 +72,7 @@ void PiCommunication::processPiMessage(String message) {
             systemState.currentData.mode = mode;
             systemState.currentData.alert_active = (alert == 1);
             systemState.currentData.timestamp = millis();
-            systemState.currentData.object_detected = (distance <= config.system.distance_threshold) || systemState.currentData.alert_active;
+            systemState.currentData.object_detected = (distance <= config().system.distance_threshold) || systemState.currentData.alert_active;
             
             if (systemState.currentData.object_detected) {
                 systemState.currentData.status = "Object Detected 🚨";
@@ -79,82 +86,82 @@ void PiCommunication::processPiMessage(String message) {
                 if(i < 5) systemState.currentData.pi_history[i++] = val;
             }
             
-            systemState.addToHistory(systemState.currentData);
+            storeReading();
             systemState.lastPiHeartbeat = millis();
             return;
         } else {
-            Serial.print("JSON Parse Error: ");
-            Serial.println(error.c_str());
+            TRACE(PI_JSON_ERROR, error.c_str());
         }
     }
 
     // Check for Pi Boot/Console messages
-    if (message.indexOf("Debian") != -1 || message.indexOf("login:") != -1 || message.indexOf("Linux") != -1) {
+    if (strstr(message, "Debian") || strstr(message, "login:") || strstr(message, "Linux")) {
         Serial.println("⚠️ Pi Serial Console detected! Please disable it using 'sudo raspi-config' -> Interface Options -> Serial Port");
         return;
     }
 
-    // Parse legacy messages from Raspberry Pi
-    if (message.startsWith("DISTANCE:")) {
-        float distance = message.substring(9).toFloat();
-        updateSystemState(distance);
-    }
-    else if (message.startsWith("ALERT:")) {
-        String alertLevel = message.substring(6);
-        triggerAlert(alertLevel);
-    }
-    else if (message.startsWith("STATUS:")) {
-        String status = message.substring(7);
-        updateSystemStatus(status);
-    }
-    else if (message.startsWith("SYSTEM:")) {
-        String systemMsg = message.substring(7);
-        Serial.println("System message from Pi: " + systemMsg);
+    // Legacy "NAME:value" messages from the Raspberry Pi share the command table.
+    // Its handlers act on the live instance, so a scratch one only traces them.
+    if (!persist) {
+        TRACE(PI_COMMAND_REJECTED, message);
+        return;
     }
-    else if (message.startsWith("HEARTBEAT:")) {
-        systemState.lastPiHeartbeat = millis();
-        Serial.println("✓ Pi heartbeat received");
+    while (isspace((unsigned char)*message)) message++;
+    command = message;
+    while (command.length() && isspace((unsigned char)command.c_str()[command.length() - 1])) {
+        command.truncate(command.length() - 1);
     }
-    else if (message.startsWith("ERROR:")) {
-        String errorMsg = message.substring(6);
-        Serial.println("✗ Pi error: " + errorMsg);
+    CommandReply reply;
+    if (commands.dispatch(CMD_UART, command.c_str(), reply)) {
+        TRACE(PI_COMMAND, command.c_str());
+    } else {
+        TRACE(PI_COMMAND_REJECTED, command.c_str());
     }
+    commands.complete(reply);
 }
 
 void PiCommunication::updateSystemState(float distance) {
     systemState.currentData.distance = distance;
     systemState.currentData.timestamp = millis();
-    systemState.currentData.object_detected = (distance <= config.system.distance_threshold);
+    systemState.currentData.object_detected = (distance <= config().system.distance_threshold);
     
-    if (distance <= config.system.distance_threshold) {
+    if (distance <= config().system.distance_threshold) {
         systemState.currentData.status = "Object Detected 🚨";
     } else {
         systemState.currentData.status = "Normal ✅";
     }
     
     // Add to history
+    storeReading();
+}
+
+void PiCommunication::storeReading() {
     systemState.addToHistory(systemState.currentData);
+    if (!persist) return;
+
+    // Flash and the RTC ring belong to the live instance only
+    dataManager.saveSensorData(systemState.currentData);
+    if (systemState.currentData.isValid()) rtcSnapshot.recordSample(systemState.currentData);
 }
 
-void PiCommunication::triggerAlert(String level) {
-    Serial.print("Alert from Pi: ");
-    Serial.println(level);
+void PiCommunication::triggerAlert(const char* level) {
+    TRACE(PI_ALERT, level);
     
     // Visual alert on ESP32
-    if (config.hardware.status_led_pin > 0) {
-        digitalWrite(config.hardware.status_led_pin, HIGH);
+    if (config().hardware.status_led_pin > 0) {
+        digitalWrite(config().hardware.status_led_pin, HIGH);
         delay(200);
-        digitalWrite(config.hardware.status_led_pin, LOW);
+        digitalWrite(config().hardware.status_led_pin, LOW);
     }
 }
 
-void PiCommunication::updateSystemStatus(String status) {
+void PiCommunication::updateSystemStatus(const char* status) {
     systemState.currentData.status = status;
 }
 
 void PiCommunication::checkSPIData() {
     // Basic SPI slave implementation
-    if (config.system.enable_spi && digitalRead(config.hardware.spi_cs_pin) == LOW) {
+    if (config().system.enable_spi && digitalRead(config().hardware.spi_cs_pin) == LOW) {
         // SPI communication active - implement your protocol here
         // This would handle high-speed data like images
     }
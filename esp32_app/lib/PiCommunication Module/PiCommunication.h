@@ -6,23 +6,32 @@
 #include <HardwareSerial.h>
 #include "../../include/config.h"
 #include "../../include/state.h"
+#include "../../include/fixed_string.h"
 
 class PiCommunication {
 private:
     SystemState& systemState;
-    String receivedData = "";
+    bool persist;
+    // Longest line the Pi sends is a JSON packet of ~80 bytes
+    static const size_t LINE_LENGTH = 256;
+    FixedString<LINE_LENGTH> receivedData;
+    bool discarding = false;            // rest of an over-long line
+    FixedString<LINE_LENGTH> command;   // trimmed copy of a command line
     
-    void processPiMessage(String message);
     void checkSPIData();
+    void storeReading();  // currentData into history, flash and RTC memory
 
 public:
-    PiCommunication(SystemState& state) : systemState(state) {}
+    // persist = false keeps readings out of DataManager and RTC memory and
+    // leaves command lines undispatched (benchmarks, UART replay)
+    PiCommunication(SystemState& state, bool persist = true) : systemState(state), persist(persist) {}
     
     void begin();
     void handle();
+    void processPiMessage(const char* message);  // one complete line, newline stripped
     void updateSystemState(float distance);
-    void triggerAlert(String level);
-    void updateSystemStatus(String status);
+    void triggerAlert(const char* level);
+    void updateSystemStatus(const char* status);
 };
 
 extern PiCommunication piComm;
@@ -1,7 +1,8 @@
 #include "SpiModule.h"
+#include "../../include/trace.h"
 
-SpiModule spiSlave(config.hardware.spi_cs_pin, config.hardware.spi_mosi_pin, 
-                   config.hardware.spi_miso_pin, config.hardware.spi_sck_pin);
+SpiModule spiSlave(config().hardware.spi_cs_pin, config().hardware.spi_mosi_pin, 
+                   config().hardware.spi_miso_pin, config().hardware.spi_sck_pin);
 
 SpiModule* SpiModule::instance = nullptr;
 
@@ -100,10 +101,10 @@ float SpiModule::getDistanceData() {
         
         // Validate distance
         if (distance >= 0 && distance <= 400) { // Valid ultrasonic range
-            Serial.println(" SPI distance received: " + String(distance, 1) + "cm");
+            TRACE(SPI_DISTANCE, distance);
             return distance;
         } else {
-            Serial.println(" Invalid SPI distance: " + String(distance, 1));
+            TRACE(SPI_BAD_DISTANCE, distance);
         }
     }
     
@@ -117,12 +118,12 @@ void SpiModule::sendResponse(uint8_t response) {
     unsigned long startTime = millis();
     while (digitalRead(csPin) == HIGH) {
         if (millis() - startTime > 100) { // Timeout after 100ms
-            Serial.println(" SPI send timeout");
+            TRACE(SPI_TIMEOUT);
             return;
         }
     }
     
     // Send response byte
     SPI.transfer(response);
-    Serial.println(" SPI response sent: 0x" + String(response, HEX));
+    TRACE(SPI_RESPONSE, response);
 }
\ No newline at end of file
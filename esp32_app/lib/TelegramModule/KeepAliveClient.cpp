@@ -0,0 +1,186 @@
+#include "KeepAliveClient.h"
+
+KeepAliveClient::KeepAliveClient(Client& transport)
+    : transport(transport), port(0), redirectPort(0), lastUsed(0), idle(false), handshakes(0), reuses(0),
+      lastHandshake(0), maxHandshake(0), sessionHeap(0) {
+  resetResponse();
+}
+
+bool KeepAliveClient::reusable(const char* targetHost, uint16_t targetPort) {
+  if (!transport.connected()) return false;
+  if (port != targetPort || host != targetHost) return false;
+  if (millis() - lastUsed > IDLE_LIMIT_MS) return false;
+
+  // Bytes nobody asked for yet: the last response was longer than it said
+  return transport.available() == 0;
+}
+
+void KeepAliveClient::resetResponse() {
+  headerLength = 0;
+  headersDone = false;
+  keepAlive = false;
+  contentLength = -1;
+  bodyRead = 0;
+}
+
+void KeepAliveClient::track(const uint8_t* data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    if (headersDone) {
+      bodyRead += length - i;
+      return;
+    }
+
+    char c = (char)data[i];
+    if (c == '\r') continue;
+    if (c != '\n') {
+      if (headerLength < sizeof(headerLine) - 1) headerLine[headerLength++] = c;
+      continue;
+    }
+    headerLine[headerLength] = '\0';
+    if (headerLength == 0) {
+      headersDone = true;
+    } else {
+      headerDone();
+    }
+    headerLength = 0;
+  }
+}
+
+void KeepAliveClient::headerDone() {
+  if (strncmp(headerLine, "HTTP/", 5) == 0) {
+    keepAlive = strncmp(headerLine, "HTTP/1.1 ", 9) == 0;
+  } else if (strncasecmp(headerLine, "Content-Length:", 15) == 0) {
+    contentLength = strtol(headerLine + 15, nullptr, 10);
+  } else if (strncasecmp(headerLine, "Connection:", 11) == 0) {
+    for (const char* p = headerLine + 11; *p; p++) {
+      if (strncasecmp(p, "close", 5) == 0) keepAlive = false;
+    }
+  } else if (strncasecmp(headerLine, "Transfer-Encoding:", 18) == 0) {
+    // Chunk boundaries aren't followed; don't reuse
+    keepAlive = false;
+  }
+}
+
+bool KeepAliveClient::responseComplete() const {
+  return headersDone && keepAlive && contentLength >= 0 && bodyRead == (size_t)contentLength;
+}
+
+int KeepAliveClient::handshake(const char* targetHost, uint16_t targetPort) {
+  close();
+
+  uint32_t heapBefore = ESP.getFreeHeap();
+  unsigned long start = millis();
+  int result = transport.connect(targetHost, targetPort);
+  unsigned long elapsed = millis() - start;
+
+  if (result) {
+    host = targetHost;
+    port = targetPort;
+    lastUsed = millis();
+    handshakes++;
+    lastHandshake = elapsed;
+    if (elapsed > maxHandshake) maxHandshake = elapsed;
+    uint32_t heapAfter = ESP.getFreeHeap();
+    sessionHeap = heapBefore > heapAfter ? heapBefore - heapAfter : 0;
+    Serial.println(" Connected to " + host + " in " + String(elapsed) + "ms");
+  } else {
+    Serial.println(" Connect to " + String(targetHost) + " failed after " + String(elapsed) + "ms");
+  }
+  return result;
+}
+
+void KeepAliveClient::redirect(const String& host, uint16_t port) {
+  redirectHost = host;
+  redirectPort = port;
+}
+
+int KeepAliveClient::connect(const char* targetHost, uint16_t targetPort) {
+  if (redirectHost.length()) {
+    targetHost = redirectHost.c_str();
+    targetPort = redirectPort;
+  }
+
+  idle = false;
+  resetResponse();
+  if (reusable(targetHost, targetPort)) {
+    reuses++;
+    lastUsed = millis();
+    return 1;
+  }
+  return handshake(targetHost, targetPort);
+}
+
+int KeepAliveClient::connect(const char* targetHost, uint16_t targetPort, int32_t) {
+  return connect(targetHost, targetPort);
+}
+
+int KeepAliveClient::connect(IPAddress ip, uint16_t targetPort) {
+  return connect(ip.toString().c_str(), targetPort);
+}
+
+int KeepAliveClient::connect(IPAddress ip, uint16_t targetPort, int32_t) {
+  return connect(ip, targetPort);
+}
+
+size_t KeepAliveClient::write(uint8_t b) {
+  return write(&b, 1);
+}
+
+size_t KeepAliveClient::write(const uint8_t* buf, size_t size) {
+  size_t written = transport.write(buf, size);
+  if (written != size) {
+    // Half-open socket: drop it so the next request handshakes afresh
+    close();
+  } else {
+    lastUsed = millis();
+  }
+  return written;
+}
+
+int KeepAliveClient::available() {
+  return transport.available();
+}
+
+int KeepAliveClient::read() {
+  int c = transport.read();
+  if (c >= 0) {
+    uint8_t b = c;
+    track(&b, 1);
+  }
+  return c;
+}
+
+int KeepAliveClient::read(uint8_t* buf, size_t size) {
+  int n = transport.read(buf, size);
+  if (n > 0) track(buf, n);
+  return n;
+}
+
+int KeepAliveClient::peek() {
+  return transport.peek();
+}
+
+void KeepAliveClient::flush() {
+  transport.flush();
+}
+
+void KeepAliveClient::stop() {
+  // Keep the session for the next request (see connect()), but only after
+  // a response that ended exactly where it said it would
+  if (!responseComplete()) close();
+  lastUsed = millis();
+  idle = true;
+}
+
+uint8_t KeepAliveClient::connected() {
+  // Callers check connected() before connect(); looking disconnected while
+  // idle routes them through connect(), which checks the socket
+  return !idle && transport.connected();
+}
+
+void KeepAliveClient::close() {
+  if (transport.connected()) {
+    transport.stop();
+  }
+  sessionHeap = 0;
+}
@@ -0,0 +1,87 @@
+#ifndef KEEP_ALIVE_CLIENT_H
+#define KEEP_ALIVE_CLIENT_H
+
+#include <Arduino.h>
+#include <Client.h>
+
+// Client wrapper that keeps the TLS connection to one host open between
+// requests. UniversalTelegramBot calls stop() after every request; here that
+// only marks the connection idle, and the next connect() to the same host
+// reuses it. A real handshake happens only on first use, after a failed
+// write, after the server closes the socket, or once the link has been idle
+// longer than IDLE_LIMIT_MS.
+//
+// UniversalTelegramBot doesn't frame responses (it reads until the socket
+// goes quiet), so the wrapper follows the headers of each response as they
+// are read. The connection is kept only when the response had a
+// Content-Length, no "Connection: close", and its body was read to the last
+// byte; anything else (chunked, cut short, over-long) closes it, so a late
+// tail can never be parsed as the next reply.
+//
+// The transport is any Client: WiFiClientSecure for the real API, or a plain
+// WiFiClient with redirect() pointing every connect() at a local mock server.
+class KeepAliveClient : public Client {
+public:
+  static const unsigned long IDLE_LIMIT_MS = 60000;
+
+  explicit KeepAliveClient(Client& transport);
+
+  int connect(IPAddress ip, uint16_t port) override;
+  int connect(const char* host, uint16_t port) override;
+  int connect(IPAddress ip, uint16_t port, int32_t timeout);
+  int connect(const char* host, uint16_t port, int32_t timeout);
+  size_t write(uint8_t b) override;
+  size_t write(const uint8_t* buf, size_t size) override;
+  int available() override;
+  int read() override;
+  int read(uint8_t* buf, size_t size) override;
+  int peek() override;
+  void flush() override;
+  void stop() override;
+  uint8_t connected() override;
+  operator bool() override { return connected(); }
+
+  // Really close the socket (on errors or shutdown)
+  void close();
+
+  // Connect to host:port whatever host the caller asks for (testing)
+  void redirect(const String& host, uint16_t port);
+
+  unsigned long handshakeCount() const { return handshakes; }
+  unsigned long reuseCount() const { return reuses; }
+  unsigned long lastHandshakeMs() const { return lastHandshake; }
+  unsigned long maxHandshakeMs() const { return maxHandshake; }
+  unsigned long sessionHeapBytes() const { return sessionHeap; }
+
+private:
+  Client& transport;
+  String host;
+  uint16_t port;
+  String redirectHost;
+  uint16_t redirectPort;
+  unsigned long lastUsed;
+  bool idle;  // released by stop(); reported as disconnected until connect()
+
+  // Framing of the response being read
+  char headerLine[48];     // current header line, cut to fit
+  uint8_t headerLength;
+  bool headersDone;
+  bool keepAlive;          // HTTP/1.1 and no "Connection: close"
+  long contentLength;      // -1 until seen
+  size_t bodyRead;
+
+  unsigned long handshakes;
+  unsigned long reuses;
+  unsigned long lastHandshake;
+  unsigned long maxHandshake;
+  unsigned long sessionHeap;  // heap held by the open TLS session
+
+  bool reusable(const char* targetHost, uint16_t targetPort);
+  void resetResponse();
+  void track(const uint8_t* data, size_t length);
+  void headerDone();
+  bool responseComplete() const;
+  int handshake(const char* targetHost, uint16_t targetPort);
+};
+
+#endif
@@ -1,27 +1,81 @@
 #include "TelegramModule.h"
+#include <WiFi.h>
+#include "../../include/commands.h"
+#include "../../include/heap_profiler.h"
+#include "../../include/boot_arena.h"
 
 
 
 TelegramModule::TelegramModule() 
-    : client(nullptr), bot(nullptr), lastCheckTime(0), initialized(false) {}
+    : initialized(false), lock(nullptr), sent(nullptr), outgoing(nullptr), parked(false), pollHandle(nullptr),
+      requests(0), requestTotalMs(0), requestMaxMs(0), polls(0), pollsCut(0), commandCount(0) {}
 
 TelegramModule::~TelegramModule() {
     stop();
 }
 
+bool TelegramModule::openChannel(TelegramChannel& channel) {
+    const char* apiServer = config().telegram.api_server;
+
+    if (strlen(apiServer) > 0) {
+        // Local mock Bot API (see mock_telegram_api.py): plain HTTP to host:port
+        String server = apiServer;
+        int colon = server.lastIndexOf(':');
+        String host = colon > 0 ? server.substring(0, colon) : server;
+        uint16_t port = colon > 0 ? server.substring(colon + 1).toInt() : 8081;
+        channel.transport = bootArena.create<WiFiClient>("Telegram transport");
+        if (!channel.transport) return false;
+        channel.connection = bootArena.create<KeepAliveClient>("Telegram connection", *channel.transport);
+        if (!channel.connection) return false;
+        channel.connection->redirect(host, port);
+    } else {
+        WiFiClientSecure* secure = bootArena.create<WiFiClientSecure>("Telegram TLS transport");
+        if (!secure) return false;
+        secure->setCACert(TELEGRAM_CERTIFICATE_ROOT);
+        channel.transport = secure;
+        channel.connection = bootArena.create<KeepAliveClient>("Telegram connection", *channel.transport);
+        if (!channel.connection) return false;
+    }
+
+    channel.bot = bootArena.create<UniversalTelegramBot>("Telegram bot", config().telegram.bot_token,
+                                                         *channel.connection);
+    return channel.bot != nullptr;
+}
+
+void TelegramModule::closeChannel(TelegramChannel& channel) {
+    bootArena.destroy(channel.bot);
+    channel.bot = nullptr;
+    if (channel.connection) channel.connection->close();
+    bootArena.destroy(channel.connection);
+    channel.connection = nullptr;
+    bootArena.destroy(channel.transport);
+    channel.transport = nullptr;
+}
+
 bool TelegramModule::begin() {
     if (initialized) return true;
 
-    if (config.telegram.enable_telegram && strlen(config.telegram.bot_token) > 0) {
-        client = new WiFiClientSecure();
-        client->setCACert(TELEGRAM_CERTIFICATE_ROOT);
-        bot = new UniversalTelegramBot(config.telegram.bot_token, *client);
-        lastCheckTime = millis();
+    if (config().telegram.enable_telegram && strlen(config().telegram.bot_token) > 0) {
+        if (!lock) lock = xSemaphoreCreateMutex();
+        if (!sent) sent = xSemaphoreCreateBinary();
+        if (!openChannel(channel)) {
+            closeChannel(channel);
+            return false;
+        }
         initialized = true;
+
+        if (xTaskCreatePinnedToCore(pollTask, "telegram", POLL_STACK, this,
+                                    POLL_PRIORITY, &pollHandle, PRO_CPU_NUM) != pdPASS) {
+            Serial.println(" Failed to start Telegram poll task");
+            pollHandle = nullptr;
+        }
         
         Serial.println(" Telegram bot initialized");
-        Serial.println(" Bot Token: " + String(config.telegram.bot_token).substring(0, 10) + "...");
-        Serial.println(" Chat ID: " + String(config.telegram.chat_id));
+        Serial.println(" Bot Token: " + String(config().telegram.bot_token).substring(0, 10) + "...");
+        Serial.println(" Chat ID: " + String(config().telegram.chat_id));
+        if (strlen(config().telegram.api_server) > 0) {
+            Serial.println(" Using mock Bot API at " + String(config().telegram.api_server));
+        }
     } else {
         Serial.println(" Telegram bot disabled or invalid configuration");
         initialized = false;
@@ -31,146 +85,113 @@ bool TelegramModule::begin() {
 }
 
 void TelegramModule::stop() {
-    if (bot) {
-        delete bot;
-        bot = nullptr;
+    if (pollHandle) {
+        vTaskDelete(pollHandle);
+        pollHandle = nullptr;
     }
-    if (client) {
-        delete client;
-        client = nullptr;
+    // A sender still waiting for the poll task gets a failure
+    if (Outgoing* message = outgoing.exchange(nullptr)) {
+        message->success = false;
+        xSemaphoreGive(sent);
     }
+    closeChannel(channel);
     initialized = false;
     Serial.println(" Telegram bot stopped");
 }
 
-void TelegramModule::handleMessages() {
-    if (!initialized) return;
-
-    if (millis() - lastCheckTime > config.telegram.check_interval) {
-        int numNewMessages = bot->getUpdates(bot->last_message_received + 1);
+void TelegramModule::pollTask(void* arg) {
+    static_cast<TelegramModule*>(arg)->runPolling();
+}
 
-        for (int i = 0; i < numNewMessages; i++) {
-            String chatId = String(bot->messages[i].chat_id);
-            String text = bot->messages[i].text;
-            text.trim();
-            text.toLowerCase();
+void TelegramModule::runPolling() {
+    for (;;) {
+        sendOutgoing();
+        if (!config().telegram.enable_telegram || !WiFi.isConnected()) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+            continue;
+        }
 
-            Serial.println(" Telegram command: " + text + " from: " + chatId);
+        // Read every time so a change from the settings page applies to the
+        // next poll, and so a poll cut short by a sender doesn't stay short
+        int longPoll = config().telegram.long_poll;
+        channel.bot->longPoll = longPoll;
 
-            // Security check: only respond to authorized chat ID
-            if (chatId != config.telegram.chat_id) {
-                Serial.println(" Unauthorized chat ID: " + chatId);
-                bot->sendMessage(chatId, " Unauthorized access. Your chat ID: " + chatId, "");
-                continue;
-            }
+        unsigned long started = millis();
+        int received = pollOnce();
+        unsigned long elapsed = millis() - started;
 
-            handleCommand(chatId, text);
+        // Short polling, or a long poll that came back early and empty
+        // (an error): wait before asking again. A sender wakes us up.
+        if (longPoll == 0 || (received == 0 && elapsed < 1000)) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(config().telegram.check_interval));
         }
-
-        lastCheckTime = millis();
     }
 }
 
-void TelegramModule::handleCommand(String chatId, String text) {
-    String response;
-
-    if (text == "/start" || text == "/help") {
-        response = " *ESP32 Surveillance Bot Commands:*\n\n";
-        response += " `/status` - Current system status\n";
-        response += " `/history` - Recent distance readings\n";
-        response += " `/config` - System configuration\n";
-        response += " `/test` - Send test alert\n";
-        response += " `/restart` - Restart system\n";
-        response += " `/help` - This help message\n\n";
-        response += " _Distance Threshold: " + String(config.system.distance_threshold) + "cm_";
-
-    } else if (text == "/status") {
-        response = generateStatusMessage();
-        
-    } else if (text == "/history") {
-        response = " *Recent Distance History:*\n\n";
-        int count = min(5, systemState.getHistoryCount());
-        for (int i = 0; i < count; i++) {
-            SensorData data = systemState.getHistory(i);
-            response += "• " + String(data.distance, 1) + "cm - ";
-            response += (data.object_detected ? "🚨 Alert" : " Normal");
-            response += "\n";
-        }
-        if (count == 0) response += "No data available yet";
-        
-    } else if (text == "/config") {
-        response = " *System Configuration:*\n\n";
-        response += " Threshold: " + String(config.system.distance_threshold) + "cm\n";
-        response += " Cooldown: " + String(config.system.alert_cooldown/1000) + "s\n";
-        response += " Refresh: " + String(config.system.web_refresh_interval) + "s\n";
-        response += " Telegram: " + String(config.telegram.enable_telegram ? "Enabled" : "Disabled") + "\n";
-        response += " WiFi Mode: " + systemState.wifiMode + "\n";
-        response += " Uptime: " + systemState.getFormattedUptime();
-        
-    } else if (text == "/test") {
-        response = " *Test Alert Sent!*\n\n";
-        response += "This is a test notification from your surveillance system.\n";
-        response += "System time: " + String(millis()/1000) + "s";
-        
-    } else if (text == "/restart") {
-        response = " *System Restarting...*\n\n";
-        response += "ESP32 will restart in 3 seconds.";
-        bot->sendMessage(chatId, response, "");
-        delay(3000);
-        ESP.restart();
-        return;
-        
-    } else {
-        response = " Unknown command. Send `/help` for available commands.";
-    }
+int TelegramModule::pollOnce() {
+    HEAP_TAG("telegram");
+    UniversalTelegramBot* bot = channel.bot;
+    int longPoll = bot->longPoll;
 
-    if (bot->sendMessage(chatId, response, "Markdown")) {
-        Serial.println(" Telegram response sent");
-    } else {
-        Serial.println(" Failed to send Telegram response");
+    // From here on a sender cuts the poll short rather than wait it out;
+    // one that came just before is served first
+    parked = true;
+    sendOutgoing();
+    int numNewMessages = bot->getUpdates(bot->last_message_received + 1);
+    parked = false;
+    polls++;
+
+    if (longPoll > 0 && bot->longPoll == 0) {
+        // Its answer would arrive ahead of the next request's, so the
+        // connection can't be reused
+        pollsCut++;
+        channel.connection->close();
+        sendOutgoing();
     }
-}
 
-String TelegramModule::generateStatusMessage() {
-    String message = " *Surveillance System Status*\n\n";
-    message += " *Distance:* " + String(systemState.currentData.distance, 1) + " cm\n";
-    message += " *Alert:* " + String(systemState.currentData.object_detected ? "ACTIVE 🚨" : "Clear ✅") + "\n";
-    message += " *Status:* " + systemState.currentData.status + "\n";
-    message += " *Uptime:* " + systemState.getFormattedUptime() + "\n";
-    message += " *WiFi:* " + systemState.wifiMode + "\n";
-    message += " *Memory:* " + String(ESP.getFreeHeap()) + " bytes\n";
-    message += " *Data Points:* " + String(systemState.getHistoryCount()) + "\n\n";
-    
-    if (systemState.currentData.object_detected) {
-        message += " *Object detected within " + String(config.system.distance_threshold) + "cm!*";
-    } else {
-        message += " *System monitoring normally*";
+    for (int i = 0; i < numNewMessages; i++) {
+        String chatId = String(bot->messages[i].chat_id);
+        String text = bot->messages[i].text;
+        text.trim();
+
+        Serial.println(" Telegram command: " + text + " from: " + chatId);
+
+        // Security check: only respond to authorized chat ID
+        if (chatId != config().telegram.chat_id) {
+            Serial.println(" Unauthorized chat ID: " + chatId);
+            bot->sendMessage(chatId, " Unauthorized access. Your chat ID: " + chatId, "");
+            continue;
+        }
+
+        commandCount++;
+        CommandReply reply;
+        commands.dispatch(CMD_TELEGRAM, text.c_str(), reply);
+        if (bot->sendMessage(chatId, reply.text, "Markdown")) {
+            Serial.println(" Telegram response sent");
+        } else {
+            Serial.println(" Failed to send Telegram response");
+        }
+        commands.complete(reply);
     }
-    
-    return message;
+    return numNewMessages;
 }
 
-bool TelegramModule::sendAlert(const String& message) {
+bool TelegramModule::sendAlert(const String& message, float distance) {
     if (!initialized) return false;
 
-    // Check cooldown period
-    unsigned long currentTime = millis();
-    if (currentTime - systemState.lastAlertTime < config.system.alert_cooldown) {
-        Serial.println(" Alert cooldown active, skipping Telegram alert");
-        return false;
-    }
+    // Cooldown is enforced by the sensor task before an alert is queued
 
     String fullMessage = " *SURVEILLANCE ALERT* 🚨\n\n";
     fullMessage += message + "\n\n";
-    fullMessage += " Current Distance: " + String(systemState.currentData.distance, 1) + "cm\n";
+    // The reading that raised the alert, not whatever came in since
+    if (!isnan(distance)) fullMessage += " Distance: " + String(distance, 1) + "cm\n";
     fullMessage += " Time: " + systemState.getFormattedUptime() + "\n";
-    fullMessage += " Threshold: " + String(config.system.distance_threshold) + "cm";
+    fullMessage += " Threshold: " + String(config().system.distance_threshold) + "cm";
 
-    bool success = bot->sendMessage(config.telegram.chat_id, fullMessage, "Markdown");
+    bool success = send(config().telegram.chat_id, fullMessage, "Markdown");
     
     if (success) {
         Serial.println(" Telegram alert sent successfully");
-        systemState.lastAlertTime = currentTime;
     } else {
         Serial.println(" Failed to send Telegram alert");
     }
@@ -180,5 +201,59 @@ bool TelegramModule::sendAlert(const String& message) {
 
 bool TelegramModule::sendMessage(const String& chatId, const String& message) {
     if (!initialized) return false;
-    return bot->sendMessage(chatId, message, "");
-}
\ No newline at end of file
+    return send(chatId, message, "");
+}
+
+bool TelegramModule::send(const String& chatId, const String& text, const char* parseMode) {
+    Outgoing message = { &chatId, &text, parseMode, false };
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    outgoing = &message;
+    if (pollHandle && xTaskGetCurrentTaskHandle() != pollHandle) {
+        // UniversalTelegramBot rereads longPoll while it waits for an answer,
+        // so a parked getUpdates gives up at once
+        if (parked) channel.bot->longPoll = 0;
+        xTaskNotifyGive(pollHandle);
+    } else {
+        // On the poll task, or there is none: nothing else uses the connection
+        sendOutgoing();
+    }
+    xSemaphoreTake(sent, portMAX_DELAY);
+    xSemaphoreGive(lock);
+    return message.success;
+}
+
+void TelegramModule::sendOutgoing() {
+    Outgoing* message = outgoing.exchange(nullptr);
+    if (!message) return;
+
+    unsigned long started = millis();
+    message->success = channel.bot->sendMessage(*message->chatId, *message->text, message->parseMode);
+    recordRequest(started);
+    if (!message->success) {
+        // Don't reuse a session that just failed a request
+        channel.connection->close();
+    }
+    xSemaphoreGive(sent);
+}
+
+void TelegramModule::recordRequest(unsigned long started) {
+    unsigned long elapsed = millis() - started;
+    requests++;
+    requestTotalMs += elapsed;
+    if (elapsed > requestMaxMs) requestMaxMs = elapsed;
+}
+
+String TelegramModule::stats() const {
+    if (!initialized) return "Telegram off";
+
+    unsigned long avg = requests ? requestTotalMs / requests : 0;
+    return "Telegram sends " + String(requests) + " (avg " + String(avg) + "/max " +
+           String(requestMaxMs) + "ms), polls " + String(polls) + " (long poll " +
+           String(config().telegram.long_poll) + "s, " + String(pollsCut) + " cut short, " +
+           String(commandCount) + " commands), handshakes " + String(channel.connection->handshakeCount()) +
+           " (last " + String(channel.connection->lastHandshakeMs()) + "/max " +
+           String(channel.connection->maxHandshakeMs()) + "ms), reused " +
+           String(channel.connection->reuseCount()) + ", session heap " +
+           String(channel.connection->sessionHeapBytes()) + " B";
+}
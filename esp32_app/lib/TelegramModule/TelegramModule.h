@@ -4,18 +4,68 @@
 #include <Arduino.h>
 #include <UniversalTelegramBot.h>
 #include <WiFiClientSecure.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <atomic>
 #include "../../include/state.h"
 #include "../../include/config.h"
+#include "KeepAliveClient.h"
 
+// One Bot API connection: transport, keep-alive wrapper and bot instance
+struct TelegramChannel {
+  Client* transport = nullptr;
+  KeepAliveClient* connection = nullptr;
+  UniversalTelegramBot* bot = nullptr;
+};
+
+// Commands (see commands.h) are received by a dedicated task that long-polls getUpdates, so
+// they arrive within a round-trip and an idle bot makes one request per
+// long_poll period.
+//
+// Everything goes over one Bot API connection, so only one TLS session
+// (tens of KB of mbedTLS buffers) is ever resident. Only the poll task uses
+// it: sendAlert() and sendMessage() hand their message over and wait. When
+// a long poll is parked on the server, the hand-over cuts it short, and the
+// connection is dropped, since the server still owes that poll an answer.
+// So an alert waits for a fresh handshake at worst, never for a poll.
 class TelegramModule {
 private:
-  WiFiClientSecure* client;
-  UniversalTelegramBot* bot;
-  unsigned long lastCheckTime;
+  // A message handed to the poll task; lives on the sender's stack
+  struct Outgoing {
+    const String* chatId;
+    const String* text;
+    const char* parseMode;
+    bool success;
+  };
+
+  TelegramChannel channel;  // poll task only once it runs
   bool initialized;
-  
-  void handleCommand(String chatId, String text);
-  String generateStatusMessage();
+  SemaphoreHandle_t lock;   // one sender at a time
+  SemaphoreHandle_t sent;   // given by the poll task when `outgoing` is done
+  std::atomic<Outgoing*> outgoing;
+  std::atomic<bool> parked; // poll task is inside a long poll
+  TaskHandle_t pollHandle;
+
+  static const uint32_t POLL_STACK = 8192;
+  static const UBaseType_t POLL_PRIORITY = 1;
+
+  // Send latency (TLS reuse included) and poll counts
+  unsigned long requests;
+  unsigned long requestTotalMs;
+  unsigned long requestMaxMs;
+  unsigned long polls;
+  unsigned long pollsCut;
+  unsigned long commandCount;
+
+  bool openChannel(TelegramChannel& channel);
+  void closeChannel(TelegramChannel& channel);
+  static void pollTask(void* arg);
+  void runPolling();
+  int pollOnce();
+  bool send(const String& chatId, const String& text, const char* parseMode);
+  void sendOutgoing();
+  void recordRequest(unsigned long started);
 
 public:
   TelegramModule();
@@ -23,10 +73,10 @@ public:
   
   bool begin();
   void stop();
-  void handleMessages();
-  bool sendAlert(const String& message);
+  bool sendAlert(const String& message, float distance = NAN);
   bool sendMessage(const String& chatId, const String& message);
   bool isInitialized() const { return initialized; }
+  String stats() const;
 };
 
 extern TelegramModule telegramBot;
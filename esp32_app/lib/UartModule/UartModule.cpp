@@ -1,7 +1,9 @@
 #include "UartModule.h"
 #include "../../include/config.h"
+#include "../../include/trace.h"
+#include "../../include/boot_arena.h"
 
-UartModule piUart(config.hardware.uart_rx_pin, config.hardware.uart_tx_pin);
+UartModule piUart(config().hardware.uart_rx_pin, config().hardware.uart_tx_pin);
 
 UartModule::UartModule(int rxPin, int txPin, long baudRate) 
     : uart(nullptr), rxPin(rxPin), txPin(txPin), baudRate(baudRate), initialized(false) {}
@@ -13,7 +15,8 @@ UartModule::~UartModule() {
 bool UartModule::begin() {
     if (initialized) return true;
 
-    uart = new HardwareSerial(2); // Use UART2 on ESP32
+    uart = bootArena.create<HardwareSerial>("UART", 2); // Use UART2 on ESP32
+    if (!uart) return false;
     uart->begin(baudRate, SERIAL_8N1, rxPin, txPin);
     uart->setTimeout(100); // 100ms timeout
     
@@ -32,7 +35,7 @@ bool UartModule::begin() {
 void UartModule::end() {
     if (uart) {
         uart->end();
-        delete uart;
+        bootArena.destroy(uart);
         uart = nullptr;
     }
     initialized = false;
@@ -51,7 +54,7 @@ String UartModule::readString() {
     data.trim();
     
     if (data.length() > 0) {
-        Serial.println(" UART received: " + data);
+        TRACE(UART_RX, data.length(), data.c_str());
     }
     
     return data;
@@ -61,12 +64,12 @@ void UartModule::writeString(const String& data) {
     if (!initialized) return;
     
     uart->print(data);
-    Serial.println(" UART sent: " + data);
+    TRACE(UART_TX, data.length(), data.c_str());
 }
 
 void UartModule::writeBytes(const uint8_t* data, size_t length) {
     if (!initialized) return;
     
     uart->write(data, length);
-    Serial.println(" UART sent " + String(length) + " bytes");
+    TRACE(UART_TX_RAW, length);
 }
\ No newline at end of file
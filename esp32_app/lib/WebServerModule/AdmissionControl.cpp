@@ -0,0 +1,164 @@
+#include "AdmissionControl.h"
+#include "../../include/trace.h"
+#include "../GzipStream/GzipStream.h"
+
+AdmissionControl admission;
+
+// Name, priority, requests of this endpoint in flight at most
+AdmissionControl::EndpointStats AdmissionControl::endpoints[WEB_ENDPOINT_COUNT] = {
+  {"dashboard",     WebPriority::Page,    2},
+  {"config_page",   WebPriority::Page,    1},
+  {"history_page",  WebPriority::Page,    1},
+  {"not_found",     WebPriority::Page,    1},
+  {"status",        WebPriority::Api,     3},
+  {"history",       WebPriority::Api,     2},
+  {"chart",         WebPriority::Api,     1},
+  {"config",        WebPriority::Api,     2},
+  {"config_save",   WebPriority::Api,     1},
+  {"command",       WebPriority::Api,     2},
+  {"logs",          WebPriority::Bulk,    1},
+  {"heap",          WebPriority::Metrics, 2},
+  {"web",           WebPriority::Metrics, 2},
+  {"export",        WebPriority::Bulk,    1},
+  {"bench",         WebPriority::Bulk,    1},
+};
+
+// Tickets per priority kept free for the priorities above it
+static const uint8_t RESERVED[] = {
+  0,                                           // Metrics
+  1,                                           // Api
+  WEB_MAX_IN_FLIGHT / 2,                       // Page
+  WEB_MAX_IN_FLIGHT - WEB_MAX_IN_FLIGHT / 3,   // Bulk
+};
+
+bool AdmissionControl::Ticket::hold(RequestArena::Lease* lease) {
+  for (RequestArena::Lease*& slot : leases) {
+    if (slot) continue;
+    slot = lease;
+    return true;
+  }
+  return false;
+}
+
+AdmissionControl::Ticket* AdmissionControl::enter(WebEndpoint endpoint) {
+  EndpointStats& stats = endpoints[endpoint];
+  uint8_t reserved = RESERVED[(int)stats.priority];
+  if (stats.inFlight >= stats.limit || active + reserved >= WEB_MAX_IN_FLIGHT) {
+    stats.shed++;
+    TRACE(WEB_SHED, stats.name, (unsigned)active);
+    return nullptr;
+  }
+
+  for (Ticket& ticket : tickets) {
+    if (ticket.taken) continue;
+    ticket = Ticket();
+    ticket.taken = true;
+    ticket.route = endpoint;
+    ticket.startMs = millis();
+
+    if (++stats.inFlight > stats.peak) stats.peak = stats.inFlight;
+    if (++active > peakActive) peakActive = active;
+    return &ticket;
+  }
+  // Can't happen while active < WEB_MAX_IN_FLIGHT, but never hand out a ticket twice
+  stats.shed++;
+  return nullptr;
+}
+
+void AdmissionControl::finish(Ticket* ticket) {
+  if (!ticket || !ticket->taken) return;
+  for (RequestArena::Lease* lease : ticket->leases) {
+    if (lease) lease->release();
+  }
+
+  EndpointStats& stats = endpoints[ticket->route];
+  if (ticket->busy) {
+    stats.shed++;
+  } else {
+    uint32_t heldMs = millis() - ticket->startMs;
+    stats.served++;
+    stats.totalMs += heldMs;
+    if (heldMs > stats.maxMs) stats.maxMs = heldMs;
+  }
+  stats.inFlight--;
+  active--;
+  ticket->taken = false;
+}
+
+uint8_t AdmissionControl::retryAfter(WebEndpoint endpoint) {
+  // Pages and bulk transfers back off longer so polls get through first
+  return endpoints[endpoint].priority >= WebPriority::Page ? 2 : 1;
+}
+
+String AdmissionControl::summary() const {
+  uint32_t served = 0;
+  uint32_t shed = 0;
+  uint32_t slowest = 0;
+  const char* slowestName = nullptr;
+  for (const EndpointStats& stats : endpoints) {
+    served += stats.served;
+    shed += stats.shed;
+    if (stats.maxMs > slowest) {
+      slowest = stats.maxMs;
+      slowestName = stats.name;
+    }
+  }
+
+  String out = "requests " + String(served) + " served, " + String(shed) + " shed, " +
+               String(peakActive) + "/" + String(WEB_MAX_IN_FLIGHT) + " in flight at peak";
+  if (slowestName) out += ", slowest " + String(slowestName) + " " + String(slowest) + " ms";
+  return out;
+}
+
+void AdmissionControl::writeJson(Print& out) const {
+  static const char* const PRIORITIES[] = {"metrics", "api", "page", "bulk"};
+
+  out.print("{\"in_flight\":");
+  out.print(active);
+  out.print(",\"peak_in_flight\":");
+  out.print(peakActive);
+  out.print(",\"max_in_flight\":");
+  out.print(WEB_MAX_IN_FLIGHT);
+  out.print(",\"endpoints\":[");
+  for (int i = 0; i < WEB_ENDPOINT_COUNT; i++) {
+    const EndpointStats& stats = endpoints[i];
+    if (i > 0) out.print(',');
+    out.print("{\"name\":\"");
+    out.print(stats.name);
+    out.print("\",\"priority\":\"");
+    out.print(PRIORITIES[(int)stats.priority]);
+    out.print("\",\"limit\":");
+    out.print(stats.limit);
+    out.print(",\"in_flight\":");
+    out.print(stats.inFlight);
+    out.print(",\"peak\":");
+    out.print(stats.peak);
+    out.print(",\"served\":");
+    out.print(stats.served);
+    out.print(",\"shed\":");
+    out.print(stats.shed);
+    out.print(",\"avg_ms\":");
+    out.print(stats.served ? (uint32_t)(stats.totalMs / stats.served) : 0);
+    out.print(",\"max_ms\":");
+    out.print(stats.maxMs);
+    out.print('}');
+  }
+
+  out.print("],\"arena\":{\"slabs\":");
+  out.print(requestArena.slabs());
+  out.print(",\"in_use\":");
+  out.print(requestArena.inUse());
+  out.print(",\"peak\":");
+  out.print(requestArena.peakInUse());
+  out.print(",\"busy\":");
+  out.print(requestArena.rejected());
+  out.print(",\"too_large\":");
+  out.print(requestArena.overflows());
+
+  // Compressed responses completed so far, and the CPU time they cost
+  GzipStream::Totals gzip = GzipStream::totals();
+  out.printf("},\"gzip\":{\"streams\":%lu,\"bytes_in\":%llu,\"bytes_out\":%llu,\"us_per_kb\":%lu}}",
+             (unsigned long)gzip.streams, (unsigned long long)gzip.bytesIn,
+             (unsigned long long)gzip.bytesOut,
+             (unsigned long)(gzip.bytesIn ? gzip.busyUs * 1024 / gzip.bytesIn : 0));
+}
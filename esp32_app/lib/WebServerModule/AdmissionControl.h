@@ -0,0 +1,108 @@
+#ifndef ADMISSION_CONTROL_H
+#define ADMISSION_CONTROL_H
+
+#include <Arduino.h>
+#include "../../include/request_arena.h"
+
+#ifndef WEB_MAX_IN_FLIGHT
+#define WEB_MAX_IN_FLIGHT 6
+#endif
+
+// Routes the admission table knows about; order matches ENDPOINTS in
+// AdmissionControl.cpp
+enum WebEndpoint : uint8_t {
+  WEB_DASHBOARD,
+  WEB_CONFIG_PAGE,
+  WEB_HISTORY_PAGE,
+  WEB_NOT_FOUND,
+  WEB_STATUS,
+  WEB_HISTORY,
+  WEB_CHART,
+  WEB_CONFIG,
+  WEB_CONFIG_SAVE,
+  WEB_COMMAND,
+  WEB_LOGS,
+  WEB_HEAP,
+  WEB_STATS,
+  WEB_EXPORT,
+  WEB_BENCH,
+  WEB_ENDPOINT_COUNT
+};
+
+// Lower value wins when the server is busy
+enum class WebPriority : uint8_t {
+  Metrics,   // /api/heap, /api/web: what you look at when things go wrong
+  Api,       // status, history, chart, config, commands
+  Page,      // HTML pages
+  Bulk       // exports, logs, benchmarks
+};
+
+// Admission control for the web server. Every request takes a ticket before
+// any work is done and gives it back when its connection closes. A request
+// is turned away (503 with Retry-After) when its endpoint already has its
+// limit of requests in flight, or when the server as a whole is past the
+// share its priority may use: metrics can fill all WEB_MAX_IN_FLIGHT
+// tickets, the API all but one, pages half and bulk transfers a third. So a
+// burst of page loads or exports can never take the last tickets a status
+// poll or /api/heap needs.
+//
+// Tickets also hold the request arena slabs of their request, so one
+// disconnect handler returns everything. Like the arena, tickets are taken
+// and returned on the async_tcp task only.
+class AdmissionControl {
+public:
+  class Ticket {
+  public:
+    // Slab to return with the ticket; false if it already holds two
+    bool hold(RequestArena::Lease* lease);
+    // The request was answered 503 after all (no slab free)
+    void refused() { busy = true; }
+    WebEndpoint endpoint() const { return route; }
+
+  private:
+    friend class AdmissionControl;
+    RequestArena::Lease* leases[2] = {nullptr, nullptr};
+    uint32_t startMs = 0;
+    WebEndpoint route = WEB_DASHBOARD;
+    bool busy = false;
+    bool taken = false;
+  };
+
+  struct EndpointStats {
+    const char* name;
+    WebPriority priority;
+    uint8_t limit;
+    uint8_t inFlight;
+    uint8_t peak;
+    uint32_t served;
+    uint32_t shed;
+    uint32_t maxMs;
+    uint64_t totalMs;
+  };
+
+  // nullptr when the request has to be shed; counted as shed
+  Ticket* enter(WebEndpoint endpoint);
+  // Returns the ticket and its slabs, records the time it was held
+  void finish(Ticket* ticket);
+
+  // Seconds a shed client should wait before trying again
+  static uint8_t retryAfter(WebEndpoint endpoint);
+
+  uint8_t inFlight() const { return active; }
+  const EndpointStats& stats(WebEndpoint endpoint) const { return endpoints[endpoint]; }
+
+  // Totals for the health log
+  String summary() const;
+  // GET /api/web: per-endpoint counters plus the request arena
+  void writeJson(Print& out) const;
+
+private:
+  static EndpointStats endpoints[WEB_ENDPOINT_COUNT];
+  Ticket tickets[WEB_MAX_IN_FLIGHT];
+  uint8_t active = 0;
+  uint8_t peakActive = 0;
+};
+
+extern AdmissionControl admission;
+
+#endif
@@ -1,7 +1,91 @@
 #include "WebServerModule.h"
 #include "../HtmlPage/html_page.h"
+#include "../DataManager/DataExport.h"
+#include "../DataManager/ChartDownsample.h"
+#include "../GzipStream/GzipStream.h"
+#include "../../include/config_schema.h"
+#include "../../include/config_store.h"
+#include "../../include/commands.h"
+#include "../../include/trace.h"
+#include "../../include/bench.h"
+#include "../../include/uart_replay.h"
+#include "../../include/heap_profiler.h"
+#include "../../include/boot_arena.h"
+#include "../../include/request_arena.h"
+#include <SPIFFS.h>
 #include <ArduinoJson.h>
 #include <AsyncJson.h>
+#include <algorithm>
+
+// Smaller bodies go out as they are; the compressor needs a slab of its own
+static const size_t GZIP_MIN_BYTES = 1024;
+
+// Read position in a finished body, kept next to its compressor
+struct LeaseReader {
+  const uint8_t* data;
+  size_t length;
+  size_t pos;
+};
+
+static size_t readLease(void* context, uint8_t* buffer, size_t maxLen) {
+  LeaseReader* reader = static_cast<LeaseReader*>(context);
+  size_t n = std::min(maxLen, reader->length - reader->pos);
+  memcpy(buffer, reader->data + reader->pos, n);
+  reader->pos += n;
+  return n;
+}
+
+static size_t readExport(void* context, uint8_t* buffer, size_t maxLen) {
+  return static_cast<DataExport*>(context)->read(buffer, maxLen);
+}
+
+static size_t readChart(void* context, uint8_t* buffer, size_t maxLen) {
+  return static_cast<ChartDownsample*>(context)->read(buffer, maxLen);
+}
+
+// /api/logs as text: records formatted one line at a time from a snapshot
+// taken into the same slab
+struct LogCursor {
+  const TraceRecord* records;
+  size_t count;
+  size_t next;
+  char line[TRACE_LINE_LENGTH + 2];
+  size_t lineLength;
+  size_t linePos;
+};
+
+static size_t readLogs(LogCursor* cursor, uint8_t* buffer, size_t maxLen) {
+  size_t written = 0;
+  while (written < maxLen) {
+    if (cursor->linePos == cursor->lineLength) {
+      if (cursor->next == cursor->count) break;
+      size_t length = TraceLog::format(cursor->records[cursor->next++], cursor->line, TRACE_LINE_LENGTH);
+      length = std::min(length, (size_t)TRACE_LINE_LENGTH - 1);
+      cursor->line[length++] = '\r';
+      cursor->line[length++] = '\n';
+      cursor->lineLength = length;
+      cursor->linePos = 0;
+    }
+    size_t n = std::min(maxLen - written, cursor->lineLength - cursor->linePos);
+    memcpy(buffer + written, cursor->line + cursor->linePos, n);
+    cursor->linePos += n;
+    written += n;
+  }
+  return written;
+}
+
+static bool acceptsGzip(AsyncWebServerRequest* request) {
+  if (!request->hasHeader("Accept-Encoding")) return false;
+  const char* gzip = strstr(request->getHeader("Accept-Encoding")->value().c_str(), "gzip");
+  if (!gzip) return false;
+  // "gzip;q=0" (also written "gzip ; q=0") means not acceptable
+  const char* params = gzip + 4;
+  while (*params == ' ' || *params == '\t') params++;
+  if (*params != ';') return true;
+  params++;
+  while (*params == ' ' || *params == '\t') params++;
+  return strncmp(params, "q=", 2) != 0 || atof(params + 2) > 0;
+}
 
 WebServerModule::WebServerModule() : server(nullptr), initialized(false) {}
 
@@ -12,7 +96,7 @@ WebServerModule::~WebServerModule() {
 bool WebServerModule::begin() {
   if (initialized) return true;
   
-  server = new AsyncWebServer(80);
+  server = bootArena.create<AsyncWebServer>("web server", 80);
   if (!server) return false;
   
   setupRoutes();
@@ -26,60 +110,103 @@ bool WebServerModule::begin() {
 void WebServerModule::stop() {
   if (server) {
     server->end();
-    delete server;
+    bootArena.destroy(server);
     server = nullptr;
   }
   initialized = false;
 }
 
 void WebServerModule::setupRoutes() {
+  // Every route but the replay upload goes through admit() first; see
+  // AdmissionControl.h for the limits and priorities
+
   // Root endpoint - dashboard
   server->on("/", HTTP_GET, [this](AsyncWebServerRequest* request) {
-    handleRoot(request);
+    if (AdmissionControl::Ticket* ticket = admit(request, WEB_DASHBOARD)) handleRoot(request, ticket);
   });
   
   // Pages
   server->on("/config", HTTP_GET, [this](AsyncWebServerRequest* request) {
-    AsyncWebServerResponse *response = request->beginResponse(200, "text/html", HtmlPage::generateConfigPage());
-    response->addHeader("Cache-Control", "no-cache, no-store, must-revalidate");
-    request->send(response);
+    if (AdmissionControl::Ticket* ticket = admit(request, WEB_CONFIG_PAGE)) {
+      streamPage(request, ticket, 200, HtmlPage::configPage);
+    }
   });
 
   server->on("/history", HTTP_GET, [this](AsyncWebServerRequest* request) {
-    AsyncWebServerResponse *response = request->beginResponse(200, "text/html", HtmlPage::generateHistoryPage());
-    response->addHeader("Cache-Control", "no-cache, no-store, must-revalidate");
-    request->send(response);
+    if (AdmissionControl::Ticket* ticket = admit(request, WEB_HISTORY_PAGE)) {
+      streamPage(request, ticket, 200, HtmlPage::historyPage);
+    }
   });
   
   // API endpoints
   server->on("/api/status", HTTP_GET, [this](AsyncWebServerRequest* request) {
-    handleAPI(request);
+    if (AdmissionControl::Ticket* ticket = admit(request, WEB_STATUS)) handleAPI(request, ticket);
   });
   
   server->on("/api/history", HTTP_GET, [this](AsyncWebServerRequest* request) {
-    handleHistory(request);
+    if (AdmissionControl::Ticket* ticket = admit(request, WEB_HISTORY)) handleHistory(request, ticket);
   });
+
+  server->on("/api/chart", HTTP_GET, [this](AsyncWebServerRequest* request) {
+    if (AdmissionControl::Ticket* ticket = admit(request, WEB_CHART)) handleChart(request, ticket);
+  });
+
+  server->on("/api/export", HTTP_GET, [this](AsyncWebServerRequest* request) {
+    if (AdmissionControl::Ticket* ticket = admit(request, WEB_EXPORT)) handleExport(request, ticket);
+  });
+  
+  server->on("/api/config", HTTP_GET, [this](AsyncWebServerRequest* request) {
+    if (AdmissionControl::Ticket* ticket = admit(request, WEB_CONFIG)) handleConfig(request, ticket);
+  });
+
+  server->on("/api/logs", HTTP_GET, [this](AsyncWebServerRequest* request) {
+    if (AdmissionControl::Ticket* ticket = admit(request, WEB_LOGS)) handleLogs(request, ticket);
+  });
+
+  server->on("/api/heap", HTTP_GET, [this](AsyncWebServerRequest* request) {
+    if (AdmissionControl::Ticket* ticket = admit(request, WEB_HEAP)) handleHeap(request, ticket);
+  });
+
+  server->on("/api/web", HTTP_GET, [this](AsyncWebServerRequest* request) {
+    if (AdmissionControl::Ticket* ticket = admit(request, WEB_STATS)) handleWebStats(request, ticket);
+  });
+
+  server->on("/api/bench", HTTP_GET, [this](AsyncWebServerRequest* request) {
+    if (AdmissionControl::Ticket* ticket = admit(request, WEB_BENCH)) handleBench(request, ticket);
+  });
+
+  // UART capture upload for the replay source (multipart, field name is free)
+  server->on("/api/replay", HTTP_POST,
+    [](AsyncWebServerRequest* request) {
+      if (uartReplay.isActive()) {
+        request->send(409, "application/json", "{\"status\":\"error\", \"message\":\"replay running\"}");
+        return;
+      }
+      bool stored = SPIFFS.exists(REPLAY_FILE);
+      request->send(stored ? 200 : 500, "application/json",
+                    stored ? "{\"status\":\"ok\"}" : "{\"status\":\"error\"}");
+    },
+    [this](AsyncWebServerRequest* request, const String& filename, size_t index,
+           uint8_t* data, size_t len, bool final) {
+      handleReplayUpload(request, index, data, len, final);
+    });
   
   // Handle config submission (JSON)
   AsyncCallbackJsonWebHandler* configHandler = new AsyncCallbackJsonWebHandler("/api/config", 
     [this](AsyncWebServerRequest *request, JsonVariant &json) {
-      JsonObject jsonObj = json.as<JsonObject>();
-      
-      // Update config from JSON
-      if (jsonObj.containsKey("threshold")) {
-          config.system.distance_threshold = jsonObj["threshold"].as<float>();
-      }
-      if (jsonObj.containsKey("cooldown")) {
-          config.system.alert_cooldown = jsonObj["cooldown"].as<unsigned long>() * 1000;
-      }
-      if (jsonObj.containsKey("telegram")) {
-          String val = jsonObj["telegram"].as<String>();
-          config.telegram.enable_telegram = (val == "true");
+      if (!admit(request, WEB_CONFIG_SAVE)) return;
+
+      // Validate into a copy so a bad field leaves the live config untouched
+      AppConfig updated;
+      configStore.current(updated);
+      String error;
+      if (!ConfigSchema::fromJson(updated, json.as<JsonObjectConst>(), error)) {
+        request->send(400, "application/json", "{\"status\":\"error\", \"message\":\"" + error + "\"}");
+        return;
       }
       
-      // Save config (assuming DataManager handles persistence elsewhere or we trigger it)
-      // Ideally we should call dataManager.saveConfig(config);
-      // For now, just respond success
+      // The main loop applies it and persists after edits settle
+      configStore.stage(updated);
       
       request->send(200, "application/json", "{\"status\":\"ok\", \"message\":\"Configuration saved\"}");
   });
@@ -87,98 +214,377 @@ void WebServerModule::setupRoutes() {
   
   // Command endpoint
   server->on("/api/command", HTTP_POST, [this](AsyncWebServerRequest* request) {
-    handleCommand(request);
+    if (admit(request, WEB_COMMAND)) handleCommand(request);
   });
   
   // 404 handler
-  server->onNotFound([](AsyncWebServerRequest* request) {
-    request->send(404, "text/html", HtmlPage::generateErrorPage("Page not found"));
+  server->onNotFound([this](AsyncWebServerRequest* request) {
+    if (AdmissionControl::Ticket* ticket = admit(request, WEB_NOT_FOUND)) {
+      streamPage(request, ticket, 404, HtmlPage::errorPage, "Page not found");
+    }
   });
 }
 
-void WebServerModule::handleRoot(AsyncWebServerRequest* request) {
-  Serial.println("🌐 Handling Root Request");
-  String html = HtmlPage::generateDashboard();
-  Serial.println("📄 HTML Length: " + String(html.length()));
-  
-  AsyncWebServerResponse *response = request->beginResponse(200, "text/html; charset=utf-8", html);
+AdmissionControl::Ticket* WebServerModule::admit(AsyncWebServerRequest* request, WebEndpoint endpoint) {
+  AdmissionControl::Ticket* ticket = admission.enter(endpoint);
+  if (!ticket) {
+    shed(request, endpoint);
+    return nullptr;
+  }
+  // The ticket, and any slabs it holds, is returned when the connection
+  // closes, after the last byte has been sent or the client went away.
+  // A request has one disconnect handler, so nothing else may set it.
+  request->onDisconnect([ticket]() { admission.finish(ticket); });
+  return ticket;
+}
+
+void WebServerModule::shed(AsyncWebServerRequest* request, WebEndpoint endpoint) {
+  // Answered at once rather than queued; the client knows when to come back
+  AsyncWebServerResponse* response = request->beginResponse(503, "text/plain", "Server busy");
+  response->addHeader("Retry-After", String(AdmissionControl::retryAfter(endpoint)));
+  response->addHeader("Cache-Control", "no-cache");
+  request->send(response);
+}
+
+RequestArena::Lease* WebServerModule::leaseFor(AsyncWebServerRequest* request, AdmissionControl::Ticket* ticket) {
+  bool metrics = admission.stats(ticket->endpoint()).priority == WebPriority::Metrics;
+  RequestArena::Lease* lease = requestArena.acquire(metrics);
+  if (!lease) {
+    ticket->refused();
+    shed(request, ticket->endpoint());
+    return nullptr;
+  }
+  ticket->hold(lease);
+  return lease;
+}
+
+RequestArena::Lease* WebServerModule::extraLease(AdmissionControl::Ticket* ticket) {
+  // No 503 here: the caller can always send uncompressed instead
+  RequestArena::Lease* lease = requestArena.acquire();
+  if (lease && !ticket->hold(lease)) {
+    lease->release();
+    return nullptr;
+  }
+  return lease;
+}
+
+void WebServerModule::sendLease(AsyncWebServerRequest* request, AdmissionControl::Ticket* ticket,
+                                RequestArena::Lease* lease, int code, const char* contentType) {
+  if (lease->overflowed()) {
+    Serial.println("❌ Response for " + request->url() + " is over " +
+                   String(RequestArena::slabSize()) + " bytes (raise REQUEST_ARENA_SLAB_SIZE)");
+    request->send(500, "text/plain", "Response too large");
+    return;
+  }
+
+  if (lease->length() >= GZIP_MIN_BYTES && acceptsGzip(request)) {
+    RequestArena::Lease* packed = extraLease(ticket);
+    LeaseReader* reader = packed ? packed->create<LeaseReader>(LeaseReader{lease->data(), lease->length(), 0}) : nullptr;
+    GzipStream* stream = reader ? packed->create<GzipStream>(readLease, reader) : nullptr;
+    if (stream) {
+      AsyncWebServerResponse* response = request->beginChunkedResponse(contentType,
+        [stream](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+          return stream->read(buffer, maxLen);
+        });
+      response->setCode(code);
+      response->addHeader("Content-Encoding", "gzip");
+      response->addHeader("Vary", "Accept-Encoding");
+      request->send(response);
+      return;
+    }
+  }
+
+  // Sent straight from the slab, not copied
+  request->send(request->beginResponse(code, contentType, lease->data(), lease->length()));
+}
+
+void WebServerModule::streamPage(AsyncWebServerRequest* request, AdmissionControl::Ticket* ticket, int code,
+                                 HtmlPage::Page page, const char* message) {
+  // Only the template's read position and the values it shows live in the
+  // slab; the page text is copied from flash into each chunk as the
+  // connection takes it
+  RequestArena::Lease* lease = leaseFor(request, ticket);
+  if (!lease) return;
+  HtmlPage::PageValues* values = lease->create<HtmlPage::PageValues>();
+  if (values) HtmlPage::capture(*values, message);
+  TemplateStream* stream = values ? lease->create<TemplateStream>(page(*values)) : nullptr;
+  if (!stream) {
+    request->send(500, "text/plain", "Out of memory");
+    return;
+  }
+
+  AsyncWebServerResponse* response = request->beginChunkedResponse("text/html; charset=utf-8",
+    [stream](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+      return stream->read(buffer, maxLen);
+    });
+  response->setCode(code);
   response->addHeader("Cache-Control", "no-cache, no-store, must-revalidate");
   response->addHeader("Pragma", "no-cache");
   response->addHeader("Expires", "0");
   request->send(response);
 }
 
-void WebServerModule::handleAPI(AsyncWebServerRequest* request) {
-  request->send(200, "application/json", HtmlPage::generateAPIResponse());
+void WebServerModule::handleRoot(AsyncWebServerRequest* request, AdmissionControl::Ticket* ticket) {
+  Serial.println("🌐 Handling Root Request");
+  streamPage(request, ticket, 200, HtmlPage::dashboard);
 }
 
-void WebServerModule::handleHistory(AsyncWebServerRequest* request) {
-  // Create a JSON response with history data
-  // We need to access systemState.history but it's private.
-  // We should add a method in SystemState to get history as JSON or expose it.
-  // Or we can iterate if we have access. SystemState header says:
-  // SensorData getHistory(int index) const;
-  // int getHistoryCount() const;
-  
-  StaticJsonDocument<4096> doc; // Adjust size as needed
-  JsonArray history = doc.createNestedArray("history");
-  
-  int count = systemState.getHistoryCount();
-  for (int i = 0; i < count; i++) {
-      SensorData data = systemState.getHistory(i);
-      JsonObject item = history.createNestedObject();
-      item["distance"] = data.distance;
-      item["timestamp"] = data.timestamp;
-      item["object_detected"] = data.object_detected;
+void WebServerModule::handleAPI(AsyncWebServerRequest* request, AdmissionControl::Ticket* ticket) {
+  RequestArena::Lease* body = leaseFor(request, ticket);
+  if (!body) return;
+  HtmlPage::writeAPIResponse(*body);
+  sendLease(request, ticket, body, 200, "application/json");
+}
+
+void WebServerModule::handleHistory(AsyncWebServerRequest* request, AdmissionControl::Ticket* ticket) {
+  RequestArena::Lease* body = leaseFor(request, ticket);
+  if (!body) return;
+  HtmlPage::writeHistoryJson(*body);
+  sendLease(request, ticket, body, 200, "application/json");
+}
+
+void WebServerModule::handleChart(AsyncWebServerRequest* request, AdmissionControl::Ticket* ticket) {
+  // GET /api/chart?from=<s>&to=<s>&points=<n> - stored samples in the range
+  // downsampled to at most n points (default 300) for the history chart
+  if (!dataManager.isStorageReady()) {
+    request->send(503, "application/json", "{\"error\":\"storage unavailable\"}");
+    return;
   }
-  
-  String response;
-  serializeJson(doc, response);
-  request->send(200, "application/json", response);
-}
-
-void WebServerModule::handleConfig(AsyncWebServerRequest* request) {
-    // This is handled by the JsonHandler now for POST
-    // For GET, we return the current config as JSON?
-    // Or maybe just the HTML page handles it.
-    // Let's implement GET for API consistency
-    StaticJsonDocument<512> doc;
-    doc["threshold"] = config.system.distance_threshold;
-    doc["cooldown"] = config.system.alert_cooldown / 1000;
-    doc["telegram"] = config.telegram.enable_telegram;
+
+  uint32_t from = 0;
+  uint32_t to = UINT32_MAX;
+  uint16_t points = 300;
+  if (request->hasParam("from")) from = strtoul(request->getParam("from")->value().c_str(), nullptr, 10);
+  if (request->hasParam("to")) to = strtoul(request->getParam("to")->value().c_str(), nullptr, 10);
+  if (request->hasParam("points")) {
+    points = constrain(request->getParam("points")->value().toInt(), (long)ChartDownsample::MIN_POINTS,
+                       (long)ChartDownsample::MAX_POINTS);
+  }
+
+  // Both flash cursors live in the chart, in the request's slab; their
+  // files are closed when the slab goes back
+  RequestArena::Lease* lease = leaseFor(request, ticket);
+  if (!lease) return;
+  ChartDownsample* chart = lease->create<ChartDownsample>(from, to, points);
+  if (!chart) {
+    request->send(500, "text/plain", "Out of memory");
+    return;
+  }
+
+  GzipStream* stream = nullptr;
+  if (acceptsGzip(request)) {
+    RequestArena::Lease* packed = extraLease(ticket);
+    if (packed) stream = packed->create<GzipStream>(readChart, chart);
+  }
+
+  AsyncWebServerResponse* response;
+  if (stream) {
+    response = request->beginChunkedResponse("application/json",
+      [stream](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+        return stream->read(buffer, maxLen);
+      });
+    response->addHeader("Content-Encoding", "gzip");
+    response->addHeader("Vary", "Accept-Encoding");
+  } else {
+    response = request->beginChunkedResponse("application/json",
+      [chart](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+        return chart->read(buffer, maxLen);
+      });
+  }
+  response->addHeader("Cache-Control", "no-cache");
+  request->send(response);
+}
+
+void WebServerModule::handleExport(AsyncWebServerRequest* request, AdmissionControl::Ticket* ticket) {
+  // /api/export?from=<s>&to=<s>&clock=epoch|uptime&format=ndjson|csv&include=all|samples|events
+  // &gzip=0|1, compressed by default when the client accepts gzip
+  if (!dataManager.isStorageReady()) {
+    request->send(503, "application/json", "{\"error\":\"storage unavailable\"}");
+    return;
+  }
+
+  uint32_t from = 0;
+  uint32_t to = UINT32_MAX;
+  if (request->hasParam("from")) from = strtoul(request->getParam("from")->value().c_str(), nullptr, 10);
+  if (request->hasParam("to")) to = strtoul(request->getParam("to")->value().c_str(), nullptr, 10);
+
+  // Seconds of one clock only: uptime and epoch times can't share a range
+  ExportClock clock = ExportClock::Epoch;
+  if (request->hasParam("clock")) {
+    String name = request->getParam("clock")->value();
+    if (name == "uptime") {
+      clock = ExportClock::Uptime;
+    } else if (name != "epoch") {
+      request->send(400, "application/json", "{\"error\":\"clock must be epoch or uptime\"}");
+      return;
+    }
+  }
+
+  ExportFormat format = ExportFormat::NDJSON;
+  if (request->hasParam("format") && request->getParam("format")->value() == "csv") {
+    format = ExportFormat::CSV;
+  }
+
+  String include = request->hasParam("include") ? request->getParam("include")->value() : "all";
+  bool samples = include != "events";
+  bool events = include != "samples";
+  bool gzip = request->hasParam("gzip") ? request->getParam("gzip")->value() != "0" : acceptsGzip(request);
+
+  // The cursor lives in the request's slab; its files are closed when the
+  // slab goes back
+  RequestArena::Lease* lease = leaseFor(request, ticket);
+  if (!lease) return;
+  DataExport* cursor = lease->create<DataExport>(format, clock, from, to, samples, events);
+  if (!cursor) {
+    request->send(500, "text/plain", "Out of memory");
+    return;
+  }
+  const char* contentType = format == ExportFormat::CSV ? "text/csv" : "application/x-ndjson";
+  const char* filename = format == ExportFormat::CSV ? "attachment; filename=\"export.csv\""
+                                                     : "attachment; filename=\"export.ndjson\"";
+
+  // The compressor takes a request arena slab; without one the export goes out plain
+  GzipStream* stream = nullptr;
+  if (gzip) {
+    RequestArena::Lease* packed = extraLease(ticket);
+    if (packed) stream = packed->create<GzipStream>(readExport, cursor);
+  }
+
+  AsyncWebServerResponse* response;
+  if (stream) {
+    response = request->beginChunkedResponse(contentType,
+      [stream](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+        return stream->read(buffer, maxLen);
+      });
+    response->addHeader("Content-Encoding", "gzip");
+    response->addHeader("Vary", "Accept-Encoding");
+  } else {
+    response = request->beginChunkedResponse(contentType,
+      [cursor](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+        return cursor->read(buffer, maxLen);
+      });
+  }
+
+  response->addHeader("Content-Disposition", filename);
+  response->addHeader("Cache-Control", "no-cache");
+  request->send(response);
+}
+
+void WebServerModule::handleConfig(AsyncWebServerRequest* request, AdmissionControl::Ticket* ticket) {
+    // GET /api/config - every field from the schema, secrets masked
+    AppConfig current;
+    configStore.current(current);
     
-    String response;
-    serializeJson(doc, response);
-    request->send(200, "application/json", response);
+    RequestArena::Lease* body = leaseFor(request, ticket);
+    if (!body) return;
+
+    StaticJsonDocument<3072> doc;
+    ConfigSchema::toJson(current, doc.to<JsonObject>());
+    serializeJson(doc, *body);
+    sendLease(request, ticket, body, 200, "application/json");
+}
+
+void WebServerModule::handleLogs(AsyncWebServerRequest* request, AdmissionControl::Ticket* ticket) {
+  // GET /api/logs?n=<records>&format=text|bin - newest trace records, oldest
+  // first; "bin" is the raw 32-byte records for trace_decode.py. The
+  // snapshot is taken into the slab, so n is capped by what fits there.
+  size_t limit = TraceLog::CAPACITY;
+  if (request->hasParam("n")) {
+    limit = constrain(request->getParam("n")->value().toInt(), 1, (long)TraceLog::CAPACITY);
+  }
+  bool binary = request->hasParam("format") && request->getParam("format")->value() == "bin";
+
+  RequestArena::Lease* lease = leaseFor(request, ticket);
+  if (!lease) return;
+  LogCursor* cursor = binary ? nullptr : lease->create<LogCursor>();
+  if (!binary && !cursor) {
+    request->send(500, "text/plain", "Out of memory");
+    return;
+  }
+  limit = std::min(limit, lease->room() / sizeof(TraceRecord));
+  TraceRecord* records = lease->createArray<TraceRecord>(limit);
+  size_t count = records ? traceLog.snapshot(records, limit) : 0;
+
+  if (binary) {
+    request->send(request->beginResponse(200, "application/octet-stream", (const uint8_t*)records,
+                                         count * sizeof(TraceRecord)));
+    return;
+  }
+  cursor->records = records;
+  cursor->count = count;
+  request->send(request->beginChunkedResponse("text/plain",
+    [cursor](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+      return readLogs(cursor, buffer, maxLen);
+    }));
+}
+
+void WebServerModule::handleHeap(AsyncWebServerRequest* request, AdmissionControl::Ticket* ticket) {
+  // GET /api/heap - gauges, plus per-tag counters in a HEAP_PROFILE build.
+  // Metrics may take the reserved slab, so this answers when the pool is busy.
+  RequestArena::Lease* body = leaseFor(request, ticket);
+  if (!body) return;
+  heapProfiler.writeJson(*body);
+  sendLease(request, ticket, body, 200, "application/json");
+}
+
+void WebServerModule::handleWebStats(AsyncWebServerRequest* request, AdmissionControl::Ticket* ticket) {
+  // GET /api/web - admission counters per endpoint and request arena usage.
+  // Metrics may take the reserved slab, so this answers when the pool is busy.
+  RequestArena::Lease* body = leaseFor(request, ticket);
+  if (!body) return;
+  admission.writeJson(*body);
+  sendLease(request, ticket, body, 200, "application/json");
+}
+
+void WebServerModule::handleBench(AsyncWebServerRequest* request, AdmissionControl::Ticket* ticket) {
+  // GET /api/bench?filter=<name> - microbenchmark results as JSON lines.
+  // Runs on the async_tcp task, so no other page is rendered from the
+  // dataset meanwhile; the whole suite takes well under a second.
+  RequestArena::Lease* body = leaseFor(request, ticket);
+  if (!body) return;
+  const char* filter = request->hasParam("filter") ? request->getParam("filter")->value().c_str() : nullptr;
+  runBenchmarks(*body, filter && *filter ? filter : nullptr);
+  sendLease(request, ticket, body, 200, "application/x-ndjson");
+}
+
+void WebServerModule::handleReplayUpload(AsyncWebServerRequest* request, size_t index,
+                                         uint8_t* data, size_t len, bool final) {
+  if (index == 0) {
+    if (uartReplay.isActive()) return;
+    SPIFFS.remove(REPLAY_FILE);
+    request->_tempFile = SPIFFS.open(REPLAY_FILE, FILE_WRITE);
+  }
+  if (!request->_tempFile) return;
+
+  if (request->_tempFile.write(data, len) != len) {
+    // Out of flash: drop the partial capture rather than replay half of it
+    request->_tempFile.close();
+    SPIFFS.remove(REPLAY_FILE);
+    return;
+  }
+  if (final) {
+    Serial.println("📼 Replay capture stored (" + String(request->_tempFile.size()) + " bytes)");
+    request->_tempFile.close();
+  }
 }
 
 void WebServerModule::handleCommand(AsyncWebServerRequest* request) {
-  if (request->hasParam("command", true)) { // true for body? No, usually query for simple command
-      // If sent as query param /api/command?command=refresh
-      String command = request->getParam("command")->value();
-      
-      if (command == "test_alert") {
-          // Trigger a test alert manually
-          // systemState.currentData.object_detected = true; // This might be overwritten by sensor
-          // Instead, we might want a flag or just log it.
-          Serial.println("Manual Test Alert Requested");
-          request->send(200, "text/plain", "Test alert triggered (check logs)");
-      } else if (command == "refresh") {
-           request->send(200, "text/plain", "Refreshed");
-      } else {
-           request->send(400, "text/plain", "Unknown command");
-      }
-  } else if (request->hasParam("command", true)) { // Check post body if any
-      String command = request->getParam("command", true)->value();
-       if (command == "test_alert") {
-          Serial.println("Manual Test Alert Requested");
-          request->send(200, "text/plain", "Test alert triggered");
-       } else {
-           request->send(200, "text/plain", "Command received: " + command);
-       }
-  } else {
+  // POST /api/command?command=<name>[&arg=<value>], query string or form body
+  bool inBody = !request->hasParam("command") && request->hasParam("command", true);
+  if (!request->hasParam("command", inBody)) {
     request->send(400, "text/plain", "Missing command parameter");
+    return;
   }
+
+  String line = request->getParam("command", inBody)->value();
+  if (request->hasParam("arg", inBody)) {
+    line += " " + request->getParam("arg", inBody)->value();
+  }
+
+  CommandReply reply;
+  commands.dispatch(CMD_HTTP, line.c_str(), reply);
+  request->send(reply.ok ? 200 : 400, "text/plain", reply.text);
+  commands.complete(reply);
 }
 
 void WebServerModule::handleClient() {
@@ -6,6 +6,9 @@
 #include <ESPAsyncWebServer.h>
 #include "../../include/state.h"
 #include "../../include/config.h"
+#include "../../include/request_arena.h"
+#include "../HtmlPage/html_page.h"
+#include "AdmissionControl.h"
 
 class WebServerModule {
 private:
@@ -13,11 +16,27 @@ private:
   bool initialized = false;
   
   void setupRoutes();
-  void handleRoot(AsyncWebServerRequest* request);
-  void handleAPI(AsyncWebServerRequest* request);
-  void handleConfig(AsyncWebServerRequest* request);
-  void handleHistory(AsyncWebServerRequest* request);
+  AdmissionControl::Ticket* admit(AsyncWebServerRequest* request, WebEndpoint endpoint);
+  void shed(AsyncWebServerRequest* request, WebEndpoint endpoint);
+  RequestArena::Lease* leaseFor(AsyncWebServerRequest* request, AdmissionControl::Ticket* ticket);
+  RequestArena::Lease* extraLease(AdmissionControl::Ticket* ticket);
+  void sendLease(AsyncWebServerRequest* request, AdmissionControl::Ticket* ticket,
+                 RequestArena::Lease* lease, int code, const char* contentType);
+  void streamPage(AsyncWebServerRequest* request, AdmissionControl::Ticket* ticket, int code,
+                  HtmlPage::Page page, const char* message = nullptr);
+  void handleRoot(AsyncWebServerRequest* request, AdmissionControl::Ticket* ticket);
+  void handleAPI(AsyncWebServerRequest* request, AdmissionControl::Ticket* ticket);
+  void handleConfig(AsyncWebServerRequest* request, AdmissionControl::Ticket* ticket);
+  void handleHistory(AsyncWebServerRequest* request, AdmissionControl::Ticket* ticket);
+  void handleChart(AsyncWebServerRequest* request, AdmissionControl::Ticket* ticket);
+  void handleExport(AsyncWebServerRequest* request, AdmissionControl::Ticket* ticket);
   void handleCommand(AsyncWebServerRequest* request);
+  void handleLogs(AsyncWebServerRequest* request, AdmissionControl::Ticket* ticket);
+  void handleHeap(AsyncWebServerRequest* request, AdmissionControl::Ticket* ticket);
+  void handleWebStats(AsyncWebServerRequest* request, AdmissionControl::Ticket* ticket);
+  void handleBench(AsyncWebServerRequest* request, AdmissionControl::Ticket* ticket);
+  void handleReplayUpload(AsyncWebServerRequest* request, size_t index, uint8_t* data,
+                          size_t len, bool final);
 
 public:
   WebServerModule();
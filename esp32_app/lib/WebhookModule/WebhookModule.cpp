@@ -0,0 +1,30 @@
+#include "WebhookModule.h"
+#include <HTTPClient.h>
+
+WebhookModule webhook;
+
+bool WebhookModule::isConfigured() const {
+  return config().webhook.enable_webhook && strlen(config().webhook.url) > 0;
+}
+
+int WebhookModule::post(const String& json) {
+  if (!isConfigured()) return -1;
+
+  HTTPClient http;
+  http.setTimeout(TIMEOUT_MS);
+  http.setConnectTimeout(TIMEOUT_MS);
+  if (!http.begin(config().webhook.url)) {
+    Serial.println(" Webhook URL rejected: " + String(config().webhook.url));
+    return -1;
+  }
+
+  http.addHeader("Content-Type", "application/json");
+  int code = http.POST(json);
+  http.end();
+
+  if (code < 200 || code >= 300) {
+    Serial.println(" Webhook POST failed: " +
+                   (code < 0 ? HTTPClient::errorToString(code) : String(code)));
+  }
+  return code;
+}
@@ -0,0 +1,21 @@
+#ifndef WEBHOOK_MODULE_H
+#define WEBHOOK_MODULE_H
+
+#include <Arduino.h>
+#include "../../include/config.h"
+
+// Generic HTTP sink: POSTs a small JSON document to config().webhook.url.
+// Any 2xx response counts as delivered. Only used from its notification
+// worker, so it needs no locking.
+class WebhookModule {
+public:
+  static const uint16_t TIMEOUT_MS = 5000;
+
+  // Returns the HTTP status code, or a negative HTTPClient error
+  int post(const String& json);
+  bool isConfigured() const;
+};
+
+extern WebhookModule webhook;
+
+#endif
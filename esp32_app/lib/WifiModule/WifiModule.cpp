@@ -0,0 +1,185 @@
+#include "WifiModule.h"
+#include "../DataManager/DataManager.h"
+#include "../../include/heap_profiler.h"
+
+WifiModule wifiModule;
+
+static uint32_t ssidHash(const char* ssid) {
+  uint32_t hash = 2166136261u;
+  for (; *ssid; ssid++) hash = (hash ^ (uint8_t)*ssid) * 16777619u;
+  return hash;
+}
+
+WifiModule::WifiModule()
+    : state(State::Idle), apActive(false), usedCache(false), attemptStart(0), nextAttempt(0),
+      backoff(MIN_BACKOFF_MS), connectedAt(0), disconnectedSince(0), lastRssiUpdate(0),
+      reconnectAttempts(0), gotIp(false), lostConnection(false), disconnectReason(0),
+      bssid{0}, channel(0) {}
+
+void WifiModule::begin() {
+  Serial.println("\n🌐 Setting up WiFi...");
+
+  // Credentials come from our config and reconnects are paced by handle()
+  WiFi.persistent(false);
+  WiFi.setAutoReconnect(false);
+  WiFi.onEvent([this](arduino_event_id_t event, arduino_event_info_t info) {
+    onEvent(event, info);
+  });
+
+  disconnectedSince = millis();
+
+  if (!config().wifi.enable_station_mode || strlen(config().wifi.sta_ssid) == 0) {
+    startAccessPoint();
+    return;
+  }
+
+  WiFi.mode(WIFI_STA);
+  startAttempt();
+}
+
+void WifiModule::onEvent(arduino_event_id_t event, arduino_event_info_t info) {
+  // Runs on the WiFi event task: record only, act in handle()
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_CONNECTED:
+      memcpy(bssid, info.wifi_sta_connected.bssid, sizeof(bssid));
+      channel = info.wifi_sta_connected.channel;
+      break;
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      gotIp = true;
+      break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+      disconnectReason = info.wifi_sta_disconnected.reason;
+      lostConnection = true;
+      break;
+    default:
+      break;
+  }
+}
+
+void WifiModule::startAttempt() {
+  WifiCache cache;
+  usedCache = dataManager.loadWifiCache(cache) &&
+              cache.ssidHash == ssidHash(config().wifi.sta_ssid) &&
+              cache.channel > 0;
+
+  if (usedCache) {
+    // Known channel and BSSID: associate directly without a full scan
+    WiFi.begin(config().wifi.sta_ssid, config().wifi.sta_password, cache.channel, cache.bssid);
+    Serial.println("🔌 Connecting to WiFi: " + String(config().wifi.sta_ssid) +
+                   " (cached channel " + String(cache.channel) + ")");
+  } else {
+    WiFi.begin(config().wifi.sta_ssid, config().wifi.sta_password);
+    Serial.println("🔌 Connecting to WiFi: " + String(config().wifi.sta_ssid));
+  }
+
+  state = State::Connecting;
+  attemptStart = millis();
+}
+
+void WifiModule::scheduleRetry() {
+  state = State::Backoff;
+  reconnectAttempts++;
+  nextAttempt = millis() + backoff;
+  Serial.println("📶 WiFi retry #" + String(reconnectAttempts) + " in " + String(backoff / 1000) + "s");
+  backoff = min(backoff * 2, (unsigned long)MAX_BACKOFF_MS);
+}
+
+void WifiModule::startAccessPoint() {
+  bool station = config().wifi.enable_station_mode && strlen(config().wifi.sta_ssid) > 0;
+
+  // Keep the station side retrying in the background while the AP serves the dashboard
+  Serial.println("📡 Starting AP Mode...");
+  WiFi.mode(station ? WIFI_AP_STA : WIFI_AP);
+  WiFi.softAP(config().wifi.ap_ssid, config().wifi.ap_password);
+  apActive = true;
+
+  systemState.wifiConnected = true;
+  systemState.wifiMode = "AP";
+  systemState.wifiSignalStrength = 0;
+  Serial.println("✅ AP Mode - IP: " + WiFi.softAPIP().toString());
+}
+
+void WifiModule::stopAccessPoint() {
+  WiFi.softAPdisconnect(true);
+  WiFi.mode(WIFI_STA);
+  apActive = false;
+  Serial.println("📡 AP Mode stopped, station connected");
+}
+
+void WifiModule::handle() {
+  HEAP_TAG("wifi");
+  unsigned long now = millis();
+
+  if (gotIp) {
+    gotIp = false;
+    state = State::Connected;
+    connectedAt = now;
+    reconnectAttempts = 0;
+    backoff = MIN_BACKOFF_MS;
+
+    WifiCache cache = {};
+    cache.ssidHash = ssidHash(config().wifi.sta_ssid);
+    memcpy(cache.bssid, bssid, sizeof(cache.bssid));
+    cache.channel = channel;
+    dataManager.saveWifiCache(cache);
+
+    if (apActive) {
+      stopAccessPoint();
+    }
+
+    systemState.wifiConnected = true;
+    systemState.wifiMode = "Station";
+    systemState.wifiSignalStrength = WiFi.RSSI();
+    lastRssiUpdate = now;
+    Serial.println("✅ WiFi connected in " + String(now - attemptStart) + "ms! IP: " +
+                   WiFi.localIP().toString());
+  }
+
+  if (lostConnection) {
+    lostConnection = false;
+
+    if (state == State::Connected) {
+      Serial.println("❌ WiFi connection lost (reason " + String(disconnectReason) + ")");
+      disconnectedSince = now;
+      systemState.wifiConnected = apActive;
+      if (!apActive) systemState.wifiMode = "Disconnected";
+    } else if (state == State::Connecting && usedCache) {
+      // The AP may have moved channel; fall back to a full scan next time
+      dataManager.clearWifiCache();
+    }
+
+    if (state != State::Backoff) {
+      scheduleRetry();
+    }
+  }
+
+  switch (state) {
+    case State::Connecting:
+      if (now - attemptStart > (unsigned long)config().wifi.connection_timeout) {
+        Serial.println("❌ Failed to connect to WiFi");
+        if (usedCache) dataManager.clearWifiCache();
+        WiFi.disconnect();
+        scheduleRetry();
+      }
+      break;
+    case State::Backoff:
+      if ((long)(now - nextAttempt) >= 0) {
+        startAttempt();
+      }
+      break;
+    case State::Connected:
+      if (now - lastRssiUpdate > 10000) {
+        systemState.wifiSignalStrength = WiFi.RSSI();
+        lastRssiUpdate = now;
+      }
+      break;
+    case State::Idle:
+      break;
+  }
+
+  // Offline for longer than the connection timeout: serve the dashboard over AP
+  if (!apActive && state != State::Connected &&
+      now - disconnectedSince > (unsigned long)config().wifi.connection_timeout) {
+    startAccessPoint();
+  }
+}
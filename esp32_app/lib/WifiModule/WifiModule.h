@@ -0,0 +1,57 @@
+#ifndef WIFI_MODULE_H
+#define WIFI_MODULE_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "../../include/state.h"
+#include "../../include/config.h"
+
+// Event-driven WiFi bring-up. begin() returns immediately; connection,
+// AP fallback and reconnects with exponential backoff are driven from
+// handle() using flags set by the WiFi event task. The last good
+// BSSID/channel is cached in NVS so the next boot skips the scan.
+class WifiModule {
+private:
+  enum class State { Idle, Connecting, Connected, Backoff };
+
+  static const unsigned long MIN_BACKOFF_MS = 1000;
+  static const unsigned long MAX_BACKOFF_MS = 60000;
+
+  State state;
+  bool apActive;
+  bool usedCache;
+  unsigned long attemptStart;
+  unsigned long nextAttempt;
+  unsigned long backoff;
+  unsigned long connectedAt;
+  unsigned long disconnectedSince;
+  unsigned long lastRssiUpdate;
+  int reconnectAttempts;
+
+  // Written by the WiFi event task, consumed in handle()
+  volatile bool gotIp;
+  volatile bool lostConnection;
+  volatile uint8_t disconnectReason;
+  uint8_t bssid[6];
+  volatile uint8_t channel;
+
+  void onEvent(arduino_event_id_t event, arduino_event_info_t info);
+  void startAttempt();
+  void startAccessPoint();
+  void stopAccessPoint();
+  void scheduleRetry();
+
+public:
+  WifiModule();
+
+  void begin();
+  void handle();
+  bool isConnected() const { return state == State::Connected; }
+  bool isAccessPointActive() const { return apActive; }
+  unsigned long connectedSince() const { return connectedAt; }
+  int getReconnectAttempts() const { return reconnectAttempts; }
+};
+
+extern WifiModule wifiModule;
+
+#endif
@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""Minimal stand-in for the Telegram Bot API, for testing the ESP32 offline.
+
+Point the ESP32 at it by setting "tg_api_server" to "<this-host>:8081"
+(POST /api/config). The firmware then talks plain HTTP to this server.
+
+Lines typed on stdin are delivered to the bot as messages from --chat-id,
+so "/status" behaves like a command sent from the Telegram app. Messages
+the bot sends are printed. getUpdates honours the long-poll "timeout"
+parameter: it blocks until a message is queued or the timeout expires.
+"""
+
+import argparse
+import json
+import sys
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse
+
+updates = []
+next_update_id = 1
+next_message_id = 1
+cond = threading.Condition()
+args = None
+
+
+def queue_message(text):
+    global next_update_id, next_message_id
+    with cond:
+        chat = {"id": int(args.chat_id), "type": "private", "first_name": "Mock"}
+        updates.append({
+            "update_id": next_update_id,
+            "message": {
+                "message_id": next_message_id,
+                "from": {"id": int(args.chat_id), "is_bot": False, "first_name": "Mock"},
+                "chat": chat,
+                "date": int(time.time()),
+                "text": text,
+            },
+        })
+        next_update_id += 1
+        next_message_id += 1
+        cond.notify_all()
+
+
+class Handler(BaseHTTPRequestHandler):
+    # Keep-alive, like api.telegram.org
+    protocol_version = "HTTP/1.1"
+
+    def log_message(self, fmt, *a):
+        if args.verbose:
+            sys.stderr.write("%s - %s\n" % (self.address_string(), fmt % a))
+
+    def reply(self, payload):
+        body = json.dumps(payload).encode()
+        self.send_response(200)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(body)))
+        try:
+            self.end_headers()
+            self.wfile.write(body)
+        except (BrokenPipeError, ConnectionResetError):
+            # The ESP32 hangs up on a long poll it cut short to send an alert
+            self.close_connection = True
+
+    def params(self):
+        url = urlparse(self.path)
+        values = {k: v[-1] for k, v in parse_qs(url.query).items()}
+        length = int(self.headers.get("Content-Length") or 0)
+        if length:
+            raw = self.rfile.read(length)
+            if "json" in (self.headers.get("Content-Type") or ""):
+                values.update(json.loads(raw or b"{}"))
+            else:
+                values.update({k: v[-1] for k, v in parse_qs(raw.decode()).items()})
+        method = url.path.rsplit("/", 1)[-1]
+        return method, values
+
+    def do_GET(self):
+        self.handle_call()
+
+    def do_POST(self):
+        self.handle_call()
+
+    def handle_call(self):
+        global next_message_id
+        method, values = self.params()
+
+        if method == "getUpdates":
+            offset = int(values.get("offset", 0))
+            limit = int(values.get("limit", 100))
+            timeout = int(values.get("timeout", 0))
+            deadline = time.time() + timeout
+            with cond:
+                # Telegram confirms updates below offset by dropping them
+                updates[:] = [u for u in updates if u["update_id"] >= offset]
+                while not updates and time.time() < deadline:
+                    cond.wait(deadline - time.time())
+                result = updates[:limit]
+            self.reply({"ok": True, "result": result})
+
+        elif method == "sendMessage":
+            print("bot -> %s: %s" % (values.get("chat_id"), values.get("text")))
+            with cond:
+                message_id = next_message_id
+                next_message_id += 1
+            self.reply({"ok": True, "result": {
+                "message_id": message_id,
+                "chat": {"id": values.get("chat_id")},
+                "date": int(time.time()),
+                "text": values.get("text"),
+            }})
+
+        else:
+            self.reply({"ok": True, "result": True})
+
+
+def main():
+    global args
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port", type=int, default=8081)
+    parser.add_argument("--chat-id", default="123456789", help="must match the ESP32's chat_id")
+    parser.add_argument("--verbose", action="store_true", help="log every request")
+    args = parser.parse_args()
+
+    server = ThreadingHTTPServer(("", args.port), Handler)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    print("Mock Bot API on port %d; type a command (e.g. /status) to send it" % args.port)
+
+    for line in sys.stdin:
+        line = line.strip()
+        if line:
+            queue_message(line)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,158 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+// Host (env:native) stand-in for the Arduino core. Time comes from a
+// virtual clock that only moves when the test harness (or a delay) moves
+// it, so runs are deterministic and independent of host load.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+#include <deque>
+#include "WString.h"
+#include "freertos/FreeRTOS.h"
+
+using std::min;
+using std::max;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW  0x0
+#define INPUT        0x01
+#define OUTPUT       0x03
+#define INPUT_PULLUP 0x05
+#define SERIAL_8N1   0x800001c
+
+#define PROGMEM
+#define F(s) (s)
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#ifndef ARDUINO
+#define ARDUINO 10819
+#endif
+
+size_t strlcpy(char* dst, const char* src, size_t size);
+
+// ---- Virtual clock ----
+
+namespace VirtualClock {
+  void set(uint64_t micros);
+  void advance(uint64_t micros);
+  uint64_t now();  // microseconds since boot
+}
+
+inline unsigned long millis() { return (unsigned long)(VirtualClock::now() / 1000); }
+inline unsigned long micros() { return (unsigned long)VirtualClock::now(); }
+inline void delay(unsigned long ms) { VirtualClock::advance((uint64_t)ms * 1000); }
+inline void delayMicroseconds(unsigned int us) { VirtualClock::advance(us); }
+inline void yield() {}
+
+long random(long max);
+long random(long min, long max);
+
+// ---- GPIO (levels are remembered, nothing is driven) ----
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+// ---- Serial ports ----
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* data, size_t length) {
+    size_t n = 0;
+    while (length--) n += write(*data++);
+    return n;
+  }
+  size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+
+  size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+  size_t print(const char* s) { return write(s); }
+  size_t print(char c) { return write((uint8_t)c); }
+  template <typename T> size_t print(T v) { return print(String(v)); }
+  size_t print(double v, int digits) { return print(String(v, digits)); }
+  size_t println() { return write("\n"); }
+  template <typename T> size_t println(const T& v) { size_t n = print(v); return n + println(); }
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  // No timeout on the host: stops at the terminator or when data runs out
+  size_t readBytesUntil(char terminator, char* buffer, size_t length) {
+    size_t n = 0;
+    int c;
+    while (n < length && (c = read()) >= 0 && c != terminator) buffer[n++] = (char)c;
+    return n;
+  }
+};
+
+// Serial writes to stdout (or is muted); Serial2 reads bytes injected by the harness
+class HardwareSerial : public Stream {
+public:
+  explicit HardwareSerial(int port) : port(port) {}
+
+  void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int rxPin = -1, int txPin = -1) {
+    (void)config; (void)rxPin; (void)txPin;
+    this->baud = baud;
+  }
+  void end() {}
+  void flush() { fflush(stdout); }
+
+  int available() override { return (int)rx.size(); }
+  int read() override {
+    if (rx.empty()) return -1;
+    int c = (uint8_t)rx.front();
+    rx.pop_front();
+    return c;
+  }
+  int peek() override { return rx.empty() ? -1 : (uint8_t)rx.front(); }
+  String readStringUntil(char terminator);
+
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* data, size_t length) override;
+  using Print::write;
+
+  // Harness side
+  void inject(const char* data, size_t length) { rx.insert(rx.end(), data, data + length); }
+  void setMuted(bool muted) { this->muted = muted; }
+  const std::string& transmitted() const { return tx; }
+
+private:
+  int port;
+  unsigned long baud = 0;
+  bool muted = false;
+  std::deque<char> rx;
+  std::string tx;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial2;
+
+// ---- Chip ----
+
+class EspClass {
+public:
+  uint32_t getFreeHeap() { return 200 * 1024; }
+  uint32_t getMinFreeHeap() { return 180 * 1024; }
+  void restart();
+
+  unsigned long restartRequests = 0;
+};
+
+extern EspClass ESP;
+
+#endif
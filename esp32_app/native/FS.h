@@ -0,0 +1,71 @@
+#ifndef NATIVE_FS_H
+#define NATIVE_FS_H
+
+// Arduino FS/File on top of a host directory (see NativeFS::setRoot)
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include "Arduino.h"
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+class File : public Stream {
+public:
+  File() {}
+  File(FILE* handle, const std::string& path);
+
+  explicit operator bool() const { return (bool)handle; }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* data, size_t length) override;
+  using Print::write;
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t read(uint8_t* buffer, size_t length);
+
+  bool seek(uint32_t position);
+  size_t position() const;
+  size_t size() const;
+  const char* path() const { return name.c_str(); }
+  void flush();
+  void close() { handle.reset(); }
+
+private:
+  std::shared_ptr<FILE> handle;  // shared so copies behave like Arduino File handles
+  std::string name;
+};
+
+class FS {
+public:
+  File open(const char* path, const char* mode = FILE_READ);
+  File open(const String& path, const char* mode = FILE_READ) { return open(path.c_str(), mode); }
+  bool exists(const char* path);
+  bool exists(const String& path) { return exists(path.c_str()); }
+  bool remove(const char* path);
+  bool remove(const String& path) { return remove(path.c_str()); }
+  bool rename(const char* from, const char* to);
+  bool rename(const String& from, const String& to) { return rename(from.c_str(), to.c_str()); }
+
+protected:
+  std::string hostPath(const char* path) const;
+};
+
+}  // namespace fs
+
+using fs::File;
+using fs::FS;
+
+namespace NativeFS {
+  // Directory that stands in for the flash filesystem (created on demand)
+  void setRoot(const std::string& directory);
+  const std::string& root();
+}
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef NATIVE_PREFERENCES_H
+#define NATIVE_PREFERENCES_H
+
+// NVS Preferences kept in process memory; every Preferences object with the
+// same namespace sees the same keys, like on the device
+
+#include <map>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+
+class Preferences {
+public:
+  bool begin(const char* name, bool readOnly = false);
+  void end() { space = nullptr; }
+  bool clear();
+  bool remove(const char* key);
+  bool isKey(const char* key);
+
+  size_t putBytes(const char* key, const void* value, size_t length);
+  size_t getBytes(const char* key, void* buffer, size_t maxLength);
+  size_t getBytesLength(const char* key);
+
+  size_t putBool(const char* key, bool value) { return put(key, value); }
+  size_t putInt(const char* key, int32_t value) { return put(key, value); }
+  size_t putULong(const char* key, uint32_t value) { return put(key, value); }
+  size_t putFloat(const char* key, float value) { return put(key, value); }
+  size_t putString(const char* key, const char* value) { return putBytes(key, value, strlen(value) + 1); }
+  size_t putString(const char* key, const String& value) { return putString(key, value.c_str()); }
+
+  bool getBool(const char* key, bool defaultValue = false) { return get(key, defaultValue); }
+  int32_t getInt(const char* key, int32_t defaultValue = 0) { return get(key, defaultValue); }
+  uint32_t getULong(const char* key, uint32_t defaultValue = 0) { return get(key, defaultValue); }
+  float getFloat(const char* key, float defaultValue = NAN) { return get(key, defaultValue); }
+  size_t getString(const char* key, char* value, size_t maxLength);
+  String getString(const char* key, const String& defaultValue = String());
+
+private:
+  typedef std::map<std::string, std::vector<uint8_t>> Space;
+  Space* space = nullptr;
+  bool readOnly = false;
+
+  template <typename T> size_t put(const char* key, T value) { return putBytes(key, &value, sizeof(value)); }
+  template <typename T> T get(const char* key, T defaultValue) {
+    T value;
+    return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+  }
+};
+
+#endif
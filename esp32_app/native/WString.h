@@ -0,0 +1,137 @@
+#ifndef NATIVE_WSTRING_H
+#define NATIVE_WSTRING_H
+
+// Arduino String for host builds, on top of std::string. Covers the subset
+// the firmware uses; conversions follow the Arduino core's formatting.
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class String {
+public:
+  String() {}
+  String(const char* s) : value(s ? s : "") {}
+  String(const std::string& s) : value(s) {}
+  String(char c) : value(1, c) {}
+  String(unsigned char v, unsigned char base = 10) : value(integer((unsigned long)v, base)) {}
+  String(int v, unsigned char base = 10) : value(base == 10 ? std::to_string(v) : integer((unsigned)v, base)) {}
+  String(unsigned int v, unsigned char base = 10) : value(integer(v, base)) {}
+  String(long v, unsigned char base = 10) : value(base == 10 ? std::to_string(v) : integer((unsigned long)v, base)) {}
+  String(unsigned long v, unsigned char base = 10) : value(integer(v, base)) {}
+  String(long long v, unsigned char base = 10) : value(base == 10 ? std::to_string(v) : integer((unsigned long long)v, base)) {}
+  String(unsigned long long v, unsigned char base = 10) : value(integer(v, base)) {}
+  String(float v, unsigned int decimals = 2) : value(fixed(v, decimals)) {}
+  String(double v, unsigned int decimals = 2) : value(fixed(v, decimals)) {}
+
+  const char* c_str() const { return value.c_str(); }
+  unsigned int length() const { return value.size(); }
+  bool isEmpty() const { return value.empty(); }
+  bool reserve(unsigned int size) { value.reserve(size); return true; }
+
+  char charAt(unsigned int i) const { return i < value.size() ? value[i] : 0; }
+  char operator[](unsigned int i) const { return charAt(i); }
+  char& operator[](unsigned int i) { return value[i]; }
+
+  bool concat(const String& s) { value += s.value; return true; }
+  bool concat(const char* s) { if (s) value += s; return s != nullptr; }
+  bool concat(const char* s, unsigned int length) { if (s) value.append(s, length); return s != nullptr; }
+  bool concat(char c) { value += c; return true; }
+  template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+  bool concat(T v) { return concat(String(v)); }
+
+  template <typename T>
+  String& operator+=(const T& v) { concat(v); return *this; }
+
+  bool equals(const String& s) const { return value == s.value; }
+  bool equals(const char* s) const { return value == (s ? s : ""); }
+  bool equalsIgnoreCase(const String& s) const { return strcasecmp(c_str(), s.c_str()) == 0; }
+  bool operator==(const String& s) const { return equals(s); }
+  bool operator==(const char* s) const { return equals(s); }
+  bool operator!=(const String& s) const { return !equals(s); }
+  bool operator!=(const char* s) const { return !equals(s); }
+  bool operator<(const String& s) const { return value < s.value; }
+
+  bool startsWith(const String& prefix) const { return value.compare(0, prefix.value.size(), prefix.value) == 0; }
+  bool endsWith(const String& suffix) const {
+    return value.size() >= suffix.value.size() &&
+           value.compare(value.size() - suffix.value.size(), suffix.value.size(), suffix.value) == 0;
+  }
+
+  int indexOf(char c, unsigned int from = 0) const { return position(value.find(c, from)); }
+  int indexOf(const String& s, unsigned int from = 0) const { return position(value.find(s.value, from)); }
+  int lastIndexOf(char c) const { return position(value.rfind(c)); }
+  int lastIndexOf(const String& s) const { return position(value.rfind(s.value)); }
+
+  String substring(unsigned int from) const { return from < value.size() ? String(value.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const {
+    if (from > to) std::swap(from, to);
+    return from < value.size() ? String(value.substr(from, to - from)) : String();
+  }
+
+  void replace(const String& find, const String& with) {
+    if (find.value.empty()) return;
+    for (size_t pos = value.find(find.value); pos != std::string::npos;
+         pos = value.find(find.value, pos + with.value.size())) {
+      value.replace(pos, find.value.size(), with.value);
+    }
+  }
+  void remove(unsigned int index) { if (index < value.size()) value.erase(index); }
+  void remove(unsigned int index, unsigned int count) { if (index < value.size()) value.erase(index, count); }
+
+  void trim() {
+    size_t first = value.find_first_not_of(" \t\r\n\f\v");
+    if (first == std::string::npos) { value.clear(); return; }
+    value = value.substr(first, value.find_last_not_of(" \t\r\n\f\v") - first + 1);
+  }
+  void toLowerCase() { for (char& c : value) c = tolower((unsigned char)c); }
+  void toUpperCase() { for (char& c : value) c = toupper((unsigned char)c); }
+
+  long toInt() const { return atol(c_str()); }
+  float toFloat() const { return atof(c_str()); }
+  double toDouble() const { return atof(c_str()); }
+
+  const std::string& str() const { return value; }
+
+private:
+  std::string value;
+
+  static int position(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+
+  template <typename T>
+  static std::string integer(T v, unsigned char base) {
+    if (base < 2 || base > 36) base = 10;
+    std::string out;
+    do {
+      int digit = v % base;
+      out.insert(out.begin(), (char)(digit < 10 ? '0' + digit : 'a' + digit - 10));
+      v /= base;
+    } while (v);
+    return out;
+  }
+
+  static std::string fixed(double v, unsigned int decimals) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, v);
+    return buffer;
+  }
+};
+
+inline String operator+(const String& a, const String& b) { String out(a); out.concat(b); return out; }
+inline String operator+(const String& a, const char* b) { String out(a); out.concat(b); return out; }
+inline String operator+(const char* a, const String& b) { String out(a); out.concat(b); return out; }
+inline String operator+(const String& a, char b) { String out(a); out.concat(b); return out; }
+inline String operator+(char a, const String& b) { String out(a); out.concat(b); return out; }
+template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+inline String operator+(const String& a, T b) { return a + String(b); }
+
+inline bool operator==(const char* a, const String& b) { return b == a; }
+
+#endif
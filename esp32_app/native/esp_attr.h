@@ -0,0 +1,10 @@
+#ifndef NATIVE_ESP_ATTR_H
+#define NATIVE_ESP_ATTR_H
+
+// One section, as on the device, so tests can reach all of "RTC memory"
+// through the linker's __start_rtc_noinit/__stop_rtc_noinit symbols
+#define RTC_NOINIT_ATTR __attribute__((section("rtc_noinit")))
+#define RTC_DATA_ATTR
+#define IRAM_ATTR
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef NATIVE_ESP_SYSTEM_H
+#define NATIVE_ESP_SYSTEM_H
+
+typedef enum {
+  ESP_RST_UNKNOWN,
+  ESP_RST_POWERON,
+  ESP_RST_EXT,
+  ESP_RST_SW,
+  ESP_RST_PANIC,
+  ESP_RST_INT_WDT,
+  ESP_RST_TASK_WDT,
+  ESP_RST_WDT,
+  ESP_RST_DEEPSLEEP,
+  ESP_RST_BROWNOUT,
+  ESP_RST_SDIO,
+} esp_reset_reason_t;
+
+// Host processes start cold; tests set another reason to simulate a warm
+// reset (RTC_NOINIT_ATTR variables keep their contents across it)
+esp_reset_reason_t esp_reset_reason();
+
+namespace NativeReset {
+  void setReason(esp_reset_reason_t reason);
+}
+
+#endif
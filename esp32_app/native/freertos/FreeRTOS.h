@@ -0,0 +1,37 @@
+#ifndef NATIVE_FREERTOS_H
+#define NATIVE_FREERTOS_H
+
+// FreeRTOS subset for host builds. Mutexes and critical sections map onto
+// std::recursive_mutex; there is no scheduler, so task creation fails and
+// vTaskDelay just advances the virtual clock.
+
+#include <cstdint>
+#include <mutex>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdFALSE 0
+#define pdTRUE  1
+#define pdFAIL  0
+#define pdPASS  1
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#define PRO_CPU_NUM 0
+#define APP_CPU_NUM 1
+
+inline int xPortGetCoreID() { return APP_CPU_NUM; }
+
+struct NativeMux {
+  std::recursive_mutex mutex;
+};
+typedef NativeMux portMUX_TYPE;
+// Only used in constructor initialiser lists, where lock() value-initialises
+#define portMUX_INITIALIZER_UNLOCKED
+#define portENTER_CRITICAL(mux) (mux)->mutex.lock()
+#define portEXIT_CRITICAL(mux) (mux)->mutex.unlock()
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef NATIVE_QUEUE_H
+#define NATIVE_QUEUE_H
+
+#include "FreeRTOS.h"
+
+// Declared so headers that hold queue handles compile; host builds don't create queues
+typedef void* QueueHandle_t;
+
+#endif
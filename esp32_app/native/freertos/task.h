@@ -0,0 +1,20 @@
+#ifndef NATIVE_TASK_H
+#define NATIVE_TASK_H
+
+#include "FreeRTOS.h"
+
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+void vTaskDelay(TickType_t ticks);
+
+// No scheduler on the host: callers see the same failure as when the heap is exhausted
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char*, uint32_t, void*,
+                                          UBaseType_t, TaskHandle_t* handle, BaseType_t) {
+  if (handle) *handle = nullptr;
+  return pdFAIL;
+}
+inline void vTaskDelete(TaskHandle_t) {}
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 0; }
+
+#endif
@@ -0,0 +1,425 @@
+// Host replay harness for the native build (pio run -e native).
+//
+// Feeds Pi protocol lines (JSON packets or NAME:value messages) through the
+// real ingestion path: Serial2 -> PiCommunication -> commands -> SystemState
+// -> DataManager, with the housekeeping jobs from main.cpp running on the
+// virtual clock. Built with AddressSanitizer/UBSan, so any memory error on
+// that path aborts the run with a report.
+//
+//   .pio/build/native/program [lines.txt] [--step-ms N] [--fs DIR] [--quiet]
+//   .pio/build/native/program --uart /dev/pts/N [--quiet]
+//   .pio/build/native/program --bench [--filter NAME]
+//   .pio/build/native/program --soak DAYS [--rate HZ]
+//
+// Reads stdin when no file is given. Each plain line advances the clock by
+// --step-ms (default 100); a UART capture (see uart_replay.h) advances it
+// to each line's recorded time instead. --uart reads a tty in real time, for
+// uart_replay.py play --pty. Firmware output goes to stdout, the run summary
+// to stderr. --bench runs the microbenchmarks in src/bench.cpp instead and
+// prints only their JSON lines. --soak generates Pi traffic for DAYS of
+// virtual time while polling the pages like an open dashboard, prints an
+// hourly heap checkpoint per tag (see heap_profiler.h) as JSON lines, and
+// exits 1 if any tag's allocations per sample or live bytes keep growing.
+
+// The unit tests (pio test -e native) build the sources with their own main()
+#ifndef PIO_UNIT_TESTING
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include "../include/config.h"
+#include "../include/state.h"
+#include "../include/rtc_snapshot.h"
+#include "../include/config_store.h"
+#include "../include/scheduler.h"
+#include "../include/commands.h"
+#include "../include/trace.h"
+#include "../include/bench.h"
+#include "../include/uart_replay.h"
+#include "../include/heap_profiler.h"
+#include "../include/request_arena.h"
+#include "../lib/HtmlPage/html_page.h"
+#include "../lib/DataManager/DataManager.h"
+#include "../lib/PiCommunication Module/PiCommunication.h"
+
+static Scheduler housekeeping("host");
+
+// Benchmark results go straight to stdout, away from the (muted) firmware log
+class StdoutPrint : public Print {
+public:
+  size_t write(uint8_t c) override { return fwrite(&c, 1, 1, stdout); }
+  size_t write(const uint8_t* data, size_t length) override { return fwrite(data, 1, length, stdout); }
+};
+
+static unsigned long lineCount = 0;
+static std::chrono::nanoseconds busy(0);
+
+// Ingestion should not touch the heap once the first lines are through
+// (the sensor task's requireZeroHeap() on the device)
+static const unsigned long HEAP_WARMUP_LINES = 10;
+static unsigned long heapLines = 0;
+static unsigned long heapFirstLine = 0;
+static const char* heapFirstTag = nullptr;
+
+static void ingest() {
+  uint32_t allocations = HeapProfiler::taskAllocations();
+  auto started = std::chrono::steady_clock::now();
+  piComm.handle();
+  busy += std::chrono::steady_clock::now() - started;
+
+  if (HeapProfiler::taskAllocations() != allocations && lineCount >= HEAP_WARMUP_LINES) {
+    if (!heapLines++) {
+      heapFirstLine = lineCount + 1;
+      heapFirstTag = HeapProfiler::taskLastTag();
+    }
+  }
+}
+
+// Returns true when ingestion allocated after warm-up
+static bool reportIngestHeap() {
+  if (!heapLines) return false;
+  fprintf(stderr, "heap: %lu ingest calls allocated after warm-up (first at line %lu, tag %s)\n",
+          heapLines, heapFirstLine, heapFirstTag);
+  return true;
+}
+
+static void runDue(uint64_t untilMicros) {
+  while (VirtualClock::now() < untilMicros) {
+    unsigned long wait = housekeeping.run();
+    uint64_t next = VirtualClock::now() + (uint64_t)max(wait, 1UL) * 1000;
+    VirtualClock::set(min(next, untilMicros));
+  }
+  housekeeping.run();
+}
+
+// On the device ESP.restart() doesn't return
+static bool restarted() {
+  if (!ESP.restartRequests) return false;
+  fprintf(stderr, "restart requested after line %lu, stopping replay\n", lineCount);
+  return true;
+}
+
+// Plain lines, or a UART capture; returns the capture's span in ms (0 for plain lines)
+static uint32_t replayLines(std::istream& lines, unsigned long stepMs) {
+  std::string line;
+  bool capture = false;
+  uint32_t at = 0;
+  uint64_t start = VirtualClock::now();
+
+  while (std::getline(lines, line)) {
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (lineCount == 0 && line == REPLAY_HEADER) {
+      capture = true;
+      continue;
+    }
+
+    if (capture) {
+      if (line.empty() || line[0] == '#') continue;
+      size_t space = line.find(' ');
+      if (space == std::string::npos) continue;
+      at = strtoul(line.c_str(), nullptr, 10);
+      line.erase(0, space + 1);
+      runDue(start + (uint64_t)at * 1000);
+    }
+
+    line += '\n';
+    Serial2.inject(line.data(), line.size());
+    ingest();
+    lineCount++;
+
+    if (!capture) runDue(VirtualClock::now() + (uint64_t)stepMs * 1000);
+    if (restarted()) break;
+  }
+  return capture ? at : 0;
+}
+
+// Real time: the clock follows the wall clock and bytes arrive as the tty
+// delivers them. A slow harness shows up as stalls on the writer's side.
+static uint32_t replayTty(const char* path) {
+  int fd = open(path, O_RDONLY | O_NOCTTY);
+  if (fd < 0) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return 0;
+  }
+  termios tty;
+  if (tcgetattr(fd, &tty) == 0) {
+    cfmakeraw(&tty);
+    tcsetattr(fd, TCSANOW, &tty);
+  }
+
+  auto origin = std::chrono::steady_clock::now();
+  auto elapsedUs = [&]() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - origin).count();
+  };
+  uint64_t firstByte = 0, lastByte = 0;
+  char buffer[512];
+
+  for (;;) {
+    pollfd waiting = { fd, POLLIN, 0 };
+    poll(&waiting, 1, 10);
+    if (waiting.revents & POLLIN) {
+      ssize_t n = read(fd, buffer, sizeof(buffer));
+      if (n <= 0) break;
+      Serial2.inject(buffer, n);
+      for (ssize_t i = 0; i < n; i++) lineCount += buffer[i] == '\n';
+      lastByte = elapsedUs();
+      if (!firstByte) firstByte = lastByte;
+      ingest();
+    } else if (waiting.revents & (POLLHUP | POLLERR)) {
+      break;  // writer closed the pty
+    }
+
+    runDue(elapsedUs());
+    if (restarted()) break;
+  }
+  close(fd);
+  return (uint32_t)((lastByte - firstByte) / 1000);
+}
+
+struct SoakPoint {
+  unsigned long samples;
+  uint32_t allocs;
+  uint32_t liveBytes;
+};
+
+// A page request as the web server serves it: rendered into a leased
+// request arena slab that is released once sent
+static void servePage(void (*write)(Print&), Print* sink = nullptr) {
+  RequestArena::Lease* body = requestArena.acquire();
+  if (!body) return;
+  write(*body);
+  if (sink) sink->write(body->data(), body->length());
+  body->release();
+}
+
+static void soakCheckpoint(unsigned hour, std::map<std::string, std::vector<SoakPoint>>& series) {
+  // The series grows every hour by design; keep it out of the verdict
+  HEAP_TAG("soak");
+  HeapTagStats tags[HeapProfiler::MAX_TAGS];
+  int count = heapProfiler.snapshot(tags, HeapProfiler::MAX_TAGS);
+  printf("{\"hour\":%u,\"samples\":%lu,\"untracked\":%lu,\"tags\":{", hour,
+         systemState.sampleCount, heapProfiler.untrackedCount());
+  for (int i = 0; i < count; i++) {
+    printf("%s\"%s\":{\"allocs\":%u,\"live\":%u,\"live_bytes\":%u,\"long_lived\":%u}",
+           i ? "," : "", tags[i].name, tags[i].allocs, tags[i].liveBlocks, tags[i].liveBytes,
+           tags[i].longLived);
+    series[tags[i].name].push_back({ systemState.sampleCount, tags[i].allocs, tags[i].liveBytes });
+  }
+  printf("}}\n");
+  fflush(stdout);
+}
+
+// The first hour is warm-up (history ring, buffers and caches filling up);
+// after it every tag should allocate the same per sample and hold steady.
+static int soakVerdict(const std::map<std::string, std::vector<SoakPoint>>& series) {
+  int flagged = 0;
+  for (const auto& entry : series) {
+    const std::vector<SoakPoint>& points = entry.second;
+    // Tags first seen after warm-up start their series late
+    if (entry.first == "soak" || points.size() < 4) continue;
+    const SoakPoint& warm = points[0];
+    const SoakPoint& first = points[1];
+    const SoakPoint& mid = points[points.size() / 2];
+    const SoakPoint& beforeLast = points[points.size() - 2];
+    const SoakPoint& last = points.back();
+
+    auto perSample = [](const SoakPoint& from, const SoakPoint& to) {
+      unsigned long samples = to.samples - from.samples;
+      return samples ? (double)(to.allocs - from.allocs) / samples : 0.0;
+    };
+    double early = perSample(warm, first);
+    double late = perSample(beforeLast, last);
+    if (late > early * 1.10 + 0.05) {
+      fprintf(stderr, "GROWTH %s: %.2f -> %.2f allocations per sample\n", entry.first.c_str(),
+              early, late);
+      flagged++;
+    }
+
+    // A leak climbs through both halves; a cache that settles late does not
+    if (last.liveBytes > warm.liveBytes + 256 && mid.liveBytes > warm.liveBytes &&
+        last.liveBytes > mid.liveBytes) {
+      fprintf(stderr, "GROWTH %s: live bytes %u -> %u -> %u\n", entry.first.c_str(),
+              warm.liveBytes, mid.liveBytes, last.liveBytes);
+      flagged++;
+    }
+  }
+  return flagged;
+}
+
+static int soak(double days, double rateHz) {
+  if (!HeapProfiler::enabled()) {
+    fprintf(stderr, "--soak needs a HEAP_PROFILE build\n");
+    return 1;
+  }
+  const uint64_t periodUs = (uint64_t)(1e6 / rateHz);
+  const uint64_t endUs = VirtualClock::now() + (uint64_t)(days * 86400e6);
+  const uint64_t hourUs = 3600ULL * 1000000;
+  uint64_t nextHour = VirtualClock::now() + hourUs;
+  uint64_t nextStatus = 0, nextHistory = 0, nextCommand = 0;
+  unsigned hour = 0;
+  std::map<std::string, std::vector<SoakPoint>> series;
+  float recent[5] = {};
+  auto started = std::chrono::steady_clock::now();
+
+  // Same packets as uart_replay.py synth: a slow approach and retreat with noise
+  for (unsigned long i = 0; VirtualClock::now() < endUs; i++) {
+    double t = i / rateHz;
+    float distance = 30 + 10 * (1 + sin(t / 10)) + (rand() % 100) / 100.0f - 0.5f;
+    recent[i % 5] = distance;
+    char packet[128];
+    snprintf(packet, sizeof(packet), "{\"d\": %.2f, \"m\": %d, \"a\": %d, \"h\": [%.1f, %.1f, %.1f, %.1f, %.1f]}\n",
+             distance, (int)(t / 600) % 3, distance < 35 ? 1 : 0, recent[0], recent[1], recent[2],
+             recent[3], recent[4]);
+    Serial2.inject(packet, strlen(packet));
+    ingest();
+    lineCount++;
+
+    // An open dashboard polls the status every 2 s and the chart every minute
+    uint64_t now = VirtualClock::now();
+    if (now >= nextStatus) {
+      servePage(HtmlPage::writeAPIResponse);
+      nextStatus = now + 2000000;
+    }
+    if (now >= nextHistory) {
+      servePage(HtmlPage::writeHistoryJson);
+      nextHistory = now + 60000000;
+    }
+    if (now >= nextCommand) {
+      CommandReply reply;
+      commands.dispatch(CMD_HTTP, "status", reply);
+      commands.complete(reply);
+      nextCommand = now + 600000000;
+    }
+
+    runDue(now + periodUs);
+    if (VirtualClock::now() >= nextHour) {
+      soakCheckpoint(++hour, series);
+      nextHour += hourUs;
+    }
+    if (restarted()) return 1;
+  }
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+  fprintf(stderr, "soak: %.2f days, %lu samples at %.0f Hz in %.0f s (%.0fx)\n", days, lineCount,
+          rateHz, seconds, days * 86400 / seconds);
+  int flagged = 0;
+  if (hour < 4) {
+    fprintf(stderr, "soak: need at least 4 hourly checkpoints to judge growth\n");
+  } else {
+    flagged = soakVerdict(series);
+    fprintf(stderr, flagged ? "soak: %d growth warning(s)\n" : "soak: no growth\n", flagged);
+  }
+#ifdef ZERO_HEAP
+  if (reportIngestHeap()) flagged++;
+#endif
+  return flagged ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  const char* input = nullptr;
+  unsigned long stepMs = 100;
+  const char* uart = nullptr;
+  bool quiet = false;
+  bool bench = false;
+  const char* filter = nullptr;
+  double soakDays = 0;
+  double soakRate = 10;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--step-ms") && i + 1 < argc) {
+      stepMs = strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp(argv[i], "--fs") && i + 1 < argc) {
+      NativeFS::setRoot(argv[++i]);
+    } else if (!strcmp(argv[i], "--uart") && i + 1 < argc) {
+      uart = argv[++i];
+    } else if (!strcmp(argv[i], "--quiet")) {
+      quiet = true;
+    } else if (!strcmp(argv[i], "--bench")) {
+      bench = true;
+    } else if (!strcmp(argv[i], "--filter") && i + 1 < argc) {
+      filter = argv[++i];
+    } else if (!strcmp(argv[i], "--soak") && i + 1 < argc) {
+      soakDays = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--rate") && i + 1 < argc) {
+      soakRate = max(atof(argv[++i]), 0.1);
+    } else {
+      input = argv[i];
+    }
+  }
+
+  std::ifstream file;
+  if (input) {
+    file.open(input);
+    if (!file) {
+      fprintf(stderr, "cannot open %s\n", input);
+      return 1;
+    }
+  }
+  std::istream& lines = input ? file : std::cin;
+
+  // Same bring-up order as setup(), minus the network
+  Serial.setMuted(quiet || bench || soakDays > 0);
+  rtcSnapshot.restore(systemState);
+  initConfig();
+  if (!dataManager.begin()) {
+    fprintf(stderr, "DataManager failed to start\n");
+    return 1;
+  }
+  dataManager.loadConfig(bootConfig());
+  configStore.begin();
+  bootConfig().raspberry_pi.enable_communication = true;
+  bootConfig().system.enable_uart = true;
+  piComm.begin();
+  HtmlPage::setSystemState(&systemState);
+
+  if (bench) {
+    StdoutPrint out;
+    return runBenchmarks(out, filter) > 0 ? 0 : 1;
+  }
+
+  housekeeping.add("config", 250, []() { configStore.handle(); });
+  housekeeping.add("trace", 20, []() { traceLog.drainToSerial(16); });
+  housekeeping.add("commands", 250, []() { commands.handle(); });
+  housekeeping.add("flush", 100, []() { dataManager.handle(); });
+
+  if (soakDays > 0) return soak(soakDays, soakRate);
+
+  uint32_t captureSpan = uart ? replayTty(uart) : replayLines(lines, stepMs);
+
+  dataManager.flush();
+  traceLog.drainToSerial(TraceLog::CAPACITY);
+  Serial.setMuted(false);
+  servePage(HtmlPage::writeAPIResponse, &Serial);
+  Serial.println();
+
+  double nsPerLine = lineCount ? (double)busy.count() / lineCount : 0.0;
+  fprintf(stderr, "lines: %lu, ingest: %.0f ns/line, virtual time: %lu ms\n", lineCount,
+          nsPerLine, millis());
+  if (captureSpan && nsPerLine > 0) {
+    // Host CPU, not the ESP32: compare captures, or use "replay" on the device
+    double rate = lineCount * 1000.0 / captureSpan;
+    fprintf(stderr, "capture: %.1f lines/s, parser limit on this host ~%.0f lines/s (%.0fx)\n",
+            rate, 1e9 / nsPerLine, 1e9 / nsPerLine / rate);
+  }
+  fprintf(stderr, "history: %d, commands: %lu ok / %lu rejected\n",
+          systemState.getHistoryCount(), commands.dispatchedCount(), commands.rejectedCount());
+  fprintf(stderr, "storage: %s, %lu bytes used\n", NativeFS::root().c_str(),
+          (unsigned long)SPIFFS.usedBytes());
+  fprintf(stderr, "jobs: %s\n", housekeeping.stats().c_str());
+#ifdef ZERO_HEAP
+  if (reportIngestHeap()) return 1;
+#endif
+  return 0;
+}
+
+#endif // PIO_UNIT_TESTING
@@ -0,0 +1,5 @@
+# PlatformIO extra script for env:native: build_flags only reach the
+# compiler, so the sanitizer runtimes have to be added to the link as well.
+Import("env")
+
+env.Append(LINKFLAGS=["-fsanitize=address,undefined"])
@@ -0,0 +1,257 @@
+// Definitions behind the host (env:native) Arduino/ESP-IDF shims
+
+#include <cstdarg>
+#include <random>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Arduino.h"
+#include "SPI.h"
+#include "esp_system.h"
+#include "SPIFFS.h"
+#include "Preferences.h"
+#include "freertos/task.h"
+
+// Constructed before (and destroyed after) the firmware's globals, whose
+// destructors still log and flush to storage on exit
+#define SHIM_GLOBAL __attribute__((init_priority(101)))
+
+// ---- Core ----
+
+size_t strlcpy(char* dst, const char* src, size_t size) {
+  size_t length = strlen(src);
+  if (size) {
+    size_t n = length < size - 1 ? length : size - 1;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+  }
+  return length;
+}
+
+static uint64_t clockMicros = 0;
+
+void VirtualClock::set(uint64_t micros) { clockMicros = micros; }
+void VirtualClock::advance(uint64_t micros) { clockMicros += micros; }
+uint64_t VirtualClock::now() { return clockMicros; }
+
+void vTaskDelay(TickType_t ticks) { delay(ticks * portTICK_PERIOD_MS); }
+
+static std::mt19937 rng(12345);  // fixed seed: runs are reproducible
+
+long random(long max) { return max > 0 ? (long)(rng() % (unsigned long)max) : 0; }
+long random(long min, long max) { return max > min ? min + random(max - min) : min; }
+
+static uint8_t pinLevels[40];
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin < sizeof(pinLevels)) pinLevels[pin] = (mode == INPUT_PULLUP) ? HIGH : LOW;
+}
+void digitalWrite(uint8_t pin, uint8_t value) { if (pin < sizeof(pinLevels)) pinLevels[pin] = value; }
+int digitalRead(uint8_t pin) { return pin < sizeof(pinLevels) ? pinLevels[pin] : LOW; }
+
+size_t Print::printf(const char* format, ...) {
+  char buffer[256];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  if (length < 0) return 0;
+  return write((const uint8_t*)buffer, min((size_t)length, sizeof(buffer) - 1));
+}
+
+String HardwareSerial::readStringUntil(char terminator) {
+  String out;
+  int c;
+  while ((c = read()) >= 0 && c != terminator) out += (char)c;
+  return out;
+}
+
+size_t HardwareSerial::write(uint8_t c) { return write(&c, 1); }
+
+size_t HardwareSerial::write(const uint8_t* data, size_t length) {
+  if (port == 0) {
+    if (!muted) fwrite(data, 1, length, stdout);
+  } else {
+    tx.append((const char*)data, length);
+  }
+  return length;
+}
+
+HardwareSerial Serial SHIM_GLOBAL (0);
+HardwareSerial Serial2 SHIM_GLOBAL (2);
+SPIClass SPI SHIM_GLOBAL;
+EspClass ESP SHIM_GLOBAL;
+
+void EspClass::restart() {
+  // Nothing to reboot into; the harness can check the counter
+  restartRequests++;
+}
+
+static esp_reset_reason_t resetReason = ESP_RST_POWERON;
+
+esp_reset_reason_t esp_reset_reason() { return resetReason; }
+void NativeReset::setReason(esp_reset_reason_t reason) { resetReason = reason; }
+
+// ---- Filesystem ----
+
+static std::string fsRoot SHIM_GLOBAL = ".native_fs";
+
+void NativeFS::setRoot(const std::string& directory) { fsRoot = directory; }
+const std::string& NativeFS::root() { return fsRoot; }
+
+namespace fs {
+
+File::File(FILE* file, const std::string& path) : handle(file, fclose), name(path) {}
+
+size_t File::write(const uint8_t* data, size_t length) {
+  return handle ? fwrite(data, 1, length, handle.get()) : 0;
+}
+
+int File::available() {
+  return handle ? (int)(size() - position()) : 0;
+}
+
+int File::read() {
+  return handle ? fgetc(handle.get()) : -1;
+}
+
+int File::peek() {
+  if (!handle) return -1;
+  int c = fgetc(handle.get());
+  if (c != EOF) ungetc(c, handle.get());
+  return c;
+}
+
+size_t File::read(uint8_t* buffer, size_t length) {
+  return handle ? fread(buffer, 1, length, handle.get()) : 0;
+}
+
+bool File::seek(uint32_t offset) {
+  return handle && fseek(handle.get(), offset, SEEK_SET) == 0;
+}
+
+size_t File::position() const {
+  return handle ? (size_t)ftell(handle.get()) : 0;
+}
+
+size_t File::size() const {
+  if (!handle) return 0;
+  fflush(handle.get());
+  struct stat info;
+  return fstat(fileno(handle.get()), &info) == 0 ? (size_t)info.st_size : 0;
+}
+
+void File::flush() {
+  if (handle) fflush(handle.get());
+}
+
+std::string FS::hostPath(const char* path) const {
+  return fsRoot + (path[0] == '/' ? "" : "/") + path;
+}
+
+File FS::open(const char* path, const char* mode) {
+  // Arduino "w"/"a" create the file; fopen needs binary mode for exact sizes
+  std::string hostMode = std::string(mode) + "b";
+  FILE* file = fopen(hostPath(path).c_str(), hostMode.c_str());
+  return file ? File(file, path) : File();
+}
+
+bool FS::exists(const char* path) {
+  struct stat info;
+  return stat(hostPath(path).c_str(), &info) == 0;
+}
+
+bool FS::remove(const char* path) {
+  return ::remove(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const char* from, const char* to) {
+  return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+}  // namespace fs
+
+SPIFFSFS SPIFFS SHIM_GLOBAL;
+
+bool SPIFFSFS::begin(bool, const char*, uint8_t, const char*) {
+  mkdir(fsRoot.c_str(), 0755);
+  struct stat info;
+  return stat(fsRoot.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+bool SPIFFSFS::format() {
+  std::string command = "rm -rf '" + fsRoot + "'";
+  return system(command.c_str()) == 0 && begin();
+}
+
+size_t SPIFFSFS::usedBytes() {
+  // SPIFFS is flat, so the root's regular files are everything
+  DIR* dir = opendir(fsRoot.c_str());
+  if (!dir) return 0;
+  size_t used = 0;
+  while (dirent* entry = readdir(dir)) {
+    struct stat info;
+    std::string path = fsRoot + "/" + entry->d_name;
+    if (stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode)) used += info.st_size;
+  }
+  closedir(dir);
+  return used;
+}
+
+// ---- Preferences ----
+
+static std::map<std::string, std::map<std::string, std::vector<uint8_t>>> nvs SHIM_GLOBAL;
+
+bool Preferences::begin(const char* name, bool readOnly) {
+  space = &nvs[name];
+  this->readOnly = readOnly;
+  return true;
+}
+
+bool Preferences::clear() {
+  if (!space || readOnly) return false;
+  space->clear();
+  return true;
+}
+
+bool Preferences::remove(const char* key) {
+  return space && !readOnly && space->erase(key) > 0;
+}
+
+bool Preferences::isKey(const char* key) {
+  return space && space->count(key) > 0;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t length) {
+  if (!space || readOnly) return 0;
+  const uint8_t* bytes = static_cast<const uint8_t*>(value);
+  (*space)[key].assign(bytes, bytes + length);
+  return length;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+  if (!space) return 0;
+  auto it = space->find(key);
+  return it == space->end() ? 0 : it->second.size();
+}
+
+size_t Preferences::getBytes(const char* key, void* buffer, size_t maxLength) {
+  size_t length = getBytesLength(key);
+  if (length == 0 || length > maxLength) return 0;
+  memcpy(buffer, (*space)[key].data(), length);
+  return length;
+}
+
+size_t Preferences::getString(const char* key, char* value, size_t maxLength) {
+  size_t length = getBytes(key, value, maxLength);
+  if (length == 0 && maxLength) value[0] = '\0';
+  return length;
+}
+
+String Preferences::getString(const char* key, const String& defaultValue) {
+  size_t length = getBytesLength(key);
+  if (length == 0) return defaultValue;
+  std::vector<char> buffer(length + 1, '\0');
+  getBytes(key, buffer.data(), length);
+  return String(buffer.data());
+}
@@ -0,0 +1,26 @@
+// Host stand-ins for modules that need the network stack. Commands that
+// raise notifications still run; nothing is delivered.
+
+#include "../lib/NotificationModule/NotificationModule.h"
+
+NotificationDispatcher notifications;
+
+NotificationDispatcher::NotificationDispatcher()
+    : workers{}, workerCount(0), idLock(portMUX_INITIALIZER_UNLOCKED), nextId(1) {}
+
+bool NotificationDispatcher::begin() {
+  return true;
+}
+
+bool NotificationDispatcher::notify(NotifyPriority, const char*, const char*, float) {
+  nextId++;
+  return false;
+}
+
+bool NotificationDispatcher::notifySink(const char*, NotifyPriority, const char*, const char*, float) {
+  return false;
+}
+
+String NotificationDispatcher::summary() const {
+  return "No notification sinks (native build)";
+}
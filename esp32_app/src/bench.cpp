@@ -0,0 +1,230 @@
+#include "bench.h"
+#include <algorithm>
+#include <new>
+#include "config.h"
+#include "state.h"
+#include "request_arena.h"
+#include "../lib/GzipStream/GzipStream.h"
+#include "../lib/HtmlPage/html_page.h"
+#include "../lib/PiCommunication Module/PiCommunication.h"
+
+#ifdef ARDUINO_ARCH_ESP32
+static const char* const BENCH_TARGET = "esp32";
+static const uint32_t BENCH_SCALE = 1;
+
+static uint32_t cpuMhz() { return ESP.getCpuFreqMHz(); }
+static uint32_t cycleCount() { return ESP.getCycleCount(); }
+static uint64_t elapsedNs(uint32_t cycles, uint64_t) { return (uint64_t)cycles * 1000 / cpuMhz(); }
+static uint64_t hostNs() { return 0; }
+#else
+#include <chrono>
+
+// millis() is the virtual clock on the host, so time with the real one
+static const char* const BENCH_TARGET = "host";
+static const uint32_t BENCH_SCALE = 20;
+
+static uint32_t cpuMhz() { return 0; }
+static uint32_t cycleCount() { return 0; }
+static uint64_t elapsedNs(uint32_t, uint64_t ns) { return ns; }
+static uint64_t hostNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+static const int BENCH_RUNS = 5;  // after one warm-up run
+
+// ---- Fixed dataset ----
+
+static const char* const PI_PACKETS[] = {
+  "{\"d\":123.4,\"m\":0,\"a\":0,\"h\":[120.1,121.7,122.0,123.9,123.4]}",
+  "{\"d\":35.2,\"m\":1,\"a\":1,\"h\":[80.5,64.2,51.0,42.8,35.2]}",
+  "{\"d\":250.0,\"m\":2,\"a\":0,\"h\":[249.8,250.3,250.1,249.9,250.0]}",
+  "{\"d\":18.7,\"m\":1,\"a\":1,\"h\":[22.4,21.0,19.9,19.1,18.7]}",
+};
+static const int PI_PACKET_COUNT = sizeof(PI_PACKETS) / sizeof(PI_PACKETS[0]);
+
+static SystemState* benchState = nullptr;
+static PiCommunication* benchPi = nullptr;
+
+static void fillHistory(SystemState& state) {
+  unsigned long now = millis();
+  for (int i = 0; i < 100; i++) {
+    SensorData data;
+    data.distance = 10.5f + (i * 37) % 300;
+    data.object_detected = data.distance <= 40;
+    data.timestamp = now - (100 - i) * 500UL;
+    data.mode = i % 3;
+    data.status = data.object_detected ? "Object Detected 🚨" : "Normal ✅";
+    state.addToHistory(data);
+    state.currentData = data;
+  }
+}
+
+// ---- Cases ----
+
+// Each body returns the bytes it serialized (0 for the others)
+struct BenchCase {
+  const char* name;
+  uint32_t iterations;  // per run on the device; the host runs BENCH_SCALE times more
+  size_t (*body)(uint32_t i);
+};
+
+static size_t benchPiJson(uint32_t i) {
+  benchPi->processPiMessage(PI_PACKETS[i % PI_PACKET_COUNT]);
+  return 0;
+}
+
+// Results are kept so the compiler can't drop the work
+static volatile float benchResult;
+
+static size_t benchAverageDistance(uint32_t) {
+  benchResult = benchState->getAverageDistance(100);
+  return 0;
+}
+
+static size_t benchDetectionCount(uint32_t) {
+  benchResult = benchState->getDetectionCount(60);
+  return 0;
+}
+
+// Set by a case that could not do its work; runCase() reports it instead
+// of timing nothing
+static const char* benchError = nullptr;
+
+// Rendered into a request arena slab, the same way the web server does
+static size_t renderPage(void (*write)(Print&)) {
+  RequestArena::Lease* body = requestArena.acquire();
+  if (!body) {
+    benchError = "no free request slab";
+    return 0;
+  }
+  write(*body);
+  size_t length = body->length();
+  body->release();
+  return length;
+}
+
+static size_t benchApiResponse(uint32_t) {
+  return renderPage(HtmlPage::writeAPIResponse);
+}
+
+static size_t benchHistoryJson(uint32_t) {
+  return renderPage(HtmlPage::writeHistoryJson);
+}
+
+struct BenchSource {
+  const uint8_t* data;
+  size_t length;
+  size_t pos;
+};
+
+static size_t readBenchSource(void* context, uint8_t* buffer, size_t maxLen) {
+  BenchSource* source = static_cast<BenchSource*>(context);
+  size_t n = std::min(maxLen, source->length - source->pos);
+  memcpy(buffer, source->data + source->pos, n);
+  source->pos += n;
+  return n;
+}
+
+// History JSON rendered and compressed as for a client that accepts gzip;
+// bytes is the compressed size, so the ratio is history_json's bytes over it
+static size_t benchGzipHistory(uint32_t) {
+  RequestArena::Lease* body = requestArena.acquire();
+  RequestArena::Lease* packed = requestArena.acquire();
+  size_t bytes = 0;
+  if (!body || !packed) {
+    benchError = "needs two free request slabs";
+  } else {
+    HtmlPage::writeHistoryJson(*body);
+    BenchSource source = { body->data(), body->length(), 0 };
+    GzipStream* stream = packed->create<GzipStream>(readBenchSource, &source);
+    uint8_t chunk[256];
+    size_t n;
+    while (stream && (n = stream->read(chunk, sizeof(chunk))) > 0) bytes += n;
+  }
+  if (body) body->release();
+  if (packed) packed->release();
+  return bytes;
+}
+
+static const BenchCase CASES[] = {
+  { "pi_json",          50, benchPiJson },
+  { "average_distance", 50, benchAverageDistance },
+  { "detection_count",  50, benchDetectionCount },
+  { "api_response",     50, benchApiResponse },
+  { "history_json",     10, benchHistoryJson },
+  { "gzip_history",     10, benchGzipHistory },
+};
+
+static void runCase(Print& out, const BenchCase& bench) {
+  uint32_t iterations = bench.iterations * BENCH_SCALE;
+  uint64_t ns[BENCH_RUNS];
+  uint32_t cycles[BENCH_RUNS];
+  size_t bytes = 0;
+  benchError = nullptr;
+
+  for (int run = -1; run < BENCH_RUNS && !benchError; run++) {
+    // Same starting point for every run: pi_json appends to the history
+    fillHistory(*benchState);
+    size_t produced = 0;
+
+    uint64_t startNs = hostNs();
+    uint32_t startCycles = cycleCount();
+    for (uint32_t i = 0; i < iterations; i++) produced += bench.body(i);
+    uint32_t spent = cycleCount() - startCycles;
+    uint64_t spentNs = hostNs() - startNs;
+
+    if (run < 0) continue;
+    cycles[run] = spent;
+    ns[run] = elapsedNs(spent, spentNs);
+    bytes = produced / iterations;
+  }
+
+  if (benchError) {
+    out.printf("{\"bench\":\"%s\",\"error\":\"%s\"}\n", bench.name, benchError);
+    return;
+  }
+
+  std::sort(ns, ns + BENCH_RUNS);
+  std::sort(cycles, cycles + BENCH_RUNS);
+  out.printf("{\"bench\":\"%s\",\"iterations\":%u,\"ns_median\":%.1f,\"ns_min\":%.1f,"
+             "\"cycles_median\":%u,\"bytes\":%u}\n",
+             bench.name, (unsigned)iterations, (double)ns[BENCH_RUNS / 2] / iterations,
+             (double)ns[0] / iterations, (unsigned)(cycles[BENCH_RUNS / 2] / iterations),
+             (unsigned)bytes);
+}
+
+int runBenchmarks(Print& out, const char* filter) {
+  benchState = new (std::nothrow) SystemState();
+  if (!benchState) {
+    out.println("{\"error\":\"out of memory\"}");
+    return 0;
+  }
+  // Scratch link: readings go to benchState only, never to flash
+  benchPi = new (std::nothrow) PiCommunication(*benchState, false);
+  if (!benchPi) {
+    delete benchState;
+    out.println("{\"error\":\"out of memory\"}");
+    return 0;
+  }
+
+  out.printf("{\"suite\":\"surveillance\",\"version\":1,\"target\":\"%s\",\"cpu_mhz\":%u,\"runs\":%d}\n",
+             BENCH_TARGET, (unsigned)cpuMhz(), BENCH_RUNS);
+
+  // The page generators read HtmlPage's state; point them at the dataset
+  HtmlPage::setSystemState(benchState);
+  int ran = 0;
+  for (const BenchCase& bench : CASES) {
+    if (filter && !strstr(bench.name, filter)) continue;
+    runCase(out, bench);
+    ran++;
+  }
+  HtmlPage::setSystemState(&systemState);
+
+  delete benchPi;
+  delete benchState;
+  benchPi = nullptr;
+  benchState = nullptr;
+  return ran;
+}
@@ -0,0 +1,24 @@
+#include "boot_arena.h"
+
+BootArena bootArena;
+
+void* BootArena::allocate(const char* what, size_t length, size_t align) {
+  if (sealed) {
+    Serial.println("❌ Boot arena sealed, " + String(what) + " not created (modules start in setup())");
+    return nullptr;
+  }
+
+  size_t start = (offset + align - 1) & ~(align - 1);
+  if (start + length > BOOT_ARENA_SIZE) {
+    Serial.println("❌ Boot arena full, " + String(what) + " needs " + String(length) +
+                   " bytes (raise BOOT_ARENA_SIZE)");
+    return nullptr;
+  }
+  offset = start + length;
+  return storage + start;
+}
+
+void BootArena::seal() {
+  sealed = true;
+  Serial.println("🧱 Boot arena: " + String(offset) + " of " + String(BOOT_ARENA_SIZE) + " bytes");
+}
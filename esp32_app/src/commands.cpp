@@ -0,0 +1,338 @@
+#include "commands.h"
+#include "config.h"
+#include "config_store.h"
+#include "state.h"
+#include "trace.h"
+#include "uart_replay.h"
+#include "heap_profiler.h"
+#include "../lib/PiCommunication Module/PiCommunication.h"
+#include "../lib/NotificationModule/NotificationModule.h"
+
+CommandRegistry commands;
+
+typedef void (*CommandHandler)(uint8_t channel, const CommandArgs& args, CommandReply& reply);
+
+struct CommandSpec {
+  const char* name;
+  CommandArg arg;
+  uint8_t channels;
+  CommandHandler handler;
+  const char* help;       // nullptr = alias, not listed
+};
+
+static const char* channelName(uint8_t channel) {
+  switch (channel) {
+    case CMD_UART:     return "uart";
+    case CMD_MQTT:     return "mqtt";
+    case CMD_TELEGRAM: return "telegram";
+    case CMD_HTTP:     return "http";
+    default:           return "?";
+  }
+}
+
+// Nothing reads replies on the Pi link, and building them there would put
+// String allocations on the ingestion path (zero-heap builds abort on those)
+static bool wantsReply(uint8_t channel) {
+  return channel != CMD_UART;
+}
+
+// ---- Shared handlers ----
+
+static void cmdHelp(uint8_t channel, const CommandArgs&, CommandReply& reply) {
+  if (!wantsReply(channel)) return;
+  reply.text = commands.help(channel);
+  reply.text += "\n _Distance Threshold: " + String(config().system.distance_threshold) + "cm_";
+}
+
+static void cmdStatus(uint8_t channel, const CommandArgs& args, CommandReply& reply) {
+  // "STATUS:<text>" from the Pi sets the status line; everywhere else it's a query
+  if (channel == CMD_UART && args.present) {
+    piComm.updateSystemStatus(args.text);
+    return;
+  }
+  if (!wantsReply(channel)) return;
+
+  reply.text = " *Surveillance System Status*\n\n";
+  reply.text += " *Distance:* " + String(systemState.currentData.distance, 1) + " cm\n";
+  reply.text += " *Alert:* " + String(systemState.currentData.object_detected ? "ACTIVE 🚨" : "Clear ✅") + "\n";
+  reply.text += " *Status:* " + String(systemState.currentData.status.c_str()) + "\n";
+  reply.text += " *Uptime:* " + systemState.getFormattedUptime() + "\n";
+  reply.text += " *WiFi:* " + String(systemState.wifiMode.c_str()) + "\n";
+  reply.text += " *Memory:* " + String(ESP.getFreeHeap()) + " bytes\n";
+  reply.text += " *Data Points:* " + String(systemState.getHistoryCount()) + "\n\n";
+
+  if (systemState.currentData.object_detected) {
+    reply.text += " *Object detected within " + String(config().system.distance_threshold) + "cm!*";
+  } else {
+    reply.text += " *System monitoring normally*";
+  }
+}
+
+static void cmdHistory(uint8_t channel, const CommandArgs&, CommandReply& reply) {
+  if (!wantsReply(channel)) return;
+  reply.text = " *Recent Distance History:*\n\n";
+  int count = min(5, systemState.getHistoryCount());
+  for (int i = 0; i < count; i++) {
+    SensorData data = systemState.getHistory(i);
+    reply.text += "• " + String(data.distance, 1) + "cm - ";
+    reply.text += (data.object_detected ? "🚨 Alert" : " Normal");
+    reply.text += "\n";
+  }
+  if (count == 0) reply.text += "No data available yet";
+}
+
+static void cmdConfig(uint8_t channel, const CommandArgs&, CommandReply& reply) {
+  if (!wantsReply(channel)) return;
+  reply.text = " *System Configuration:*\n\n";
+  reply.text += " Threshold: " + String(config().system.distance_threshold) + "cm\n";
+  reply.text += " Cooldown: " + String(config().system.alert_cooldown/1000) + "s\n";
+  reply.text += " Refresh: " + String(config().system.web_refresh_interval) + "s\n";
+  reply.text += " Telegram: " + String(config().telegram.enable_telegram ? "Enabled" : "Disabled") + "\n";
+  reply.text += " WiFi Mode: " + String(systemState.wifiMode.c_str()) + "\n";
+  reply.text += " Uptime: " + systemState.getFormattedUptime();
+}
+
+static void cmdTest(uint8_t channel, const CommandArgs&, CommandReply& reply) {
+  // Goes through the real notification path, so every enabled sink is exercised
+  char text[32];
+  snprintf(text, sizeof(text), "Test alert via %s", channelName(channel));
+  bool queued = notifications.notify(NotifyPriority::Normal, "test", text);
+  if (!wantsReply(channel)) return;
+  reply.text = queued ? " *Test Alert Sent!*\n\nThis is a test notification from your surveillance system.\n"
+                      : " *No notification sink enabled*\n\n";
+  reply.text += "System time: " + String(millis()/1000) + "s";
+}
+
+static void cmdRefresh(uint8_t channel, const CommandArgs&, CommandReply& reply) {
+  if (!wantsReply(channel)) return;
+  reply.text = "Refreshed";
+}
+
+static void cmdRestart(uint8_t, const CommandArgs&, CommandReply& reply) {
+  reply.text = " *System Restarting...*\n\nESP32 will restart in 3 seconds.";
+  reply.restart = true;
+}
+
+static void cmdReplay(uint8_t, const CommandArgs& args, CommandReply& reply) {
+  // "replay" reports, "replay <speed>|max" starts, "replay stop" stops
+  if (!args.present) {
+    reply.text = " *Replay:* " + String(uartReplay.isActive() ? "running, " : "") + uartReplay.summary();
+    return;
+  }
+  if (strcasecmp(args.text, "stop") == 0) {
+    uartReplay.stop();
+    reply.text = "Replay stopping";
+    return;
+  }
+
+  float speed = strcasecmp(args.text, "max") == 0 ? 0 : atof(args.text);
+  if (speed < 0 || (speed == 0 && strcasecmp(args.text, "max") != 0)) {
+    reply.ok = false;
+    reply.text = "replay expects a speed factor, \"max\" or \"stop\"";
+    return;
+  }
+  if (!uartReplay.start(speed)) {
+    reply.ok = false;
+    reply.text = "A replay is already running";
+    return;
+  }
+  reply.text = "Replay of " REPLAY_FILE " queued; results on serial and via `replay`";
+}
+
+// ---- Pi link messages ----
+
+// These run for every packet on the ingestion path, so they trace instead
+// of building reply text
+
+static void cmdDistance(uint8_t, const CommandArgs& args, CommandReply&) {
+  piComm.updateSystemState(args.number);
+}
+
+static void cmdAlert(uint8_t, const CommandArgs& args, CommandReply&) {
+  piComm.triggerAlert(args.text);
+}
+
+static void cmdSystem(uint8_t, const CommandArgs& args, CommandReply&) {
+  TRACE(PI_SYSTEM, args.text);
+}
+
+static void cmdHeartbeat(uint8_t, const CommandArgs&, CommandReply&) {
+  systemState.lastPiHeartbeat = millis();
+}
+
+static void cmdError(uint8_t, const CommandArgs& args, CommandReply&) {
+  TRACE(PI_ERROR, args.text);
+}
+
+constexpr CommandSpec COMMANDS[] = {
+  { "help",       CommandArg::None,   CMD_ALL,    cmdHelp,      "This help message" },
+  { "start",      CommandArg::None,   CMD_ALL,    cmdHelp,      nullptr },
+  { "status",     CommandArg::Text,   CMD_ALL,    cmdStatus,    "Current system status" },
+  { "history",    CommandArg::None,   CMD_ALL,    cmdHistory,   "Recent distance readings" },
+  { "config",     CommandArg::None,   CMD_ALL,    cmdConfig,    "System configuration" },
+  // Not from the Pi: a line on the link could send alerts to every sink
+  { "test",       CommandArg::None,   CMD_REMOTE, cmdTest,      "Send test alert" },
+  { "test_alert", CommandArg::None,   CMD_REMOTE, cmdTest,      nullptr },
+  { "refresh",    CommandArg::None,   CMD_ALL,    cmdRefresh,   nullptr },
+  // Not from the Pi: any line on the link, or in a replayed capture, could restart us
+  { "restart",    CommandArg::None,   CMD_REMOTE, cmdRestart,   "Restart system" },
+  { "replay",     CommandArg::Text,   CMD_REMOTE, cmdReplay,    "Replay a UART capture: <speed>|max|stop" },
+  { "distance",   CommandArg::Number, CMD_UART,   cmdDistance,  "Report a distance (Pi)" },
+  { "alert",      CommandArg::Text,   CMD_UART,   cmdAlert,     "Alert level (Pi)" },
+  { "system",     CommandArg::Text,   CMD_UART,   cmdSystem,    "System message (Pi)" },
+  { "heartbeat",  CommandArg::Text,   CMD_UART,   cmdHeartbeat, "Link heartbeat (Pi)" },
+  { "error",      CommandArg::Text,   CMD_UART,   cmdError,     "Error report (Pi)" },
+};
+
+constexpr size_t COMMAND_COUNT = sizeof(COMMANDS) / sizeof(COMMANDS[0]);
+
+// ---- Compile-time perfect hash ----
+
+constexpr size_t COMMAND_SLOTS = 32;  // power of two
+static_assert(COMMAND_COUNT < COMMAND_SLOTS, "command table needs more hash slots");
+
+constexpr char lowerAscii(char c) {
+  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+constexpr size_t nameLength(const char* name) {
+  size_t length = 0;
+  while (name[length]) length++;
+  return length;
+}
+
+constexpr uint32_t commandHash(const char* name, size_t length, uint32_t seed) {
+  uint32_t hash = 2166136261u ^ seed;
+  for (size_t i = 0; i < length; i++) hash = (hash ^ (uint8_t)lowerAscii(name[i])) * 16777619u;
+  return hash ^ (hash >> 15);
+}
+
+constexpr size_t commandSlot(const char* name, size_t length, uint32_t seed) {
+  return commandHash(name, length, seed) & (COMMAND_SLOTS - 1);
+}
+
+constexpr bool seedIsPerfect(uint32_t seed) {
+  bool used[COMMAND_SLOTS] = {};
+  for (size_t i = 0; i < COMMAND_COUNT; i++) {
+    size_t slot = commandSlot(COMMANDS[i].name, nameLength(COMMANDS[i].name), seed);
+    if (used[slot]) return false;
+    used[slot] = true;
+  }
+  return true;
+}
+
+constexpr uint32_t findSeed() {
+  for (uint32_t seed = 0; seed < 100000; seed++) {
+    if (seedIsPerfect(seed)) return seed;
+  }
+  return 0;
+}
+
+constexpr uint32_t COMMAND_SEED = findSeed();
+static_assert(seedIsPerfect(COMMAND_SEED), "no collision-free seed for the command table");
+
+struct CommandSlots {
+  int8_t index[COMMAND_SLOTS];
+};
+
+constexpr CommandSlots buildSlots() {
+  CommandSlots slots = {};
+  for (size_t i = 0; i < COMMAND_SLOTS; i++) slots.index[i] = -1;
+  for (size_t i = 0; i < COMMAND_COUNT; i++) {
+    slots.index[commandSlot(COMMANDS[i].name, nameLength(COMMANDS[i].name), COMMAND_SEED)] = i;
+  }
+  return slots;
+}
+
+constexpr CommandSlots COMMAND_TABLE = buildSlots();
+
+static const CommandSpec* lookup(const char* name, size_t length) {
+  int index = COMMAND_TABLE.index[commandSlot(name, length, COMMAND_SEED)];
+  if (index < 0) return nullptr;
+
+  // Names outside the table can land on a used slot, so confirm the match
+  const CommandSpec& spec = COMMANDS[index];
+  for (size_t i = 0; i < length; i++) {
+    if (spec.name[i] != lowerAscii(name[i])) return nullptr;
+  }
+  return spec.name[length] == '\0' ? &spec : nullptr;
+}
+
+// ---- CommandRegistry ----
+
+CommandRegistry::CommandRegistry() : restartAt(0), dispatched(0), rejected(0) {}
+
+bool CommandRegistry::dispatch(uint8_t channel, const char* line, CommandReply& reply) {
+  HEAP_TAG("commands");
+  const char* p = line;
+  while (*p == ' ') p++;
+  if (*p == '/') p++;
+
+  const char* name = p;
+  while (*p && *p != ' ' && *p != ':' && *p != '@') p++;
+  size_t length = p - name;
+
+  // Telegram appends the bot name in groups: "/status@my_bot"
+  if (*p == '@') {
+    while (*p && *p != ' ') p++;
+  }
+  if (*p == ':' || *p == ' ') p++;
+  while (*p == ' ') p++;
+
+  const CommandSpec* spec = lookup(name, length);
+  if (!spec || !(spec->channels & channel)) {
+    rejected++;
+    reply.ok = false;
+    if (channel != CMD_UART) reply.text = " Unknown command. Send `/help` for available commands.";
+    return false;
+  }
+
+  CommandArgs args;
+  args.present = *p != '\0';
+  args.text = p;
+  if (spec->arg == CommandArg::Number) {
+    char* end = nullptr;
+    args.number = strtof(p, &end);
+    while (end && *end == ' ') end++;
+    if (!args.present || end == p || *end != '\0') {
+      rejected++;
+      reply.ok = false;
+      if (channel != CMD_UART) reply.text = String(spec->name) + " expects a number";
+      return false;
+    }
+  }
+
+  dispatched++;
+  spec->handler(channel, args, reply);
+  return true;
+}
+
+void CommandRegistry::complete(const CommandReply& reply) {
+  if (!reply.restart) return;
+
+  // Deferred to the main loop so the transport can finish (and Telegram
+  // can acknowledge the update) before the restart
+  restartAt = millis() + RESTART_DELAY_MS;
+  if (restartAt == 0) restartAt = 1;
+}
+
+void CommandRegistry::handle() {
+  if (restartAt == 0 || (long)(millis() - restartAt) < 0) return;
+
+  Serial.println("🔄 Restarting on command");
+  configStore.flush();
+  ESP.restart();
+}
+
+String CommandRegistry::help(uint8_t channel) const {
+  String out = " *ESP32 Surveillance Bot Commands:*\n\n";
+  for (const CommandSpec& spec : COMMANDS) {
+    if (!spec.help || !(spec.channels & channel)) continue;
+    out += " `";
+    if (channel == CMD_TELEGRAM) out += "/";
+    out += spec.name;
+    if (spec.arg == CommandArg::Number) out += " <n>";
+    out += "` - " + String(spec.help) + "\n";
+  }
+  return out;
+}
@@ -0,0 +1,242 @@
+#include "config_schema.h"
+#include <math.h>
+
+#define CONFIG_BLOB_MAGIC   0x47464353  // "SCFG"
+#define CONFIG_BLOB_VERSION 1
+#define SECRET_PLACEHOLDER  "********"
+
+static uint32_t blobChecksum(const uint8_t* data, size_t length) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ data[i]) * 16777619u;
+  }
+  return hash;
+}
+
+static inline uint8_t* fieldPtr(AppConfig& cfg, const ConfigField& field) {
+  return reinterpret_cast<uint8_t*>(&cfg) + field.offset;
+}
+
+static inline const uint8_t* fieldPtr(const AppConfig& cfg, const ConfigField& field) {
+  return reinterpret_cast<const uint8_t*>(&cfg) + field.offset;
+}
+
+// Numeric value in user units
+static double readNumber(const AppConfig& cfg, const ConfigField& field) {
+  const uint8_t* p = fieldPtr(cfg, field);
+  double value = 0;
+  switch (field.type) {
+    case ConfigType::Bool:  value = *reinterpret_cast<const bool*>(p) ? 1 : 0; break;
+    case ConfigType::Int:   value = *reinterpret_cast<const int*>(p); break;
+    case ConfigType::ULong: value = *reinterpret_cast<const unsigned long*>(p); break;
+    case ConfigType::Float: value = *reinterpret_cast<const float*>(p); break;
+    case ConfigType::String: break;
+  }
+  return value / field.scale;
+}
+
+static void writeNumber(AppConfig& cfg, const ConfigField& field, double value) {
+  uint8_t* p = fieldPtr(cfg, field);
+  double stored = value * field.scale;
+  switch (field.type) {
+    case ConfigType::Bool:  *reinterpret_cast<bool*>(p) = stored != 0; break;
+    case ConfigType::Int:   *reinterpret_cast<int*>(p) = (int)lround(stored); break;
+    case ConfigType::ULong: *reinterpret_cast<unsigned long*>(p) = (unsigned long)llround(stored); break;
+    case ConfigType::Float: *reinterpret_cast<float*>(p) = (float)stored; break;
+    case ConfigType::String: break;
+  }
+}
+
+const ConfigField* ConfigSchema::find(const char* key) {
+  for (const ConfigField& field : CONFIG_FIELDS) {
+    if (strcmp(field.key, key) == 0) return &field;
+  }
+  return nullptr;
+}
+
+void ConfigSchema::applyDefaults(AppConfig& cfg) {
+  for (const ConfigField& field : CONFIG_FIELDS) {
+    if (field.type == ConfigType::String) {
+      char* text = reinterpret_cast<char*>(fieldPtr(cfg, field));
+      strncpy(text, field.defaultText, field.size - 1);
+      text[field.size - 1] = '\0';
+    } else {
+      writeNumber(cfg, field, field.defaultValue);
+    }
+  }
+}
+
+size_t ConfigSchema::encodeBlob(const AppConfig& cfg, uint8_t* buffer, size_t capacity) {
+  if (capacity < configBlobCapacity()) return 0;
+
+  size_t length = 12;
+  uint16_t records = 0;
+
+  for (const ConfigField& field : CONFIG_FIELDS) {
+    if (!(field.flags & CFG_PERSIST)) continue;
+
+    const uint8_t* value = fieldPtr(cfg, field);
+    uint8_t valueLength = field.type == ConfigType::String
+        ? strnlen(reinterpret_cast<const char*>(value), field.size - 1)
+        : field.size;
+    uint16_t hash = configKeyHash(field.key);
+
+    buffer[length++] = hash & 0xFF;
+    buffer[length++] = hash >> 8;
+    buffer[length++] = (uint8_t)field.type;
+    buffer[length++] = valueLength;
+    memcpy(buffer + length, value, valueLength);
+    length += valueLength;
+    records++;
+  }
+
+  uint32_t magic = CONFIG_BLOB_MAGIC;
+  uint16_t version = CONFIG_BLOB_VERSION;
+  uint32_t checksum = blobChecksum(buffer + 12, length - 12);
+  memcpy(buffer, &magic, 4);
+  memcpy(buffer + 4, &version, 2);
+  memcpy(buffer + 6, &records, 2);
+  memcpy(buffer + 8, &checksum, 4);
+  return length;
+}
+
+bool ConfigSchema::decodeBlob(AppConfig& cfg, const uint8_t* buffer, size_t length) {
+  if (length < 12) return false;
+
+  uint32_t magic, checksum;
+  uint16_t version, records;
+  memcpy(&magic, buffer, 4);
+  memcpy(&version, buffer + 4, 2);
+  memcpy(&records, buffer + 6, 2);
+  memcpy(&checksum, buffer + 8, 4);
+
+  if (magic != CONFIG_BLOB_MAGIC || version != CONFIG_BLOB_VERSION) return false;
+  if (checksum != blobChecksum(buffer + 12, length - 12)) return false;
+
+  size_t pos = 12;
+  for (uint16_t i = 0; i < records; i++) {
+    if (pos + 4 > length) return false;
+    uint16_t hash = buffer[pos] | (buffer[pos + 1] << 8);
+    ConfigType type = (ConfigType)buffer[pos + 2];
+    uint8_t valueLength = buffer[pos + 3];
+    pos += 4;
+    if (pos + valueLength > length) return false;
+
+    // Unknown or retyped fields are skipped and keep their defaults
+    for (const ConfigField& field : CONFIG_FIELDS) {
+      if (configKeyHash(field.key) != hash || field.type != type) continue;
+
+      uint8_t* target = fieldPtr(cfg, field);
+      if (type == ConfigType::String) {
+        size_t n = min((size_t)valueLength, (size_t)field.size - 1);
+        memcpy(target, buffer + pos, n);
+        target[n] = '\0';
+      } else if (valueLength == field.size) {
+        memcpy(target, buffer + pos, valueLength);
+      }
+      break;
+    }
+    pos += valueLength;
+  }
+
+  return true;
+}
+
+void ConfigSchema::toJson(const AppConfig& cfg, JsonObject obj) {
+  for (const ConfigField& field : CONFIG_FIELDS) {
+    const uint8_t* p = fieldPtr(cfg, field);
+    switch (field.type) {
+      case ConfigType::Bool:
+        obj[field.key] = *reinterpret_cast<const bool*>(p);
+        break;
+      case ConfigType::Int:
+      case ConfigType::ULong:
+      case ConfigType::Float:
+        obj[field.key] = readNumber(cfg, field);
+        break;
+      case ConfigType::String: {
+        const char* text = reinterpret_cast<const char*>(p);
+        if (field.flags & CFG_SECRET) {
+          obj[field.key] = text[0] ? SECRET_PLACEHOLDER : "";
+        } else {
+          obj[field.key] = text;
+        }
+        break;
+      }
+    }
+  }
+}
+
+bool ConfigSchema::fromJson(AppConfig& cfg, JsonObjectConst obj, String& error) {
+  for (const ConfigField& field : CONFIG_FIELDS) {
+    JsonVariantConst value = obj[field.key];
+    if (value.isNull()) continue;
+
+    if (field.type == ConfigType::String) {
+      const char* text = value.as<const char*>();
+      if (!text) {
+        error = String(field.key) + " must be a string";
+        return false;
+      }
+      if ((field.flags & CFG_SECRET) && (text[0] == '\0' || strcmp(text, SECRET_PLACEHOLDER) == 0)) {
+        continue;
+      }
+      if (strlen(text) >= field.size) {
+        error = String(field.key) + " is longer than " + String(field.size - 1) + " characters";
+        return false;
+      }
+      strcpy(reinterpret_cast<char*>(fieldPtr(cfg, field)), text);
+      continue;
+    }
+
+    // Form posts send everything as strings, so accept both representations
+    double number;
+    if (value.is<bool>()) {
+      number = value.as<bool>() ? 1 : 0;
+    } else if (value.is<double>()) {
+      number = value.as<double>();
+    } else if (value.is<const char*>()) {
+      const char* text = value.as<const char*>();
+      char* end = nullptr;
+      if (strcmp(text, "true") == 0 || strcmp(text, "on") == 0) {
+        number = 1;
+      } else if (strcmp(text, "false") == 0 || strcmp(text, "off") == 0) {
+        number = 0;
+      } else {
+        number = strtod(text, &end);
+        if (end == text || *end != '\0') {
+          error = String(field.key) + " is not a number";
+          return false;
+        }
+      }
+    } else {
+      error = String(field.key) + " has an invalid type";
+      return false;
+    }
+
+    if (field.type != ConfigType::Bool && (number < field.minValue || number > field.maxValue)) {
+      error = String(field.key) + " must be between " + String(field.minValue, 0) +
+              " and " + String(field.maxValue, 0);
+      return false;
+    }
+    writeNumber(cfg, field, number);
+  }
+
+  return true;
+}
+
+bool ConfigSchema::fieldEquals(const ConfigField& field, const AppConfig& a, const AppConfig& b) {
+  if (field.type == ConfigType::String) {
+    return strncmp(reinterpret_cast<const char*>(fieldPtr(a, field)),
+                   reinterpret_cast<const char*>(fieldPtr(b, field)), field.size) == 0;
+  }
+  return memcmp(fieldPtr(a, field), fieldPtr(b, field), field.size) == 0;
+}
+
+const char* ConfigSchema::textValue(const ConfigField& field, const AppConfig& cfg) {
+  return field.type == ConfigType::String ? reinterpret_cast<const char*>(fieldPtr(cfg, field)) : "";
+}
+
+double ConfigSchema::numberValue(const ConfigField& field, const AppConfig& cfg) {
+  return readNumber(cfg, field);
+}
@@ -0,0 +1,90 @@
+#include "config_store.h"
+#include "config_schema.h"
+#include "../lib/DataManager/DataManager.h"
+
+ConfigStore configStore;
+
+ConfigStore::ConfigStore()
+    : lock(portMUX_INITIALIZER_UNLOCKED), hasPending(false), dirty(false),
+      lastEdit(0), lastPublish(0), writes(0), coalesced(0) {}
+
+void ConfigStore::begin() {
+  persisted = config();
+  lastPublish = millis();
+}
+
+void ConfigStore::current(AppConfig& out) {
+  portENTER_CRITICAL(&lock);
+  memcpy(&out, hasPending ? &pending : &config(), sizeof(AppConfig));
+  portEXIT_CRITICAL(&lock);
+}
+
+void ConfigStore::stage(const AppConfig& updated) {
+  portENTER_CRITICAL(&lock);
+  memcpy(&pending, &updated, sizeof(AppConfig));
+  if (hasPending || dirty) coalesced++;
+  hasPending = true;
+  lastEdit = millis();
+  portEXIT_CRITICAL(&lock);
+}
+
+void ConfigStore::handle() {
+  if (hasPending) {
+    apply(false);
+  }
+
+  if (dirty && millis() - lastEdit > DEBOUNCE_MS) {
+    persist();
+  }
+}
+
+void ConfigStore::flush() {
+  // About to restart: nothing is left to read the old buffer for long
+  if (hasPending) {
+    apply(true);
+  }
+  if (dirty) {
+    persist();
+  }
+}
+
+void ConfigStore::apply(bool force) {
+  // The spare buffer was live until the last publish; readers on other
+  // tasks get PUBLISH_GAP_MS to finish with it before it is overwritten
+  unsigned long now = millis();
+  if (!force && now - lastPublish < PUBLISH_GAP_MS) return;
+
+  // The edit is copied into the spare buffer, then one pointer store makes
+  // it live: a reader sees either the old or the new config, never a mix
+  portENTER_CRITICAL(&lock);
+  publishConfig(pending);
+  hasPending = false;
+  portEXIT_CRITICAL(&lock);
+
+  lastPublish = now;
+  dirty = true;
+}
+
+void ConfigStore::persist() {
+  dirty = false;
+  const AppConfig& live = config();
+
+  String changed;
+  for (const ConfigField& field : CONFIG_FIELDS) {
+    if ((field.flags & CFG_PERSIST) && !ConfigSchema::fieldEquals(field, live, persisted)) {
+      if (changed.length()) changed += ", ";
+      changed += field.key;
+    }
+  }
+
+  // Nothing that NVS holds has changed: skip the erase cycle entirely
+  if (changed.length() == 0) {
+    Serial.println("⚙️ Config unchanged, nothing to persist");
+    return;
+  }
+
+  dataManager.saveConfig(live);
+  persisted = live;
+  writes++;
+  Serial.println("⚙️ Config persisted (" + changed + ")");
+}
@@ -0,0 +1,399 @@
+#include "heap_profiler.h"
+#include <new>
+#include <utility>
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#else
+#include <atomic>
+#endif
+
+HeapProfiler heapProfiler;
+
+HeapGauges HeapProfiler::gauges() {
+  HeapGauges gauges = {};
+#ifdef ARDUINO_ARCH_ESP32
+  gauges.freeBytes = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  gauges.minFreeBytes = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+  gauges.largestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  if (gauges.freeBytes) {
+    gauges.fragmentation = 100 - (uint8_t)((uint64_t)gauges.largestBlock * 100 / gauges.freeBytes);
+  }
+#endif
+  return gauges;
+}
+
+#ifdef HEAP_PROFILE
+
+// Everything below runs inside malloc/free, possibly before constructors:
+// only constant-initialized state, no allocation, no logging.
+
+#ifndef HEAP_PROFILE_SLOTS
+#ifdef ARDUINO_ARCH_ESP32
+#define HEAP_PROFILE_SLOTS 1024
+#else
+#define HEAP_PROFILE_SLOTS 4096
+#endif
+#endif
+static_assert((HEAP_PROFILE_SLOTS & (HEAP_PROFILE_SLOTS - 1)) == 0, "HEAP_PROFILE_SLOTS must be a power of two");
+
+struct LiveBlock {
+  uintptr_t ptr;      // 0 = empty slot
+  uint32_t size;
+  uint32_t born;      // millis()
+  uint8_t tag;
+};
+
+static LiveBlock blocks[HEAP_PROFILE_SLOTS];
+static uint32_t liveCount;
+static unsigned long untracked;
+static HeapTagStats tags[HeapProfiler::MAX_TAGS];
+static int tagCount;
+
+#ifdef ARDUINO_ARCH_ESP32
+static portMUX_TYPE heapLock = portMUX_INITIALIZER_UNLOCKED;
+static inline void lock() { portENTER_CRITICAL(&heapLock); }
+static inline void unlock() { portEXIT_CRITICAL(&heapLock); }
+
+// Current tag and allocation count per task; a task claims a slot the first
+// time it sets a tag or asks for its count
+struct TaskTag {
+  TaskHandle_t task;
+  uint32_t allocs;
+  uint8_t tag;
+  uint8_t lastTag;
+  uint8_t exempt;    // HEAP_EXEMPT nesting depth
+};
+static TaskTag taskTags[16];
+
+static TaskTag* taskTag(bool claim) {
+  if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING) return nullptr;
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  for (TaskTag& entry : taskTags) {
+    if (entry.task == self) return &entry;
+  }
+  if (!claim) return nullptr;
+
+  TaskTag* found = nullptr;
+  lock();
+  for (TaskTag& entry : taskTags) {
+    if (!entry.task) {
+      entry.task = self;
+      found = &entry;
+      break;
+    }
+  }
+  unlock();
+  return found;
+}
+
+uint8_t HeapProfiler::currentTag() {
+  TaskTag* entry = taskTag(false);
+  return entry ? entry->tag : 0;
+}
+
+void HeapProfiler::setCurrentTag(uint8_t tag) {
+  TaskTag* entry = taskTag(tag != 0);
+  if (entry) entry->tag = tag;
+}
+
+void HeapProfiler::setTaskExempt(bool exempt) {
+  TaskTag* entry = taskTag(true);
+  if (entry) entry->exempt += exempt ? 1 : -1;
+}
+
+uint32_t HeapProfiler::taskAllocations() {
+  TaskTag* entry = taskTag(true);
+  return entry ? entry->allocs : 0;
+}
+
+const char* HeapProfiler::taskLastTag() {
+  TaskTag* entry = taskTag(false);
+  return tagName(entry ? entry->lastTag : 0);
+}
+
+// Tag for a new block; also counts it against the allocating task, which
+// is the only writer of its entry
+static uint8_t chargeTask() {
+  TaskTag* entry = taskTag(false);
+  if (!entry) return 0;
+  if (!entry->exempt) {
+    entry->allocs++;
+    entry->lastTag = entry->tag;
+  }
+  return entry->tag;
+}
+#else
+// The host build is single-threaded; the flag only guards against misuse
+static std::atomic_flag heapLock = ATOMIC_FLAG_INIT;
+static inline void lock() { while (heapLock.test_and_set(std::memory_order_acquire)) {} }
+static inline void unlock() { heapLock.clear(std::memory_order_release); }
+
+static uint8_t hostTag;
+static uint8_t hostLastTag;
+static int hostExempt;
+static uint32_t hostAllocs;
+
+uint8_t HeapProfiler::currentTag() { return hostTag; }
+void HeapProfiler::setCurrentTag(uint8_t tag) { hostTag = tag; }
+void HeapProfiler::setTaskExempt(bool exempt) { hostExempt += exempt ? 1 : -1; }
+uint32_t HeapProfiler::taskAllocations() { return hostAllocs; }
+const char* HeapProfiler::taskLastTag() { return tagName(hostLastTag); }
+
+static uint8_t chargeTask() {
+  if (!hostExempt) {
+    hostAllocs++;
+    hostLastTag = hostTag;
+  }
+  return hostTag;
+}
+#endif
+
+bool HeapProfiler::enabled() { return true; }
+
+uint8_t HeapProfiler::tagIndex(const char* name) {
+  // Tags are string literals, so the pointer usually matches
+  for (int i = 1; i < tagCount; i++) {
+    if (tags[i].name == name) return i;
+  }
+
+  lock();
+  if (tagCount == 0) {
+    tags[0].name = "other";
+    tagCount = 1;
+  }
+  uint8_t index = 0;
+  for (int i = 1; i < tagCount && !index; i++) {
+    if (strcmp(tags[i].name, name) == 0) index = i;
+  }
+  if (!index && tagCount < MAX_TAGS) {
+    index = tagCount;
+    tags[tagCount++].name = name;
+  }
+  unlock();
+  return index;
+}
+
+const char* HeapProfiler::tagName(uint8_t index) {
+  return index < tagCount ? tags[index].name : "other";
+}
+
+static inline uint32_t slotOf(uintptr_t ptr) {
+  return (uint32_t)((ptr >> 3) * 2654435761u) & (HEAP_PROFILE_SLOTS - 1);
+}
+
+void HeapProfiler::recordAlloc(void* ptr, size_t size) {
+  uint8_t tag = chargeTask();
+  uint32_t now = millis();
+
+  lock();
+  HeapTagStats& stats = tags[tag];
+  stats.allocs++;
+  stats.totalBytes += size;
+
+  // Keep a quarter of the table free so probe chains stay short
+  if (liveCount >= HEAP_PROFILE_SLOTS * 3 / 4) {
+    untracked++;
+    unlock();
+    return;
+  }
+
+  uint32_t slot = slotOf((uintptr_t)ptr);
+  while (blocks[slot].ptr) slot = (slot + 1) & (HEAP_PROFILE_SLOTS - 1);
+  blocks[slot] = { (uintptr_t)ptr, (uint32_t)size, now, tag };
+  liveCount++;
+
+  stats.liveBlocks++;
+  stats.liveBytes += size;
+  if (stats.liveBytes > stats.peakBytes) stats.peakBytes = stats.liveBytes;
+  unlock();
+}
+
+void HeapProfiler::recordFree(void* ptr) {
+  uint32_t now = millis();
+
+  lock();
+  uint32_t slot = slotOf((uintptr_t)ptr);
+  while (blocks[slot].ptr && blocks[slot].ptr != (uintptr_t)ptr) {
+    slot = (slot + 1) & (HEAP_PROFILE_SLOTS - 1);
+  }
+  if (!blocks[slot].ptr) {
+    // Allocated before tracking had room, or outside the wrapped calls
+    unlock();
+    return;
+  }
+
+  const LiveBlock& block = blocks[slot];
+  HeapTagStats& stats = tags[block.tag];
+  stats.frees++;
+  stats.liveBlocks--;
+  stats.liveBytes -= block.size;
+  stats.lifetimeMs += now - block.born;
+
+  // Backward-shift deletion keeps linear probing correct without tombstones
+  uint32_t hole = slot;
+  uint32_t next = (hole + 1) & (HEAP_PROFILE_SLOTS - 1);
+  while (blocks[next].ptr) {
+    uint32_t home = slotOf(blocks[next].ptr);
+    if (((next - home) & (HEAP_PROFILE_SLOTS - 1)) >= ((next - hole) & (HEAP_PROFILE_SLOTS - 1))) {
+      blocks[hole] = blocks[next];
+      hole = next;
+    }
+    next = (next + 1) & (HEAP_PROFILE_SLOTS - 1);
+  }
+  blocks[hole].ptr = 0;
+  liveCount--;
+  unlock();
+}
+
+int HeapProfiler::snapshot(HeapTagStats* out, int maxTags) const {
+  uint32_t now = millis();
+
+  lock();
+  int count = min(tagCount, maxTags);
+  for (int i = 0; i < count; i++) {
+    out[i] = tags[i];
+    out[i].longLived = 0;
+  }
+  for (const LiveBlock& block : blocks) {
+    if (block.ptr && block.tag < count && now - block.born > LONG_LIVED_MS) out[block.tag].longLived++;
+  }
+  unlock();
+  return count;
+}
+
+unsigned long HeapProfiler::untrackedCount() const {
+  return untracked;
+}
+
+// ---- Allocation hooks ----
+
+#ifdef ARDUINO_ARCH_ESP32
+// Linked with -Wl,--wrap=malloc,--wrap=free,--wrap=realloc,--wrap=calloc
+extern "C" {
+void* __real_malloc(size_t size);
+void __real_free(void* ptr);
+void* __real_realloc(void* ptr, size_t size);
+void* __real_calloc(size_t count, size_t size);
+
+void* __wrap_malloc(size_t size) {
+  void* ptr = __real_malloc(size);
+  if (ptr) heapProfiler.recordAlloc(ptr, size);
+  return ptr;
+}
+
+void __wrap_free(void* ptr) {
+  // Forget the block first: once freed, another task may be handed the address
+  if (ptr) heapProfiler.recordFree(ptr);
+  __real_free(ptr);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+  if (ptr) heapProfiler.recordFree(ptr);
+  void* moved = __real_realloc(ptr, size);
+  if (moved) {
+    heapProfiler.recordAlloc(moved, size);
+  } else if (ptr && size) {
+    // Failed: the old block is still live, only its age is lost
+    heapProfiler.recordAlloc(ptr, 0);
+  }
+  return moved;
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+  void* ptr = __real_calloc(count, size);
+  if (ptr) heapProfiler.recordAlloc(ptr, count * size);
+  return ptr;
+}
+}
+#else
+// Host: String is std::string underneath, so operator new sees every allocation
+static void* trackedNew(size_t size) {
+  void* ptr = malloc(size ? size : 1);
+  if (ptr) heapProfiler.recordAlloc(ptr, size);
+  return ptr;
+}
+
+static void trackedDelete(void* ptr) {
+  if (!ptr) return;
+  heapProfiler.recordFree(ptr);
+  free(ptr);
+}
+
+void* operator new(size_t size) {
+  void* ptr = trackedNew(size);
+  if (!ptr) throw std::bad_alloc();
+  return ptr;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return trackedNew(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return trackedNew(size); }
+void operator delete(void* ptr) noexcept { trackedDelete(ptr); }
+void operator delete[](void* ptr) noexcept { trackedDelete(ptr); }
+void operator delete(void* ptr, size_t) noexcept { trackedDelete(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { trackedDelete(ptr); }
+#endif
+
+#else  // !HEAP_PROFILE
+
+bool HeapProfiler::enabled() { return false; }
+uint8_t HeapProfiler::tagIndex(const char*) { return 0; }
+const char* HeapProfiler::tagName(uint8_t) { return "other"; }
+uint8_t HeapProfiler::currentTag() { return 0; }
+void HeapProfiler::setCurrentTag(uint8_t) {}
+void HeapProfiler::setTaskExempt(bool) {}
+uint32_t HeapProfiler::taskAllocations() { return 0; }
+const char* HeapProfiler::taskLastTag() { return "other"; }
+void HeapProfiler::recordAlloc(void*, size_t) {}
+void HeapProfiler::recordFree(void*) {}
+int HeapProfiler::snapshot(HeapTagStats*, int) const { return 0; }
+unsigned long HeapProfiler::untrackedCount() const { return 0; }
+
+#endif  // HEAP_PROFILE
+
+void HeapProfiler::writeJson(Print& out) const {
+  HeapGauges heap = gauges();
+  out.printf("{\"free\":%u,\"min_free\":%u,\"largest\":%u,\"fragmentation\":%u,\"profiling\":%s",
+             (unsigned)heap.freeBytes, (unsigned)heap.minFreeBytes, (unsigned)heap.largestBlock,
+             (unsigned)heap.fragmentation, enabled() ? "true" : "false");
+
+  HeapTagStats stats[MAX_TAGS];
+  int count = snapshot(stats, MAX_TAGS);
+  if (enabled()) out.printf(",\"untracked\":%lu,\"tags\":[", untrackedCount());
+  for (int i = 0; i < count; i++) {
+    const HeapTagStats& tag = stats[i];
+    out.printf("%s{\"tag\":\"%s\",\"allocs\":%u,\"frees\":%u,\"live\":%u,\"live_bytes\":%u,"
+               "\"peak_bytes\":%u,\"total_bytes\":%llu,\"avg_lifetime_ms\":%llu,\"long_lived\":%u}",
+               i ? "," : "", tag.name, (unsigned)tag.allocs, (unsigned)tag.frees,
+               (unsigned)tag.liveBlocks, (unsigned)tag.liveBytes, (unsigned)tag.peakBytes,
+               (unsigned long long)tag.totalBytes,
+               (unsigned long long)(tag.frees ? tag.lifetimeMs / tag.frees : 0),
+               (unsigned)tag.longLived);
+  }
+  out.print(enabled() ? "]}" : "}");
+}
+
+String HeapProfiler::summary() const {
+  HeapGauges heap = gauges();
+  String out = "free " + String(heap.freeBytes) + ", largest " + String(heap.largestBlock) +
+               " (frag " + String(heap.fragmentation) + "%), min " + String(heap.minFreeBytes);
+
+  HeapTagStats stats[MAX_TAGS];
+  int count = snapshot(stats, MAX_TAGS);
+  if (count == 0) return out;
+
+  // The three tags holding the most live memory
+  out += " | live:";
+  for (int shown = 0; shown < 3 && shown < count; shown++) {
+    int best = shown;
+    for (int i = shown + 1; i < count; i++) {
+      if (stats[i].liveBytes > stats[best].liveBytes) best = i;
+    }
+    std::swap(stats[shown], stats[best]);
+    out += " " + String(stats[shown].name) + " " + String(stats[shown].liveBytes) + "B/" +
+           String(stats[shown].liveBlocks) + " (" + String(stats[shown].longLived) + " old)";
+  }
+  return out;
+}
@@ -6,15 +6,27 @@
 // Include all modules
 #include "../include/config.h"
 #include "../include/state.h"
+#include "../include/rtc_snapshot.h"
+#include "../include/config_store.h"
+#include "../include/tasks.h"
+#include "../include/scheduler.h"
+#include "../include/commands.h"
+#include "../include/trace.h"
+#include "../include/heap_profiler.h"
+#include "../include/boot_arena.h"
+#include "../include/request_arena.h"
 #include "../lib/HtmlPage/html_page.h"
 
 #include "../lib/WebServerModule/WebServerModule.h"
+#include "../lib/GzipStream/GzipStream.h"
 #include "../lib/TelegramModule/TelegramModule.h"
 #include "../lib/MqttModule/MqttModule.h"
 #include "../lib/UartModule/UartModule.h"
 #include "../lib/SpiModule/SpiModule.h"
 #include "../lib/DataManager/DataManager.h"
 #include "../lib/PiCommunication Module/PiCommunication.h"
+#include "../lib/WifiModule/WifiModule.h"
+#include "../lib/NotificationModule/NotificationModule.h"
 
 // Global instances
 WebServerModule webServer;
@@ -23,104 +35,36 @@ MqttModule mqttClient;
 
 // System status variables
 bool systemInitialized = false;
-unsigned long lastReconnectAttempt = 0;
-int reconnectAttempts = 0;
-const int MAX_RECONNECT_ATTEMPTS = 5;
 
-// WiFi setup function
-void setupWiFi() {
-  Serial.println("\n🌐 Setting up WiFi...");
-  
-  if (config.wifi.enable_station_mode && strlen(config.wifi.sta_ssid) > 0) {
-    WiFi.begin(config.wifi.sta_ssid, config.wifi.sta_password);
-    Serial.print("🔌 Connecting to WiFi: " + String(config.wifi.sta_ssid));
-    
-    unsigned long startTime = millis();
-    while (WiFi.status() != WL_CONNECTED && 
-           millis() - startTime < config.wifi.connection_timeout) {
-      delay(500);
-      Serial.print(".");
-      
-      // Blink status LED while connecting
-      digitalWrite(config.hardware.status_led_pin, !digitalRead(config.hardware.status_led_pin));
-    }
-    
-    if (WiFi.status() == WL_CONNECTED) {
-      systemState.wifiConnected = true;
-      systemState.wifiMode = "Station";
-      systemState.wifiSignalStrength = WiFi.RSSI();
-      Serial.println("\n✅ WiFi connected! IP: " + WiFi.localIP().toString());
-      digitalWrite(config.hardware.status_led_pin, LOW);
-      return;
-    } else {
-      Serial.println("\n❌ Failed to connect to WiFi");
-      digitalWrite(config.hardware.status_led_pin, HIGH);
-    }
-  }
-  
-  // Fallback to AP mode
-  Serial.println("📡 Starting AP Mode...");
-  WiFi.softAP(config.wifi.ap_ssid, config.wifi.ap_password);
-  systemState.wifiConnected = true;
-  systemState.wifiMode = "AP";
-  systemState.wifiSignalStrength = 0;
-  Serial.println("✅ AP Mode - IP: " + WiFi.softAPIP().toString());
-}
+// Housekeeping jobs run from loop()
+Scheduler housekeeping("loop");
 
-// Process incoming sensor data from Pi
-void processPiSensorData() {
-  piComm.handle();
-}
-
-// Process alerts and notifications
-void processAlerts() {
-  // Check if we need to send alerts for object detection
-  if (systemState.currentData.object_detected) {
-    unsigned long currentTime = millis();
-    
-    // Check alert cooldown
-    if (currentTime - systemState.lastAlertTime > config.system.alert_cooldown) {
-      String alertMessage = "🚨 Object detected at " + 
-                           String(systemState.currentData.distance, 1) + "cm";
-      
-      // Send Telegram alert
-      if (config.telegram.enable_telegram) {
-        if (telegramBot.sendAlert(alertMessage)) {
-          Serial.println("📱 Telegram alert sent");
-        } else {
-          Serial.println("❌ Failed to send Telegram alert");
-        }
-      }
-      
-      // Send MQTT alert
-      if (config.mqtt.enable_mqtt) {
-        if (mqttClient.publishAlert(alertMessage)) {
-          Serial.println("📡 MQTT alert sent");
-        } else {
-          Serial.println("❌ Failed to send MQTT alert");
-        }
-      }
-      
-      systemState.lastAlertTime = currentTime;
-      Serial.println("🔔 Alert sent: " + alertMessage);
-    }
-  }
+static void reportStage(const char* stage, unsigned long& mark) {
+  unsigned long now = millis();
+  Serial.println("⏱️ " + String(stage) + ": " + String(now - mark) + "ms (t=" + String(now) + "ms)");
+  mark = now;
 }
 
 // System initialization
 void setupSystem() {
   Serial.begin(115200);
-  delay(1000);
+  unsigned long stageMark = millis();
   
   Serial.println("\n🚀 ESP32 Surveillance System v3.0");
   Serial.println("=================================");
   
+  // Restore history and alert cooldown after a watchdog/OTA reset
+  if (rtcSnapshot.restore(systemState)) {
+    Serial.println("♻️ Warm boot: restored " + String(rtcSnapshot.restoredSamples()) +
+                   " samples (boot #" + String(systemState.bootCount) + ")");
+  }
+  
   // Initialize configuration
   initConfig();
   
   // Initialize status LED
-  pinMode(config.hardware.status_led_pin, OUTPUT);
-  digitalWrite(config.hardware.status_led_pin, HIGH);
+  pinMode(config().hardware.status_led_pin, OUTPUT);
+  digitalWrite(config().hardware.status_led_pin, HIGH);
   
   // Initialize data manager first (loads config)
   if (!dataManager.begin()) {
@@ -128,29 +72,28 @@ void setupSystem() {
   }
   
   // Load configuration
-  dataManager.loadConfig(config);
-  
-  // FORCE CONFIG OVERRIDES (Fix for mismatch and errors)
-  config.system.distance_threshold = 40.0;
-  config.telegram.enable_telegram = false;
-  Serial.println("ℹ️ Config forced: Threshold=40cm, Telegram=Disabled");
+  dataManager.loadConfig(bootConfig());
+  configStore.begin();
+  dataManager.logEvent("System boot");
+  reportStage("Config and storage", stageMark);
   
-  // Setup WiFi
-  setupWiFi();
-  
-  // Initialize Pi communication
-  if (config.raspberry_pi.enable_communication) {
+  // Start ingestion first so samples and local alerts don't wait for the network
+  if (config().raspberry_pi.enable_communication) {
     piComm.begin();
     Serial.println("✅ Pi communication initialized");
   }
+  reportStage("Pi link", stageMark);
+  
+  // WiFi connects in the background; advanced by the network task
+  wifiModule.begin();
+  reportStage("WiFi start", stageMark);
   
   // Initialize HTML Page dependencies
   HtmlPage::setSystemState(&systemState);
-  HtmlPage::setConfig(&config);
   
   // Initialize service modules
   Serial.println("\n🔧 Initializing service modules...");
-  if (config.system.enable_web_server) {
+  if (config().system.enable_web_server) {
     if (webServer.begin()) {
       Serial.println("✅ Web server started");
     } else {
@@ -158,7 +101,7 @@ void setupSystem() {
     }
   }
   
-  if (config.telegram.enable_telegram) {
+  if (config().telegram.enable_telegram) {
     if (telegramBot.begin()) {
       Serial.println("✅ Telegram bot initialized");
     } else {
@@ -166,7 +109,7 @@ void setupSystem() {
     }
   }
   
-  if (config.mqtt.enable_mqtt) {
+  if (config().mqtt.enable_mqtt) {
     if (mqttClient.begin()) {
       Serial.println("✅ MQTT client initialized");
     } else {
@@ -174,28 +117,79 @@ void setupSystem() {
     }
   }
   
+  // Alerts are delivered by per-sink workers with retry and backoff
+  notifications.begin();
+  reportStage("Service modules", stageMark);
+  
   // Configure time for timestamps
   configTime(0, 0, "pool.ntp.org", "time.nist.gov");
   
-  // Initialize system state
-  systemState.currentData.timestamp = millis();
-  systemState.currentData.status = "System Ready ✅";
+  // Initialize system state (a restored snapshot keeps its last reading)
+  if (!rtcSnapshot.wasRestored()) {
+    systemState.currentData.timestamp = millis();
+    systemState.currentData.status = "System Ready ✅";
+  }
   systemState.piConnected = false;
   
   // Enable watchdog timer for system stability
   esp_task_wdt_init(10, true);
   esp_task_wdt_add(NULL);
   
-  digitalWrite(config.hardware.status_led_pin, LOW);
+  digitalWrite(config().hardware.status_led_pin, LOW);
+  
+  // Apply staged config edits; persist once they settle
+  housekeeping.add("config", 250, []() { configStore.handle(); });
+
+  // Format and print trace records; producers never touch the serial port
+  housekeeping.add("trace", 20, []() { traceLog.drainToSerial(16); });
+
+  // Deferred restarts requested by a command
+  housekeeping.add("commands", 250, []() { commands.handle(); });
+  
+  // Persist buffered samples and events so exports stay current; checked
+  // often so the sensor task's early-flush requests are served promptly
+  housekeeping.add("flush", 100, []() { dataManager.handle(); });
+  
+  // System health monitoring
+  housekeeping.add("health", 30000, []() {
+    HEAP_TAG("health");
+    Serial.println("💓 System Health - Uptime: " + systemState.getFormattedUptime() +
+                  " | Free RAM: " + String(ESP.getFreeHeap()) + " bytes" +
+                  " | Pi Connected: " + String(systemState.isPiConnected() ? "Yes" : "No") +
+                  " | Distance: " + String(systemState.currentData.distance, 1) + "cm");
+    Serial.println("💓 " + tasks.healthSummary());
+    Serial.println("💓 Notifications - " + notifications.summary());
+    if (config().telegram.enable_telegram) {
+      Serial.println("💓 " + telegramBot.stats() + " | Min free heap: " + String(ESP.getMinFreeHeap()) + " bytes");
+    }
+    if (config().mqtt.enable_mqtt) {
+      Serial.println("💓 " + mqttClient.telemetryStats());
+    }
+    Serial.println("💓 Reports - " + tasks.reportSummary());
+    Serial.println("💓 Jitter - " + tasks.schedulerSummary() + " | " + housekeeping.stats());
+    Serial.println("💓 Heap - " + heapProfiler.summary());
+    if (webServer.isRunning()) {
+      Serial.println("💓 Web - " + admission.summary());
+      Serial.println("💓 Web memory - " + requestArena.summary() + " | " + GzipStream::summary());
+    }
+  }, 30000);
+  
+  // Hand ingestion and networking over to their pinned tasks
+  tasks.begin();
+  reportStage("Tasks", stageMark);
+
+  // Every module object exists now; later requests for arena space are bugs
+  bootArena.seal();
   systemInitialized = true;
   
-  Serial.println("\n✅ System initialization complete!");
-  String dashboardIP = (systemState.wifiMode == "Station") ? WiFi.localIP().toString() : WiFi.softAPIP().toString();
-  Serial.println("📡 Dashboard available at: http://" + dashboardIP);
+  Serial.println("\n✅ System initialization complete in " + String(millis()) + "ms");
+  if (wifiModule.isAccessPointActive()) {
+    Serial.println("📡 Dashboard available at: http://" + WiFi.softAPIP().toString());
+  }
   Serial.println("=================================\n");
 }
 
-// Main loop
+// Main loop: housekeeping only, ingestion and networking run in their own tasks
 void loop() {
   // Feed the watchdog to prevent system reset
   esp_task_wdt_reset();
@@ -203,43 +197,8 @@ void loop() {
   // Update system uptime
   systemState.updateUptime();
   
-  // Process sensor data from Raspberry Pi
-  processPiSensorData();
-  
-  // Process alerts and notifications
-  processAlerts();
-  
-  // Handle Telegram messages
-  if (config.telegram.enable_telegram) {
-    telegramBot.handleMessages();
-  }
-  
-  // Handle MQTT client
-  if (config.mqtt.enable_mqtt) {
-    mqttClient.handleClient();
-  }
-  
-  // System status LED blink (slow blink when normal, fast when alert)
-  static unsigned long lastBlink = 0;
-  unsigned long blinkInterval = systemState.currentData.object_detected ? 200 : 1000;
-  
-  if (millis() - lastBlink > blinkInterval) {
-    digitalWrite(config.hardware.status_led_pin, !digitalRead(config.hardware.status_led_pin));
-    lastBlink = millis();
-  }
-  
-  // System health monitoring
-  static unsigned long lastHealthCheck = 0;
-  if (millis() - lastHealthCheck > 30000) { // Every 30 seconds
-    Serial.println("💓 System Health - Uptime: " + systemState.getFormattedUptime() +
-                  " | Free RAM: " + String(ESP.getFreeHeap()) + " bytes" +
-                  " | Pi Connected: " + String(systemState.isPiConnected() ? "Yes" : "No") +
-                  " | Distance: " + String(systemState.currentData.distance, 1) + "cm");
-    lastHealthCheck = millis();
-  }
-  
-  // Brief delay to prevent overwhelming the system
-  delay(50);
+  // Sleep until the next housekeeping job is due
+  vTaskDelay(pdMS_TO_TICKS(housekeeping.run()));
 }
 
 // Setup function
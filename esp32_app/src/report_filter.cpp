@@ -0,0 +1,68 @@
+#include "report_filter.h"
+
+ReportFilter::ReportFilter(const char* name)
+    : name(name), hasReference(false), referenceDistance(0), referenceState(0),
+      lastReport(0), sent{}, suppressed(0) {}
+
+uint8_t ReportFilter::stateOf(const SensorData& data) {
+  return (data.object_detected ? 0x01 : 0) | (data.alert_active ? 0x02 : 0) | (uint8_t)(data.mode << 2);
+}
+
+ReportReason ReportFilter::evaluate(const SensorData& data, float deadband,
+                                    unsigned long heartbeatMs, unsigned long now) {
+  uint8_t state = stateOf(data);
+  ReportReason reason = ReportReason::None;
+
+  if (!hasReference) {
+    reason = ReportReason::First;
+  } else if (state != referenceState) {
+    reason = ReportReason::State;
+  } else if (fabsf(data.distance - referenceDistance) > deadband) {
+    reason = ReportReason::Change;
+  } else if (now - lastReport >= heartbeatMs) {
+    reason = ReportReason::Heartbeat;
+  }
+
+  if (reason == ReportReason::None) {
+    suppressed++;
+    return reason;
+  }
+
+  // Measure later changes against what the receiver last saw, so a slow
+  // drift is still reported once it adds up to the deadband
+  hasReference = true;
+  referenceDistance = data.distance;
+  referenceState = state;
+  lastReport = now;
+  sent[(int)reason]++;
+  return reason;
+}
+
+unsigned long ReportFilter::sentCount() const {
+  unsigned long total = 0;
+  for (int i = 1; i < REASON_COUNT; i++) total += sent[i];
+  return total;
+}
+
+const char* ReportFilter::reasonName(ReportReason reason) {
+  switch (reason) {
+    case ReportReason::First:     return "first";
+    case ReportReason::Change:    return "change";
+    case ReportReason::State:     return "state";
+    case ReportReason::Heartbeat: return "heartbeat";
+    default:                      return "none";
+  }
+}
+
+String ReportFilter::stats() const {
+  unsigned long total = sentCount();
+  unsigned long evaluated = total + suppressed;
+  unsigned long share = evaluated ? (suppressed * 100UL) / evaluated : 0;
+
+  String out = String(name) + " sent " + String(total) + " (";
+  for (int i = 1; i < REASON_COUNT; i++) {
+    if (i > 1) out += ", ";
+    out += String(reasonName((ReportReason)i)) + " " + String(sent[i]);
+  }
+  return out + "), suppressed " + String(suppressed) + " (" + String(share) + "%)";
+}
@@ -0,0 +1,74 @@
+#include "request_arena.h"
+
+RequestArena requestArena;
+
+size_t RequestArena::Lease::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t RequestArena::Lease::write(const uint8_t* data, size_t length) {
+  if (overflow) return 0;
+  if (length > REQUEST_ARENA_SLAB_SIZE - used) {
+    overflow = true;
+    return 0;
+  }
+  memcpy(slab + used, data, length);
+  used += length;
+  return length;
+}
+
+void* RequestArena::Lease::allocate(size_t length, size_t align) {
+  size_t start = (used + align - 1) & ~(align - 1);
+  if (overflow || start + length > REQUEST_ARENA_SLAB_SIZE) {
+    overflow = true;
+    return nullptr;
+  }
+  used = start + length;
+  return slab + start;
+}
+
+void RequestArena::Lease::release() {
+  if (!leased) return;
+  for (Cleanup* cleanup = cleanups; cleanup; cleanup = cleanup->next) {
+    cleanup->destroy(cleanup->object);
+  }
+  cleanups = nullptr;
+  requestArena.returned(*this);
+}
+
+RequestArena::Lease* RequestArena::acquire(bool reserved) {
+  if (!reserved && leasedCount + REQUEST_ARENA_RESERVED >= REQUEST_ARENA_SLABS) {
+    rejectCount++;
+    return nullptr;
+  }
+  for (int i = 0; i < REQUEST_ARENA_SLABS; i++) {
+    Lease& lease = leases[i];
+    if (lease.leased) continue;
+
+    lease.slab = storage[i];
+    lease.used = 0;
+    lease.overflow = false;
+    lease.cleanups = nullptr;
+    lease.leased = true;
+    leasedCount++;
+    if (leasedCount > peakLeased) peakLeased = leasedCount;
+    return &lease;
+  }
+  rejectCount++;
+  return nullptr;
+}
+
+void RequestArena::returned(Lease& lease) {
+  if (lease.used > peakUsed) peakUsed = lease.used;
+  if (lease.overflow) overflowCount++;
+  lease.leased = false;
+  lease.slab = nullptr;
+  lease.used = 0;
+  leasedCount--;
+}
+
+String RequestArena::summary() const {
+  return "slabs " + String(peakLeased) + "/" + String(REQUEST_ARENA_SLABS) + " at peak, largest " +
+         String(peakUsed) + "/" + String(REQUEST_ARENA_SLAB_SIZE) + " B, " + String(rejectCount) +
+         " busy, " + String(overflowCount) + " too large";
+}
@@ -0,0 +1,168 @@
+#include "rtc_snapshot.h"
+#include <esp_attr.h>
+#include <esp_system.h>
+
+#define RTC_SNAPSHOT_MAGIC   0x53555256  // "SURV"
+#define RTC_SNAPSHOT_VERSION 2
+#define RTC_HISTORY_SIZE     100
+
+struct RtcSample {
+  uint32_t timestamp;  // millis() when taken
+  float distance;
+  uint8_t flags;       // bit0 object_detected, bit1 alert_active
+  uint8_t mode;
+  uint16_t check;      // guards against a slot torn by the reset
+};
+
+struct RtcHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t head;           // next slot to write
+  uint16_t count;
+  uint16_t reserved;
+  uint32_t savedAt;        // millis() at the last update
+  uint32_t lastAlertTime;
+  uint32_t bootCount;
+  uint32_t sampleCount;
+  uint32_t alertCount;
+  uint32_t generation;     // bumped on every write; the newer valid copy wins
+  uint32_t checksum;       // over all fields above
+};
+
+// Not zeroed by the startup code, so contents survive a warm reset. Updates
+// go to the copy not in use, so a reset part way through one leaves the
+// previous header intact.
+RTC_NOINIT_ATTR static RtcHeader rtcHeaders[2];
+RTC_NOINIT_ATTR static RtcSample rtcSamples[RTC_HISTORY_SIZE];
+
+// Working copy in normal RAM and the index of the last copy written
+static RtcHeader rtcHeader;
+static uint8_t rtcActive = 0;
+
+RtcSnapshot rtcSnapshot;
+
+static uint32_t checksum(const uint8_t* data, size_t length) {
+  // FNV-1a
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ data[i]) * 16777619u;
+  }
+  return hash;
+}
+
+static uint32_t headerChecksum(const RtcHeader& header) {
+  return checksum((const uint8_t*)&header, offsetof(RtcHeader, checksum));
+}
+
+static bool headerValid(const RtcHeader& header) {
+  return header.magic == RTC_SNAPSHOT_MAGIC &&
+         header.version == RTC_SNAPSHOT_VERSION &&
+         header.count <= RTC_HISTORY_SIZE &&
+         header.head < RTC_HISTORY_SIZE &&
+         header.checksum == headerChecksum(header);
+}
+
+// Writes the working copy over the older RTC copy, then makes it current
+static void commitHeader() {
+  rtcHeader.generation++;
+  rtcHeader.checksum = headerChecksum(rtcHeader);
+  rtcActive ^= 1;
+  rtcHeaders[rtcActive] = rtcHeader;
+}
+
+static uint16_t sampleChecksum(const RtcSample& sample) {
+  uint32_t hash = checksum((const uint8_t*)&sample, offsetof(RtcSample, check));
+  return (hash >> 16) ^ (hash & 0xFFFF);
+}
+
+bool RtcSnapshot::restore(SystemState& state) {
+  esp_reset_reason_t reason = esp_reset_reason();
+  bool warmBoot = reason != ESP_RST_POWERON && reason != ESP_RST_BROWNOUT && reason != ESP_RST_UNKNOWN;
+  bool valid[2] = {warmBoot && headerValid(rtcHeaders[0]), warmBoot && headerValid(rtcHeaders[1])};
+  if (valid[0] && valid[1]) {
+    rtcActive = (int32_t)(rtcHeaders[1].generation - rtcHeaders[0].generation) > 0 ? 1 : 0;
+  } else {
+    rtcActive = valid[1] ? 1 : 0;
+  }
+
+  if (!valid[rtcActive]) {
+    memset(&rtcHeader, 0, sizeof(rtcHeader));
+    rtcHeader.magic = RTC_SNAPSHOT_MAGIC;
+    rtcHeader.version = RTC_SNAPSHOT_VERSION;
+    rtcHeader.bootCount = 1;
+    // Both copies, so a stale one can't outrank the fresh start
+    rtcActive = 0;
+    commitHeader();
+    commitHeader();
+    state.bootCount = 1;
+    restored = false;
+    return false;
+  }
+
+  rtcHeader = rtcHeaders[rtcActive];
+
+  // millis() restarted at zero; shift stored times so that
+  // "millis() - t" gives the same age it had when last saved
+  uint32_t shift = millis() - rtcHeader.savedAt;
+
+  int oldest = (rtcHeader.head - rtcHeader.count + RTC_HISTORY_SIZE) % RTC_HISTORY_SIZE;
+  restoredCount = 0;
+  for (int i = 0; i < rtcHeader.count; i++) {
+    const RtcSample& sample = rtcSamples[(oldest + i) % RTC_HISTORY_SIZE];
+    if (sample.check != sampleChecksum(sample)) continue;
+
+    SensorData data;
+    data.distance = sample.distance;
+    data.timestamp = sample.timestamp + shift;
+    data.object_detected = sample.flags & 0x01;
+    data.alert_active = sample.flags & 0x02;
+    data.mode = sample.mode;
+    data.status = data.object_detected ? "Object Detected 🚨" : "Normal ✅";
+
+    state.history[state.historyIndex] = data;
+    state.historyIndex = (state.historyIndex + 1) % SystemState::HISTORY_SIZE;
+    if (state.historyCount < SystemState::HISTORY_SIZE) {
+      state.historyCount++;
+    }
+    state.currentData = data;
+    restoredCount++;
+  }
+
+  if (rtcHeader.lastAlertTime != 0) {
+    state.lastAlertTime = rtcHeader.lastAlertTime + shift;
+  }
+  state.sampleCount = rtcHeader.sampleCount;
+  state.alertCount = rtcHeader.alertCount;
+  state.bootCount = ++rtcHeader.bootCount;
+
+  rtcHeader.savedAt = millis();
+  rtcHeader.lastAlertTime = state.lastAlertTime;
+  commitHeader();
+
+  restored = true;
+  return true;
+}
+
+void RtcSnapshot::recordSample(const SensorData& data) {
+  RtcSample& slot = rtcSamples[rtcHeader.head];
+  slot.timestamp = data.timestamp;
+  slot.distance = data.distance;
+  slot.flags = (data.object_detected ? 0x01 : 0) | (data.alert_active ? 0x02 : 0);
+  slot.mode = data.mode;
+  slot.check = sampleChecksum(slot);
+
+  rtcHeader.head = (rtcHeader.head + 1) % RTC_HISTORY_SIZE;
+  if (rtcHeader.count < RTC_HISTORY_SIZE) {
+    rtcHeader.count++;
+  }
+  rtcHeader.sampleCount++;
+  rtcHeader.savedAt = millis();
+  commitHeader();
+}
+
+void RtcSnapshot::sync(const SystemState& state) {
+  rtcHeader.savedAt = millis();
+  rtcHeader.lastAlertTime = state.lastAlertTime;
+  rtcHeader.alertCount = state.alertCount;
+  commitHeader();
+}
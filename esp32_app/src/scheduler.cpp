@@ -0,0 +1,95 @@
+#include "scheduler.h"
+#include "heap_profiler.h"
+#include <limits.h>
+
+Scheduler::Scheduler(const char* name) : name(name), count(0), zeroHeapFrom(0) {}
+
+int Scheduler::add(const char* jobName, unsigned long periodMs, JobFn fn, unsigned long firstDelayMs) {
+  if (count == MAX_JOBS) {
+    Serial.println("❌ Scheduler " + String(name) + " full, job not added: " + String(jobName));
+    return -1;
+  }
+
+  Job& job = jobs[count];
+  job.name = jobName;
+  job.period = periodMs;
+  job.deadline = millis() + firstDelayMs;
+  job.fn = fn;
+  job.runs = 0;
+  job.totalLate = 0;
+  job.maxLate = 0;
+  job.heapRuns = 0;
+  return count++;
+}
+
+void Scheduler::setPeriod(int id, unsigned long periodMs) {
+  if (id < 0 || id >= count) return;
+  jobs[id].period = periodMs;
+}
+
+unsigned long Scheduler::run() {
+  unsigned long now = millis();
+
+  for (int i = 0; i < count; i++) {
+    Job& job = jobs[i];
+    // Signed difference keeps the comparison correct across millis() wrap
+    long late = (long)(now - job.deadline);
+    if (late < 0) continue;
+
+#ifdef ZERO_HEAP
+    uint32_t allocations = HeapProfiler::taskAllocations();
+    job.fn();
+    if (HeapProfiler::taskAllocations() != allocations) heapUsed(job);
+#else
+    job.fn();
+#endif
+    job.runs++;
+    job.totalLate += late;
+    if ((unsigned long)late > job.maxLate) job.maxLate = late;
+
+    // Stay on the original grid; after a long stall skip ahead instead of
+    // running the job back to back to catch up
+    job.deadline += job.period;
+    if ((long)(now - job.deadline) >= 0) {
+      job.deadline = now + job.period;
+    }
+    now = millis();
+  }
+
+  long sleep = LONG_MAX;
+  for (int i = 0; i < count; i++) {
+    long remaining = (long)(jobs[i].deadline - now);
+    if (remaining < sleep) sleep = remaining;
+  }
+  return sleep < 0 ? 0 : (unsigned long)sleep;
+}
+
+void Scheduler::requireZeroHeap(unsigned long settleMs) {
+#ifdef ZERO_HEAP
+  zeroHeapFrom = millis() + settleMs;
+  if (zeroHeapFrom == 0) zeroHeapFrom = 1;
+#endif
+}
+
+void Scheduler::heapUsed(Job& job) {
+  job.heapRuns++;
+  if (zeroHeapFrom == 0 || (long)(millis() - zeroHeapFrom) < 0) return;
+
+  // Deliberately loud: a steady-state allocation is the bug this build hunts
+  Serial.printf("❌ Heap allocation in %s/%s after boot (tag %s)\n", name, job.name,
+                HeapProfiler::taskLastTag());
+  Serial.flush();
+  abort();
+}
+
+String Scheduler::stats() const {
+  String out = String(name) + ":";
+  for (int i = 0; i < count; i++) {
+    const Job& job = jobs[i];
+    unsigned long avg = job.runs ? job.totalLate / job.runs : 0;
+    out += " " + String(job.name) + " " + String(job.runs) + "x late avg " +
+           String(avg) + "/max " + String(job.maxLate) + "ms";
+    if (job.heapRuns) out += " heap " + String(job.heapRuns) + "x";
+  }
+  return out;
+}
@@ -46,6 +46,7 @@ void SystemState::addToHistory(const SensorData& data) {
     if (historyCount < HISTORY_SIZE) {
       historyCount++;
     }
+    sampleCount++;
   }
 }
 
@@ -104,7 +105,7 @@ bool SystemState::hasRecentAlert() const {
 }
 
 bool SystemState::isPiConnected() const {
-  return (millis() - lastPiHeartbeat) < config.raspberry_pi.connection_timeout;
+  return (millis() - lastPiHeartbeat) < config().raspberry_pi.connection_timeout;
 }
 
 float SystemState::getAverageDistance(int samples) const {
@@ -131,12 +132,14 @@ int SystemState::getDetectionCount(int timeWindow) const {
     return 0;
   }
   
-  unsigned long windowStart = millis() - (timeWindow * 1000);
+  unsigned long now = millis();
+  unsigned long window = (unsigned long)timeWindow * 1000;
   int count = 0;
   
   for (int i = 0; i < historyCount; i++) {
     SensorData data = getHistory(i);
-    if (data.timestamp >= windowStart && data.object_detected) {
+    // Age-based so it stays correct across millis() wrap and restored history
+    if (now - data.timestamp <= window && data.object_detected) {
       count++;
     }
   }
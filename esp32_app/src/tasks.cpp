@@ -0,0 +1,237 @@
+#include "tasks.h"
+#include <esp_task_wdt.h>
+#include "config.h"
+#include "state.h"
+#include "rtc_snapshot.h"
+#include "uart_replay.h"
+#include "heap_profiler.h"
+#include "../lib/DataManager/DataManager.h"
+#include "../lib/PiCommunication Module/PiCommunication.h"
+#include "../lib/WifiModule/WifiModule.h"
+#include "../lib/MqttModule/MqttModule.h"
+#include "../lib/NotificationModule/NotificationModule.h"
+
+TaskRunner tasks;
+
+TaskRunner::TaskRunner()
+    : sensorHandle(nullptr), networkHandle(nullptr), readings(nullptr), readingsDropped(0),
+      sensorJobs("sensor"), networkJobs("network"), mqttReport("mqtt"), webhookReport("webhook") {}
+
+bool TaskRunner::begin() {
+  readings = xQueueCreateStatic(READING_QUEUE_DEPTH, sizeof(SensorData), readingStorage, &readingQueue);
+  setupSensorJobs();
+  setupNetworkJobs();
+
+  if (xTaskCreatePinnedToCore(sensorTask, "sensor", SENSOR_STACK, this,
+                              SENSOR_PRIORITY, &sensorHandle, APP_CPU_NUM) != pdPASS) {
+    Serial.println("❌ Failed to start sensor task");
+    return false;
+  }
+
+  if (xTaskCreatePinnedToCore(networkTask, "network", NETWORK_STACK, this,
+                              NETWORK_PRIORITY, &networkHandle, PRO_CPU_NUM) != pdPASS) {
+    Serial.println("❌ Failed to start network task");
+    return false;
+  }
+
+  Serial.println("✅ Tasks started (sensor: core " + String(APP_CPU_NUM) +
+                 ", network: core " + String(PRO_CPU_NUM) + ")");
+  return true;
+}
+
+void TaskRunner::sensorTask(void* arg) {
+  static_cast<TaskRunner*>(arg)->runSensor();
+}
+
+void TaskRunner::networkTask(void* arg) {
+  static_cast<TaskRunner*>(arg)->runNetwork();
+}
+
+void TaskRunner::setupSensorJobs() {
+  unsigned long bootSamples = systemState.sampleCount;
+
+  sensorJobs.add("pi", PI_POLL_MS, [this, bootSamples, lastSample = bootSamples,
+                                     firstSampleReported = false]() mutable {
+    // A running replay feeds its own scratch state, beside the live UART
+    piComm.handle();
+    uartReplay.handle();
+
+    if (systemState.sampleCount != lastSample) {
+      lastSample = systemState.sampleCount;
+      queueReading();
+    }
+
+    evaluateAlert(systemState, true);
+    if (SystemState* replayed = uartReplay.state()) {
+      unsigned long alertStart = micros();
+      evaluateAlert(*replayed, false);
+      uartReplay.noteAlert(micros() - alertStart);
+    }
+
+    // The sensor task owns lastAlertTime and the counters, so it also
+    // keeps their RTC copy current
+    rtcSnapshot.sync(systemState);
+
+    if (!firstSampleReported && systemState.sampleCount != bootSamples) {
+      firstSampleReported = true;
+      Serial.printf("⏱️ First sample at t=%lums\n", millis());
+    }
+  });
+
+  sensorJobs.add("pi-timeout", PI_TIMEOUT_CHECK_MS, [this]() { checkPiTimeout(); });
+
+  // Status LED: slow blink when normal, fast when an object is detected
+  static int ledJob = -1;
+  ledJob = sensorJobs.add("led", 1000, [this]() {
+    digitalWrite(config().hardware.status_led_pin, !digitalRead(config().hardware.status_led_pin));
+    sensorJobs.setPeriod(ledJob, systemState.currentData.object_detected ? 200 : 1000);
+  });
+
+  // Ingestion, detection and alerting run on static buffers only
+  sensorJobs.requireZeroHeap(ZERO_HEAP_SETTLE_MS);
+}
+
+void TaskRunner::runSensor() {
+  esp_task_wdt_add(NULL);
+
+  for (;;) {
+    esp_task_wdt_reset();
+    vTaskDelay(pdMS_TO_TICKS(sensorJobs.run()));
+  }
+}
+
+void TaskRunner::queueReading() {
+  // Copied here, on the task that writes currentData, so telemetry never
+  // sees a sample half updated. Never blocks: a stalled network task loses
+  // the oldest readings, not the sensor task's time.
+  if (xQueueSend(readings, &systemState.currentData, 0) == pdTRUE) return;
+  SensorData oldest;
+  xQueueReceive(readings, &oldest, 0);
+  readingsDropped++;
+  xQueueSend(readings, &systemState.currentData, 0);
+}
+
+void TaskRunner::checkPiTimeout() {
+  bool connected = systemState.isPiConnected();
+  if (connected == systemState.piConnected) return;
+
+  systemState.piConnected = connected;
+  Serial.println(connected ? "✓ Pi link up" : "✗ Pi heartbeat timed out");
+  dataManager.logEvent(connected ? "Pi connected" : "Pi timeout");
+  // Same key for both states: a flapping link coalesces to its latest state
+  notifications.notify(NotifyPriority::Normal, "pi-link",
+                       connected ? "✓ Raspberry Pi link restored" : "✗ Raspberry Pi heartbeat lost");
+}
+
+void TaskRunner::evaluateAlert(SystemState& state, bool deliver) {
+  HEAP_TAG("alert");
+  if (!state.currentData.object_detected) return;
+
+  unsigned long now = millis();
+  if (now - state.lastAlertTime <= config().system.alert_cooldown) return;
+
+  // Cooldown is decided here, not by the notifiers, so a slow or failed
+  // delivery can't hold back the next detection
+  float distance = state.currentData.distance;
+  state.lastAlertTime = now;
+  state.alertCount++;
+
+  // Every alert is delivered on its own, so no coalescing key
+  char text[48];
+  snprintf(text, sizeof(text), "🚨 Object detected at %.1fcm", distance);
+  if (!deliver) return;
+  if (!notifications.notify(NotifyPriority::High, nullptr, text, distance)) {
+    Serial.println("🔔 Alert raised (no notification sink accepted it)");
+  }
+
+  snprintf(text, sizeof(text), "Alert %.1fcm", distance);
+  dataManager.logEvent(text);
+}
+
+void TaskRunner::setupNetworkJobs() {
+  networkJobs.add("wifi", WIFI_HANDLE_MS, []() {
+    static bool readyReported = false;
+    wifiModule.handle();
+
+    if (!readyReported && wifiModule.isConnected()) {
+      readyReported = true;
+      Serial.println("⏱️ WiFi ready at t=" + String(wifiModule.connectedSince()) + "ms");
+      Serial.println("📡 Dashboard available at: http://" + WiFi.localIP().toString());
+    }
+  });
+
+  // The enable flags are re-read on every run so the settings page can
+  // switch MQTT off without a restart
+  networkJobs.add("mqtt", MQTT_LOOP_MS, []() {
+    if (config().mqtt.enable_mqtt) {
+      mqttClient.handleClient();
+    }
+  });
+
+  networkJobs.add("telemetry", TELEMETRY_CHECK_MS, [this]() { reportReadings(); });
+
+  networkJobs.add("mqtt-reconnect", MQTT_RECONNECT_MS, []() {
+    if (config().mqtt.enable_mqtt && !mqttClient.isConnected()) {
+      mqttClient.reconnect();
+    }
+  }, MQTT_RECONNECT_MS);
+}
+
+void TaskRunner::reportReadings() {
+  HEAP_TAG("telemetry");
+  SensorData data;
+  while (xQueueReceive(readings, &data, 0) == pdTRUE) {
+    reportReading(data);
+  }
+}
+
+void TaskRunner::reportReading(const SensorData& data) {
+  const AppConfig& cfg = config();
+  unsigned long now = millis();
+  float deadband = cfg.report.deadband;
+  unsigned long heartbeat = cfg.report.heartbeat * 1000UL;
+
+  // A channel that is switched off starts over with a full report
+  if (cfg.mqtt.enable_mqtt && cfg.mqtt.enable_telemetry) {
+    if (mqttReport.evaluate(data, deadband, heartbeat, now) != ReportReason::None) {
+      mqttClient.queueTelemetry(data);
+    }
+  } else {
+    mqttReport.reset();
+  }
+
+  if (cfg.webhook.report_readings) {
+    ReportReason reason = webhookReport.evaluate(data, deadband, heartbeat, now);
+    if (reason != ReportReason::None) {
+      // Coalesced, so an unreachable endpoint only ever holds the latest reading
+      char text[48];
+      snprintf(text, sizeof(text), "Reading %.1fcm (%s)", data.distance,
+               ReportFilter::reasonName(reason));
+      notifications.notifySink("webhook", NotifyPriority::Low, "reading", text, data.distance);
+    }
+  } else {
+    webhookReport.reset();
+  }
+}
+
+String TaskRunner::reportSummary() const {
+  return mqttReport.stats() + " | " + webhookReport.stats() + " | queue dropped " + String(readingsDropped);
+}
+
+void TaskRunner::runNetwork() {
+  for (;;) {
+    vTaskDelay(pdMS_TO_TICKS(networkJobs.run()));
+  }
+}
+
+String TaskRunner::schedulerSummary() const {
+  return sensorJobs.stats() + " | " + networkJobs.stats();
+}
+
+String TaskRunner::healthSummary() const {
+  if (!sensorHandle || !networkHandle) return "Tasks not running";
+
+  // High-water marks are the smallest free stack seen, in bytes on ESP32
+  return "Stack free - sensor: " + String(uxTaskGetStackHighWaterMark(sensorHandle)) +
+         " | network: " + String(uxTaskGetStackHighWaterMark(networkHandle));
+}
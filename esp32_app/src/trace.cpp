@@ -0,0 +1,159 @@
+#include "trace.h"
+
+TraceLog traceLog;
+
+static const char* const TRACE_FORMATS[] = {
+#define TRACE_EVENT(name, level, format) format,
+#include "trace_events.h"
+#undef TRACE_EVENT
+};
+
+static const char LEVEL_TAGS[] = { 'D', 'I', 'W', 'E' };
+
+TraceLog::TraceLog() : head(0), tail(0), lost(0) {
+  for (Slot& slot : slots) slot.seq.store(0, std::memory_order_relaxed);
+}
+
+void TraceLog::pack(TraceRecord& entry, uint8_t& used, int value) {
+  if (used < 2) entry.args[used++] = (uint32_t)value;
+}
+
+void TraceLog::pack(TraceRecord& entry, uint8_t& used, unsigned value) {
+  if (used < 2) entry.args[used++] = value;
+}
+
+void TraceLog::pack(TraceRecord& entry, uint8_t& used, float value) {
+  if (used < 2) memcpy(&entry.args[used++], &value, sizeof(value));
+}
+
+void TraceLog::pack(TraceRecord& entry, uint8_t&, const char* text) {
+  strlcpy(entry.text, text ? text : "", sizeof(entry.text));
+}
+
+void TraceLog::commit(TraceRecord& entry) {
+  entry.time = millis();
+  entry.core = xPortGetCoreID();
+
+  uint32_t ticket = head.fetch_add(1, std::memory_order_relaxed);
+  Slot& slot = slots[ticket & (CAPACITY - 1)];
+  // Mark the slot busy before touching it. A release store would only order
+  // the writes before it; the fence keeps the entry copy from moving above
+  // it, so a reader that copied any of the new entry sees seq changed when
+  // it checks again.
+  slot.seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.entry = entry;
+  slot.seq.store(ticket + 1, std::memory_order_release);
+}
+
+bool TraceLog::read(uint32_t ticket, TraceRecord& out) const {
+  const Slot& slot = slots[ticket & (CAPACITY - 1)];
+  if (slot.seq.load(std::memory_order_acquire) != ticket + 1) return false;
+  out = slot.entry;
+  // A writer lapping the reader changes seq; discard the torn copy
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return slot.seq.load(std::memory_order_relaxed) == ticket + 1;
+}
+
+void TraceLog::drainToSerial(int maxRecords) {
+  TraceRecord entry;
+  for (int i = 0; i < maxRecords; i++) {
+    uint32_t newest = head.load(std::memory_order_acquire);
+    if (tail == newest) return;
+
+    // Overwritten before we got to them. Skip to half a ring behind the
+    // writers so the next records aren't overwritten while we print, and
+    // report the gap directly instead of adding to the ring.
+    if (newest - tail > CAPACITY) {
+      uint32_t skipped = newest - CAPACITY / 2 - tail;
+      lost += skipped;
+      tail += skipped;
+
+      TraceRecord gap = {};
+      gap.time = millis();
+      gap.id = (uint16_t)TraceId::TRACE_LOST;
+      gap.level = TRACE_LEVELS[gap.id];
+      gap.core = xPortGetCoreID();
+      gap.args[0] = skipped;
+      char line[TRACE_LINE_LENGTH];
+      format(gap, line, sizeof(line));
+      Serial.println(line);
+      continue;
+    }
+
+    if (!read(tail, entry)) {
+      // Still being written: try again next time. Overwritten meanwhile:
+      // the lap check above skips it on the next pass.
+      return;
+    }
+    tail++;
+
+    if (entry.level >= TRACE_SERIAL_LEVEL) {
+      char line[TRACE_LINE_LENGTH];
+      format(entry, line, sizeof(line));
+      Serial.println(line);
+    }
+  }
+}
+
+size_t TraceLog::snapshot(TraceRecord* out, size_t maxRecords) const {
+  uint32_t newest = head.load(std::memory_order_acquire);
+  uint32_t available = min(newest, (uint32_t)CAPACITY);
+  uint32_t first = newest - min((uint32_t)maxRecords, available);
+
+  size_t count = 0;
+  for (uint32_t ticket = first; ticket != newest; ticket++) {
+    if (read(ticket, out[count])) count++;
+  }
+  return count;
+}
+
+const char* TraceLog::formatOf(uint16_t id) {
+  return id < (uint16_t)TraceId::Count ? TRACE_FORMATS[id] : "unknown trace event %u %u %s";
+}
+
+size_t TraceLog::format(const TraceRecord& entry, char* line, size_t size) {
+  int length = snprintf(line, size, "[%7lu.%03lu] %c%u ",
+                        (unsigned long)(entry.time / 1000), (unsigned long)(entry.time % 1000),
+                        LEVEL_TAGS[entry.level & 3], entry.core);
+
+  // Apply the format one conversion at a time, feeding args in order
+  const char* p = formatOf(entry.id);
+  uint8_t used = 0;
+  while (*p && length < (int)size - 1) {
+    if (*p != '%') {
+      line[length++] = *p++;
+      continue;
+    }
+    p++;
+    char conversion = *p ? *p++ : '\0';
+    uint32_t arg = used < 2 ? entry.args[used] : 0;
+    size_t room = size - length;
+    int written = 0;
+    switch (conversion) {
+      case 'd': written = snprintf(line + length, room, "%d", (int)arg); used++; break;
+      case 'u': written = snprintf(line + length, room, "%u", (unsigned)arg); used++; break;
+      case 'x': written = snprintf(line + length, room, "%x", (unsigned)arg); used++; break;
+      case 'c': written = snprintf(line + length, room, "%c", (char)arg); used++; break;
+      case 'f': {
+        float value;
+        memcpy(&value, &arg, sizeof(value));
+        written = snprintf(line + length, room, "%.1f", value);
+        used++;
+        break;
+      }
+      case 's': {
+        char text[TRACE_TEXT_LENGTH + 1];
+        memcpy(text, entry.text, TRACE_TEXT_LENGTH);
+        text[TRACE_TEXT_LENGTH] = '\0';
+        written = snprintf(line + length, room, "%s", text);
+        break;
+      }
+      case '%': written = snprintf(line + length, room, "%%"); break;
+      default: break;
+    }
+    length = min(length + max(written, 0), (int)size - 1);
+  }
+  line[length] = '\0';
+  return length;
+}
@@ -0,0 +1,166 @@
+#include "uart_replay.h"
+#include <SPIFFS.h>
+#include <new>
+#include "heap_profiler.h"
+#include "../lib/PiCommunication Module/PiCommunication.h"
+
+UartReplay uartReplay;
+
+UartReplay::UartReplay()
+    : startRequested(false), stopRequested(false), requestedSpeed(1), active(false), speed(1),
+      hasLine(false), lineAt(0), startedAt(0), finishedAt(0), lines(0), skipped(0), lastAt(0),
+      maxLag(0), behindLine(0), behindRate(0), parseTotal(0), parseMax(0), alertTotal(0),
+      alertMax(0), alertRuns(0), replayState(nullptr), replayPi(nullptr) {}
+
+bool UartReplay::start(float speed) {
+  if (active || startRequested) return false;
+  requestedSpeed = speed;
+  stopRequested = false;
+  startRequested = true;
+  return true;
+}
+
+void UartReplay::begin() {
+  // Opening the capture and logging allocate; the replayed lines must not
+  HEAP_EXEMPT();
+  startRequested = false;
+  file = SPIFFS.open(REPLAY_FILE, FILE_READ);
+  if (!file) {
+    Serial.println("❌ Replay: " REPLAY_FILE " not found (upload one with POST /api/replay)");
+    return;
+  }
+
+  // Replayed readings land in their own state, as the benchmarks' do: the
+  // live history, storage and alerts never see them
+  replayState = new (std::nothrow) SystemState();
+  replayPi = replayState ? new (std::nothrow) PiCommunication(*replayState, false) : nullptr;
+  if (!replayPi) {
+    delete replayState;
+    replayState = nullptr;
+    file.close();
+    Serial.println("❌ Replay: out of memory");
+    return;
+  }
+
+  speed = requestedSpeed;
+  lines = skipped = 0;
+  lastAt = 0;
+  maxLag = 0;
+  behindLine = 0;
+  behindRate = 0;
+  parseTotal = parseMax = 0;
+  alertTotal = alertMax = alertRuns = 0;
+  // The first read may set up the file's buffer, so it happens in here too
+  hasLine = readLine();
+  startedAt = millis();
+  finishedAt = 0;
+  active = true;
+  Serial.println("▶️ Replay started at " + (speed > 0 ? String(speed, 1) + "x" : String("max speed")));
+}
+
+void UartReplay::finish(const char* reason) {
+  HEAP_EXEMPT();
+  file.close();
+  delete replayPi;
+  delete replayState;
+  replayPi = nullptr;
+  replayState = nullptr;
+  active = false;
+  finishedAt = millis();
+  Serial.println("⏹️ Replay " + String(reason) + ": " + summary());
+}
+
+bool UartReplay::readLine() {
+  while (file.available()) {
+    size_t length = file.readBytesUntil('\n', line, sizeof(line) - 1);
+    line[length] = '\0';
+    if (length && line[length - 1] == '\r') line[--length] = '\0';
+    if (length == 0 || line[0] == '#') continue;
+
+    // Over-long lines were split by readBytesUntil; the tail would not parse
+    char* text = nullptr;
+    unsigned long at = strtoul(line, &text, 10);
+    if (length == sizeof(line) - 1 || text == line || *text != ' ') {
+      skipped++;
+      continue;
+    }
+    memmove(line, text + 1, strlen(text + 1) + 1);
+    lineAt = at;
+    return true;
+  }
+  return false;
+}
+
+bool UartReplay::handle() {
+  if (startRequested && !active) begin();
+  if (!active) return false;
+  if (stopRequested) {
+    finish("stopped");
+    return false;
+  }
+
+  // Feed every line that is due, but leave the task time for its other jobs;
+  // whatever is left over shows up as lag on the next run
+  unsigned long entered = micros();
+  while (micros() - entered < BUDGET_US) {
+    if (!hasLine) {
+      hasLine = readLine();
+      if (!hasLine) {
+        finish("finished");
+        return false;
+      }
+    }
+
+    unsigned long now = millis();
+    unsigned long due = speed > 0 ? startedAt + (unsigned long)(lineAt / speed) : now;
+    if ((long)(now - due) < 0) break;
+
+    unsigned long lag = now - due;
+    if (lag > maxLag) maxLag = lag;
+    if (lag > BEHIND_MS && behindLine == 0) {
+      behindLine = lines + 1;
+      behindRate = lineAt ? lines * 1000.0f * speed / lineAt : 0;
+    }
+
+    unsigned long parseStart = micros();
+    replayPi->processPiMessage(line);
+    unsigned long spent = micros() - parseStart;
+    parseTotal += spent;
+    if (spent > parseMax) parseMax = spent;
+
+    lines++;
+    lastAt = lineAt;
+    hasLine = false;
+  }
+  return true;
+}
+
+void UartReplay::noteAlert(unsigned long us) {
+  if (!active) return;
+  alertTotal += us;
+  alertRuns++;
+  if (us > alertMax) alertMax = us;
+}
+
+String UartReplay::summary() const {
+  if (lines == 0 && !active) return "no replay run yet";
+
+  unsigned long elapsed = (active ? millis() : finishedAt) - startedAt;
+  float achieved = elapsed ? lines * 1000.0f / elapsed : 0;
+  unsigned long parseAvg = lines ? parseTotal / lines : 0;
+  unsigned long alertAvg = alertRuns ? alertTotal / alertRuns : 0;
+
+  String out = String(lines) + " lines in " + String(elapsed / 1000.0f, 1) + "s (" +
+               String(achieved, 1) + "/s";
+  if (speed > 0 && lastAt) out += ", offered " + String(lines * 1000.0f * speed / lastAt, 1) + "/s";
+  out += "), lag max " + String(maxLag) + "ms";
+  out += ", parse avg " + String(parseAvg) + "/max " + String(parseMax) + "us";
+  out += ", alert avg " + String(alertAvg) + "/max " + String(alertMax) + "us";
+  if (parseAvg) out += ", parser limit ~" + String(1000000UL / parseAvg) + "/s";
+  if (skipped) out += ", " + String(skipped) + " skipped";
+  if (speed > 0) {
+    out += behindLine ? ", fell behind at line " + String(behindLine) + " (" + String(behindRate, 1) + "/s)"
+                      : ", kept up";
+  }
+  return out;
+}
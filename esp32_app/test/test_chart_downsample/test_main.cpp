@@ -0,0 +1,180 @@
+// ChartDownsample: range filtering, LTTB bucket selection and the sample
+// index over the sample files
+//   pio test -e native -f test_chart_downsample
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <unity.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "DataManager/ChartDownsample.h"
+
+// 14 samples a second apart: flat at 100 cm with one peak or dip per bucket
+// when asked for 5 points (buckets 1-4, 5-8 and 9-12)
+static const float SHAPE[] = {100, 100, 100, 300, 100, 100, 0, 100, 100, 100, 250, 100, 100, 100};
+static const uint32_t START = 1000;
+static const size_t COUNT = sizeof(SHAPE) / sizeof(SHAPE[0]);
+
+static void writeSamples(const char* path, size_t first, size_t last) {
+  File file = SPIFFS.open(path, FILE_WRITE);
+  for (size_t i = first; i < last; i++) {
+    StoredSample sample = {START + (uint32_t)i, 0, SHAPE[i], 0, 0};
+    file.write((const uint8_t*)&sample, sizeof(sample));
+  }
+  file.close();
+}
+
+static void writeTimes(const char* path, const std::vector<uint32_t>& times) {
+  File file = SPIFFS.open(path, FILE_WRITE);
+  for (uint32_t time : times) {
+    StoredSample sample = {time, 0, 100, 0, 0};
+    file.write((const uint8_t*)&sample, sizeof(sample));
+  }
+  file.close();
+}
+
+// Files written behind DataManager's back are indexed when it starts, as at boot
+static void reindex() {
+  dataManager.end();
+  TEST_ASSERT_TRUE(dataManager.begin());
+}
+
+// Whole response, read in small pieces like the chunked web callback
+static std::string render(uint32_t from, uint32_t to, uint16_t points) {
+  reindex();
+  ChartDownsample chart(from, to, points);
+  std::string out;
+  uint8_t buffer[7];
+  while (size_t n = chart.read(buffer, sizeof(buffer))) out.append((const char*)buffer, n);
+  return out;
+}
+
+void setUp() {
+  char root[] = "/tmp/chart_test_XXXXXX";
+  TEST_ASSERT_NOT_NULL(mkdtemp(root));
+  NativeFS::setRoot(root);
+  initConfig();
+  TEST_ASSERT_TRUE(dataManager.begin());
+}
+
+void tearDown() {
+  dataManager.end();
+  SPIFFS.format();
+  rmdir(NativeFS::root().c_str());
+}
+
+static void test_short_range_is_returned_as_is() {
+  writeSamples(SAMPLES_FILE, 0, 4);
+  TEST_ASSERT_EQUAL_STRING(
+      "{\"samples\":4,\"points\":[[1000.000,100.00],[1001.000,100.00],[1002.000,100.00],"
+      "[1003.000,300.00]]}\n",
+      render(0, UINT32_MAX, 10).c_str());
+}
+
+static void test_range_bounds_are_inclusive() {
+  writeSamples(SAMPLES_FILE, 0, COUNT);
+  TEST_ASSERT_EQUAL_STRING(
+      "{\"samples\":3,\"points\":[[1005.000,100.00],[1006.000,0.00],[1007.000,100.00]]}\n",
+      render(1005, 1007, 10).c_str());
+  TEST_ASSERT_EQUAL_STRING("{\"samples\":0,\"points\":[]}\n", render(2000, 3000, 10).c_str());
+}
+
+static void test_bucket_keeps_largest_triangle() {
+  writeSamples(SAMPLES_FILE, 0, COUNT);
+  // First and last as they are, then the peak, dip and peak of each bucket
+  TEST_ASSERT_EQUAL_STRING(
+      "{\"samples\":14,\"points\":[[1000.000,100.00],[1003.000,300.00],[1006.000,0.00],"
+      "[1010.000,250.00],[1013.000,100.00]]}\n",
+      render(0, UINT32_MAX, 5).c_str());
+}
+
+static void test_points_are_clamped() {
+  writeSamples(SAMPLES_FILE, 0, COUNT);
+  // One bucket between the end points: the largest excursion wins
+  TEST_ASSERT_EQUAL_STRING(
+      "{\"samples\":14,\"points\":[[1000.000,100.00],[1003.000,300.00],[1013.000,100.00]]}\n",
+      render(0, UINT32_MAX, 1).c_str());
+}
+
+static void test_reads_across_rotated_file() {
+  writeSamples(SAMPLES_FILE_OLD, 0, 7);
+  writeSamples(SAMPLES_FILE, 7, COUNT);
+  TEST_ASSERT_EQUAL_STRING(
+      "{\"samples\":14,\"points\":[[1000.000,100.00],[1003.000,300.00],[1006.000,0.00],"
+      "[1010.000,250.00],[1013.000,100.00]]}\n",
+      render(0, UINT32_MAX, 5).c_str());
+}
+
+static void test_index_count_matches_a_scan() {
+  // Several index blocks per file, rising time, then a reboot on the
+  // uptime clock part way through the current file
+  std::vector<uint32_t> old, current;
+  for (uint32_t i = 0; i < 1500; i++) old.push_back(1000 + i);
+  for (uint32_t i = 0; i < 700; i++) current.push_back(2500 + i);
+  for (uint32_t i = 0; i < 900; i++) current.push_back(10 + i / 2);
+  writeTimes(SAMPLES_FILE_OLD, old);
+  writeTimes(SAMPLES_FILE, current);
+  reindex();
+
+  std::vector<uint32_t> all = old;
+  all.insert(all.end(), current.begin(), current.end());
+  const uint32_t ranges[][2] = {{0, UINT32_MAX}, {1700, 2600}, {1000, 1511}, {1512, 2023},
+                                {3199, 3199}, {3200, 9000}, {0, 100}, {200, 1200}};
+  for (const auto& range : ranges) {
+    uint32_t expected = 0;
+    uint32_t firstAt = UINT32_MAX;
+    for (size_t i = 0; i < all.size(); i++) {
+      if (all[i] < range[0] || all[i] > range[1]) continue;
+      if (firstAt == UINT32_MAX) firstAt = i;
+      expected++;
+    }
+    uint32_t skip;
+    TEST_ASSERT_EQUAL(expected, dataManager.countSamples(range[0], range[1], skip));
+    // Skipped records are whole blocks before the first one in range
+    if (expected) TEST_ASSERT_TRUE(skip <= firstAt && firstAt - skip < 512);
+  }
+}
+
+static void test_range_starts_past_skipped_blocks() {
+  std::vector<uint32_t> times;
+  for (uint32_t i = 0; i < 3000; i++) times.push_back(1000 + i);
+  writeTimes(SAMPLES_FILE_OLD, std::vector<uint32_t>(times.begin(), times.begin() + 1600));
+  writeTimes(SAMPLES_FILE, std::vector<uint32_t>(times.begin() + 1600, times.end()));
+  TEST_ASSERT_EQUAL_STRING(
+      "{\"samples\":901,\"points\":[[2700.000,100.00],[2701.000,100.00],[3600.000,100.00]]}\n",
+      render(2700, 3600, 3).c_str());
+}
+
+static void test_index_follows_flushes_and_rotation() {
+  for (int i = 0; i < 25000; i++) {
+    SensorData data;
+    data.distance = 100;
+    dataManager.saveSensorData(data);
+  }
+  dataManager.flush();
+  TEST_ASSERT_TRUE(SPIFFS.exists(SAMPLES_FILE_OLD));
+
+  uint32_t skip;
+  TEST_ASSERT_EQUAL(25000, dataManager.countSamples(0, UINT32_MAX, skip));
+  TEST_ASSERT_EQUAL(0, skip);
+  TEST_ASSERT_EQUAL(0, dataManager.countSamples(0, 1000, skip));
+
+  dataManager.resetAllData();
+  TEST_ASSERT_EQUAL(0, dataManager.countSamples(0, UINT32_MAX, skip));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_short_range_is_returned_as_is);
+  RUN_TEST(test_range_bounds_are_inclusive);
+  RUN_TEST(test_bucket_keeps_largest_triangle);
+  RUN_TEST(test_points_are_clamped);
+  RUN_TEST(test_reads_across_rotated_file);
+  RUN_TEST(test_index_count_matches_a_scan);
+  RUN_TEST(test_range_starts_past_skipped_blocks);
+  RUN_TEST(test_index_follows_flushes_and_rotation);
+  return UNITY_END();
+}
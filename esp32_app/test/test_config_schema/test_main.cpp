@@ -0,0 +1,188 @@
+// Config schema: blob round trip, blobs written by other firmware versions,
+// and migration of the old per-key NVS layout
+//   pio test -e native -f test_config_schema
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <SPIFFS.h>
+#include <unity.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+#include "config_schema.h"
+#include "DataManager/DataManager.h"
+
+// Blob as another firmware version would write it (layout in config_schema.cpp)
+class BlobWriter {
+public:
+  BlobWriter() : bytes(12, 0) {}
+
+  template <typename T> BlobWriter& add(const char* key, ConfigType type, T value) {
+    return raw(key, type, &value, sizeof(value));
+  }
+  BlobWriter& text(const char* key, const char* value) {
+    return raw(key, ConfigType::String, value, strlen(value));
+  }
+
+  std::vector<uint8_t> finish(uint16_t version = 1) {
+    uint32_t magic = 0x47464353;  // "SCFG"
+    uint32_t hash = 2166136261u;
+    for (size_t i = 12; i < bytes.size(); i++) hash = (hash ^ bytes[i]) * 16777619u;
+    memcpy(&bytes[0], &magic, 4);
+    memcpy(&bytes[4], &version, 2);
+    memcpy(&bytes[6], &records, 2);
+    memcpy(&bytes[8], &hash, 4);
+    return bytes;
+  }
+
+private:
+  std::vector<uint8_t> bytes;
+  uint16_t records = 0;
+
+  BlobWriter& raw(const char* key, ConfigType type, const void* value, uint8_t length) {
+    uint16_t hash = configKeyHash(key);
+    bytes.push_back(hash & 0xFF);
+    bytes.push_back(hash >> 8);
+    bytes.push_back((uint8_t)type);
+    bytes.push_back(length);
+    bytes.insert(bytes.end(), (const uint8_t*)value, (const uint8_t*)value + length);
+    records++;
+    return *this;
+  }
+};
+
+static AppConfig defaults() {
+  AppConfig cfg;
+  memset(&cfg, 0, sizeof(cfg));
+  ConfigSchema::applyDefaults(cfg);
+  return cfg;
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_defaults_follow_the_table() {
+  AppConfig cfg = defaults();
+  TEST_ASSERT_EQUAL_FLOAT(40.0, cfg.system.distance_threshold);
+  TEST_ASSERT_EQUAL(30000, cfg.system.alert_cooldown);  // seconds * scale
+  TEST_ASSERT_EQUAL(1883, cfg.mqtt.port);
+  TEST_ASSERT_EQUAL_STRING("surveillance_system", cfg.wifi.ap_ssid);
+  TEST_ASSERT_FALSE(cfg.telegram.enable_telegram);
+}
+
+static void test_blob_round_trip() {
+  AppConfig cfg = defaults();
+  cfg.system.distance_threshold = 72.5;
+  cfg.system.alert_cooldown = 120000;
+  cfg.mqtt.port = 8883;
+  cfg.telegram.enable_telegram = true;
+  strcpy(cfg.mqtt.server, "broker.lan");
+  strcpy(cfg.mqtt.password, "s3cret");
+
+  static uint8_t blob[configBlobCapacity()];
+  size_t length = ConfigSchema::encodeBlob(cfg, blob, sizeof(blob));
+  TEST_ASSERT_GREATER_THAN(12, length);
+
+  AppConfig decoded = defaults();
+  TEST_ASSERT_TRUE(ConfigSchema::decodeBlob(decoded, blob, length));
+  for (const ConfigField& field : CONFIG_FIELDS) {
+    if (!(field.flags & CFG_PERSIST)) continue;
+    TEST_ASSERT_TRUE_MESSAGE(ConfigSchema::fieldEquals(field, cfg, decoded), field.key);
+  }
+}
+
+static void test_blob_from_other_version_keeps_known_fields() {
+  // Reordered, one key this firmware doesn't know and one whose type changed
+  std::vector<uint8_t> blob = BlobWriter()
+      .text("mqtt_server", "10.0.0.5")
+      .add("retired_key", ConfigType::Int, 7)
+      .add("threshold", ConfigType::Int, 90)
+      .add("mqtt_port", ConfigType::Int, 1884)
+      .add("telegram", ConfigType::Bool, true)
+      .finish();
+
+  AppConfig cfg = defaults();
+  TEST_ASSERT_TRUE(ConfigSchema::decodeBlob(cfg, blob.data(), blob.size()));
+  TEST_ASSERT_EQUAL_STRING("10.0.0.5", cfg.mqtt.server);
+  TEST_ASSERT_EQUAL(1884, cfg.mqtt.port);
+  TEST_ASSERT_TRUE(cfg.telegram.enable_telegram);
+  TEST_ASSERT_EQUAL_FLOAT(40.0, cfg.system.distance_threshold);  // was an int: default kept
+  TEST_ASSERT_EQUAL_STRING("esp32/surveillance", cfg.mqtt.topic);  // not in the blob
+}
+
+static void test_blob_string_longer_than_field_is_cut() {
+  char longName[64];
+  memset(longName, 'n', sizeof(longName) - 1);
+  longName[sizeof(longName) - 1] = '\0';
+  std::vector<uint8_t> blob = BlobWriter().text("ap_ssid", longName).finish();
+
+  AppConfig cfg = defaults();
+  TEST_ASSERT_TRUE(ConfigSchema::decodeBlob(cfg, blob.data(), blob.size()));
+  TEST_ASSERT_EQUAL(sizeof(cfg.wifi.ap_ssid) - 1, strlen(cfg.wifi.ap_ssid));
+}
+
+static void test_damaged_blob_is_rejected() {
+  std::vector<uint8_t> blob = BlobWriter().add("mqtt_port", ConfigType::Int, 1884).finish();
+  AppConfig cfg = defaults();
+
+  std::vector<uint8_t> flipped = blob;
+  flipped.back() ^= 0x01;
+  TEST_ASSERT_FALSE(ConfigSchema::decodeBlob(cfg, flipped.data(), flipped.size()));
+
+  std::vector<uint8_t> future = BlobWriter().add("mqtt_port", ConfigType::Int, 1884).finish(2);
+  TEST_ASSERT_FALSE(ConfigSchema::decodeBlob(cfg, future.data(), future.size()));
+
+  TEST_ASSERT_FALSE(ConfigSchema::decodeBlob(cfg, blob.data(), blob.size() - 1));
+  TEST_ASSERT_FALSE(ConfigSchema::decodeBlob(cfg, blob.data(), 8));
+  TEST_ASSERT_EQUAL(1883, cfg.mqtt.port);
+}
+
+static void test_per_key_config_is_migrated_once() {
+  char root[] = "/tmp/config_test_XXXXXX";
+  TEST_ASSERT_NOT_NULL(mkdtemp(root));
+  NativeFS::setRoot(root);
+  TEST_ASSERT_TRUE(dataManager.begin());
+
+  // What the firmware before the config blob left in NVS
+  Preferences nvs;
+  nvs.begin("surveillance");
+  nvs.clear();
+  nvs.putFloat("threshold", 55.5f);
+  nvs.putULong("cooldown", 60000);
+  nvs.putBool("telegram", true);
+  nvs.putString("mqtt_server", "broker.lan");
+
+  AppConfig cfg = defaults();
+  TEST_ASSERT_TRUE(dataManager.loadConfig(cfg));
+  TEST_ASSERT_EQUAL_FLOAT(55.5, cfg.system.distance_threshold);
+  TEST_ASSERT_EQUAL(60000, cfg.system.alert_cooldown);
+  TEST_ASSERT_TRUE(cfg.telegram.enable_telegram);
+  TEST_ASSERT_EQUAL_STRING("broker.lan", cfg.mqtt.server);
+  TEST_ASSERT_EQUAL(1883, cfg.mqtt.port);
+
+  // The old keys are gone and the blob holds the same values
+  TEST_ASSERT_FALSE(nvs.isKey("threshold"));
+  TEST_ASSERT_FALSE(nvs.isKey("mqtt_server"));
+  TEST_ASSERT_TRUE(nvs.isKey(CONFIG_BLOB_KEY));
+
+  AppConfig reloaded = defaults();
+  TEST_ASSERT_TRUE(dataManager.loadConfig(reloaded));
+  TEST_ASSERT_EQUAL_FLOAT(55.5, reloaded.system.distance_threshold);
+  TEST_ASSERT_EQUAL_STRING("broker.lan", reloaded.mqtt.server);
+
+  nvs.end();
+  dataManager.end();
+  SPIFFS.format();
+  rmdir(root);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_defaults_follow_the_table);
+  RUN_TEST(test_blob_round_trip);
+  RUN_TEST(test_blob_from_other_version_keeps_known_fields);
+  RUN_TEST(test_blob_string_longer_than_field_is_cut);
+  RUN_TEST(test_damaged_blob_is_rejected);
+  RUN_TEST(test_per_key_config_is_migrated_once);
+  return UNITY_END();
+}
@@ -0,0 +1,98 @@
+// DataExport: clock selection, range filtering and the sample/event merge
+//   pio test -e native -f test_data_export
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <unity.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include "DataManager/DataExport.h"
+
+static StoredSample sample(uint32_t time, float distance, bool uptime) {
+  StoredSample record = {time, 0, distance, (uint8_t)(uptime ? RECORD_UPTIME_CLOCK : 0), 0};
+  return record;
+}
+
+static StoredEvent event(uint32_t time, const char* text, bool uptime) {
+  StoredEvent record = {time, 0, (uint8_t)(uptime ? RECORD_UPTIME_CLOCK : 0), (uint8_t)strlen(text), {}};
+  memcpy(record.text, text, strlen(text));
+  return record;
+}
+
+template <typename Record> static void append(const char* path, const Record& record) {
+  File file = SPIFFS.open(path, FILE_APPEND);
+  file.write((const uint8_t*)&record, sizeof(record));
+  file.close();
+}
+
+static std::string render(ExportClock clock, uint32_t from = 0, uint32_t to = UINT32_MAX) {
+  DataExport cursor(ExportFormat::CSV, clock, from, to, true, true);
+  std::string out;
+  uint8_t buffer[11];
+  while (size_t n = cursor.read(buffer, sizeof(buffer))) out.append((const char*)buffer, n);
+  return out;
+}
+
+static const char* HEADER = "type,time,clock,distance,object_detected,alert_active,mode,message\n";
+
+void setUp() {
+  char root[] = "/tmp/export_test_XXXXXX";
+  TEST_ASSERT_NOT_NULL(mkdtemp(root));
+  NativeFS::setRoot(root);
+  SPIFFS.begin(true);
+
+  // Boot 1 logs on uptime until NTP syncs, then boot 2 does the same
+  append(SAMPLES_FILE, sample(5, 100, true));
+  append(EVENTS_FILE, event(8, "Pi connected", true));
+  append(SAMPLES_FILE, sample(1700000010, 90, false));
+  append(EVENTS_FILE, event(1700000020, "Alert 30.0cm", false));
+  append(SAMPLES_FILE, sample(1700000030, 30, false));
+  append(SAMPLES_FILE, sample(3, 110, true));
+  append(SAMPLES_FILE, sample(1700000500, 80, false));
+}
+
+void tearDown() {
+  SPIFFS.format();
+  rmdir(NativeFS::root().c_str());
+}
+
+static void test_epoch_export_leaves_out_uptime_records() {
+  // Uptime seconds would otherwise sort before, and fall inside, any range from 0
+  TEST_ASSERT_EQUAL_STRING(
+      (std::string(HEADER) +
+       "sample,1700000010.000,epoch,90.00,0,0,0,\n"
+       "event,1700000020.000,epoch,,,,,\"Alert 30.0cm\"\n"
+       "sample,1700000030.000,epoch,30.00,0,0,0,\n"
+       "sample,1700000500.000,epoch,80.00,0,0,0,\n").c_str(),
+      render(ExportClock::Epoch).c_str());
+}
+
+static void test_epoch_range_is_inclusive() {
+  TEST_ASSERT_EQUAL_STRING(
+      (std::string(HEADER) +
+       "event,1700000020.000,epoch,,,,,\"Alert 30.0cm\"\n"
+       "sample,1700000030.000,epoch,30.00,0,0,0,\n").c_str(),
+      render(ExportClock::Epoch, 1700000020, 1700000030).c_str());
+}
+
+static void test_uptime_export_keeps_write_order() {
+  // Boot 2's sample at 3 s still follows boot 1's at 5 s
+  TEST_ASSERT_EQUAL_STRING(
+      (std::string(HEADER) +
+       "sample,5.000,uptime,100.00,0,0,0,\n"
+       "sample,3.000,uptime,110.00,0,0,0,\n"
+       "event,8.000,uptime,,,,,\"Pi connected\"\n").c_str(),
+      render(ExportClock::Uptime).c_str());
+  TEST_ASSERT_EQUAL_STRING(
+      (std::string(HEADER) + "sample,5.000,uptime,100.00,0,0,0,\n").c_str(),
+      render(ExportClock::Uptime, 4, 6).c_str());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_epoch_export_leaves_out_uptime_records);
+  RUN_TEST(test_epoch_range_is_inclusive);
+  RUN_TEST(test_uptime_export_keeps_write_order);
+  return UNITY_END();
+}
@@ -0,0 +1,191 @@
+// DataManager: sample and event records, batching and file rotation
+//   pio test -e native -f test_data_manager
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <unity.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <vector>
+#include "config.h"
+#include "DataManager/DataManager.h"
+
+static const size_t MAX_SAMPLES_BYTES = 256 * 1024;  // DataManager::MAX_SAMPLES_FILE_SIZE
+static const size_t MAX_EVENTS_BYTES = 32 * 1024;    // DataManager::MAX_EVENTS_FILE_SIZE
+static const int SAMPLE_BATCH = 32;                  // DataManager::SAMPLE_BUFFER_SIZE
+static const int EVENT_BATCH = 8;                    // DataManager::EVENT_BUFFER_SIZE
+
+static SensorData reading(float distance, bool detected = false, int mode = 0) {
+  SensorData data;
+  data.distance = distance;
+  data.object_detected = detected;
+  data.mode = mode;
+  return data;
+}
+
+template <typename Record> static std::vector<Record> readRecords(const char* path) {
+  std::vector<Record> records;
+  File file = SPIFFS.open(path, FILE_READ);
+  if (!file) return records;
+  Record record;
+  while (file.read((uint8_t*)&record, sizeof(record)) == sizeof(record)) records.push_back(record);
+  file.close();
+  return records;
+}
+
+static size_t fileSize(const char* path) {
+  File file = SPIFFS.open(path, FILE_READ);
+  size_t size = file ? file.size() : 0;
+  file.close();
+  return size;
+}
+
+void setUp() {
+  char root[] = "/tmp/data_test_XXXXXX";
+  TEST_ASSERT_NOT_NULL(mkdtemp(root));
+  NativeFS::setRoot(root);
+  VirtualClock::set(5 * 1000000ULL);
+  initConfig();
+  TEST_ASSERT_TRUE(dataManager.begin());
+}
+
+void tearDown() {
+  dataManager.end();
+  SPIFFS.format();
+  rmdir(NativeFS::root().c_str());
+}
+
+static void test_samples_are_batched_until_flush() {
+  for (int i = 0; i < SAMPLE_BATCH - 1; i++) dataManager.saveSensorData(reading(100 + i));
+  TEST_ASSERT_EQUAL(0, fileSize(SAMPLES_FILE));
+
+  // The batch's last slot writes it out
+  dataManager.saveSensorData(reading(200));
+  TEST_ASSERT_EQUAL(SAMPLE_BATCH * sizeof(StoredSample), fileSize(SAMPLES_FILE));
+
+  dataManager.saveSensorData(reading(300));
+  dataManager.flush();
+  std::vector<StoredSample> samples = readRecords<StoredSample>(SAMPLES_FILE);
+  TEST_ASSERT_EQUAL(SAMPLE_BATCH + 1, samples.size());
+  TEST_ASSERT_EQUAL_FLOAT(100, samples[0].distance);
+  TEST_ASSERT_EQUAL_FLOAT(300, samples.back().distance);
+}
+
+static void test_sample_record_fields() {
+  struct timeval now;
+  gettimeofday(&now, nullptr);
+  dataManager.saveSensorData(reading(35.25, true, 2));
+  dataManager.flush();
+
+  std::vector<StoredSample> samples = readRecords<StoredSample>(SAMPLES_FILE);
+  TEST_ASSERT_EQUAL(1, samples.size());
+  const StoredSample& sample = samples[0];
+  TEST_ASSERT_EQUAL_FLOAT(35.25, sample.distance);
+  TEST_ASSERT_EQUAL(2, sample.mode);
+  TEST_ASSERT_EQUAL(RECORD_OBJECT_DETECTED, sample.flags & (RECORD_OBJECT_DETECTED | RECORD_ALERT_ACTIVE));
+  // The host clock is set, so records carry epoch time
+  TEST_ASSERT_EQUAL(0, sample.flags & RECORD_UPTIME_CLOCK);
+  TEST_ASSERT_TRUE(sample.time >= (uint32_t)now.tv_sec && sample.time <= (uint32_t)now.tv_sec + 5);
+  TEST_ASSERT_LESS_THAN(1000, sample.millis);
+}
+
+static void test_logging_disabled_stores_nothing() {
+  bootConfig().system.enable_data_logging = false;
+  dataManager.saveSensorData(reading(100));
+  dataManager.logEvent("Alert 12.0cm");
+  dataManager.flush();
+  TEST_ASSERT_EQUAL(0, fileSize(SAMPLES_FILE));
+  TEST_ASSERT_EQUAL(0, fileSize(EVENTS_FILE));
+}
+
+static void test_event_text_is_cut_at_utf8_boundary() {
+  dataManager.logEvent("Pi connected");
+  // 22 ASCII bytes, then a 3-byte character that would straddle the cut
+  dataManager.logEvent("0123456789012345678901\xE2\x9C\x85 tail");
+  dataManager.flush();
+
+  std::vector<StoredEvent> events = readRecords<StoredEvent>(EVENTS_FILE);
+  TEST_ASSERT_EQUAL(2, events.size());
+  TEST_ASSERT_EQUAL(12, events[0].length);
+  TEST_ASSERT_EQUAL_MEMORY("Pi connected", events[0].text, 12);
+  TEST_ASSERT_EQUAL(22, events[1].length);
+  TEST_ASSERT_EQUAL_MEMORY("0123456789012345678901", events[1].text, 22);
+}
+
+static void test_events_are_written_when_batch_fills() {
+  for (int i = 0; i < EVENT_BATCH - 1; i++) dataManager.logEvent("Pi timeout");
+  TEST_ASSERT_EQUAL(0, fileSize(EVENTS_FILE));
+  dataManager.logEvent("Pi connected");
+  TEST_ASSERT_EQUAL(EVENT_BATCH * sizeof(StoredEvent), fileSize(EVENTS_FILE));
+}
+
+static void test_alert_event_asks_for_a_prompt_flush() {
+  dataManager.logEvent("Alert 12.0cm");
+  TEST_ASSERT_EQUAL(0, fileSize(EVENTS_FILE));
+
+  // handle() writes it out without waiting for the flush interval
+  dataManager.handle();
+  TEST_ASSERT_EQUAL(sizeof(StoredEvent), fileSize(EVENTS_FILE));
+}
+
+static void test_samples_rotate_to_one_old_file() {
+  size_t perFile = MAX_SAMPLES_BYTES / sizeof(StoredSample);
+  size_t total = perFile + 500;
+  for (size_t i = 0; i < total; i++) dataManager.saveSensorData(reading(1 + i % 399));
+  dataManager.flush();
+
+  // Rotation moves whole batches, so both files hold complete records
+  size_t oldSize = fileSize(SAMPLES_FILE_OLD);
+  size_t newSize = fileSize(SAMPLES_FILE);
+  TEST_ASSERT_GREATER_THAN(0, oldSize);
+  TEST_ASSERT_TRUE(oldSize <= MAX_SAMPLES_BYTES);
+  TEST_ASSERT_EQUAL(0, oldSize % sizeof(StoredSample));
+  TEST_ASSERT_EQUAL(total * sizeof(StoredSample), oldSize + newSize);
+
+  // Oldest first across the two files, nothing lost or repeated
+  std::vector<StoredSample> samples = readRecords<StoredSample>(SAMPLES_FILE_OLD);
+  std::vector<StoredSample> newer = readRecords<StoredSample>(SAMPLES_FILE);
+  samples.insert(samples.end(), newer.begin(), newer.end());
+  for (size_t i = 0; i < total; i++) TEST_ASSERT_EQUAL_FLOAT(1 + i % 399, samples[i].distance);
+
+  // A second rotation drops the first generation
+  for (size_t i = 0; i < perFile; i++) dataManager.saveSensorData(reading(50));
+  dataManager.flush();
+  TEST_ASSERT_TRUE(fileSize(SAMPLES_FILE_OLD) + fileSize(SAMPLES_FILE) < (total + perFile) * sizeof(StoredSample));
+  TEST_ASSERT_EQUAL_FLOAT(50, readRecords<StoredSample>(SAMPLES_FILE_OLD).back().distance);
+}
+
+static void test_events_rotate_to_one_old_file() {
+  size_t perFile = MAX_EVENTS_BYTES / sizeof(StoredEvent);
+  for (size_t i = 0; i < perFile + 20; i++) dataManager.logEvent("Pi timeout");
+  dataManager.flush();
+  TEST_ASSERT_EQUAL(perFile * sizeof(StoredEvent), fileSize(EVENTS_FILE_OLD));
+  TEST_ASSERT_EQUAL(20 * sizeof(StoredEvent), fileSize(EVENTS_FILE));
+}
+
+static void test_reset_removes_records() {
+  dataManager.saveSensorData(reading(100));
+  dataManager.logEvent("Pi connected");
+  dataManager.flush();
+  dataManager.saveSensorData(reading(120));  // still buffered
+
+  dataManager.resetAllData();
+  dataManager.flush();
+  TEST_ASSERT_FALSE(SPIFFS.exists(SAMPLES_FILE));
+  TEST_ASSERT_FALSE(SPIFFS.exists(EVENTS_FILE));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_samples_are_batched_until_flush);
+  RUN_TEST(test_sample_record_fields);
+  RUN_TEST(test_logging_disabled_stores_nothing);
+  RUN_TEST(test_event_text_is_cut_at_utf8_boundary);
+  RUN_TEST(test_events_are_written_when_batch_fills);
+  RUN_TEST(test_alert_event_asks_for_a_prompt_flush);
+  RUN_TEST(test_samples_rotate_to_one_old_file);
+  RUN_TEST(test_events_rotate_to_one_old_file);
+  RUN_TEST(test_reset_removes_records);
+  return UNITY_END();
+}
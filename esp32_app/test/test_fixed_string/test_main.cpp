@@ -0,0 +1,87 @@
+// FixedString: truncation, UTF-8 boundaries and the append/truncate API
+//   pio test -e native -f test_fixed_string
+
+#include <Arduino.h>
+#include <unity.h>
+#include "fixed_string.h"
+
+void setUp() {}
+void tearDown() {}
+
+static void test_assign_fits() {
+  FixedString<8> text = "sensor";
+  TEST_ASSERT_EQUAL_STRING("sensor", text.c_str());
+  TEST_ASSERT_EQUAL(6, text.length());
+  TEST_ASSERT_FALSE(text.full());
+  TEST_ASSERT_TRUE(text == "sensor");
+  TEST_ASSERT_TRUE(text != "sensors");
+}
+
+static void test_assign_truncates_to_capacity() {
+  FixedString<8> text = "ultrasonic";
+  TEST_ASSERT_EQUAL(7, FixedString<8>::capacity());
+  TEST_ASSERT_EQUAL_STRING("ultraso", text.c_str());
+  TEST_ASSERT_EQUAL(7, text.length());
+  TEST_ASSERT_TRUE(text.full());
+}
+
+static void test_assign_cuts_at_utf8_boundary() {
+  // "ab" + U+2705 (3 bytes) + "c": the cut would land inside the emoji
+  FixedString<5> text = "ab\xE2\x9C\x85" "c";
+  TEST_ASSERT_EQUAL_STRING("ab", text.c_str());
+  TEST_ASSERT_EQUAL(2, text.length());
+
+  // Exactly fits
+  FixedString<6> whole = "ab\xE2\x9C\x85";
+  TEST_ASSERT_EQUAL_STRING("ab\xE2\x9C\x85", whole.c_str());
+  TEST_ASSERT_TRUE(whole.full());
+}
+
+static void test_assign_reads_no_further_than_capacity() {
+  // strnlen(value, N): a source without a terminator in range is fine
+  const char source[4] = {'a', 'b', 'c', 'd'};
+  FixedString<4> text;
+  text.assign(source);
+  TEST_ASSERT_EQUAL_STRING("abc", text.c_str());
+}
+
+static void test_append_stops_when_full() {
+  FixedString<4> text;
+  TEST_ASSERT_TRUE(text.isEmpty());
+  TEST_ASSERT_TRUE(text.append('x'));
+  TEST_ASSERT_TRUE(text.append('y'));
+  TEST_ASSERT_TRUE(text.append('z'));
+  TEST_ASSERT_FALSE(text.append('!'));
+  TEST_ASSERT_EQUAL_STRING("xyz", text.c_str());
+}
+
+static void test_truncate_and_clear() {
+  FixedString<16> text = "distance=42";
+  text.truncate(8);
+  TEST_ASSERT_EQUAL_STRING("distance", text.c_str());
+  text.truncate(20);  // longer than the text: no change
+  TEST_ASSERT_EQUAL(8, text.length());
+  text.clear();
+  TEST_ASSERT_TRUE(text.isEmpty());
+  TEST_ASSERT_EQUAL_STRING("", text.c_str());
+}
+
+static void test_copies_are_independent() {
+  FixedString<16> first = "Normal";
+  FixedString<16> second = first;
+  second = "Object Detected";
+  TEST_ASSERT_EQUAL_STRING("Normal", first.c_str());
+  TEST_ASSERT_EQUAL_STRING("Object Detected", second.c_str());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_assign_fits);
+  RUN_TEST(test_assign_truncates_to_capacity);
+  RUN_TEST(test_assign_cuts_at_utf8_boundary);
+  RUN_TEST(test_assign_reads_no_further_than_capacity);
+  RUN_TEST(test_append_stops_when_full);
+  RUN_TEST(test_truncate_and_clear);
+  RUN_TEST(test_copies_are_independent);
+  return UNITY_END();
+}
@@ -0,0 +1,130 @@
+// GzipStream: output must inflate (zlib) back to exactly the input
+//   pio test -e native -f test_gzip_stream
+
+#include <Arduino.h>
+#include <unity.h>
+#include <zlib.h>
+#include <memory>
+#include <random>
+#include <string>
+#include "GzipStream/GzipStream.h"
+
+struct Input {
+  std::string data;
+  size_t pos = 0;
+  size_t piece = SIZE_MAX;  // most the source hands over per call
+};
+
+static size_t readInput(void* context, uint8_t* buffer, size_t maxLen) {
+  Input* input = static_cast<Input*>(context);
+  size_t n = std::min(std::min(maxLen, input->piece), input->data.size() - input->pos);
+  memcpy(buffer, input->data.data() + input->pos, n);
+  input->pos += n;
+  return n;
+}
+
+static std::string compress(Input& input, size_t chunk) {
+  std::unique_ptr<GzipStream> stream(new GzipStream(readInput, &input));
+  std::string out;
+  std::unique_ptr<uint8_t[]> buffer(new uint8_t[chunk]);
+  while (size_t n = stream->read(buffer.get(), chunk)) out.append((const char*)buffer.get(), n);
+  TEST_ASSERT_TRUE(stream->finished());
+  TEST_ASSERT_EQUAL(input.data.size(), stream->bytesIn());
+  TEST_ASSERT_EQUAL(out.size(), stream->bytesOut());
+  return out;
+}
+
+// Inflates a gzip member; also checks zlib found the CRC-32 and length right
+static std::string inflateGzip(const std::string& gzip) {
+  z_stream z = {};
+  TEST_ASSERT_EQUAL(Z_OK, inflateInit2(&z, 16 + MAX_WBITS));
+  z.next_in = (Bytef*)gzip.data();
+  z.avail_in = gzip.size();
+
+  std::string out;
+  char buffer[4096];
+  int result;
+  do {
+    z.next_out = (Bytef*)buffer;
+    z.avail_out = sizeof(buffer);
+    result = inflate(&z, Z_NO_FLUSH);
+    TEST_ASSERT_TRUE_MESSAGE(result == Z_OK || result == Z_STREAM_END, "not a valid gzip stream");
+    out.append(buffer, sizeof(buffer) - z.avail_out);
+  } while (result != Z_STREAM_END);
+  TEST_ASSERT_EQUAL(0, z.avail_in);  // nothing after the trailer
+  inflateEnd(&z);
+  return out;
+}
+
+static void roundTrip(const std::string& data, size_t chunk, size_t piece = SIZE_MAX) {
+  Input input;
+  input.data = data;
+  input.piece = piece;
+  std::string restored = inflateGzip(compress(input, chunk));
+  TEST_ASSERT_EQUAL(data.size(), restored.size());
+  TEST_ASSERT_TRUE(restored == data);
+}
+
+// Like /api/history: many near-identical lines, longer than the window
+static std::string jsonLines(size_t count) {
+  std::string text;
+  char line[96];
+  for (size_t i = 0; i < count; i++) {
+    snprintf(line, sizeof(line), "{\"t\":%lu,\"d\":%.2f,\"o\":%d,\"s\":\"Normal\"}\n",
+             1700000000ul + i, 100 + (i % 37) * 0.25, (int)(i % 11 == 0));
+    text += line;
+  }
+  return text;
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_empty_input() {
+  roundTrip("", 64);
+}
+
+static void test_short_text() {
+  roundTrip("Object Detected", 64);
+}
+
+static void test_repetitive_text_compresses() {
+  std::string data = jsonLines(2000);
+  Input input;
+  input.data = data;
+  std::string gzip = compress(input, 1460);
+  TEST_ASSERT_LESS_THAN(data.size() / 3, gzip.size());
+  TEST_ASSERT_TRUE(inflateGzip(gzip) == data);
+}
+
+static void test_incompressible_data() {
+  std::mt19937 rng(41);
+  std::string data(10000, '\0');
+  for (char& c : data) c = (char)rng();
+  roundTrip(data, 512);
+}
+
+static void test_long_runs() {
+  // Matches up to the 258-byte maximum, overlapping their own source
+  std::string data(5000, 'a');
+  data += std::string(300, 'b') + "end";
+  roundTrip(data, 256);
+}
+
+static void test_tiny_reads_and_pieces() {
+  std::string data = jsonLines(200);
+  roundTrip(data, 1);          // one output byte per call
+  roundTrip(data, 1460, 1);    // source hands over one byte at a time
+  roundTrip(data, 7, 13);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_input);
+  RUN_TEST(test_short_text);
+  RUN_TEST(test_repetitive_text_compresses);
+  RUN_TEST(test_incompressible_data);
+  RUN_TEST(test_long_runs);
+  RUN_TEST(test_tiny_reads_and_pieces);
+  return UNITY_END();
+}
@@ -0,0 +1,143 @@
+// HtmlPage JSON writers: /api/data and /api/history bodies
+//   pio test -e native -f test_html_json
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <unity.h>
+#include <memory>
+#include <string>
+#include "config.h"
+#include "HtmlPage/html_page.h"
+
+// Collects what a writer prints, as the request arena lease would
+class Capture : public Print {
+public:
+  std::string text;
+  size_t write(uint8_t c) override {
+    text += (char)c;
+    return 1;
+  }
+};
+
+static SensorData reading(float distance, unsigned long timestamp, bool detected) {
+  SensorData data;
+  data.distance = distance;
+  data.timestamp = timestamp;
+  data.object_detected = detected;
+  return data;
+}
+
+static std::unique_ptr<SystemState> state;
+
+void setUp() {
+  initConfig();
+  state.reset(new SystemState());
+  HtmlPage::setSystemState(state.get());
+}
+
+void tearDown() {
+  HtmlPage::setSystemState(nullptr);
+  state.reset();
+}
+
+static void test_history_json_is_newest_first() {
+  state->addToHistory(reading(120.5, 1000, false));
+  state->addToHistory(reading(35.25, 2000, true));
+
+  Capture out;
+  HtmlPage::writeHistoryJson(out);
+  TEST_ASSERT_EQUAL_STRING(
+      "{\"history\":[{\"distance\":35.25,\"timestamp\":2000,\"object_detected\":true},"
+      "{\"distance\":120.50,\"timestamp\":1000,\"object_detected\":false}]}",
+      out.text.c_str());
+}
+
+static void test_history_json_holds_whole_ring() {
+  for (int i = 1; i <= 150; i++) state->addToHistory(reading(i, i, false));
+
+  Capture out;
+  HtmlPage::writeHistoryJson(out);
+  DynamicJsonDocument doc(16384);
+  TEST_ASSERT_FALSE(deserializeJson(doc, out.text.c_str()));
+  JsonArray history = doc["history"];
+  TEST_ASSERT_EQUAL(100, history.size());
+  size_t i = 0;
+  for (JsonVariant entry : history) {
+    TEST_ASSERT_EQUAL_FLOAT(150 - i, entry["distance"].as<float>());
+    i++;
+  }
+}
+
+static void test_history_json_empty() {
+  Capture out;
+  HtmlPage::writeHistoryJson(out);
+  TEST_ASSERT_EQUAL_STRING("{\"history\":[]}", out.text.c_str());
+
+  HtmlPage::setSystemState(nullptr);
+  out.text.clear();
+  HtmlPage::writeHistoryJson(out);
+  TEST_ASSERT_EQUAL_STRING("{\"history\":[]}", out.text.c_str());
+}
+
+static void test_api_response_fields() {
+  bootConfig().system.distance_threshold = 45;
+  state->currentData = reading(33.5, 4000, true);
+  state->currentData.mode = 2;
+  state->currentData.alert_active = true;
+  state->currentData.status = "Object Detected";
+  for (int i = 0; i < 5; i++) state->currentData.pi_history[i] = 30 + i;
+  state->systemUptime = 3600;
+  state->wifiConnected = true;
+  state->wifiMode = "STA";
+  state->bootCount = 3;
+  state->sampleCount = 1234;
+  state->alertCount = 7;
+
+  Capture out;
+  HtmlPage::writeAPIResponse(out);
+  DynamicJsonDocument doc(2048);
+  TEST_ASSERT_FALSE(deserializeJson(doc, out.text.c_str()));
+  TEST_ASSERT_EQUAL_FLOAT(33.5, doc["distance"].as<float>());
+  TEST_ASSERT_TRUE(doc["object_detected"].as<bool>());
+  TEST_ASSERT_EQUAL_STRING("Object Detected", doc["status"].as<const char*>());
+  TEST_ASSERT_EQUAL(4000, doc["timestamp"].as<unsigned long>());
+  TEST_ASSERT_EQUAL(2, doc["mode"].as<int>());
+  TEST_ASSERT_TRUE(doc["alert_active"].as<bool>());
+  JsonArray history = doc["pi_history"];
+  TEST_ASSERT_EQUAL(5, history.size());
+  TEST_ASSERT_EQUAL(3600, doc["uptime"].as<unsigned long>());
+  TEST_ASSERT_TRUE(doc["wifi_connected"].as<bool>());
+  TEST_ASSERT_EQUAL_STRING("STA", doc["wifi_mode"].as<const char*>());
+  TEST_ASSERT_EQUAL_FLOAT(45, doc["threshold"].as<float>());
+  TEST_ASSERT_EQUAL(3, doc["boot_count"].as<unsigned long>());
+  TEST_ASSERT_EQUAL(1234, doc["sample_count"].as<unsigned long>());
+  TEST_ASSERT_EQUAL(7, doc["alert_count"].as<unsigned long>());
+  TEST_ASSERT_FALSE(doc["free_memory"].isNull());
+}
+
+static void test_api_response_escapes_status() {
+  state->currentData.status = "say \"hi\"";
+  Capture out;
+  HtmlPage::writeAPIResponse(out);
+  DynamicJsonDocument doc(2048);
+  TEST_ASSERT_FALSE(deserializeJson(doc, out.text.c_str()));
+  TEST_ASSERT_EQUAL_STRING("say \"hi\"", doc["status"].as<const char*>());
+}
+
+static void test_api_response_without_state() {
+  HtmlPage::setSystemState(nullptr);
+  Capture out;
+  HtmlPage::writeAPIResponse(out);
+  TEST_ASSERT_EQUAL_STRING("{}", out.text.c_str());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_history_json_is_newest_first);
+  RUN_TEST(test_history_json_holds_whole_ring);
+  RUN_TEST(test_history_json_empty);
+  RUN_TEST(test_api_response_fields);
+  RUN_TEST(test_api_response_escapes_status);
+  RUN_TEST(test_api_response_without_state);
+  return UNITY_END();
+}
@@ -0,0 +1,140 @@
+// PiCommunication: JSON packets and command lines fed through Serial2
+//   pio test -e native -f test_pi_communication
+
+#include <Arduino.h>
+#include <unity.h>
+#include <memory>
+#include <string>
+#include "config.h"
+#include "state.h"
+#include "PiCommunication Module/PiCommunication.h"
+
+static std::unique_ptr<SystemState> state;
+static std::unique_ptr<PiCommunication> pi;
+
+// What the Pi would send, then one handle() as the sensor task runs it
+static void receive(const std::string& bytes, PiCommunication& link) {
+  Serial2.inject(bytes.data(), bytes.size());
+  link.handle();
+}
+
+static void receive(const std::string& bytes) {
+  receive(bytes, *pi);
+}
+
+void setUp() {
+  VirtualClock::set(1000000);
+  initConfig();
+  bootConfig().system.enable_uart = true;
+  bootConfig().system.distance_threshold = 40;
+  while (Serial2.read() >= 0) {}
+  state.reset(new SystemState());
+  pi.reset(new PiCommunication(*state, false));
+}
+
+void tearDown() {
+  pi.reset();
+  state.reset();
+}
+
+static void test_json_packet_updates_state() {
+  receive("{\"d\":123.4,\"m\":2,\"a\":0,\"h\":[120.1,121.7,122.0,123.9,123.4]}\n");
+  const SensorData& data = state->currentData;
+  TEST_ASSERT_EQUAL_FLOAT(123.4f, data.distance);
+  TEST_ASSERT_EQUAL(2, data.mode);
+  TEST_ASSERT_FALSE(data.alert_active);
+  TEST_ASSERT_FALSE(data.object_detected);
+  TEST_ASSERT_EQUAL_STRING("Normal ✅", data.status.c_str());
+  TEST_ASSERT_EQUAL_FLOAT(120.1f, data.pi_history[0]);
+  TEST_ASSERT_EQUAL_FLOAT(123.4f, data.pi_history[4]);
+  TEST_ASSERT_EQUAL(1000, data.timestamp);
+  TEST_ASSERT_EQUAL(1000, state->lastPiHeartbeat);
+  TEST_ASSERT_EQUAL(1, state->getHistoryCount());
+  TEST_ASSERT_EQUAL(1, state->sampleCount);
+}
+
+static void test_detection_by_threshold_or_alert_flag() {
+  receive("{\"d\":40.0,\"m\":1,\"a\":0,\"h\":[]}\n");
+  TEST_ASSERT_TRUE(state->currentData.object_detected);
+  TEST_ASSERT_EQUAL_STRING("Object Detected 🚨", state->currentData.status.c_str());
+
+  receive("{\"d\":40.5,\"m\":1,\"a\":0,\"h\":[]}\n");
+  TEST_ASSERT_FALSE(state->currentData.object_detected);
+
+  // The Pi's own alert flag counts even beyond the threshold
+  receive("{\"d\":250.0,\"m\":1,\"a\":1,\"h\":[]}\n");
+  TEST_ASSERT_TRUE(state->currentData.alert_active);
+  TEST_ASSERT_TRUE(state->currentData.object_detected);
+}
+
+static void test_line_split_across_reads() {
+  receive("{\"d\":88.0,\"m\":0,");
+  TEST_ASSERT_EQUAL(0, state->sampleCount);
+  receive("\"a\":0,\"h\":[]}");
+  TEST_ASSERT_EQUAL(0, state->sampleCount);
+  receive("\n{\"d\":89.0,\"m\":0,\"a\":0,\"h\":[]}\n");
+  TEST_ASSERT_EQUAL(2, state->sampleCount);
+  TEST_ASSERT_EQUAL_FLOAT(88, state->getHistory(1).distance);
+  TEST_ASSERT_EQUAL_FLOAT(89, state->getHistory(0).distance);
+}
+
+static void test_over_long_line_is_dropped_whole() {
+  // Valid JSON up front, so a parse of the truncated line would succeed
+  std::string line = "{\"d\":12.0,\"m\":0,\"a\":0,\"h\":[]}";
+  line += std::string(400, ' ');
+  receive(line + "\n{\"d\":150.0,\"m\":0,\"a\":0,\"h\":[]}\n");
+  TEST_ASSERT_EQUAL(1, state->sampleCount);
+  TEST_ASSERT_EQUAL_FLOAT(150, state->currentData.distance);
+}
+
+static void test_bad_json_changes_nothing() {
+  receive("{\"d\":150.0,\"m\":0,\"a\":0,\"h\":[]}\n");
+  receive("{\"d\":12.0,\"m\":0,\n");
+  receive("{garbage}\n");
+  TEST_ASSERT_EQUAL(1, state->sampleCount);
+  TEST_ASSERT_EQUAL_FLOAT(150, state->currentData.distance);
+}
+
+static void test_out_of_range_distance_is_not_stored() {
+  receive("{\"d\":0.0,\"m\":0,\"a\":0,\"h\":[]}\n");
+  TEST_ASSERT_EQUAL(0, state->getHistoryCount());
+  TEST_ASSERT_EQUAL(1000, state->lastPiHeartbeat);  // still a sign of life
+}
+
+static void test_uart_disabled_leaves_bytes_queued() {
+  bootConfig().system.enable_uart = false;
+  receive("{\"d\":150.0,\"m\":0,\"a\":0,\"h\":[]}\n");
+  TEST_ASSERT_EQUAL(0, state->sampleCount);
+  TEST_ASSERT_GREATER_THAN(0, Serial2.available());
+}
+
+static void test_scratch_instance_skips_command_lines() {
+  receive("DISTANCE:25.0\n");
+  TEST_ASSERT_EQUAL(0, state->sampleCount);
+  TEST_ASSERT_EQUAL(0, systemState.sampleCount);
+}
+
+static void test_command_lines_reach_the_live_state() {
+  unsigned long before = systemState.sampleCount;
+  receive("  DISTANCE:25.5  \n", piComm);
+  TEST_ASSERT_EQUAL_FLOAT(25.5, systemState.currentData.distance);
+  TEST_ASSERT_TRUE(systemState.currentData.object_detected);
+  TEST_ASSERT_EQUAL(before + 1, systemState.sampleCount);
+
+  receive("STATUS:Calibrating\n", piComm);
+  TEST_ASSERT_EQUAL_STRING("Calibrating", systemState.currentData.status.c_str());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_json_packet_updates_state);
+  RUN_TEST(test_detection_by_threshold_or_alert_flag);
+  RUN_TEST(test_line_split_across_reads);
+  RUN_TEST(test_over_long_line_is_dropped_whole);
+  RUN_TEST(test_bad_json_changes_nothing);
+  RUN_TEST(test_out_of_range_distance_is_not_stored);
+  RUN_TEST(test_uart_disabled_leaves_bytes_queued);
+  RUN_TEST(test_scratch_instance_skips_command_lines);
+  RUN_TEST(test_command_lines_reach_the_live_state);
+  return UNITY_END();
+}
@@ -0,0 +1,173 @@
+// RtcSnapshot: warm-boot restore, the header copies and the slot checksums
+//   pio test -e native -f test_rtc_snapshot
+//
+// RTC_NOINIT_ATTR puts the snapshot in the rtc_noinit section on the host
+// (see native/esp_attr.h), so a "reset" is just a restore() with a warm
+// reset reason, and the tests can corrupt RTC memory between the two.
+
+#include <Arduino.h>
+#include <esp_system.h>
+#include <unity.h>
+#include <memory>
+#include "rtc_snapshot.h"
+
+extern "C" uint8_t __start_rtc_noinit[];
+extern "C" uint8_t __stop_rtc_noinit[];
+
+static const int RTC_SLOTS = 100;  // RTC_HISTORY_SIZE in rtc_snapshot.cpp
+
+static SensorData reading(float distance, unsigned long timestamp) {
+  SensorData data;
+  data.distance = distance;
+  data.timestamp = timestamp;
+  data.object_detected = distance < 40;
+  data.mode = 2;
+  return data;
+}
+
+// Power-on boot: wipes whatever RTC memory held
+static void coldBoot() {
+  NativeReset::setReason(ESP_RST_POWERON);
+  std::unique_ptr<SystemState> state(new SystemState());
+  rtcSnapshot.restore(*state);
+}
+
+// Watchdog reset: restores into a fresh state, as setup() does
+static std::unique_ptr<SystemState> warmBoot() {
+  NativeReset::setReason(ESP_RST_TASK_WDT);
+  std::unique_ptr<SystemState> state(new SystemState());
+  rtcSnapshot.restore(*state);
+  return state;
+}
+
+void setUp() {
+  VirtualClock::set(0);
+  coldBoot();
+}
+
+void tearDown() {
+  NativeReset::setReason(ESP_RST_POWERON);
+}
+
+static void test_cold_boot_discards_snapshot() {
+  rtcSnapshot.recordSample(reading(25, 0));
+  NativeReset::setReason(ESP_RST_POWERON);
+  SystemState state;
+  TEST_ASSERT_FALSE(rtcSnapshot.restore(state));
+  TEST_ASSERT_EQUAL(0, state.getHistoryCount());
+  TEST_ASSERT_EQUAL(1, state.bootCount);
+}
+
+static void test_warm_boot_restores_samples_and_counters() {
+  for (int i = 0; i < 5; i++) rtcSnapshot.recordSample(reading(100 + i, i * 100));
+
+  std::unique_ptr<SystemState> state = warmBoot();
+  TEST_ASSERT_TRUE(rtcSnapshot.wasRestored());
+  TEST_ASSERT_EQUAL(5, rtcSnapshot.restoredSamples());
+  TEST_ASSERT_EQUAL(5, state->getHistoryCount());
+  TEST_ASSERT_EQUAL(5, state->sampleCount);
+  TEST_ASSERT_EQUAL(2, state->bootCount);
+  for (int i = 0; i < 5; i++) {
+    // getHistory(0) is the newest
+    TEST_ASSERT_EQUAL_FLOAT(104 - i, state->getHistory(i).distance);
+    TEST_ASSERT_EQUAL(2, state->getHistory(i).mode);
+  }
+  TEST_ASSERT_EQUAL_FLOAT(104, state->currentData.distance);
+}
+
+static void test_restore_keeps_sample_age() {
+  VirtualClock::set(60000 * 1000ULL);
+  rtcSnapshot.recordSample(reading(80, 59000));
+
+  // millis() restarts near zero after the reset
+  VirtualClock::set(300 * 1000ULL);
+  std::unique_ptr<SystemState> state = warmBoot();
+  TEST_ASSERT_EQUAL(1, rtcSnapshot.restoredSamples());
+  // Ages are 32-bit on the device; unsigned long is wider on the host
+  TEST_ASSERT_EQUAL(1000, (uint32_t)(millis() - state->getHistory(0).timestamp));
+}
+
+static void test_ring_keeps_newest_slots() {
+  for (int i = 0; i < RTC_SLOTS + 20; i++) rtcSnapshot.recordSample(reading(i + 1, i));
+
+  std::unique_ptr<SystemState> state = warmBoot();
+  TEST_ASSERT_EQUAL(RTC_SLOTS, rtcSnapshot.restoredSamples());
+  TEST_ASSERT_EQUAL(RTC_SLOTS + 20, state->sampleCount);
+  TEST_ASSERT_EQUAL_FLOAT(RTC_SLOTS + 20, state->getHistory(0).distance);
+  TEST_ASSERT_EQUAL_FLOAT(21, state->getHistory(RTC_SLOTS - 1).distance);
+}
+
+static void test_any_flipped_byte_is_caught() {
+  size_t size = __stop_rtc_noinit - __start_rtc_noinit;
+  TEST_ASSERT_GREATER_THAN(0, size);
+
+  // Each byte of RTC memory in turn: a damaged current header falls back to
+  // the previous copy (one sample fewer, the alert time kept), and one
+  // slot's check drops just that sample. Flips in the older header copy or
+  // the alignment padding change nothing; corrupt data is never restored.
+  size_t caught = 0;
+  for (size_t offset = 0; offset < size; offset++) {
+    coldBoot();
+    SystemState alerted;
+    alerted.lastAlertTime = 500;
+    alerted.alertCount = 3;
+    for (int i = 0; i < RTC_SLOTS - 1; i++) rtcSnapshot.recordSample(reading(10 + i, i));
+    rtcSnapshot.sync(alerted);
+    rtcSnapshot.recordSample(reading(10 + RTC_SLOTS - 1, RTC_SLOTS - 1));
+    __start_rtc_noinit[offset] ^= 0x10;
+
+    std::unique_ptr<SystemState> state = warmBoot();
+    TEST_ASSERT_TRUE(rtcSnapshot.wasRestored());
+    if (rtcSnapshot.restoredSamples() < RTC_SLOTS) caught++;
+
+    TEST_ASSERT_TRUE(rtcSnapshot.restoredSamples() >= RTC_SLOTS - 1);
+    TEST_ASSERT_EQUAL(3, state->alertCount);
+    TEST_ASSERT_NOT_EQUAL(0, state->lastAlertTime);
+    for (int i = 0; i < state->getHistoryCount(); i++) {
+      SensorData data = state->getHistory(i);
+      TEST_ASSERT_TRUE(data.distance >= 10 && data.distance < 10 + RTC_SLOTS);
+      TEST_ASSERT_EQUAL_FLOAT((int)data.distance, data.distance);
+      TEST_ASSERT_EQUAL(data.distance < 40, data.object_detected);
+      TEST_ASSERT_FALSE(data.alert_active);
+      TEST_ASSERT_EQUAL(2, data.mode);
+    }
+  }
+
+  // Every byte of the current 40-byte header and the 12-byte slots is covered
+  TEST_ASSERT_EQUAL(40 + RTC_SLOTS * 12, caught);
+}
+
+static void test_reset_during_header_write_keeps_previous_copy() {
+  SystemState alerted;
+  alerted.lastAlertTime = 500;
+  alerted.alertCount = 1;
+  rtcSnapshot.sync(alerted);
+
+  // The next update is torn: the copy it was writing holds garbage
+  rtcSnapshot.recordSample(reading(25, 0));
+  size_t size = __stop_rtc_noinit - __start_rtc_noinit;
+  std::unique_ptr<uint8_t[]> before(new uint8_t[size]);
+  memcpy(before.get(), __start_rtc_noinit, size);
+  rtcSnapshot.recordSample(reading(30, 1));
+  for (size_t i = 0; i < size; i++) {
+    if (__start_rtc_noinit[i] != before[i]) __start_rtc_noinit[i] = 0xA5;
+  }
+
+  std::unique_ptr<SystemState> state = warmBoot();
+  TEST_ASSERT_TRUE(rtcSnapshot.wasRestored());
+  TEST_ASSERT_EQUAL(1, rtcSnapshot.restoredSamples());
+  TEST_ASSERT_EQUAL_FLOAT(25, state->getHistory(0).distance);
+  TEST_ASSERT_EQUAL(1, state->alertCount);
+  TEST_ASSERT_NOT_EQUAL(0, state->lastAlertTime);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_cold_boot_discards_snapshot);
+  RUN_TEST(test_warm_boot_restores_samples_and_counters);
+  RUN_TEST(test_restore_keeps_sample_age);
+  RUN_TEST(test_ring_keeps_newest_slots);
+  RUN_TEST(test_any_flipped_byte_is_caught);
+  RUN_TEST(test_reset_during_header_write_keeps_previous_copy);
+  return UNITY_END();
+}
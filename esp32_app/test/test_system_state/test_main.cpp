@@ -0,0 +1,133 @@
+// SystemState: the history ring, averages, detection counts and uptime text
+//   pio test -e native -f test_system_state
+
+#include <Arduino.h>
+#include <unity.h>
+#include <memory>
+#include "config.h"
+#include "state.h"
+
+static const int HISTORY_SLOTS = 100;  // SystemState::HISTORY_SIZE
+
+static SensorData reading(float distance, bool detected = false) {
+  SensorData data;
+  data.distance = distance;
+  data.timestamp = millis();
+  data.object_detected = detected;
+  return data;
+}
+
+static std::unique_ptr<SystemState> state;
+
+void setUp() {
+  VirtualClock::set(0);
+  initConfig();
+  state.reset(new SystemState());
+}
+
+void tearDown() {
+  state.reset();
+}
+
+static void test_history_is_newest_first() {
+  for (int i = 1; i <= 3; i++) state->addToHistory(reading(10 * i));
+  TEST_ASSERT_EQUAL(3, state->getHistoryCount());
+  TEST_ASSERT_EQUAL(3, state->sampleCount);
+  TEST_ASSERT_EQUAL_FLOAT(30, state->getHistory(0).distance);
+  TEST_ASSERT_EQUAL_FLOAT(10, state->getHistory(2).distance);
+
+  // Out of range gives an empty reading rather than a stale slot
+  TEST_ASSERT_EQUAL_FLOAT(-1, state->getHistory(3).distance);
+  TEST_ASSERT_EQUAL_STRING("Invalid Index", state->getHistory(-1).status.c_str());
+}
+
+static void test_history_keeps_newest_slots() {
+  for (int i = 1; i <= HISTORY_SLOTS + 25; i++) state->addToHistory(reading(i));
+  TEST_ASSERT_EQUAL(HISTORY_SLOTS, state->getHistoryCount());
+  TEST_ASSERT_EQUAL(HISTORY_SLOTS + 25, state->sampleCount);
+  TEST_ASSERT_EQUAL_FLOAT(HISTORY_SLOTS + 25, state->getHistory(0).distance);
+  TEST_ASSERT_EQUAL_FLOAT(26, state->getHistory(HISTORY_SLOTS - 1).distance);
+}
+
+static void test_out_of_range_readings_are_not_kept() {
+  state->addToHistory(reading(0));
+  state->addToHistory(reading(-5));
+  state->addToHistory(reading(400));
+  state->addToHistory(reading(399.5));
+  TEST_ASSERT_EQUAL(1, state->getHistoryCount());
+  TEST_ASSERT_EQUAL(1, state->sampleCount);
+  TEST_ASSERT_EQUAL_FLOAT(399.5, state->getHistory(0).distance);
+}
+
+static void test_update_data_sets_current_and_history() {
+  state->updateData(reading(120));
+  TEST_ASSERT_EQUAL_FLOAT(120, state->currentData.distance);
+  TEST_ASSERT_EQUAL(1, state->getHistoryCount());
+
+  // An invalid reading still becomes current, but stays out of the history
+  state->updateData(reading(0));
+  TEST_ASSERT_EQUAL_FLOAT(0, state->currentData.distance);
+  TEST_ASSERT_EQUAL(1, state->getHistoryCount());
+}
+
+static void test_average_over_newest_samples() {
+  for (float d : {100.0f, 50.0f, 20.0f, 30.0f}) state->addToHistory(reading(d));
+  TEST_ASSERT_EQUAL_FLOAT(25, state->getAverageDistance(2));
+  TEST_ASSERT_EQUAL_FLOAT(50, state->getAverageDistance(4));
+
+  // More than the history holds, or none: the current reading
+  state->currentData.distance = 77;
+  TEST_ASSERT_EQUAL_FLOAT(77, state->getAverageDistance(5));
+  TEST_ASSERT_EQUAL_FLOAT(77, state->getAverageDistance(0));
+}
+
+static void test_detection_count_by_age() {
+  state->addToHistory(reading(20, true));   // t=0
+  VirtualClock::set(30 * 1000000ULL);
+  state->addToHistory(reading(25, true));   // t=30s
+  state->addToHistory(reading(200, false));
+  VirtualClock::set(65 * 1000000ULL);
+  state->addToHistory(reading(30, true));   // t=65s
+
+  TEST_ASSERT_EQUAL(3, state->getDetectionCount(65));
+  TEST_ASSERT_EQUAL(2, state->getDetectionCount(60));
+  TEST_ASSERT_EQUAL(1, state->getDetectionCount(10));
+  TEST_ASSERT_EQUAL(0, state->getDetectionCount(0));
+}
+
+static void test_pi_connection_times_out() {
+  bootConfig().raspberry_pi.connection_timeout = 10000;
+  VirtualClock::set(20 * 1000000ULL);
+  state->lastPiHeartbeat = millis();
+  TEST_ASSERT_TRUE(state->isPiConnected());
+  VirtualClock::set(29999 * 1000ULL);
+  TEST_ASSERT_TRUE(state->isPiConnected());
+  VirtualClock::set(30 * 1000000ULL);
+  TEST_ASSERT_FALSE(state->isPiConnected());
+}
+
+static void test_formatted_uptime() {
+  state->systemUptime = 42;
+  TEST_ASSERT_EQUAL_STRING("42s", state->getFormattedUptime().c_str());
+  state->systemUptime = 3 * 60 + 5;
+  TEST_ASSERT_EQUAL_STRING("3m 5s", state->getFormattedUptime().c_str());
+  state->systemUptime = 2 * 3600 + 60;
+  TEST_ASSERT_EQUAL_STRING("2h 1m 0s", state->getFormattedUptime().c_str());
+  state->systemUptime = 3 * 86400 + 4 * 3600 + 59;
+  TEST_ASSERT_EQUAL_STRING("3d 4h 0m", state->getFormattedUptime().c_str());
+  state->systemUptime = 31536000UL + 10 * 86400;
+  TEST_ASSERT_EQUAL_STRING("1y 10d", state->getFormattedUptime().c_str());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_history_is_newest_first);
+  RUN_TEST(test_history_keeps_newest_slots);
+  RUN_TEST(test_out_of_range_readings_are_not_kept);
+  RUN_TEST(test_update_data_sets_current_and_history);
+  RUN_TEST(test_average_over_newest_samples);
+  RUN_TEST(test_detection_count_by_age);
+  RUN_TEST(test_pi_connection_times_out);
+  RUN_TEST(test_formatted_uptime);
+  return UNITY_END();
+}
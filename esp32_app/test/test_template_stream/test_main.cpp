@@ -0,0 +1,74 @@
+// TemplateStream: placeholders, includes, list items cut across reads and
+// braces that don't open a placeholder
+//   pio test -e native -f test_template_stream
+
+#include <Arduino.h>
+#include <unity.h>
+#include <string>
+#include "HtmlPage/TemplateStream.h"
+
+static const TemplateStream::Include INCLUDES[] = {
+  {"HEADER", "<h1>{{TITLE}}</h1>"},
+};
+
+static bool fill(const char* name, uint16_t index, Print& out, const void*) {
+  if (strcmp(name, "TITLE") == 0) {
+    out.print("Sensor");
+    return false;
+  }
+  if (strcmp(name, "ITEMS") == 0) {
+    out.print("<li>item ");
+    out.print(index);
+    out.print("</li>");
+    return index < 2;
+  }
+  return false;
+}
+
+static std::string render(const char* text, size_t chunk) {
+  TemplateStream stream(text, INCLUDES, 1, fill);
+  std::string out;
+  uint8_t buffer[64];
+  while (size_t n = stream.read(buffer, chunk)) out.append((const char*)buffer, n);
+  TEST_ASSERT_TRUE(stream.finished());
+  return out;
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_placeholders_and_includes() {
+  TEST_ASSERT_EQUAL_STRING("<h1>Sensor</h1><p>Sensor</p>",
+                           render("{{HEADER}}<p>{{TITLE}}</p>", 64).c_str());
+  TEST_ASSERT_EQUAL_STRING("[]", render("[{{UNKNOWN}}]", 64).c_str());
+}
+
+static void test_list_items_cut_across_reads() {
+  const char* expected = "<ul><li>item 0</li><li>item 1</li><li>item 2</li></ul>";
+  for (size_t chunk = 1; chunk <= 64; chunk++) {
+    TEST_ASSERT_EQUAL_STRING(expected, render("<ul>{{ITEMS}}</ul>", chunk).c_str());
+  }
+}
+
+static void test_unclosed_braces_are_text() {
+  // Script in a template: no "}}" close enough to be a placeholder name
+  const char* script = "if (a) {{ b(); } c = {x: 1}; }";
+  TEST_ASSERT_EQUAL_STRING(script, render(script, 64).c_str());
+  TEST_ASSERT_EQUAL_STRING(script, render(script, 3).c_str());
+  TEST_ASSERT_EQUAL_STRING("tail {{", render("tail {{", 64).c_str());
+  TEST_ASSERT_EQUAL_STRING("{{{", render("{{{", 1).c_str());
+}
+
+static void test_name_longer_than_limit_is_text() {
+  const char* text = "{{THIS_NAME_IS_FAR_TOO_LONG_TO_FILL}}{{TITLE}}";
+  TEST_ASSERT_EQUAL_STRING("{{THIS_NAME_IS_FAR_TOO_LONG_TO_FILL}}Sensor", render(text, 64).c_str());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_placeholders_and_includes);
+  RUN_TEST(test_list_items_cut_across_reads);
+  RUN_TEST(test_unclosed_braces_are_text);
+  RUN_TEST(test_name_longer_than_limit_is_text);
+  return UNITY_END();
+}
@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+"""Decode binary trace records from the ESP32.
+
+Fetch them straight from the device, or decode a saved dump:
+
+    python3 esp32_app/trace_decode.py --url http://<esp32-ip>
+    curl -o trace.bin "http://<esp32-ip>/api/logs?format=bin"
+    python3 esp32_app/trace_decode.py trace.bin
+
+Event formats are read from include/trace_events.h, so the decoder stays in
+step with the firmware it was checked out with. Records are 32 bytes:
+time (u32 ms), id (u16), level (u8), core (u8), two u32 args, 16 text bytes.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+import urllib.request
+
+RECORD = struct.Struct("<IHBB2I16s")
+LEVELS = "DIWE"
+EVENTS_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), "include", "trace_events.h")
+
+
+def load_formats(path):
+    pattern = re.compile(r'^TRACE_EVENT\(\s*(\w+)\s*,\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+    formats = []
+    with open(path) as f:
+        for line in f:
+            match = pattern.match(line.strip())
+            if match:
+                formats.append(match.group(3).encode().decode("unicode_escape"))
+    return formats
+
+
+def render(fmt, args, text):
+    out = []
+    used = 0
+    i = 0
+    while i < len(fmt):
+        c = fmt[i]
+        if c != "%" or i + 1 >= len(fmt):
+            out.append(c)
+            i += 1
+            continue
+        conv = fmt[i + 1]
+        i += 2
+        arg = args[used] if used < 2 else 0
+        if conv == "d":
+            out.append(str(struct.unpack("<i", struct.pack("<I", arg))[0]))
+        elif conv == "u":
+            out.append(str(arg))
+        elif conv == "x":
+            out.append("%x" % arg)
+        elif conv == "c":
+            out.append(chr(arg & 0xFF))
+        elif conv == "f":
+            out.append("%.1f" % struct.unpack("<f", struct.pack("<I", arg))[0])
+        elif conv == "s":
+            out.append(text)
+            continue
+        elif conv == "%":
+            out.append("%")
+            continue
+        used += 1
+    return "".join(out)
+
+
+def decode(data, formats):
+    for offset in range(0, len(data) - len(data) % RECORD.size, RECORD.size):
+        time_ms, event, level, core, a0, a1, raw = RECORD.unpack_from(data, offset)
+        text = raw.split(b"\0", 1)[0].decode("utf-8", "replace")
+        fmt = formats[event] if event < len(formats) else "unknown trace event %u %u %s"
+        yield "[%7d.%03d] %s%d %s" % (time_ms // 1000, time_ms % 1000, LEVELS[level & 3], core,
+                                     render(fmt, (a0, a1), text))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("dump", nargs="?", help="file saved from /api/logs?format=bin")
+    parser.add_argument("--url", help="base URL of the ESP32, e.g. http://192.168.4.1")
+    parser.add_argument("--events", default=EVENTS_H, help="path to trace_events.h")
+    args = parser.parse_args()
+
+    if args.url:
+        with urllib.request.urlopen(args.url.rstrip("/") + "/api/logs?format=bin", timeout=10) as r:
+            data = r.read()
+    elif args.dump:
+        with open(args.dump, "rb") as f:
+            data = f.read()
+    else:
+        parser.error("give a dump file or --url")
+
+    for line in decode(data, load_formats(args.events)):
+        print(line)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
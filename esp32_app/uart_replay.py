@@ -0,0 +1,214 @@
+#!/usr/bin/env python3
+"""Record, synthesize and replay Pi -> ESP32 UART traffic.
+
+Captures are text, one received line per line after a header:
+
+    # pi-uart-capture v1
+    <ms since capture start> <line as received>
+
+Record what the Pi sends (USB-UART adapter on the Pi's TX line), or make a
+synthetic capture at a chosen sample rate:
+
+    python3 esp32_app/uart_replay.py record /dev/ttyUSB0 -o walk.txt --seconds 60
+    python3 esp32_app/uart_replay.py synth --rate 50 --seconds 60 -o 50hz.txt
+
+Replay it at 1x, 10x or maximum speed into a serial port wired to the
+ESP32, or into a pty read by the native build (started for you with --run):
+
+    python3 esp32_app/uart_replay.py play walk.txt --port /dev/ttyUSB0 --speed 10
+    python3 esp32_app/uart_replay.py play walk.txt --pty --speed max \\
+        --run ".pio/build/native/program --uart {pty} --quiet"
+
+The writer reports the rate it offered, the rate it achieved and how far it
+fell behind the capture's schedule. It falls behind when the receiver stops
+draining the line (a full pty or UART buffer blocks the writer). For the
+firmware's own measurement, upload the capture and replay it on the device:
+
+    curl -F capture=@walk.txt http://<esp32-ip>/api/replay
+    curl -X POST "http://<esp32-ip>/api/command?command=replay&arg=10"
+"""
+
+import argparse
+import math
+import os
+import random
+import shlex
+import subprocess
+import sys
+import time
+
+HEADER = "# pi-uart-capture v1"
+BEHIND_MS = 100  # same threshold as UartReplay on the device
+
+
+def read_capture(path):
+    records = []
+    with open(path) as f:
+        first = f.readline().rstrip("\r\n")
+        if first != HEADER:
+            sys.exit("%s: not a capture file (expected %r)" % (path, HEADER))
+        for line in f:
+            line = line.rstrip("\r\n")
+            if not line or line.startswith("#"):
+                continue
+            at, _, text = line.partition(" ")
+            records.append((int(at), text))
+    return records
+
+
+def write_capture(out, records, comment=None):
+    out.write(HEADER + "\n")
+    if comment:
+        out.write("# %s\n" % comment)
+    for at, text in records:
+        out.write("%d %s\n" % (at, text))
+
+
+def open_serial(port, baud):
+    try:
+        import serial
+    except ImportError:
+        sys.exit("pyserial is needed for serial ports: pip install pyserial")
+    return serial.Serial(port, baud, timeout=0.1)
+
+
+def cmd_record(args):
+    port = open_serial(args.port, args.baud)
+    out = open(args.output, "w") if args.output else sys.stdout
+    out.write(HEADER + "\n# recorded from %s at %d baud\n" % (args.port, args.baud))
+    start = time.monotonic()
+    count = 0
+    try:
+        while not args.seconds or time.monotonic() - start < args.seconds:
+            raw = port.readline()
+            if not raw.endswith(b"\n"):
+                continue
+            at = int((time.monotonic() - start) * 1000)
+            out.write("%d %s\n" % (at, raw.rstrip(b"\r\n").decode("utf-8", "replace")))
+            count += 1
+    except KeyboardInterrupt:
+        pass
+    out.flush()
+    print("recorded %d lines" % count, file=sys.stderr)
+
+
+def cmd_synth(args):
+    # Same packets as the Pi's communication.py: distance, mode, alert, last 5 readings
+    rng = random.Random(args.seed)
+    history = []
+    records = []
+    period = 1000.0 / args.rate
+    for i in range(int(args.seconds * args.rate)):
+        t = i * period / 1000.0
+        distance = 30 + 20 * (1 + math.sin(t)) / 2 + rng.uniform(-0.5, 0.5)
+        history = (history + [distance])[-5:]
+        alert = int(distance < args.threshold)
+        packet = '{"d": %.2f, "m": %d, "a": %d, "h": [%s]}' % (
+            distance, int(t // 10) % 3, alert, ", ".join("%.1f" % h for h in history))
+        records.append((int(i * period), packet))
+        if args.heartbeat and i % max(int(args.rate * 5), 1) == 0:
+            records.append((int(i * period), "HEARTBEAT:1"))
+    out = open(args.output, "w") if args.output else sys.stdout
+    write_capture(out, records, "synthetic, %g Hz for %g s" % (args.rate, args.seconds))
+    out.flush()
+
+
+def cmd_play(args):
+    records = read_capture(args.capture)
+    if not records:
+        sys.exit("empty capture")
+    speed = 0.0 if args.speed == "max" else float(args.speed)
+
+    child = None
+    if args.pty:
+        master, slave = os.openpty()
+        name = os.ttyname(slave)
+        write = lambda data: os.write(master, data)
+        print("replaying into %s" % name, file=sys.stderr)
+        if args.run:
+            child = subprocess.Popen(shlex.split(args.run.replace("{pty}", name)))
+            time.sleep(args.settle)
+    else:
+        port = open_serial(args.port, args.baud)
+        write = port.write
+
+    span = records[-1][0] - records[0][0]
+    start = time.monotonic()
+    max_lag = 0.0
+    behind = None
+    for i, (at, text) in enumerate(records):
+        if speed > 0:
+            due = start + (at - records[0][0]) / 1000.0 / speed
+            wait = due - time.monotonic()
+            if wait > 0:
+                time.sleep(wait)
+            lag = (time.monotonic() - due) * 1000
+            max_lag = max(max_lag, lag)
+            if behind is None and lag > BEHIND_MS:
+                offered = i * 1000.0 * speed / max(at - records[0][0], 1)
+                behind = (i + 1, offered)
+        data = (text + "\n").encode()
+        while data:
+            data = data[write(data):]
+    elapsed = time.monotonic() - start
+
+    if args.pty:
+        # Let the reader drain what is buffered before it sees the hangup
+        time.sleep(args.settle)
+        os.close(master)
+        os.close(slave)
+    if child:
+        child.wait()
+
+    achieved = len(records) / elapsed if elapsed else float("inf")
+    print("%d lines in %.2fs: %.1f lines/s" % (len(records), elapsed, achieved), file=sys.stderr)
+    if speed > 0 and span:
+        print("offered %.1f lines/s (%gx), lag max %.0f ms" %
+              (len(records) * 1000.0 * speed / span, speed, max_lag), file=sys.stderr)
+        if behind:
+            print("fell behind at line %d (%.1f lines/s)" % behind, file=sys.stderr)
+        else:
+            print("kept up", file=sys.stderr)
+    if not args.pty:
+        need = sum(len(t) + 1 for _, t in records) * 10 / (elapsed or 1)
+        print("line needs %.0f baud at this rate (port: %d)" % (need, args.baud), file=sys.stderr)
+    return 1 if behind else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("record", help="record a capture from a serial port")
+    p.add_argument("port")
+    p.add_argument("--baud", type=int, default=115200)
+    p.add_argument("--seconds", type=float, default=0, help="stop after this long (default: Ctrl-C)")
+    p.add_argument("-o", "--output")
+    p.set_defaults(func=cmd_record)
+
+    p = sub.add_parser("synth", help="generate a capture like the Pi's simulation mode")
+    p.add_argument("--rate", type=float, default=10, help="packets per second")
+    p.add_argument("--seconds", type=float, default=60)
+    p.add_argument("--threshold", type=float, default=40, help="alert below this distance")
+    p.add_argument("--heartbeat", action="store_true", help="add HEARTBEAT:1 every 5 s")
+    p.add_argument("--seed", type=int, default=1)
+    p.add_argument("-o", "--output")
+    p.set_defaults(func=cmd_synth)
+
+    p = sub.add_parser("play", help="replay a capture into a serial port or a pty")
+    p.add_argument("capture")
+    target = p.add_mutually_exclusive_group(required=True)
+    target.add_argument("--port", help="serial port wired to the ESP32's UART")
+    target.add_argument("--pty", action="store_true", help="create a pty (for the native build)")
+    p.add_argument("--baud", type=int, default=115200)
+    p.add_argument("--speed", default="1", help="1, 10, ... or max")
+    p.add_argument("--run", help="command to start on the pty; {pty} is replaced by its path")
+    p.add_argument("--settle", type=float, default=0.5, help="seconds to wait around a --run reader")
+    p.set_defaults(func=cmd_play)
+
+    args = parser.parse_args()
+    return args.func(args) or 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
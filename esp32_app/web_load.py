@@ -0,0 +1,245 @@
+#!/usr/bin/env python3
+"""Overload the ESP32 web server and check that admission control holds up.
+
+Opens more concurrent requests than the firmware admits (WEB_MAX_IN_FLIGHT)
+with a mix of page loads, API polls, metrics and exports, then reports per
+endpoint throughput, latency percentiles and how many requests were shed
+with 503:
+
+    python3 esp32_app/web_load.py http://<esp32-ip> --clients 12 --seconds 30
+    python3 esp32_app/web_load.py http://<esp32-ip> --mix status=6,dashboard=4,export=2
+
+Before the load it counts samples per second from /api/status for
+--baseline seconds, then does the same from a separate poller while the
+load runs: Pi ingestion must not slow down because the web server is busy.
+At the end it prints the firmware's own counters from /api/web.
+
+Shed clients wait for Retry-After before their next request, as a browser
+would; --no-backoff retries at once to find where shedding stops helping.
+Exits with status 1 when ingestion dropped by more than --max-ingest-drop
+percent or the p99 latency of admitted API and metrics requests is over
+--api-p99-ms.
+"""
+
+import argparse
+import json
+import random
+import sys
+import threading
+import time
+import urllib.error
+import urllib.request
+
+ENDPOINTS = {
+    "dashboard": ("/", "page"),
+    "config_page": ("/config", "page"),
+    "history_page": ("/history", "page"),
+    "status": ("/api/status", "api"),
+    "history": ("/api/history", "api"),
+    "chart": ("/api/chart", "api"),
+    "config": ("/api/config", "api"),
+    "heap": ("/api/heap", "metrics"),
+    "web": ("/api/web", "metrics"),
+    "export": ("/api/export?include=samples", "bulk"),
+    "logs": ("/api/logs?n=64", "bulk"),
+}
+
+DEFAULT_MIX = "status=5,history=2,dashboard=3,config_page=1,heap=1,export=1"
+
+
+class Stats:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.latencies = {}   # endpoint -> [seconds] of 2xx responses
+        self.codes = {}       # endpoint -> {status: count}
+        self.retry_after = {}  # endpoint -> [seconds asked]
+
+    def add(self, name, status, seconds, retry_after):
+        with self.lock:
+            codes = self.codes.setdefault(name, {})
+            codes[status] = codes.get(status, 0) + 1
+            if 200 <= status < 300:
+                self.latencies.setdefault(name, []).append(seconds)
+            if retry_after is not None:
+                self.retry_after.setdefault(name, []).append(retry_after)
+
+
+def fetch(url, timeout, accept_gzip=True):
+    """Whole response read; returns (status, Retry-After or None, body)."""
+    request = urllib.request.Request(url)
+    if accept_gzip:
+        request.add_header("Accept-Encoding", "gzip")
+    try:
+        with urllib.request.urlopen(request, timeout=timeout) as response:
+            return response.status, None, response.read()
+    except urllib.error.HTTPError as error:
+        retry = error.headers.get("Retry-After")
+        error.read()
+        return error.code, int(retry) if retry and retry.isdigit() else None, b""
+    except (urllib.error.URLError, OSError):
+        return 0, None, b""  # refused, reset or timed out
+
+
+def parse_mix(text):
+    mix = []
+    for part in text.split(","):
+        name, _, weight = part.partition("=")
+        if name not in ENDPOINTS:
+            sys.exit("unknown endpoint %r (choose from %s)" % (name, ", ".join(ENDPOINTS)))
+        mix.append((name, int(weight or 1)))
+    return mix
+
+
+def client(base, mix, stats, stop, args):
+    names = [name for name, _ in mix]
+    weights = [weight for _, weight in mix]
+    rng = random.Random()
+    while not stop.is_set():
+        name = rng.choices(names, weights)[0]
+        start = time.monotonic()
+        status, retry, _ = fetch(base + ENDPOINTS[name][0], args.timeout)
+        stats.add(name, status, time.monotonic() - start, retry)
+        if status == 503 and retry and not args.no_backoff:
+            stop.wait(retry)
+        elif args.think > 0:
+            stop.wait(rng.uniform(0, 2 * args.think))
+
+
+def sample_count(base, timeout):
+    status, _, body = fetch(base + "/api/status", timeout, accept_gzip=False)
+    if status != 200:
+        return None
+    try:
+        return json.loads(body)["sample_count"]
+    except (ValueError, KeyError):
+        return None
+
+
+def ingest_rate(base, seconds, timeout, stop=None, result=None):
+    """Samples per second over `seconds`, from /api/status sample_count."""
+    first, first_time = None, None
+    last, last_time = None, None
+    deadline = time.monotonic() + seconds
+    while time.monotonic() < deadline and not (stop and stop.is_set()):
+        count = sample_count(base, timeout)
+        if count is not None:
+            now = time.monotonic()
+            if first is None:
+                first, first_time = count, now
+            last, last_time = count, now
+        time.sleep(1.0)
+    rate = None
+    if first is not None and last_time > first_time:
+        rate = (last - first) / (last_time - first_time)
+    if result is not None:
+        result.append(rate)
+    return rate
+
+
+def percentile(values, p):
+    values = sorted(values)
+    index = min(len(values) - 1, int(round(p / 100.0 * (len(values) - 1))))
+    return values[index]
+
+
+def report(stats, mix, seconds):
+    print("%-13s %6s %8s %8s %8s %8s %6s %6s %6s" %
+          ("endpoint", "ok", "ok/s", "p50 ms", "p95 ms", "p99 ms", "503", "other", "retry"))
+    worst_api_p99 = 0.0
+    for name, _ in mix:
+        codes = stats.codes.get(name, {})
+        latencies = stats.latencies.get(name, [])
+        ok = len(latencies)
+        shed = codes.get(503, 0)
+        other = sum(count for status, count in codes.items() if status != 503 and not 200 <= status < 300)
+        retries = stats.retry_after.get(name, [])
+        if ok:
+            p50, p95, p99 = (percentile(latencies, p) * 1000 for p in (50, 95, 99))
+            if ENDPOINTS[name][1] in ("api", "metrics"):
+                worst_api_p99 = max(worst_api_p99, p99)
+            timing = "%8.1f %8.1f %8.1f" % (p50, p95, p99)
+        else:
+            timing = "%8s %8s %8s" % ("-", "-", "-")
+        print("%-13s %6d %8.1f %s %6d %6d %6s" %
+              (name, ok, ok / seconds, timing, shed, other,
+               "%.0fs" % (sum(retries) / len(retries)) if retries else "-"))
+    return worst_api_p99
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("base", help="device URL, e.g. http://192.168.4.1")
+    parser.add_argument("--clients", type=int, default=12, help="concurrent clients (default 12)")
+    parser.add_argument("--seconds", type=float, default=30, help="load duration (default 30)")
+    parser.add_argument("--mix", default=DEFAULT_MIX, help="endpoint=weight,... (default %s)" % DEFAULT_MIX)
+    parser.add_argument("--think", type=float, default=0.0, help="mean pause between requests per client, s")
+    parser.add_argument("--timeout", type=float, default=10.0, help="per-request timeout, s")
+    parser.add_argument("--baseline", type=float, default=10.0, help="idle ingestion measurement, s (0 skips)")
+    parser.add_argument("--no-backoff", action="store_true", help="ignore Retry-After")
+    parser.add_argument("--max-ingest-drop", type=float, default=5.0, help="allowed ingestion slowdown, %%")
+    parser.add_argument("--api-p99-ms", type=float, default=0, help="fail above this API/metrics p99 (0: off)")
+    args = parser.parse_args()
+
+    base = args.base.rstrip("/")
+    mix = parse_mix(args.mix)
+
+    idle_rate = None
+    if args.baseline > 0:
+        idle_rate = ingest_rate(base, args.baseline, args.timeout)
+        if idle_rate is None:
+            sys.exit("%s/api/status did not answer; is the device up?" % base)
+        print("idle: %.1f samples/s" % idle_rate)
+
+    stats = Stats()
+    stop = threading.Event()
+    loaded = []
+    poller = threading.Thread(target=ingest_rate, args=(base, args.seconds, args.timeout, stop, loaded))
+    workers = [threading.Thread(target=client, args=(base, mix, stats, stop, args))
+               for _ in range(args.clients)]
+    started = time.monotonic()
+    poller.start()
+    for worker in workers:
+        worker.start()
+    time.sleep(args.seconds)
+    stop.set()
+    for worker in workers:
+        worker.join()
+    poller.join()
+    elapsed = time.monotonic() - started
+
+    print("load: %d clients for %.1f s" % (args.clients, elapsed))
+    worst_api_p99 = report(stats, mix, elapsed)
+
+    failed = False
+    load_rate = loaded[0] if loaded else None
+    if load_rate is None:
+        print("under load: /api/status never answered 200, ingestion not measured")
+    else:
+        print("under load: %.1f samples/s" % load_rate)
+        if idle_rate:
+            drop = 100.0 * (idle_rate - load_rate) / idle_rate
+            print("ingestion change: %+.1f%%" % -drop)
+            if drop > args.max_ingest_drop:
+                print("FAIL: ingestion dropped more than %.1f%%" % args.max_ingest_drop)
+                failed = True
+    if args.api_p99_ms and worst_api_p99 > args.api_p99_ms:
+        print("FAIL: API/metrics p99 %.1f ms over %.1f ms" % (worst_api_p99, args.api_p99_ms))
+        failed = True
+
+    status, _, body = fetch(base + "/api/web", args.timeout, accept_gzip=False)
+    if status == 200:
+        web = json.loads(body)
+        print("device: peak %d/%d in flight, arena peak %d/%d, %d busy" %
+              (web["peak_in_flight"], web["max_in_flight"], web["arena"]["peak"],
+               web["arena"]["slabs"], web["arena"]["busy"]))
+        for endpoint in web["endpoints"]:
+            if endpoint["served"] or endpoint["shed"]:
+                print("  %-13s served %6d  shed %6d  avg %4d ms  max %5d ms" %
+                      (endpoint["name"], endpoint["served"], endpoint["shed"],
+                       endpoint["avg_ms"], endpoint["max_ms"]))
+
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()